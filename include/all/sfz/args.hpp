@@ -23,6 +23,10 @@ struct callbacks;
 
 void parse(size_t argc, char* const* argv, const callbacks& callbacks);
 
+// Prints "<program>: <error>" to stderr, followed by any exceptions nested in `e`: parse() nests
+// the reason an argument was rejected in an exception naming the argument.
+void print_error(const char* program, const std::exception& e);
+
 struct callbacks {
     using get_value_f = std::function<pn::string_view()>;
 
@@ -0,0 +1,112 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_CHECKSUM_HPP_
+#define SFZ_CHECKSUM_HPP_
+
+#include <stdint.h>
+#include <pn/data>
+#include <sfz/digest.hpp>
+
+namespace sfz {
+
+// Checksums detect accidental corruption, as of a record on disk or a packet in transit, far more
+// cheaply than a cryptographic digest, but offer no protection against deliberate changes.  Each
+// has the interface of sha1, with a 32-bit integer as its digest, so each can be used with
+// file_digest() and tree_digest():
+//
+//     crc32c c;
+//     c.write(header);
+//     c.write(body);
+//     uint32_t sum = c.compute();
+//
+//     uint32_t file_sum = file_digest<crc32c>("data");
+
+// Computes the CRC-32C (Castagnoli) of some sequence of bytes, as used by iSCSI, ext4, and
+// many storage formats.  On x86, small writes use the SSE4.2 crc32 instruction, and large ones
+// are folded with carry-less multiplication (PCLMULQDQ), 64 bytes at a time.
+class crc32c {
+  public:
+    typedef uint32_t digest;
+
+    // Creates an instance in initial state, with the checksum of no bytes.
+    crc32c() { reset(); }
+
+    // Resets the object to its initial state, as if write() had never been called.
+    void reset() { _state = 0xffffffff; }
+
+    // Adds data in `input` to the current content.
+    // @param [in] input    The data to add to the checksum.
+    void write(pn::data_view input);
+    template <typename... arguments>
+    void write(const arguments&... args);
+
+    // Returns the checksum of the current content.
+    digest compute() const { return ~_state; }
+
+  private:
+    uint32_t _state;
+};
+
+// Computes the CRC-32 of some sequence of bytes, with the polynomial of zlib, gzip, PNG, and
+// Ethernet.  On x86, large writes are folded with carry-less multiplication, as for crc32c; there
+// is no instruction for this polynomial.
+class crc32 {
+  public:
+    typedef uint32_t digest;
+
+    crc32() { reset(); }
+    void reset() { _state = 0xffffffff; }
+    void write(pn::data_view input);
+    template <typename... arguments>
+    void write(const arguments&... args);
+    digest compute() const { return ~_state; }
+
+  private:
+    uint32_t _state;
+};
+
+// Computes the Adler-32 checksum of some sequence of bytes, as used by zlib.  It is faster to
+// compute than a CRC, but weaker, especially for short inputs.  On x86, large writes are summed
+// with AVX2 or SSSE3, 32 bytes at a time.
+class adler32 {
+  public:
+    typedef uint32_t digest;
+
+    adler32() { reset(); }
+    void reset() {
+        _a = 1;
+        _b = 0;
+    }
+    void write(pn::data_view input);
+    template <typename... arguments>
+    void write(const arguments&... args);
+    digest compute() const { return (_b << 16) | _a; }
+
+  private:
+    uint32_t _a;  // 1 plus the sum of the bytes, modulo 65521.
+    uint32_t _b;  // The sum of each byte's value of _a, modulo 65521.
+};
+
+// Implementation details follow.
+
+template <typename... arguments>
+void crc32c::write(const arguments&... args) {
+    digest_write::write_all(&digest_write::write_data<crc32c>, this, args...);
+}
+
+template <typename... arguments>
+void crc32::write(const arguments&... args) {
+    digest_write::write_all(&digest_write::write_data<crc32>, this, args...);
+}
+
+template <typename... arguments>
+void adler32::write(const arguments&... args) {
+    digest_write::write_all(&digest_write::write_data<adler32>, this, args...);
+}
+
+}  // namespace sfz
+
+#endif  // SFZ_CHECKSUM_HPP_
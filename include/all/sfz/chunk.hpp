@@ -0,0 +1,65 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_CHUNK_HPP_
+#define SFZ_CHUNK_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pn/data>
+#include <pn/string>
+#include <sfz/digest.hpp>
+#include <vector>
+
+namespace sfz {
+
+struct chunk_options {
+    // Every chunk but the last is at least `min_size` bytes and at most `max_size`.  Chunk sizes
+    // cluster around `avg_size`, rounded down to a power of two.  0 < min_size <= avg_size <=
+    // max_size.
+    size_t min_size = 16 << 10;
+    size_t avg_size = 64 << 10;
+    size_t max_size = 256 << 10;
+
+    // The number of threads to search for boundaries and hash chunks with.  0 means one per
+    // hardware thread.
+    int threads = 0;
+};
+
+// A part of some data, as split by chunk_data().
+struct chunk {
+    uint64_t     offset;
+    uint64_t     size;
+    sha1::digest digest;  // The sha1 digest of the chunk's bytes.
+};
+
+// Splits data into content-defined chunks, with FastCDC.  Where chunk boundaries fall depends
+// only on the bytes near them, so inserting or removing bytes in one place moves the boundaries
+// near it, but leaves the chunks elsewhere unchanged.  Identical content in two versions of a
+// file will then mostly be split into identical chunks, which can be stored once.
+//
+// Boundaries are found with a gear hash over a window of the last 64 bytes.  A boundary falls
+// after any byte at which the hash matches a mask; following FastCDC's normalized chunking, the
+// mask is stricter before `avg_size` bytes than after it, which keeps sizes close to average.
+// Chunks are cut at `max_size` if no boundary is found before.
+//
+// @param [in] data     The data to split.
+// @param [in] options  How to split it.
+// @returns             The chunks, in order.  They cover all of `data`, without overlapping.
+// @throws std::runtime_error if the sizes in `options` are invalid.
+std::vector<chunk> chunk_data(pn::data_view data, const chunk_options& options = chunk_options());
+
+// Splits a file into chunks, as chunk_data() would split its content.  The file is mapped into
+// memory, so it must be a regular file of up to 2 GiB.
+//
+// @param [in] path     The path to the file, relative or absolute.
+// @param [in] options  How to split it.
+// @returns             The chunks, in order.
+std::vector<chunk> chunk_file(
+        pn::string_view path, const chunk_options& options = chunk_options());
+
+}  // namespace sfz
+
+#endif  // SFZ_CHUNK_HPP_
@@ -0,0 +1,79 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_DELTA_HPP_
+#define SFZ_DELTA_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pn/data>
+#include <pn/output>
+#include <pn/string>
+#include <sfz/digest.hpp>
+#include <vector>
+
+namespace sfz {
+
+// Transfers a new version of a file to a host that has an old version, as rsync does.  The host
+// computes a signature of its old file and sends it; from the signature and the new file, the
+// sender computes a delta, which copies the old file's blocks where they occur in the new one,
+// and includes literally only the bytes between them; the host applies the delta to its old file.
+//
+//     host:   sig = file_signature("data");                  // Sent to the sender.
+//     sender: d   = file_delta(sig, "data");                 // Sent to the host.
+//     host:   apply_delta(mapped_file("data").data(), d, out);
+
+// The signature of an old file: the checksums of each of its blocks.
+struct signature {
+    struct block {
+        uint32_t     weak;    // A rolling checksum, cheap to update as a window slides.
+        sha1::digest strong;  // The sha1 digest, to confirm a match of the weak checksum.
+    };
+
+    uint32_t           block_size;
+    uint64_t           size;    // The size of the old file.  Its last block may be short.
+    std::vector<block> blocks;  // Block i covers [i * block_size, (i + 1) * block_size).
+
+    // @returns             The signature in a portable format, to be sent to the sender.
+    pn::data data() const;
+
+    // Reads a signature written by data().
+    // @param [in] data     The signature's data.
+    // @throws std::runtime_error if `data` is not a valid signature.
+    static signature read(pn::data_view data);
+};
+
+// Computes the signature of old data.
+//
+// @param [in] data         The old data.
+// @param [in] block_size   The size of each block, or 0 to choose one from the size of the
+//                          data: larger blocks make smaller signatures, but find fewer matches.
+// @returns                 The signature.
+signature make_signature(pn::data_view data, size_t block_size = 0);
+signature file_signature(pn::string_view path, size_t block_size = 0);
+
+// Computes a delta from old data, of which `sig` is the signature, to new data.  Blocks of the
+// old data are found at any offset in the new data, not only at multiples of the block size.
+//
+// @param [in] sig          The signature of the old data.
+// @param [in] data         The new data.
+// @returns                 The delta, in a compact, portable format.
+pn::data make_delta(const signature& sig, pn::data_view data);
+pn::data file_delta(const signature& sig, pn::string_view path);
+
+// Applies a delta to old data, writing the new data to `out` as it is reconstructed.  The new
+// data's digest is checked against the one recorded in the delta.
+//
+// @param [in] old          The old data, of which the delta's signature was computed.
+// @param [in] delta        The delta, from make_delta().
+// @param [out] out         The output to write the new data to.
+// @throws std::runtime_error if the delta is invalid, refers to blocks that `old` doesn't have,
+//                          or the new data doesn't match its recorded digest, as when `old` isn't
+//                          the data whose signature the delta was computed from.
+void apply_delta(pn::data_view old, pn::data_view delta, pn::output& out);
+
+}  // namespace sfz
+
+#endif  // SFZ_DELTA_HPP_
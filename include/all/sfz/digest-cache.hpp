@@ -0,0 +1,107 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_DIGEST_CACHE_HPP_
+#define SFZ_DIGEST_CACHE_HPP_
+
+#include <stdint.h>
+#include <pn/string>
+#include <sfz/digest.hpp>
+#include <sfz/file.hpp>
+#include <sfz/os.hpp>
+
+namespace sfz {
+
+// A persistent cache of the results of hashing files, which lets file_digest() and tree_digest()
+// skip reading files which have not changed since they were last hashed.
+//
+// A file is identified by its device, inode, size, and modification and status change times, in
+// nanoseconds.  If any of these change, the file is assumed to have changed.  What is cached is
+// the state of a sha1 instance after a file is written to it, keyed by a digest of the file's
+// identity, its name, and the state before it was written.  Caching state rather than digests is
+// what allows tree_digest() to reuse results: its digest covers the content of every file, in
+// order, so hashing a file means moving from one state to the next.
+//
+// The cache is an open-addressing hash table in a memory-mapped file, so lookups make no system
+// calls.  Several processes and threads may use the same cache at once.  Each slot is guarded by a
+// sequence counter: readers treat a slot which is being written as a miss, and writers claim a
+// slot before writing it.  When a probe sequence is full, a new entry replaces an old one.  The
+// file uses the byte order of the host, and is not meant to be shared between machines.
+class digest_cache {
+  public:
+    // The identity of a file's content, for the purpose of deciding whether it has changed.
+    struct file_id {
+        uint64_t dev;
+        uint64_t ino;
+        uint64_t size;
+        int64_t  mtime_ns;
+        int64_t  ctime_ns;
+    };
+
+    // @returns             The identity of the file described by `st`.
+    static file_id id(const Stat& st);
+
+    // What a cached transition covers.  file_digest() caches the state after a file's content
+    // alone, starting from the initial state.  tree_digest() caches the state after a file's name
+    // and content, starting from the state before it.  The kind is part of the key, so that a path
+    // which is also the name of the first file in a tree can't find the other's result.
+    enum class transition : uint8_t {
+        file = 'f',
+        tree = 't',
+    };
+
+    // The default number of entries in a new cache; a cache with this capacity uses 32 MiB.
+    static const size_t kDefaultCapacity = 1 << 18;
+
+    // Opens the cache at `path`, creating it if it doesn't exist.
+    //
+    // @param [in] path     The path to the cache file, relative or absolute.
+    // @param [in] capacity The number of entries, if the cache is created.  Rounded up to a power
+    //                      of two.  The capacity of an existing cache is kept.
+    // @throws std::runtime_error if the cache couldn't be opened, or `path` is not a cache.
+    explicit digest_cache(pn::string_view path, size_t capacity = kDefaultCapacity);
+    digest_cache(const digest_cache&) = delete;
+
+    // @returns             The number of entries the cache can hold.
+    size_t capacity() const { return _capacity; }
+
+    // Looks up the result of writing a file to `sha`.
+    //
+    // @param [in,out] sha  The state before writing the file.  If found, replaced with the state
+    //                      after writing it.
+    // @param [in] kind     What was written, as it was passed to store().
+    // @param [in] name     The name of the file, as it was passed to store().
+    // @param [in] id       The identity of the file.
+    // @returns             true if the result was found.
+    bool find(sha1& sha, transition kind, pn::string_view name, const file_id& id) const;
+
+    // Records the result of writing a file to a sha1 instance.  Nothing is recorded for files
+    // modified in the last two seconds, as they could change again without changing `id`.
+    //
+    // @param [in] before   The state before writing the file.
+    // @param [in] kind     What was written.
+    // @param [in] name     The name of the file.
+    // @param [in] id       The identity of the file, determined before reading it.
+    // @param [in] after    The state after writing the file.
+    void store(
+            const sha1& before, transition kind, pn::string_view name, const file_id& id,
+            const sha1& after);
+
+  private:
+    struct slot;
+
+    slot* slots() const;
+
+    // Converts the state of `sha` to and from the words of a slot.
+    static void save(const sha1& sha, uint32_t* words);
+    static void load(sha1& sha, const uint32_t* words);
+
+    shared_mapped_file _file;
+    size_t             _capacity;
+};
+
+}  // namespace sfz
+
+#endif  // SFZ_DIGEST_CACHE_HPP_
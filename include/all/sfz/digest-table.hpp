@@ -0,0 +1,339 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_DIGEST_TABLE_HPP_
+#define SFZ_DIGEST_TABLE_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pn/data>
+#include <sfz/digest.hpp>
+#include <type_traits>
+#include <vector>
+
+namespace sfz {
+
+// Sets and maps of sha1 digests, for indexes with many millions of entries.
+//
+// They are open-addressing hash tables, stored flat: a byte of metadata per slot, then the keys,
+// then the values, each in one array, so there is no allocation per entry, and a lookup usually
+// touches two cache lines.  Slots are probed in groups of 16, with one SIMD comparison of the
+// group's metadata finding the slots which might hold a key.  A digest is already uniformly
+// distributed, so its own bits are the hash.
+//
+// The *_many() functions look up or insert many digests at once, prefetching the memory each
+// will touch, so that several cache misses are outstanding at a time rather than one.
+//
+// data() returns a table in a form that can be written to a file and mapped into memory by any
+// number of processes, to be searched in place with digest_set_view or digest_map_view.  It uses
+// the byte order of the host, and is not meant to be shared between machines.
+class digest_set {
+  public:
+    digest_set();
+
+    // @param [in] capacity The number of digests to make room for.
+    explicit digest_set(size_t capacity);
+
+    size_t size() const { return _size; }
+    bool   empty() const { return _size == 0; }
+
+    // Makes room for `count` digests in all, so that inserting them won't rehash.
+    void reserve(size_t count);
+
+    // Removes every digest, keeping the memory allocated.
+    void clear();
+
+    // @returns             true if `key` was added, or false if it was already present.
+    bool insert(const sha1::digest& key);
+
+    bool contains(const sha1::digest& key) const;
+
+    // @returns             true if `key` was removed, or false if it wasn't present.
+    bool erase(const sha1::digest& key);
+
+    // Inserts `count` digests from `keys`.
+    // @returns             The number which were added, not already present.
+    size_t insert_many(const sha1::digest* keys, size_t count);
+
+    // Sets found[i] to whether keys[i] is present, for each of `count` digests.
+    void contains_many(const sha1::digest* keys, size_t count, bool* found) const;
+
+    // Calls f(key) for each digest, in no particular order.
+    template <typename F>
+    void for_each(F f) const;
+
+    // @returns             The set, in the form read by digest_set_view.
+    pn::data data() const;
+
+  private:
+    template <typename T>
+    friend class digest_map;
+
+    // The index of the slot holding `key`, or npos if it isn't present.
+    size_t find(const sha1::digest& key) const;
+
+    // Inserts `key` if it isn't present, rehashing first if the table is full.  If it rehashes,
+    // and `moved` is not null, sets (*moved)[new_slot] to the old slot of each key that moved.
+    // @returns             The index of the slot holding `key`.
+    size_t insert(const sha1::digest& key, bool* inserted, std::vector<size_t>* moved);
+
+    // Grows the table to hold `count` digests, if it can't already.
+    // @returns             true if it rehashed.
+    bool reserve(size_t count, std::vector<size_t>* moved);
+    void rehash(size_t capacity, std::vector<size_t>* moved);
+
+    // Prefetches the memory that looking up keys[0, count) will touch.
+    void prefetch(const sha1::digest* keys, size_t count) const;
+
+    pn::data data(const void* values, size_t value_size) const;
+
+    std::vector<uint8_t>      _ctrl;  // Per slot: empty, deleted, or 7 bits of its key's hash.
+    std::vector<sha1::digest> _keys;
+    size_t                    _size;
+    size_t                    _growth_left;  // Empty slots which may yet be filled.
+};
+
+// A map from sha1 digests to values, stored as digest_set is, with the values in a parallel
+// array.  `T` must be default-constructible; for data(), it must be trivially copyable.
+template <typename T>
+class digest_map {
+  public:
+    digest_map() {}
+    explicit digest_map(size_t capacity) { reserve(capacity); }
+
+    size_t size() const { return _keys.size(); }
+    bool   empty() const { return _keys.empty(); }
+    void   reserve(size_t count);
+    void   clear();
+
+    // @returns             The value for `key`, default-constructed if `key` wasn't present.
+    T& operator[](const sha1::digest& key);
+
+    // Adds `key` with `value`, if `key` isn't present already.
+    // @returns             true if it was added.
+    bool insert(const sha1::digest& key, const T& value);
+
+    // @returns             The value for `key`, or null if it isn't present.
+    T*       find(const sha1::digest& key);
+    const T* find(const sha1::digest& key) const;
+
+    bool erase(const sha1::digest& key) { return _keys.erase(key); }
+
+    // Inserts keys[i] with values[i], for each of `count` keys.  Keys already present keep their
+    // values.
+    // @returns             The number which were added.
+    size_t insert_many(const sha1::digest* keys, const T* values, size_t count);
+
+    // Sets found[i] to the value for keys[i], or null, for each of `count` keys.  The pointers
+    // are valid until the map is next changed.
+    void find_many(const sha1::digest* keys, size_t count, const T** found) const;
+
+    // Calls f(key, value) for each entry, in no particular order.
+    template <typename F>
+    void for_each(F f) const;
+
+    // @returns             The map, in the form read by digest_map_view<T>.
+    pn::data data() const;
+
+  private:
+    void move_values(const std::vector<size_t>& moved);
+
+    digest_set     _keys;
+    std::vector<T> _values;
+};
+
+// A read-only digest_set in the form returned by data(), such as a mapped file.  The data isn't
+// copied, and must outlive the view.  Lookups are as fast as in a digest_set.
+class digest_set_view {
+  public:
+    // @param [in] data     A set or map from data().  The views of a map ignore its values.
+    // @throws std::runtime_error if `data` isn't a set or map from data().
+    explicit digest_set_view(pn::data_view data);
+
+    size_t size() const { return _size; }
+    bool   contains(const sha1::digest& key) const;
+    void   contains_many(const sha1::digest* keys, size_t count, bool* found) const;
+
+  private:
+    template <typename T>
+    friend class digest_map_view;
+
+    // As above, also checking that the values, if any, are `value_size` bytes each.
+    digest_set_view(pn::data_view data, size_t value_size);
+
+    size_t find(const sha1::digest& key) const;
+    void   find_many(const sha1::digest* keys, size_t count, size_t* slots) const;
+
+    size_t         _size;
+    size_t         _capacity;
+    const uint8_t* _ctrl;
+    const uint8_t* _keys;    // Each key is the 20 bytes of sha1::digest::data().
+    const uint8_t* _values;  // Aligned to 16 bytes, if the data is.
+};
+
+// A read-only digest_map<T> in the form returned by data(), such as a mapped file.
+template <typename T>
+class digest_map_view {
+  public:
+    // @throws std::runtime_error if `data` isn't a map from digest_map<T>::data(), or its values
+    //                      aren't the size of T.
+    explicit digest_map_view(pn::data_view data) : _set(data, sizeof(T)) {}
+
+    size_t   size() const { return _set.size(); }
+    const T* find(const sha1::digest& key) const;
+    void     find_many(const sha1::digest* keys, size_t count, const T** found) const;
+
+  private:
+    digest_set_view _set;
+};
+
+// Implementation details follow.
+
+namespace digest_table {
+
+const size_t npos = static_cast<size_t>(-1);
+
+}  // namespace digest_table
+
+template <typename F>
+void digest_set::for_each(F f) const {
+    for (size_t i = 0; i < _ctrl.size(); ++i) {
+        if (!(_ctrl[i] & 0x80)) {
+            f(_keys[i]);
+        }
+    }
+}
+
+template <typename T>
+void digest_map<T>::move_values(const std::vector<size_t>& moved) {
+    std::vector<T> values(moved.size());
+    for (size_t i = 0; i < moved.size(); ++i) {
+        if (moved[i] != digest_table::npos) {
+            values[i] = _values[moved[i]];
+        }
+    }
+    _values.swap(values);
+}
+
+template <typename T>
+void digest_map<T>::reserve(size_t count) {
+    std::vector<size_t> moved;
+    if (_keys.reserve(count, &moved)) {
+        move_values(moved);
+    }
+}
+
+template <typename T>
+void digest_map<T>::clear() {
+    _keys.clear();
+    _values.assign(_values.size(), T());
+}
+
+template <typename T>
+T& digest_map<T>::operator[](const sha1::digest& key) {
+    bool                inserted;
+    std::vector<size_t> moved;
+    const size_t        slot = _keys.insert(key, &inserted, &moved);
+    if (!moved.empty()) {
+        move_values(moved);
+    }
+    if (inserted) {
+        _values[slot] = T();  // The slot may hold the value of an erased key.
+    }
+    return _values[slot];
+}
+
+template <typename T>
+bool digest_map<T>::insert(const sha1::digest& key, const T& value) {
+    bool                inserted;
+    std::vector<size_t> moved;
+    const size_t        slot = _keys.insert(key, &inserted, &moved);
+    if (!moved.empty()) {
+        move_values(moved);
+    }
+    if (inserted) {
+        _values[slot] = value;
+    }
+    return inserted;
+}
+
+template <typename T>
+T* digest_map<T>::find(const sha1::digest& key) {
+    const size_t slot = _keys.find(key);
+    return (slot == digest_table::npos) ? nullptr : &_values[slot];
+}
+
+template <typename T>
+const T* digest_map<T>::find(const sha1::digest& key) const {
+    const size_t slot = _keys.find(key);
+    return (slot == digest_table::npos) ? nullptr : &_values[slot];
+}
+
+template <typename T>
+size_t digest_map<T>::insert_many(const sha1::digest* keys, const T* values, size_t count) {
+    reserve(size() + count);
+    size_t added = 0;
+    for (size_t i = 0; i < count; i += 16) {
+        const size_t n = (count - i < 16) ? (count - i) : 16;
+        _keys.prefetch(keys + i, n);
+        for (size_t j = i; j < i + n; ++j) {
+            added += insert(keys[j], values[j]);
+        }
+    }
+    return added;
+}
+
+template <typename T>
+void digest_map<T>::find_many(const sha1::digest* keys, size_t count, const T** found) const {
+    for (size_t i = 0; i < count; i += 16) {
+        const size_t n = (count - i < 16) ? (count - i) : 16;
+        _keys.prefetch(keys + i, n);
+        for (size_t j = i; j < i + n; ++j) {
+            found[j] = find(keys[j]);
+        }
+    }
+}
+
+template <typename T>
+template <typename F>
+void digest_map<T>::for_each(F f) const {
+    for (size_t i = 0; i < _keys._ctrl.size(); ++i) {
+        if (!(_keys._ctrl[i] & 0x80)) {
+            f(_keys._keys[i], _values[i]);
+        }
+    }
+}
+
+template <typename T>
+pn::data digest_map<T>::data() const {
+    static_assert(std::is_trivially_copyable<T>::value, "digest_map<T>::data() needs a POD T");
+    return _keys.data(_values.data(), sizeof(T));
+}
+
+template <typename T>
+const T* digest_map_view<T>::find(const sha1::digest& key) const {
+    const size_t slot = _set.find(key);
+    return (slot == digest_table::npos) ? nullptr
+                                        : reinterpret_cast<const T*>(_set._values) + slot;
+}
+
+template <typename T>
+void digest_map_view<T>::find_many(
+        const sha1::digest* keys, size_t count, const T** found) const {
+    size_t slots[16];
+    for (size_t i = 0; i < count; i += 16) {
+        const size_t n = (count - i < 16) ? (count - i) : 16;
+        _set.find_many(keys + i, n, slots);
+        for (size_t j = 0; j < n; ++j) {
+            found[i + j] = (slots[j] == digest_table::npos)
+                                   ? nullptr
+                                   : reinterpret_cast<const T*>(_set._values) + slots[j];
+        }
+    }
+}
+
+}  // namespace sfz
+
+#endif  // SFZ_DIGEST_TABLE_HPP_
@@ -8,15 +8,23 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <functional>
 #include <pn/data>
 #include <pn/output>
 #include <pn/string>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
 namespace sfz {
 
+class digest_cache;
+
 // Computes the SHA-1 digest of some sequence of bytes.
 //
-// Based on the code provided by RFC 3174.
+// Based on the code provided by RFC 3174.  Blocks are compressed by the fastest implementation
+// the running CPU supports (SHA extensions, AVX2, or SSSE3 on x86), chosen once on first use; the
+// RFC 3174 code remains as the portable fallback.
 class sha1 {
   public:
     struct digest {
@@ -28,6 +36,13 @@ class sha1 {
         pn::data   data() const;
         pn::string hex() const;
 
+        // Parses 40 hex digits, in either case, as returned by hex().  sha1_hex_literal() does the
+        // same for literals, at compile time.
+        // @param [in] hex      The digits to parse.
+        // @param [out] out     Set to the digest, if `hex` is one.
+        // @returns             true if `hex` was a digest.
+        static bool parse_hex(pn::string_view hex, digest* out);
+
         uint32_t d[5];
     };
 
@@ -47,19 +62,42 @@ class sha1 {
     // identical, to add data in larger chunks.
     // @param [in] input    The data to add to the digest.
     void write(pn::data_view input);
+
+    // Adds values to the current content, encoded as pn::output::write() would encode them.
+    // Integers are encoded on the stack, and strings and data are written directly, so neither
+    // allocates.
+    // @param [in] args     The values to add to the digest.
     template <typename... arguments>
-    void write(const arguments&... args) {
-        pn::data d;
-        d.output().write(args...).check();
-        write(pn::data_view{d});
-    }
+    void write(const arguments&... args);
 
     // Returns a digest computed from the current content.  This method does non-trivial work, so
     // if the digest is to be used multiple times, it should be called once, and the retrieved
     // digest reused.
     digest compute() const;
 
+    // Returns the state derived from the content so far, in a portable, versioned format.
+    // Hashing can be resumed from it with import_state(), including in another process or on
+    // another machine, so that hashing a large file can be checkpointed.  The state includes up
+    // to 63 bytes of content which have not yet been compressed.
+    pn::data export_state() const;
+
+    // Replaces the current state with one returned by export_state().  Writing the rest of the
+    // content afterwards gives the same digest as writing all of it to one instance.
+    // @param [in] state    The exported state.
+    // @throws std::runtime_error if `state` is not a valid state, or is from a newer version.
+    void import_state(pn::data_view state);
+
+    // Computes the digests of many independent messages.  The result is the same as hashing each
+    // message with its own instance, but faster for small messages: they are interleaved across
+    // the SIMD lanes of a multi-buffer kernel, which processes 4, 8, or 16 messages at once,
+    // depending on the CPU.
+    // @param [in] messages The messages to hash.
+    // @returns             The digest of each message, in the same order as `messages`.
+    static std::vector<digest> hash_many(const std::vector<pn::data_view>& messages);
+
   private:
+    friend class digest_cache;
+
     // Finishes computation of the digest of the current contents.  After this method is called, it
     // is no longer valid to call update().  The implementation of digest() therefore copies *this
     // and calls finish() on the copy, rather than changing *this.
@@ -69,6 +107,8 @@ class sha1 {
 
     // Processes the content in _message_block and resets _message_block_index to 0.  This should
     // be called only when all 64 bytes of data in _message_block have been filled with content.
+    // write() bypasses _message_block for whole blocks of input, passing them to the kernel
+    // directly.
     void process_message_block();
 
     // The current value of the digest being computed.
@@ -87,15 +127,539 @@ class sha1 {
     sha1& operator=(const sha1&);
 };
 
+// Computes the SHA-1 digest of a string literal at compile time, so that a program can check
+// data against the digest of a built-in template without hashing it at startup:
+//
+//     constexpr sha1::digest kDefault = sha1_literal("...");
+//
+// The literal's terminating null isn't hashed.  Each 64-byte block nests another call, so
+// compilers' default limit on the depth of constexpr evaluation (512) allows literals of up to
+// about 25 KiB.
+template <size_t N>
+constexpr sha1::digest sha1_literal(const char (&s)[N]);
+
+// Parses a digest written as 40 hex digits, as returned by sha1::digest::hex(), at compile time:
+//
+//     constexpr sha1::digest kExpected =
+//             sha1_hex_literal("a9993e364706816aba3e25717850c26c9cd0d89d");
+//
+// A literal of the wrong length doesn't compile; an invalid digit doesn't either, in a constant
+// expression, and otherwise throws std::runtime_error.
+template <size_t N>
+constexpr sha1::digest sha1_hex_literal(const char (&hex)[N]);
+
+// Computes the SHA-1 digests of a fixed number of independent streams, each of which may be
+// written in pieces.  This is the streaming counterpart to sha1::hash_many().
+//
+// Written data is buffered until enough has accumulated to keep the lanes of a multi-buffer
+// kernel busy, so it pays to write to many streams between calls to compute().  Memory use is
+// bounded: once about 1 MiB is buffered, all whole blocks are compressed.
+class sha1_multi {
+  public:
+    // Creates `count` streams, each in initial state.
+    explicit sha1_multi(size_t count);
+    sha1_multi(const sha1_multi&) = delete;
+
+    // @returns             The number of streams.
+    size_t size() const { return _streams.size(); }
+
+    // Resets all streams to their initial state.
+    void reset();
+
+    // Adds data in `input` to the stream at `index`, which must be less than size().
+    // @param [in] index    The stream to write to.
+    // @param [in] input    The data to add to the digest.
+    void write(size_t index, pn::data_view input);
+
+    // Returns digests computed from the current content of each stream, in order.  As with
+    // sha1::compute(), the streams are unchanged, and may be written to further.
+    std::vector<sha1::digest> compute() const;
+
+  private:
+    static const size_t kFlushSize = 1 << 20;
+
+    // Compresses all buffered whole blocks, leaving only partial blocks in `pending`.
+    void flush();
+
+    struct stream {
+        sha1::digest         intermediate;
+        uint64_t             size;
+        std::vector<uint8_t> pending;
+    };
+    std::vector<stream> _streams;
+    size_t              _pending_size;
+};
+
+// Computes the SHA-256 digest of some sequence of bytes.
+//
+// Has the same interface as sha1.  Blocks are compressed with the SHA extensions on x86 CPUs that
+// have them, or else by a portable implementation of FIPS 180-4.
+class sha256 {
+  public:
+    struct digest {
+        constexpr digest() : d{} {}
+        constexpr digest(
+                uint32_t d0, uint32_t d1, uint32_t d2, uint32_t d3, uint32_t d4, uint32_t d5,
+                uint32_t d6, uint32_t d7)
+                : d{d0, d1, d2, d3, d4, d5, d6, d7} {}
+        digest(pn::data_view data);
+
+        pn::data   data() const;
+        pn::string hex() const;
+
+        uint32_t d[8];
+    };
+
+    // Creates an instance in initial state.
+    sha256();
+
+    // Copies state derived from previous calls to `other.write()`.
+    // @param [in] other    The instance to copy from.
+    explicit sha256(const sha256& other);
+
+    // Resets the object to its initial state, as if write() had never been called.
+    void reset();
+
+    // Adds data in `input` to the current content.
+    // @param [in] input    The data to add to the digest.
+    void write(pn::data_view input);
+    template <typename... arguments>
+    void write(const arguments&... args);
+
+    // Returns a digest computed from the current content.
+    digest compute() const;
+
+  private:
+    struct digest _intermediate;
+    uint64_t      _size;
+    int           _message_block_index;
+    uint8_t       _message_block[64];
+
+    sha256& operator=(const sha256&);
+};
+
+// Computes the BLAKE3 digest of some sequence of bytes, with the default (unkeyed) mode and 256
+// bits of output.
+//
+// Has the same interface as sha1, plus write_parallel().  BLAKE3 hashes its input as a binary
+// tree of 1 KiB chunks, so unlike SHA-1 and SHA-256, a single message can be hashed on several
+// threads: independent subtrees are hashed concurrently and then joined.
+class blake3 {
+  public:
+    struct digest {
+        constexpr digest() : d{} {}
+        digest(pn::data_view data);
+
+        pn::data   data() const;
+        pn::string hex() const;
+
+        uint8_t d[32];
+    };
+
+    // Creates an instance in initial state.
+    blake3();
+
+    // Copies state derived from previous calls to `other.write()`.
+    // @param [in] other    The instance to copy from.
+    explicit blake3(const blake3& other);
+
+    // Resets the object to its initial state, as if write() had never been called.
+    void reset();
+
+    // Adds data in `input` to the current content.
+    // @param [in] input    The data to add to the digest.
+    void write(pn::data_view input);
+    template <typename... arguments>
+    void write(const arguments&... args);
+
+    // Adds data in `input` to the current content, as write() does, but hashes its subtrees on
+    // up to `threads` threads.  Only large inputs (several MiB) are split.
+    // @param [in] input    The data to add to the digest.
+    // @param [in] threads  The maximum number of threads to use, including the calling thread.
+    void write_parallel(pn::data_view input, int threads);
+
+    // Returns a digest computed from the current content.
+    digest compute() const;
+
+  private:
+    // The chunk currently being hashed.
+    struct chunk_state {
+        uint32_t cv[8];
+        uint64_t counter;
+        uint8_t  block[64];
+        int      block_len;
+        int      blocks_compressed;
+    };
+
+    // Merges completed subtrees on the stack, given the number of chunks before the next one.
+    void merge_cv_stack(uint64_t chunk_counter);
+
+    // Adds the chaining value of a completed subtree, merging completed subtrees beneath it.
+    void push_cv(const uint32_t* cv, uint64_t chunk_counter);
+
+    chunk_state _chunk;
+    uint32_t    _cv_stack[54][8];
+    int         _cv_stack_len;
+
+    blake3& operator=(const blake3&);
+};
+
 bool operator==(const sha1::digest& lhs, const sha1::digest& rhs);
 bool operator!=(const sha1::digest& lhs, const sha1::digest& rhs);
+bool operator==(const sha256::digest& lhs, const sha256::digest& rhs);
+bool operator!=(const sha256::digest& lhs, const sha256::digest& rhs);
+bool operator==(const blake3::digest& lhs, const blake3::digest& rhs);
+bool operator!=(const blake3::digest& lhs, const blake3::digest& rhs);
+
+// file_digest() and tree_digest() may be used with any of the hashers above, which share an
+// interface: a default constructor, write(pn::data_view), write<T>(T), compute(), and a `digest`
+// type.  The checksums in <sfz/checksum.hpp> can be used with them too.  The overloads
+// which don't take a hasher use sha1.
+
+// How file_digest() and tree_digest() read files.
+enum ReadMode {
+    // Maps regular files between 64 KiB and 1 GiB into memory, and streams everything else.
+    READ_AUTO,
+    // Maps files into memory.  This fails for anything but regular files of up to 2 GiB.
+    READ_MAPPED,
+    // Reads files sequentially, through a reused buffer.
+    READ_STREAMED,
+};
+
+// Whether file_digest() hashes in the kernel, where it can.  On Linux, sha1 and sha256 can be
+// computed by the kernel's crypto API (AF_ALG), with file content spliced to it from the page
+// cache instead of being copied into user space.  That's only an advantage where the kernel's
+// implementation is as fast as ours, so by default it's measured before it's used.
+enum OffloadMode {
+    // Offloads regular files of 1 MiB or more, if offloading was measured to be faster.  It's
+    // measured once per process and hash function, by hashing 1 MiB both ways from a file which
+    // is only in memory, so nothing is written to disk.  That measures the cost of hashing, not
+    // of reading; for files on slow storage, where reading costs more, either way is as fast.
+    OFFLOAD_AUTO,
+    // Never offloads.
+    OFFLOAD_NEVER,
+    // Offloads everything it can: anything that can be spliced, other than mapped files.
+    OFFLOAD_ALWAYS,
+};
+
+struct file_digest_options {
+    // The number of threads to hash with, for hashers which can use more than one (blake3).  0
+    // means one per hardware thread.
+    int threads = 0;
+
+    // How to read the file.
+    ReadMode read = READ_AUTO;
+
+    // If positive, the file is read on a separate thread, up to this many buffers ahead of
+    // hashing, so that reading and hashing overlap.  Streamed files are read into a ring of
+    // buffers; mapped files have their pages faulted in a buffer's size at a time.  This helps
+    // most with cold files on slow storage, where hashing would otherwise wait on each read.
+    int read_ahead = 0;
+
+    // The size of each buffer that is read ahead.
+    size_t read_ahead_size = 1 << 20;
+
+    // Whether to hash in the kernel.  It's never done with READ_MAPPED, or for blake3.  If it is,
+    // `read_ahead` is ignored; the kernel reads ahead itself.
+    OffloadMode offload = OFFLOAD_AUTO;
+};
 
-// Hashes a regular file.
+// Hashes a file: a regular file, or anything else that can be read, like a pipe or device.
 sha1::digest file_digest(pn::string_view path);
+template <typename hasher>
+typename hasher::digest file_digest(
+        pn::string_view path, const file_digest_options& options = file_digest_options());
+
+// Hashes what can be read from `fd`, from its current offset to the end of the file.  The
+// descriptor is read sequentially, so it may be a pipe, like standard input, and is left open.
+sha1::digest file_digest(int fd);
+template <typename hasher>
+typename hasher::digest file_digest(
+        int fd, const file_digest_options& options = file_digest_options());
+
+// Hashes a regular file, as above, unless `cache` has its digest from when it was last hashed.
+// It's read as `options` say, but never offloaded: the kernel's result can't be cached.
+sha1::digest file_digest(
+        pn::string_view path, digest_cache& cache,
+        const file_digest_options& options = file_digest_options());
+
+struct tree_digest_options {
+    // The number of threads to use.  0 means one per hardware thread; 1 means to do all work on
+    // the calling thread, as tree_digest(path) does.
+    int threads = 0;
+
+    // The maximum number of files which are open at once, including those read ahead of the one
+    // being hashed.  0 means four per thread.
+    int max_files_in_flight = 0;
+
+    // How to read each file, as in file_digest_options.  Without read-ahead, and with more than
+    // one thread, the workers read ahead what they can: they fault in mapped files, and read
+    // streamed files smaller than 64 KiB into memory.  Larger streamed files are read a few
+    // buffers ahead of hashing, by a thread of their own.
+    ReadMode read            = READ_AUTO;
+    int      read_ahead      = 0;
+    size_t   read_ahead_size = 1 << 20;
+};
 
 // Hashes a tree containing regular files (or symlinks).
 sha1::digest tree_digest(pn::string_view path);
 
+// Hashes a tree as above, reading files ahead on a pool of worker threads.  The digest is always
+// the same as the one from tree_digest(path).
+sha1::digest tree_digest(pn::string_view path, const tree_digest_options& options);
+template <typename hasher>
+typename hasher::digest tree_digest(
+        pn::string_view path, const tree_digest_options& options = tree_digest_options());
+
+// Hashes a tree as above, consulting `cache` for the result of hashing each file before reading
+// it, and updating it after.  Reading stops being skipped after the first file which has changed.
+// Only sha1 results can be cached, so there's no such overload for other hashers.
+sha1::digest tree_digest(
+        pn::string_view path, const tree_digest_options& options, digest_cache& cache);
+
+struct file_digests_options {
+    // The number of files to hash at once.  0 means one per hardware thread.
+    int threads = 0;
+
+    // How to read each file, as in file_digest_options.
+    ReadMode read = READ_AUTO;
+
+    // If true, a directory is hashed with tree_digest(), rather than being an error.
+    bool trees = false;
+};
+
+// Hashes many files, several at once, each as file_digest(path) would.  Results are passed to
+// `done` on the calling thread, in the order of `paths`, each as soon as it and those before it
+// are ready, so that they can be printed as they come.  At most a few results per thread are
+// held at once.  A file which can't be hashed doesn't stop the others; `done` is passed the
+// reason instead of a digest.
+//
+// @param [in] paths    The files to hash.
+// @param [in] options  How to hash them.
+// @param [in] done     Called as done(i, digest, error) for each index into `paths`, with either
+//                      its digest, or null and a description of the error.
+void file_digests(
+        const std::vector<pn::string_view>& paths, const file_digests_options& options,
+        const std::function<void(size_t, const sha1::digest*, pn::string_view)>& done);
+
+// Has the interface of pn::output, but writes to a hasher, so that code which serializes values
+// with write() can stream them into a digest, rather than building a buffer to hash.  If given a
+// `tee`, everything written is also written there, so that data can be hashed on its way to a
+// file.
+template <typename hasher>
+class hashing_output {
+  public:
+    // @param [in] h        The hasher to write to.  Must outlive this object.
+    // @param [in] tee      If not null, an output to copy everything written to.
+    explicit hashing_output(hasher& h, pn::output* tee = nullptr) : _hasher(h), _tee(tee) {}
+
+    template <typename... arguments>
+    hashing_output& write(const arguments&... args) {
+        _hasher.write(args...);
+        if (_tee) {
+            _tee->write(args...);
+        }
+        return *this;
+    }
+
+    // Checks the tee, if any, as pn::output::check() does.
+    void check() {
+        if (_tee) {
+            _tee->check();
+        }
+    }
+
+  private:
+    hasher&     _hasher;
+    pn::output* _tee;
+};
+
+// Implementation details follow.
+
+namespace digest_write {
+
+// Integers other than bool and char are encoded big-endian, as pn::output encodes them.
+template <typename T>
+struct is_integer : std::integral_constant<
+                            bool, std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                                          !std::is_same<T, char>::value> {};
+
+template <typename T>
+struct is_bytes : std::integral_constant<
+                          bool, std::is_convertible<const T&, pn::data_view>::value ||
+                                        std::is_convertible<const T&, pn::string_view>::value> {};
+
+template <typename T>
+inline typename std::enable_if<is_integer<T>::value>::type write_one(
+        const T& value, void (*write)(void*, pn::data_view), void* h) {
+    typedef typename std::make_unsigned<T>::type unsigned_type;
+    const unsigned_type u = static_cast<unsigned_type>(value);
+    uint8_t             bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        bytes[i] = static_cast<uint8_t>(static_cast<uint64_t>(u) >> (8 * (sizeof(T) - 1 - i)));
+    }
+    write(h, pn::data_view{bytes, static_cast<int>(sizeof(T))});
+}
+
+inline void write_bytes(pn::data_view d, void (*write)(void*, pn::data_view), void* h) {
+    write(h, d);
+}
+
+inline void write_bytes(pn::string_view s, void (*write)(void*, pn::data_view), void* h) {
+    write(h, s.as_data());
+}
+
+template <typename T>
+inline typename std::enable_if<is_bytes<T>::value && !is_integer<T>::value>::type write_one(
+        const T& value, void (*write)(void*, pn::data_view), void* h) {
+    write_bytes(value, write, h);
+}
+
+// Anything else is encoded by pn::output itself.
+template <typename T>
+inline typename std::enable_if<!is_bytes<T>::value && !is_integer<T>::value>::type write_one(
+        const T& value, void (*write)(void*, pn::data_view), void* h) {
+    pn::data d;
+    d.output().write(value).check();
+    write(h, d);
+}
+
+inline void write_all(void (*)(void*, pn::data_view), void*) {}
+
+template <typename T, typename... Ts>
+inline void write_all(
+        void (*write)(void*, pn::data_view), void* h, const T& value, const Ts&... values) {
+    write_one(value, write, h);
+    write_all(write, h, values...);
+}
+
+template <typename hasher>
+void write_data(void* h, pn::data_view d) {
+    static_cast<hasher*>(h)->write(d);
+}
+
+}  // namespace digest_write
+
+// C++11 constexpr functions are a single return statement, so the SHA-1 below is written as
+// recursion: rounds() calls itself once per round, carrying the state and a window of the next
+// 16 words of the message schedule in its arguments.
+namespace sha1_constexpr {
+
+constexpr uint32_t rotl(uint32_t x, int n) {
+    return static_cast<uint32_t>(x << n) | (x >> (32 - n));
+}
+
+constexpr uint32_t f(int t, uint32_t b, uint32_t c, uint32_t d) {
+    return (t < 20) ? ((b & c) | (~b & d))
+                    : ((t < 40) || (t >= 60)) ? (b ^ c ^ d) : ((b & c) | (b & d) | (c & d));
+}
+
+constexpr uint32_t k(int t) {
+    return (t < 20) ? 0x5a827999 : (t < 40) ? 0x6ed9eba1 : (t < 60) ? 0x8f1bbcdc : 0xca62c1d6;
+}
+
+// The number of 64-byte blocks in a padded message of `size` bytes.
+constexpr size_t blocks(size_t size) { return (size + 8) / 64 + 1; }
+
+// Byte `i` of a padded message: the content, 0x80, zeros, then the size in bits, big-endian.
+constexpr uint32_t byte(const char* s, size_t size, size_t i) {
+    return (i < size) ? static_cast<uint8_t>(s[i])
+                      : (i == size) ? 0x80
+                                    : (i < blocks(size) * 64 - 8)
+                                              ? 0
+                                              : static_cast<uint8_t>(
+                                                        (uint64_t{size} * 8) >>
+                                                        (8 * (blocks(size) * 64 - 1 - i)));
+}
+
+constexpr uint32_t word(const char* s, size_t size, size_t i) {
+    return (byte(s, size, 4 * i) << 24) | (byte(s, size, 4 * i + 1) << 16) |
+           (byte(s, size, 4 * i + 2) << 8) | byte(s, size, 4 * i + 3);
+}
+
+constexpr sha1::digest rounds(
+        int t, uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t e, uint32_t w0,
+        uint32_t w1, uint32_t w2, uint32_t w3, uint32_t w4, uint32_t w5, uint32_t w6, uint32_t w7,
+        uint32_t w8, uint32_t w9, uint32_t w10, uint32_t w11, uint32_t w12, uint32_t w13,
+        uint32_t w14, uint32_t w15) {
+    return (t == 80) ? sha1::digest(a, b, c, d, e)
+                     : rounds(t + 1, rotl(a, 5) + f(t, b, c, d) + e + w0 + k(t), a, rotl(b, 30),
+                              c, d, w1, w2, w3, w4, w5, w6, w7, w8, w9, w10, w11, w12, w13, w14,
+                              w15, rotl(w13 ^ w8 ^ w2 ^ w0, 1));
+}
+
+constexpr sha1::digest add(const sha1::digest& x, const sha1::digest& y) {
+    return sha1::digest(
+            x.d[0] + y.d[0], x.d[1] + y.d[1], x.d[2] + y.d[2], x.d[3] + y.d[3], x.d[4] + y.d[4]);
+}
+
+constexpr sha1::digest compress(const sha1::digest& h, const char* s, size_t size, size_t i) {
+    return add(h, rounds(0, h.d[0], h.d[1], h.d[2], h.d[3], h.d[4], word(s, size, 16 * i),
+                         word(s, size, 16 * i + 1), word(s, size, 16 * i + 2),
+                         word(s, size, 16 * i + 3), word(s, size, 16 * i + 4),
+                         word(s, size, 16 * i + 5), word(s, size, 16 * i + 6),
+                         word(s, size, 16 * i + 7), word(s, size, 16 * i + 8),
+                         word(s, size, 16 * i + 9), word(s, size, 16 * i + 10),
+                         word(s, size, 16 * i + 11), word(s, size, 16 * i + 12),
+                         word(s, size, 16 * i + 13), word(s, size, 16 * i + 14),
+                         word(s, size, 16 * i + 15)));
+}
+
+// Compresses blocks [i, blocks(size)) into `h`.  Each block's rounds finish before the next
+// call, so nesting grows by one per block, rather than by 80.
+constexpr sha1::digest hash(const sha1::digest& h, const char* s, size_t size, size_t i) {
+    return (i == blocks(size)) ? h : hash(compress(h, s, size, i), s, size, i + 1);
+}
+
+constexpr char lower(char c) { return ((c >= 'A') && (c <= 'F')) ? (c - 'A' + 'a') : c; }
+
+constexpr uint32_t hex_digit(char c) {
+    return ((c >= '0') && (c <= '9'))
+                   ? static_cast<uint32_t>(c - '0')
+                   : ((lower(c) >= 'a') && (lower(c) <= 'f'))
+                             ? static_cast<uint32_t>(lower(c) - 'a' + 10)
+                             : throw std::runtime_error("invalid hex digit in sha1 digest");
+}
+
+constexpr uint32_t hex_word(const char* s) {
+    return (hex_digit(s[0]) << 28) | (hex_digit(s[1]) << 24) | (hex_digit(s[2]) << 20) |
+           (hex_digit(s[3]) << 16) | (hex_digit(s[4]) << 12) | (hex_digit(s[5]) << 8) |
+           (hex_digit(s[6]) << 4) | hex_digit(s[7]);
+}
+
+}  // namespace sha1_constexpr
+
+template <size_t N>
+constexpr sha1::digest sha1_literal(const char (&s)[N]) {
+    return sha1_constexpr::hash(
+            sha1::digest(0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0), s, N - 1,
+            0);
+}
+
+template <size_t N>
+constexpr sha1::digest sha1_hex_literal(const char (&hex)[N]) {
+    static_assert(N == 41, "a sha1 digest is 40 hex digits");
+    return sha1::digest(
+            sha1_constexpr::hex_word(hex), sha1_constexpr::hex_word(hex + 8),
+            sha1_constexpr::hex_word(hex + 16), sha1_constexpr::hex_word(hex + 24),
+            sha1_constexpr::hex_word(hex + 32));
+}
+
+template <typename... arguments>
+void sha1::write(const arguments&... args) {
+    digest_write::write_all(&digest_write::write_data<sha1>, this, args...);
+}
+
+template <typename... arguments>
+void sha256::write(const arguments&... args) {
+    digest_write::write_all(&digest_write::write_data<sha256>, this, args...);
+}
+
+template <typename... arguments>
+void blake3::write(const arguments&... args) {
+    digest_write::write_all(&digest_write::write_data<blake3>, this, args...);
+}
+
 }  // namespace sfz
 
 #endif  // SFZ_DIGEST_HPP_
@@ -0,0 +1,64 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_DUPLICATES_HPP_
+#define SFZ_DUPLICATES_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pn/string>
+#include <sfz/digest.hpp>
+#include <vector>
+
+namespace sfz {
+
+struct duplicate_options {
+    // The number of files to read at once.  0 means one per hardware thread.
+    int threads = 0;
+
+    // Files smaller than this are ignored.  By default, that's only empty files, which are all
+    // the same.
+    uint64_t min_size = 1;
+
+    // The number of bytes read from each end of a file to tell apart files of the same size
+    // before hashing them whole.
+    size_t sample_size = 4096;
+
+    // How to read files which are hashed whole, as in file_digest_options.
+    ReadMode read = READ_AUTO;
+};
+
+// A set of distinct files with the same content.
+struct duplicate_group {
+    uint64_t     size;
+    sha1::digest digest;
+
+    // The paths of each file.  A file with several hard links has several paths.  Each file's
+    // paths are sorted, and the files are sorted by their first path.
+    std::vector<std::vector<pn::string>> files;
+};
+
+// Finds files with the same content in the trees at `roots`.
+//
+// Only files can be duplicates of others of the same size, so files are grouped by size first,
+// and those of a unique size are never read.  Files in a group are then told apart by a hash of
+// their first and last `sample_size` bytes, and only those which still can't be are hashed
+// whole, several at once, to confirm that they are the same.
+//
+// Symlinks aren't followed.  Hard links to the same file (the same device and inode) are one
+// file: it's read once, and isn't a duplicate of itself.  Where a system doesn't report inode
+// numbers, every path is taken to be a distinct file.
+//
+// @param [in] roots    Directories or files to search.
+// @param [in] options  How to search them.
+// @returns             The groups of two or more files with the same content, largest first.
+// @throws std::runtime_error if a root doesn't exist, or a file can't be read.
+std::vector<duplicate_group> find_duplicates(
+        const std::vector<pn::string_view>& roots,
+        const duplicate_options&            options = duplicate_options());
+
+}  // namespace sfz
+
+#endif  // SFZ_DUPLICATES_HPP_
@@ -6,7 +6,9 @@
 #ifndef SFZ_ENCODING_HPP_
 #define SFZ_ENCODING_HPP_
 
+#include <stddef.h>
 #include <stdint.h>
+#include <pn/data>
 #include <pn/string>
 
 namespace sfz {
@@ -35,6 +37,48 @@ extern const pn::rune kAsciiUnknownCodePoint;
 // @returns             true iff `rune` is a valid code point.
 bool is_valid_code_point(uint32_t rune);
 
+// UTF-8 text encoding.
+//
+// pn::string always holds valid UTF-8, so bytes from elsewhere, such as files or the network,
+// must be checked before they become one.  These check a vector at a time where the CPU allows,
+// so that valid input is checked, and decoded, about as fast as it can be read.
+namespace utf8 {
+
+// Finds the first invalid UTF-8 in `data`.  Overlong sequences, surrogates, code points above
+// U+10FFFF, stray continuation bytes, and sequences which are cut off, even at the end of `data`,
+// are all invalid.
+//
+// @param [in] data     Bytes which may be UTF-8.
+// @returns             The offset of the first byte of the first invalid sequence, or
+//                      data.size() if `data` is entirely valid.
+size_t find_invalid(pn::data_view data);
+
+// @param [in] data     Bytes which may be UTF-8.
+// @returns             true iff `data` is entirely valid UTF-8.
+bool is_valid(pn::data_view data);
+
+// Decodes UTF-8, replacing each invalid sequence with kUnknownCodePoint.  As Unicode recommends,
+// an invalid sequence extends as far as it is a valid prefix, so "\xE2\x82A" becomes one
+// kUnknownCodePoint, followed by "A".
+//
+// @param [in] data     Bytes which may be UTF-8.
+// @returns             A string with the valid sequences of `data`, and the replacements.
+pn::string decode(pn::data_view data);
+
+}  // namespace utf8
+
+// Each encoding below is a namespace with the same functions:
+//
+//   - encode() encodes a string, replacing each code point which the encoding can't represent
+//     with kAsciiUnknownCodePoint.
+//   - decode() decodes a byte sequence.
+//   - encoded_size() and decoded_size() return the size of what encode() and decode() would
+//     return, without converting anything.  The sizes are counted a vector at a time where the
+//     CPU allows, and encode() and decode() count them first, so that they allocate their results
+//     once, at the exact size.
+//   - count_unencodable() returns the number of code points which encode() would replace, so
+//     that a caller can choose another encoding before encoding anything.
+
 // ASCII text encoding.
 //
 // This encoding can represent code points in the range [U+00, U+7F].  It does so by representing
@@ -44,6 +88,9 @@ namespace ascii {
 
 pn::data   encode(pn::string_view string);
 pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
 
 }  // namespace ascii
 
@@ -60,6 +107,9 @@ namespace latin1 {
 
 pn::data   encode(pn::string_view string);
 pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
 
 }  // namespace latin1
 
@@ -76,9 +126,281 @@ namespace macroman {
 
 pn::data   encode(pn::string_view string);
 pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
 
 }  // namespace macroman
 
+// Other single-byte text encodings.
+//
+// Like MacRoman, each of these encodes code points in the range [U+00, U+7F] as ASCII, and a
+// further set of up to 128 code points as the bytes [0x80, 0xFF].  Bytes which an encoding leaves
+// unassigned are decoded as kUnknownCodePoint.  Encoding and decoding take the same time per code
+// point whichever encoding is used.
+//
+//   - cp1252: Windows-1252, the Western European code page of Windows.
+//   - cp437: the code page of the IBM PC.  Bytes [0x00, 0x7F] are decoded as ASCII, including
+//     control characters, rather than the symbols which the IBM PC drew for some of them.
+//   - iso8859_N: part N of ISO/IEC 8859.  Part 1 is Latin-1, above, and there is no part 12.
+namespace cp1252 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace cp1252
+
+namespace cp437 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace cp437
+
+namespace iso8859_2 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_2
+
+namespace iso8859_3 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_3
+
+namespace iso8859_4 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_4
+
+namespace iso8859_5 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_5
+
+namespace iso8859_6 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_6
+
+namespace iso8859_7 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_7
+
+namespace iso8859_8 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_8
+
+namespace iso8859_9 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_9
+
+namespace iso8859_10 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_10
+
+namespace iso8859_11 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_11
+
+namespace iso8859_13 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_13
+
+namespace iso8859_14 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_14
+
+namespace iso8859_15 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_15
+
+namespace iso8859_16 {
+
+pn::data   encode(pn::string_view string);
+pn::string decode(pn::data_view data);
+size_t     encoded_size(pn::string_view string);
+size_t     decoded_size(pn::data_view data);
+size_t     count_unencodable(pn::string_view string);
+
+}  // namespace iso8859_16
+
+// The encodings above, for encoder and decoder.
+enum class encoding {
+    ascii,
+    latin1,
+    macroman,
+    cp1252,
+    cp437,
+    iso8859_2,
+    iso8859_3,
+    iso8859_4,
+    iso8859_5,
+    iso8859_6,
+    iso8859_7,
+    iso8859_8,
+    iso8859_9,
+    iso8859_10,
+    iso8859_11,
+    iso8859_13,
+    iso8859_14,
+    iso8859_15,
+    iso8859_16,
+};
+
+// The progress of one call to encoder::convert() or decoder::convert().
+struct convert_result {
+    size_t read;     // The number of bytes consumed from the input.
+    size_t written;  // The number of bytes stored in the output.
+};
+
+// Encoders and decoders convert text a part at a time, into buffers provided by the caller, so
+// that text of any size can be converted in constant memory.  For example, to convert a file
+// from Windows-1252 to UTF-8:
+//
+//     sfz::mapped_file file(path);
+//     sfz::decoder     d(sfz::encoding::cp1252);
+//     pn::data_view    in = file.data();
+//     uint8_t          buffer[65536];
+//     while (!in.empty()) {
+//         sfz::convert_result r = d.convert(in, buffer, sizeof buffer);
+//         write(fd, buffer, r.written);
+//         in = in.slice(r.read);
+//     }
+//
+// Each call converts as much of the input as fits in the output.  The output is identical to
+// that of the whole-buffer encode() or decode() for the same encoding, however the input is split.
+
+// Encodes UTF-8 into one of the encodings above.
+//
+// A sequence which is cut off at the end of one call's input is kept, and completed with the
+// start of the next call's.  Unlike encode(), the input need not be valid UTF-8; each invalid
+// sequence, like each code point which can't be encoded, is encoded as kAsciiUnknownCodePoint.
+class encoder {
+  public:
+    explicit encoder(encoding e);
+
+    // Encodes the start of `in` into `out`.
+    //
+    // @param [in] in       UTF-8 to encode.
+    // @param [out] out     The buffer to encode into.
+    // @param [in] size     The size of `out`.
+    // @returns             The bytes read and written.  All of `in` is read, unless `out` is
+    //                      filled first.
+    convert_result convert(pn::data_view in, uint8_t* out, size_t size);
+
+    // Ends the input.  If it ended with a sequence which was cut off, that is encoded as
+    // kAsciiUnknownCodePoint.
+    //
+    // @param [out] out     The buffer to encode into.
+    // @param [in] size     The size of `out`.  At least 1 byte is needed to be sure of finishing.
+    // @returns             The number of bytes written, 0 or 1.
+    size_t finish(uint8_t* out, size_t size);
+
+  private:
+    encoding _encoding;
+    uint8_t  _partial[4];
+    size_t   _partial_size;
+};
+
+// Decodes one of the encodings above into UTF-8.  Each byte is decoded independently, so there
+// is nothing to carry between calls, but a code point is never split between two outputs: each
+// call stops before a code point whose UTF-8 doesn't fit in what is left of `out`.
+class decoder {
+  public:
+    explicit decoder(encoding e);
+
+    // Decodes the start of `in` into `out`.
+    //
+    // @param [in] in       Bytes to decode.
+    // @param [out] out     The buffer to decode into, as UTF-8.
+    // @param [in] size     The size of `out`.  If it is at least 4 bytes, at least one byte of
+    //                      `in` is read.
+    // @returns             The bytes read and written.
+    convert_result convert(pn::data_view in, uint8_t* out, size_t size);
+
+  private:
+    encoding _encoding;
+};
+
 }  // namespace sfz
 
 #endif  // SFZ_ENCODING_HPP_
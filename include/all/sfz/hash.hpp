@@ -0,0 +1,67 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_HASH_HPP_
+#define SFZ_HASH_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pn/data>
+#include <pn/string>
+#include <sfz/digest.hpp>
+
+namespace sfz {
+
+// Fast, seeded, non-cryptographic hashes of byte sequences, for hash tables, sharding, and
+// in-memory deduplication.  They are XXH3 (from xxHash 0.8), and give the same values as
+// XXH3_64bits_withSeed() and XXH3_128bits_withSeed(), so they can be stored or compared with
+// values computed elsewhere.
+//
+// Unlike sha1, these are not resistant to deliberate collisions; with input from untrusted
+// sources, use a secret, random seed.  Inputs of up to 16 bytes are hashed with a few
+// multiplications; inputs over 240 bytes are hashed in stripes of 64 bytes, with AVX2 or SSE2
+// where the CPU has them.
+
+struct hash128 {
+    uint64_t low;
+    uint64_t high;
+};
+
+bool operator==(const hash128& lhs, const hash128& rhs);
+bool operator!=(const hash128& lhs, const hash128& rhs);
+
+// @param [in] data         The data to hash.
+// @param [in] seed         A value which selects one of a family of unrelated hash functions.
+// @returns                 The hash of `data`.
+uint64_t fast_hash64(pn::data_view data, uint64_t seed = 0);
+hash128  fast_hash128(pn::data_view data, uint64_t seed = 0);
+
+// Hash functions for unordered containers, as std::hash would be:
+//
+//     std::unordered_map<pn::string, int, sfz::string_hash> counts;
+//     std::unordered_set<sha1::digest, sfz::digest_hash>    seen;
+struct string_hash {
+    explicit string_hash(uint64_t seed = 0) : seed(seed) {}
+    size_t operator()(pn::string_view s) const { return fast_hash64(s.as_data(), seed); }
+    uint64_t seed;
+};
+
+struct data_hash {
+    explicit data_hash(uint64_t seed = 0) : seed(seed) {}
+    size_t operator()(pn::data_view d) const { return fast_hash64(d, seed); }
+    uint64_t seed;
+};
+
+// A sha1 digest is already uniformly distributed, and finding ones which collide is costly, so
+// its first bits are used directly, with no seed.
+struct digest_hash {
+    size_t operator()(const sha1::digest& d) const {
+        return static_cast<size_t>((uint64_t{d.d[0]} << 32) | d.d[1]);
+    }
+};
+
+}  // namespace sfz
+
+#endif  // SFZ_HASH_HPP_
@@ -0,0 +1,100 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_MANIFEST_HPP_
+#define SFZ_MANIFEST_HPP_
+
+#include <stdint.h>
+#include <pn/string>
+#include <sfz/digest.hpp>
+#include <sfz/merkle.hpp>
+#include <vector>
+
+namespace sfz {
+
+// A file which a tree is expected to contain, with its size and digest.
+struct manifest_entry {
+    pn::string   path;  // Relative to the root of the tree, with '/' separators.
+    uint64_t     size;
+    sha1::digest digest;
+};
+
+// Parses a manifest, which has a line for each file: its digest in hex, its size in decimal, and
+// its path, separated by single spaces.  Paths may contain spaces, but not newlines.
+//
+//     a9993e364706816aba3e25717850c26c9cd0d89d 3 docs/abc.txt
+//
+// @param [in] text     The text of the manifest.
+// @returns             The entries, in the order listed.
+// @throws std::runtime_error if a line isn't in that form.
+std::vector<manifest_entry> parse_manifest(pn::string_view text);
+
+// Parses the manifest in the file at `path`.
+std::vector<manifest_entry> read_manifest(pn::string_view path);
+
+// @returns             The manifest listing `entries`, in the form read by parse_manifest().
+pn::string format_manifest(const std::vector<manifest_entry>& entries);
+
+// Hashes the tree at `root`, as merkle_tree does.
+// @returns             An entry for each file in the tree, sorted by path.
+std::vector<manifest_entry> build_manifest(
+        pn::string_view root, const merkle_options& options = merkle_options());
+
+enum ManifestProblem {
+    MANIFEST_MISSING,       // Listed, but nothing exists at the path.
+    MANIFEST_NOT_A_FILE,    // Listed, but the path is a directory or other non-regular file.
+    MANIFEST_WRONG_SIZE,    // Listed, with a different size.
+    MANIFEST_WRONG_DIGEST,  // Listed, with the same size, but a different digest.
+    MANIFEST_UNLISTED,      // A file in the tree which the manifest doesn't list.
+};
+
+struct manifest_mismatch {
+    ManifestProblem problem;
+    pn::string      path;
+
+    // What the manifest lists, and what was found.  The actual size is set for
+    // MANIFEST_WRONG_SIZE, MANIFEST_WRONG_DIGEST, and MANIFEST_UNLISTED, and the actual digest
+    // only for MANIFEST_WRONG_DIGEST; otherwise they are zero.
+    uint64_t     expected_size;
+    sha1::digest expected_digest;
+    uint64_t     actual_size;
+    sha1::digest actual_digest;
+};
+
+struct verify_options {
+    // The number of files to hash at once.  0 means one per hardware thread.
+    int threads = 0;
+
+    // If true, verification stops at the first mismatch found, and only it is reported.  Which
+    // mismatch is found first is unspecified when several files are hashed at once.
+    bool stop_at_first_mismatch = false;
+
+    // If true, the tree is walked to find files which the manifest doesn't list.
+    bool check_unlisted = false;
+
+    // How to read each file, as in file_digest_options.
+    ReadMode read = READ_AUTO;
+};
+
+// Checks the tree at `root` against a manifest.
+//
+// Every listed path is first checked with stat(2) alone, so that missing files and files of the
+// wrong size are found without reading anything; in stop-at-first mode, a mismatch there means
+// nothing is hashed.  Only the files whose sizes match are then hashed, several at once, largest
+// first.
+//
+// @param [in] root     The path to the tree, relative or absolute.
+// @param [in] manifest The files the tree should contain.
+// @param [in] options  How to verify it.
+// @returns             The mismatches: those of listed files in the order they are listed, then
+//                      unlisted files, sorted by path.  Empty if the tree matches.
+// @throws std::runtime_error if a listed file exists but couldn't be read.
+std::vector<manifest_mismatch> verify_manifest(
+        pn::string_view root, const std::vector<manifest_entry>& manifest,
+        const verify_options& options = verify_options());
+
+}  // namespace sfz
+
+#endif  // SFZ_MANIFEST_HPP_
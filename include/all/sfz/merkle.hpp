@@ -0,0 +1,119 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_MERKLE_HPP_
+#define SFZ_MERKLE_HPP_
+
+#include <stdint.h>
+#include <pn/string>
+#include <sfz/digest-cache.hpp>
+#include <sfz/digest.hpp>
+#include <vector>
+
+namespace sfz {
+
+class merkle_tree;
+
+struct merkle_options {
+    // The number of files to hash at once.  0 means one per hardware thread.
+    int threads = 0;
+
+    // How to read each file, as in file_digest_options.
+    ReadMode read            = READ_AUTO;
+    int      read_ahead      = 0;
+    size_t   read_ahead_size = 1 << 20;
+
+    // If not null, a cache of file digests, which is consulted before reading each file.
+    digest_cache* cache = nullptr;
+
+    // If not null, an earlier tree of the same path.  Files whose identity hasn't changed since
+    // it was built aren't read again; their digests are taken from it.
+    const merkle_tree* previous = nullptr;
+};
+
+// A digest of a tree of files, in which each directory's digest combines the digests of its
+// entries.  Unlike tree_digest(), whose single digest covers everything, this records a digest
+// for every file and directory, so that two trees can be compared without visiting subtrees
+// which are the same in both.
+//
+// A file's digest is its file_digest().  A directory's digest is the sha1 digest of its entries,
+// in byte order of their names: for each, a type byte ('d' or 'f'), the size and bytes of its
+// name, and its digest.  Symlinks are followed, broken symlinks are ignored, and anything else
+// that isn't a regular file or directory is an error, as with tree_digest().  Unlike
+// tree_digest(), empty directories are included.
+//
+// Nodes are stored in breadth-first order, so the entries of each directory are contiguous, and
+// sorted by name.
+class merkle_tree {
+  public:
+    struct node {
+        // The last component of the node's path; empty for the root.
+        pn::string name;
+
+        // Whether the node is a directory, rather than a file.
+        bool directory;
+
+        // The digest of the file or directory.
+        sha1::digest digest;
+
+        // The size of a file, or the total size of the files under a directory.
+        uint64_t size;
+
+        // The identity of a file, from when it was hashed.
+        digest_cache::file_id id;
+
+        // The entries of a directory are nodes [first_child, first_child + child_count).
+        size_t first_child;
+        size_t child_count;
+    };
+
+    // Hashes the tree of files at `path`.
+    //
+    // @param [in] path     The path to a directory, relative or absolute.
+    // @param [in] options  How to hash it.
+    // @throws std::runtime_error if `path` isn't a directory, or the tree contains anything that
+    //                      can't be hashed.
+    explicit merkle_tree(pn::string_view path, const merkle_options& options = merkle_options());
+    merkle_tree(const merkle_tree&) = delete;
+    merkle_tree(merkle_tree&&)      = default;
+
+    // @returns             The node for the directory itself.
+    const node& root() const { return _nodes[0]; }
+
+    // @returns             The node at `path`, relative to the root, or null if there isn't
+    //                      one.  The empty path is the root.
+    const node* find(pn::string_view path) const;
+
+    // @returns             The entries of `dir`, of which there are dir.child_count.
+    const node* children(const node& dir) const { return _nodes.data() + dir.first_child; }
+
+    // @returns             All nodes, in breadth-first order.
+    const std::vector<node>& nodes() const { return _nodes; }
+
+  private:
+    std::vector<node> _nodes;
+    int64_t           _time_ns;  // When hashing started.
+};
+
+enum MerkleChange { MERKLE_ADDED, MERKLE_REMOVED, MERKLE_MODIFIED };
+
+struct merkle_difference {
+    MerkleChange change;
+    pn::string   path;  // Relative to the root.
+};
+
+// Lists the differences between two trees.  Only subtrees whose digests differ are visited, so
+// the cost is proportional to what has changed, not to the size of the trees.  A directory which
+// was added or removed is listed once, without its contents; a path which changed between file
+// and directory is listed as modified.
+//
+// @param [in] before   The old tree.
+// @param [in] after    The new tree.
+// @returns             The paths which differ, in depth-first order.
+std::vector<merkle_difference> diff(const merkle_tree& before, const merkle_tree& after);
+
+}  // namespace sfz
+
+#endif  // SFZ_MERKLE_HPP_
@@ -42,6 +42,7 @@ pn::string join(pn::string_view root, string_views... segments) {
 void       chdir(pn::string_view path);
 pn::string getcwd();
 void       symlink(pn::string_view content, pn::string_view container);
+Stat       stat(pn::string_view path);
 
 #ifdef _MSC_VER
 typedef int mkdir_mode_t;
@@ -20,6 +20,8 @@ class mapped_file {
     // Maps the given file into memory.
     //
     // @param [in] path     The path to the file, relative or absolute.
+    // @throws std::runtime_error if the file couldn't be mapped, or is too large to fit in a
+    //                      pn::data_view.
     explicit mapped_file(pn::string_view path);
     mapped_file(const mapped_file&) = delete;
 
@@ -46,6 +48,151 @@ class mapped_file {
     size_t           _size;
 };
 
+// Reads a file sequentially with read(2), rather than mapping it.
+//
+// This works with anything that can be read, including pipes, character devices, and files in
+// /proc, and with files too large to map.  The kernel is advised that the file will be read
+// sequentially, so that it reads ahead aggressively.
+class streamed_file {
+  public:
+    // Opens the given file.
+    //
+    // @param [in] path     The path to the file, relative or absolute.
+    explicit streamed_file(pn::string_view path);
+
+    // Reads from a file descriptor which is already open, starting at its current offset.  The
+    // descriptor is not closed.
+    //
+    // @param [in] fd       The file descriptor to read from.
+    // @param [in] name     The name to use for the file in error messages.
+    streamed_file(int fd, pn::string_view name);
+    streamed_file(const streamed_file&) = delete;
+
+    // Closes the file, if it was opened by path.
+    ~streamed_file();
+
+    // @returns             The path to the file, or the name it was given.
+    pn::string_view path() const { return _path; }
+
+    // @returns             true if the file is a regular file, and so has a known size.
+    bool regular() const { return _regular; }
+
+    // @returns             The size of a regular file, when it was opened.
+    uint64_t size() const { return _size; }
+
+    // Reads the next part of the file.
+    //
+    // @param [out] data    The buffer to read into.
+    // @param [in] size     The size of `data`.
+    // @returns             The number of bytes read, which is 0 only at the end of the file.
+    size_t read(uint8_t* data, size_t size);
+
+    // Moves to `offset` from the start of a regular file, so that parts of it can be read out of
+    // order.
+    //
+    // @param [in] offset   The offset of the next byte to read.
+    void seek(uint64_t offset);
+
+  private:
+    friend class kernel_hasher;
+
+    void init();
+
+    const pn::string _path;
+    const int        _fd;
+    const bool       _owned;
+    bool             _regular;
+    uint64_t         _size;
+};
+
+// Hashes files in the kernel, with Linux's crypto API (AF_ALG).  File content is spliced from the
+// page cache to the kernel's hash function, so it is never copied into user space.  On other
+// systems, and on Linux kernels built without AF_ALG, it is never available.
+class kernel_hasher {
+  public:
+    // @param [in] algorithm    The kernel's name for the hash function, like "sha1".
+    explicit kernel_hasher(const char* algorithm);
+    kernel_hasher(const kernel_hasher&) = delete;
+    ~kernel_hasher();
+
+    // @returns             true if the kernel can compute the hash function.
+    bool available() const { return _socket >= 0; }
+
+    // Hashes the rest of `file`, from its current offset to its end.
+    //
+    // @param [in] file     The file to hash.
+    // @param [out] digest  Set to the digest.
+    // @param [in] size     The size of the digest, in bytes.
+    // @returns             true if the file was hashed, or false if the hash function isn't
+    //                      available or the file can't be spliced, in which case nothing was read
+    //                      from it.
+    // @throws std::runtime_error if reading the file fails after it was partly hashed.
+    bool digest(streamed_file& file, uint8_t* digest, size_t size);
+
+  private:
+    int _socket;  // Bound to the hash function; each digest accepts its own connection.
+};
+
+// A regular file which exists only in memory, with no name in the file system, so that reading
+// files can be measured without writing one.  On Linux, it's a memfd; elsewhere, there are none.
+class memory_file {
+  public:
+    // Creates the file, with its offset at the start.
+    //
+    // @param [in] data     The content of the file.
+    // @throws std::runtime_error if the file couldn't be created or written, or if the system
+    //                      can't create one.
+    explicit memory_file(pn::data_view data);
+    memory_file(const memory_file&) = delete;
+
+    // Closes the file, which frees its content.
+    ~memory_file();
+
+    // @returns             The file's descriptor, which can be read with streamed_file.
+    int fd() const { return _fd; }
+
+  private:
+    int _fd;
+};
+
+// Maps a file into memory in read-write mode, shared with other processes which map it.
+//
+// Opening the file is synchronized between processes with flock(2): if the file does not exist
+// or is empty, it is extended to `size` zero bytes.  Otherwise, the whole of the existing file is
+// mapped.  Either way, `init` is called on its content before any other process can map it.
+// Since a process may stop between extending the file and initializing it, `init` should treat
+// zeroed content as new, and leave other content alone.
+class shared_mapped_file {
+  public:
+    // @param [in] path     The path to the file, relative or absolute.
+    // @param [in] size     The size of the file to create.  Must be positive.
+    // @param [in] init     Called to initialize the content of the file, if it's new.
+    shared_mapped_file(pn::string_view path, size_t size, void (*init)(uint8_t* data, size_t size));
+    shared_mapped_file(const shared_mapped_file&) = delete;
+
+    // Unmaps the file.
+    ~shared_mapped_file();
+
+    // @returns             The path to the mapped file.
+    pn::string_view path() const { return _path; }
+
+    // @returns             The mapped content of the file, which may be modified.
+    uint8_t* data() const { return _data; }
+    size_t   size() const { return _size; }
+
+  private:
+    struct fd {
+        int no;
+        fd(const pn::string& path);
+        ~fd();
+    };
+
+    const pn::string _path;
+    fd               _fd;
+    uint8_t*         _data;
+    size_t           _size;
+};
+
 }  // namespace sfz
 
 #endif  // SFZ_FILE_HPP_
@@ -19,6 +19,7 @@
 
 #include <pn/data>
 #include <pn/string>
+#include <stdexcept>
 
 namespace sfz {
 
@@ -64,6 +65,147 @@ class mapped_file {
     view_of_file     _view_of_file;
 };
 
+// Reads a file sequentially with ReadFile(), rather than mapping it.
+//
+// This works with anything that can be read, including pipes and consoles, and with files too
+// large to map.  Files opened by path are opened with FILE_FLAG_SEQUENTIAL_SCAN, so that the
+// system reads ahead aggressively.
+class streamed_file {
+  public:
+    // Opens the given file.
+    //
+    // @param [in] path     The path to the file, relative or absolute.
+    explicit streamed_file(pn::string_view path);
+
+    // Reads from a C runtime file descriptor which is already open, starting at its current
+    // offset.  The descriptor is not closed.
+    //
+    // @param [in] fd       The file descriptor to read from.
+    // @param [in] name     The name to use for the file in error messages.
+    streamed_file(int fd, pn::string_view name);
+    streamed_file(const streamed_file&) = delete;
+
+    // Closes the file, if it was opened by path.
+    ~streamed_file();
+
+    // @returns             The path to the file, or the name it was given.
+    pn::string_view path() const { return _path; }
+
+    // @returns             true if the file is a regular file, and so has a known size.
+    bool regular() const { return _regular; }
+
+    // @returns             The size of a regular file, when it was opened.
+    uint64_t size() const { return _size; }
+
+    // Reads the next part of the file.
+    //
+    // @param [out] data    The buffer to read into.
+    // @param [in] size     The size of `data`.
+    // @returns             The number of bytes read, which is 0 only at the end of the file.
+    size_t read(uint8_t* data, size_t size);
+
+    // Moves to `offset` from the start of a regular file, so that parts of it can be read out of
+    // order.
+    //
+    // @param [in] offset   The offset of the next byte to read.
+    void seek(uint64_t offset);
+
+  private:
+    void init();
+
+    const pn::string _path;
+    const HANDLE     _h;
+    const bool       _owned;
+    bool             _regular;
+    uint64_t         _size;
+};
+
+// Hashes files in the kernel, where the system can.  Windows has no interface for this, so it is
+// never available; the interface matches the posix one, which uses Linux's AF_ALG.
+class kernel_hasher {
+  public:
+    // @param [in] algorithm    The kernel's name for the hash function, like "sha1".
+    explicit kernel_hasher(const char* algorithm) { static_cast<void>(algorithm); }
+    kernel_hasher(const kernel_hasher&) = delete;
+
+    // @returns             false.
+    bool available() const { return false; }
+
+    // @returns             false; nothing is read from `file`.
+    bool digest(streamed_file& file, uint8_t* digest, size_t size) {
+        static_cast<void>(file);
+        static_cast<void>(digest);
+        static_cast<void>(size);
+        return false;
+    }
+};
+
+// A regular file which exists only in memory.  Windows has nothing like Linux's memfd, and it's
+// only used to measure kernel_hasher, which is never available here; the interface matches the
+// posix one, and constructing one throws.
+class memory_file {
+  public:
+    // @throws std::runtime_error always.
+    explicit memory_file(pn::data_view data) : _fd(-1) {
+        static_cast<void>(data);
+        throw std::runtime_error("memory files are not supported");
+    }
+    memory_file(const memory_file&) = delete;
+
+    // @returns             -1.
+    int fd() const { return _fd; }
+
+  private:
+    int _fd;
+};
+
+// Maps a file into memory in read-write mode, shared with other processes which map it.
+//
+// Opening the file is synchronized between processes with LockFileEx(): if the file does not
+// exist or is empty, it is extended to `size` zero bytes.  Otherwise, the whole of the existing
+// file is mapped.  Either way, `init` is called on its content before any other process can map
+// it.  Since a process may stop between extending the file and initializing it, `init` should
+// treat zeroed content as new, and leave other content alone.
+class shared_mapped_file {
+  public:
+    // @param [in] path     The path to the file, relative or absolute.
+    // @param [in] size     The size of the file to create.  Must be positive.
+    // @param [in] init     Called to initialize the content of the file, if it's new.
+    shared_mapped_file(pn::string_view path, size_t size, void (*init)(uint8_t* data, size_t size));
+    shared_mapped_file(const shared_mapped_file&) = delete;
+
+    // Unmaps the file.
+    ~shared_mapped_file();
+
+    // @returns             The path to the mapped file.
+    pn::string_view path() const { return _path; }
+
+    // @returns             The mapped content of the file, which may be modified.
+    uint8_t* data() const { return reinterpret_cast<uint8_t*>(_view_of_file.ptr); }
+    size_t   size() const { return _size; }
+
+  private:
+    struct handle {
+        HANDLE h;
+        handle(pn::string_view path, HANDLE h);
+        ~handle();
+    };
+
+    struct view_of_file {
+        LPVOID ptr;
+        view_of_file(pn::string_view path, LPVOID ptr);
+        ~view_of_file();
+    };
+
+    static size_t lock_and_size(pn::string_view path, HANDLE h, size_t size);
+
+    const pn::string _path;
+    handle           _file;
+    size_t           _size;
+    handle           _file_mapping;
+    view_of_file     _view_of_file;
+};
+
 }  // namespace sfz
 
 #endif  // SFZ_FILE_HPP_
@@ -5,7 +5,9 @@
 
 #include <sfz/args.hpp>
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <exception>
 #include <sfz/encoding.hpp>
 #include <sfz/range.hpp>
 #include <sfz/string-utils.hpp>
@@ -141,6 +143,24 @@ void parse(size_t argc, char* const* argv, const callbacks& callbacks) {
     }
 }
 
+// Prints an exception, followed by any nested in it.
+static void print_exception(const std::exception& e) {
+    fprintf(stderr, "%s", e.what());
+    try {
+        std::rethrow_if_nested(e);
+    } catch (const std::exception& nested) {
+        fprintf(stderr, ": ");
+        print_exception(nested);
+    } catch (...) {
+    }
+}
+
+void print_error(const char* program, const std::exception& e) {
+    fprintf(stderr, "%s: ", program);
+    print_exception(e);
+    fprintf(stderr, "\n");
+}
+
 template <>
 void integer_option<int64_t>(pn::string_view value, int64_t* out) {
     pn_error_code_t error;
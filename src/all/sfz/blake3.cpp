@@ -0,0 +1,364 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <sfz/digest.hpp>
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace sfz {
+
+namespace {
+
+// Follows the BLAKE3 specification and its reference implementation.
+
+const uint32_t kIV[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+const int kMessagePermutation[16] = {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+
+const size_t kBlockLen = 64;
+const size_t kChunkLen = 1024;
+
+const uint32_t kChunkStart = 1 << 0;
+const uint32_t kChunkEnd   = 1 << 1;
+const uint32_t kParent     = 1 << 2;
+const uint32_t kRoot       = 1 << 3;
+
+// Subtrees smaller than this are hashed on a single thread.
+const size_t kMinParallelSize = 1 << 20;
+
+inline uint32_t right_rotate(uint32_t word, int bits) {
+    return (word >> bits) | (word << (32 - bits));
+}
+
+inline uint32_t load_le32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline void g(uint32_t* s, int a, int b, int c, int d, uint32_t x, uint32_t y) {
+    s[a] = s[a] + s[b] + x;
+    s[d] = right_rotate(s[d] ^ s[a], 16);
+    s[c] = s[c] + s[d];
+    s[b] = right_rotate(s[b] ^ s[c], 12);
+    s[a] = s[a] + s[b] + y;
+    s[d] = right_rotate(s[d] ^ s[a], 8);
+    s[c] = s[c] + s[d];
+    s[b] = right_rotate(s[b] ^ s[c], 7);
+}
+
+// Compresses one 64-byte block into the 16 words of `out`.  The first 8 words are the chaining
+// value; all 16 are used for extended output, which is not needed here.
+void compress(
+        const uint32_t* cv, const uint8_t* block, uint64_t counter, uint32_t block_len,
+        uint32_t flags, uint32_t* out) {
+    uint32_t m[16];
+    for (int i = 0; i < 16; ++i) {
+        m[i] = load_le32(block + (4 * i));
+    }
+    uint32_t s[16] = {cv[0],  cv[1],  cv[2],  cv[3],
+                      cv[4],  cv[5],  cv[6],  cv[7],
+                      kIV[0], kIV[1], kIV[2], kIV[3],
+                      static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32),
+                      block_len, flags};
+    for (int round = 0; round < 7; ++round) {
+        g(s, 0, 4, 8, 12, m[0], m[1]);
+        g(s, 1, 5, 9, 13, m[2], m[3]);
+        g(s, 2, 6, 10, 14, m[4], m[5]);
+        g(s, 3, 7, 11, 15, m[6], m[7]);
+        g(s, 0, 5, 10, 15, m[8], m[9]);
+        g(s, 1, 6, 11, 12, m[10], m[11]);
+        g(s, 2, 7, 8, 13, m[12], m[13]);
+        g(s, 3, 4, 9, 14, m[14], m[15]);
+        uint32_t permuted[16];
+        for (int i = 0; i < 16; ++i) {
+            permuted[i] = m[kMessagePermutation[i]];
+        }
+        memcpy(m, permuted, sizeof(m));
+    }
+    for (int i = 0; i < 8; ++i) {
+        out[i] = s[i] ^ s[i + 8];
+        out[i + 8] = s[i + 8] ^ cv[i];
+    }
+}
+
+// The inputs to the compression of the final block of a chunk or of a parent node.  Which
+// node is the root isn't known until the input ends, so the last compression is deferred.
+struct node_output {
+    uint32_t cv[8];
+    uint8_t  block[64];
+    uint64_t counter;
+    uint32_t block_len;
+    uint32_t flags;
+
+    void chaining_value(uint32_t* out) const {
+        uint32_t words[16];
+        compress(cv, block, counter, block_len, flags, words);
+        memcpy(out, words, 8 * sizeof(uint32_t));
+    }
+
+    void root(uint8_t* out) const {
+        uint32_t words[16];
+        compress(cv, block, 0, block_len, flags | kRoot, words);
+        for (int i = 0; i < 32; ++i) {
+            out[i] = words[i / 4] >> (8 * (i % 4));
+        }
+    }
+};
+
+node_output parent_output(const uint32_t* left, const uint32_t* right) {
+    node_output o;
+    memcpy(o.cv, kIV, sizeof(kIV));
+    for (int i = 0; i < 8; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            o.block[(4 * i) + j]      = left[i] >> (8 * j);
+            o.block[32 + (4 * i) + j] = right[i] >> (8 * j);
+        }
+    }
+    o.counter   = 0;
+    o.block_len = kBlockLen;
+    o.flags     = kParent;
+    return o;
+}
+
+void parent_cv(const uint32_t* left, const uint32_t* right, uint32_t* out) {
+    parent_output(left, right).chaining_value(out);
+}
+
+// Computes the chaining value of a whole chunk, which is not the root.
+void chunk_cv(const uint8_t* input, uint64_t counter, uint32_t* out) {
+    uint32_t cv[8];
+    memcpy(cv, kIV, sizeof(kIV));
+    for (size_t i = 0; i < (kChunkLen / kBlockLen); ++i) {
+        uint32_t flags = 0;
+        if (i == 0) {
+            flags |= kChunkStart;
+        }
+        if (i == (kChunkLen / kBlockLen) - 1) {
+            flags |= kChunkEnd;
+        }
+        uint32_t words[16];
+        compress(cv, input + (i * kBlockLen), counter, kBlockLen, flags, words);
+        memcpy(cv, words, sizeof(cv));
+    }
+    memcpy(out, cv, sizeof(cv));
+}
+
+// Computes the chaining value of a complete subtree of `size` bytes, a power of two number of
+// chunks, which is not the root.  The halves are hashed concurrently if `threads` allows.
+void subtree_cv(const uint8_t* input, size_t size, uint64_t counter, int threads, uint32_t* out) {
+    if (size == kChunkLen) {
+        chunk_cv(input, counter, out);
+        return;
+    }
+    const size_t   half   = size / 2;
+    const uint64_t chunks = half / kChunkLen;
+    uint32_t       left[8], right[8];
+    if ((threads > 1) && (half >= kMinParallelSize)) {
+        const int   left_threads = threads / 2;
+        std::thread worker([=, &left] { subtree_cv(input, half, counter, left_threads, left); });
+        subtree_cv(input + half, half, counter + chunks, threads - left_threads, right);
+        worker.join();
+    } else {
+        subtree_cv(input, half, counter, 1, left);
+        subtree_cv(input + half, half, counter + chunks, 1, right);
+    }
+    parent_cv(left, right, out);
+}
+
+int popcount(uint64_t x) {
+    int count = 0;
+    for (; x; x &= x - 1) {
+        ++count;
+    }
+    return count;
+}
+
+}  // namespace
+
+blake3::blake3() { reset(); }
+
+blake3::blake3(const blake3& other) { memcpy(this, &other, sizeof(blake3)); }
+
+void blake3::reset() {
+    memcpy(_chunk.cv, kIV, sizeof(kIV));
+    _chunk.counter           = 0;
+    _chunk.block_len         = 0;
+    _chunk.blocks_compressed = 0;
+    _cv_stack_len            = 0;
+}
+
+// After merging, the stack holds one entry per 1 bit in `chunk_counter`.  This is only safe once
+// it is known that more input follows, since otherwise the top two entries might be the root's
+// children.
+void blake3::merge_cv_stack(uint64_t chunk_counter) {
+    const int post_merge = popcount(chunk_counter);
+    while (_cv_stack_len > post_merge) {
+        parent_cv(_cv_stack[_cv_stack_len - 2], _cv_stack[_cv_stack_len - 1],
+                  _cv_stack[_cv_stack_len - 2]);
+        --_cv_stack_len;
+    }
+}
+
+void blake3::push_cv(const uint32_t* cv, uint64_t chunk_counter) {
+    merge_cv_stack(chunk_counter);
+    memcpy(_cv_stack[_cv_stack_len++], cv, 8 * sizeof(uint32_t));
+}
+
+void blake3::write(pn::data_view input) { write_parallel(input, 1); }
+
+void blake3::write_parallel(pn::data_view input, int threads) {
+    const uint8_t* bytes = input.data();
+    size_t         size  = input.size();
+
+    // Finish a partial chunk first.  The current chunk is always kept back until more input
+    // arrives, in case it turns out to be the last (and so, if alone, the root).
+    while (size > 0) {
+        const size_t chunk_len = (_chunk.blocks_compressed * kBlockLen) + _chunk.block_len;
+        if (chunk_len == kChunkLen) {
+            // The current chunk is complete and more input follows.
+            uint32_t words[16];
+            compress(_chunk.cv, _chunk.block, _chunk.counter, kBlockLen,
+                     kChunkEnd | ((_chunk.blocks_compressed == 0) ? kChunkStart : 0), words);
+            push_cv(words, _chunk.counter);
+            const uint64_t next = _chunk.counter + 1;
+            memcpy(_chunk.cv, kIV, sizeof(kIV));
+            _chunk.counter           = next;
+            _chunk.block_len         = 0;
+            _chunk.blocks_compressed = 0;
+        } else if (chunk_len > 0) {
+            if (_chunk.block_len == static_cast<int>(kBlockLen)) {
+                uint32_t words[16];
+                compress(_chunk.cv, _chunk.block, _chunk.counter, kBlockLen,
+                         (_chunk.blocks_compressed == 0) ? kChunkStart : 0, words);
+                memcpy(_chunk.cv, words, sizeof(_chunk.cv));
+                ++_chunk.blocks_compressed;
+                _chunk.block_len = 0;
+            }
+            const size_t fill = std::min(kBlockLen - _chunk.block_len, size);
+            memcpy(_chunk.block + _chunk.block_len, bytes, fill);
+            _chunk.block_len += fill;
+            bytes += fill;
+            size -= fill;
+        } else {
+            break;
+        }
+    }
+
+    // Hash whole subtrees straight from the input, as large as the chunk count so far allows,
+    // keeping back at least one byte for the current chunk.
+    while (size > kChunkLen) {
+        size_t subtree = kChunkLen;
+        while ((subtree * 2) < size) {
+            subtree *= 2;
+        }
+        const uint64_t counter = _chunk.counter;
+        while (((subtree / kChunkLen) - 1) & counter) {
+            subtree /= 2;
+        }
+        const uint64_t chunks = subtree / kChunkLen;
+        if (chunks == 1) {
+            uint32_t cv[8];
+            chunk_cv(bytes, counter, cv);
+            push_cv(cv, counter);
+        } else {
+            // Push the two halves rather than their parent, which might turn out to be the root.
+            const size_t half = subtree / 2;
+            uint32_t     left[8], right[8];
+            if ((threads > 1) && (half >= kMinParallelSize)) {
+                const int   left_threads = threads / 2;
+                std::thread worker(
+                        [=, &left] { subtree_cv(bytes, half, counter, left_threads, left); });
+                subtree_cv(bytes + half, half, counter + (chunks / 2), threads - left_threads,
+                           right);
+                worker.join();
+            } else {
+                subtree_cv(bytes, half, counter, 1, left);
+                subtree_cv(bytes + half, half, counter + (chunks / 2), 1, right);
+            }
+            push_cv(left, counter);
+            push_cv(right, counter + (chunks / 2));
+        }
+        _chunk.counter = counter + chunks;
+        bytes += subtree;
+        size -= subtree;
+    }
+
+    // Start the current chunk with what remains, if anything.
+    if (size > 0) {
+        merge_cv_stack(_chunk.counter);
+    }
+    while (size > 0) {
+        if (_chunk.block_len == static_cast<int>(kBlockLen)) {
+            uint32_t words[16];
+            compress(_chunk.cv, _chunk.block, _chunk.counter, kBlockLen,
+                     (_chunk.blocks_compressed == 0) ? kChunkStart : 0, words);
+            memcpy(_chunk.cv, words, sizeof(_chunk.cv));
+            ++_chunk.blocks_compressed;
+            _chunk.block_len = 0;
+        }
+        const size_t fill = std::min(kBlockLen - _chunk.block_len, size);
+        memcpy(_chunk.block + _chunk.block_len, bytes, fill);
+        _chunk.block_len += fill;
+        bytes += fill;
+        size -= fill;
+    }
+}
+
+blake3::digest blake3::compute() const {
+    node_output o;
+    memcpy(o.cv, _chunk.cv, sizeof(o.cv));
+    memcpy(o.block, _chunk.block, _chunk.block_len);
+    memset(o.block + _chunk.block_len, 0, kBlockLen - _chunk.block_len);
+    o.counter   = _chunk.counter;
+    o.block_len = _chunk.block_len;
+    o.flags     = kChunkEnd | ((_chunk.blocks_compressed == 0) ? kChunkStart : 0);
+
+    for (int i = _cv_stack_len - 1; i >= 0; --i) {
+        uint32_t cv[8];
+        o.chaining_value(cv);
+        o = parent_output(_cv_stack[i], cv);
+    }
+
+    digest result;
+    o.root(result.d);
+    return result;
+}
+
+blake3::digest::digest(pn::data_view data) {
+    if (data.size() != 32) {
+        throw std::runtime_error(
+                pn::format("blake3 digest created from data of size {0}", data.size()).c_str());
+    }
+    memcpy(d, data.data(), sizeof(d));
+}
+
+pn::data blake3::digest::data() const {
+    pn::data out;
+    out.output().write(pn::data_view{d, static_cast<int>(sizeof(d))});
+    return out;
+}
+
+pn::string blake3::digest::hex() const {
+    char  buf[65];
+    char* ptr = buf;
+    for (int i = 0; i < 32; ++i) {
+        sprintf(ptr, "%02x", d[i]);
+        ptr += 2;
+    }
+    return pn::string_view{buf, 64}.copy();
+}
+
+bool operator==(const blake3::digest& lhs, const blake3::digest& rhs) {
+    return memcmp(lhs.d, rhs.d, sizeof(lhs.d)) == 0;
+}
+
+bool operator!=(const blake3::digest& lhs, const blake3::digest& rhs) { return !(lhs == rhs); }
+
+}  // namespace sfz
@@ -0,0 +1,374 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <sfz/checksum.hpp>
+
+#include <string.h>
+#include <algorithm>
+#include <sfz/cpu.hpp>
+
+#ifdef SFZ_X86
+#include <immintrin.h>
+#endif
+
+namespace sfz {
+
+namespace {
+
+// The polynomials, bit-reflected, as both CRCs process the least significant bit of each byte
+// first.
+const uint32_t kCrc32Polynomial  = 0xedb88320;
+const uint32_t kCrc32cPolynomial = 0x82f63b78;
+
+// Adler-32 sums are taken modulo this prime.
+const uint32_t kAdlerModulus = 65521;
+
+// The most bytes that can be added to Adler-32 sums in 32 bits before they must be reduced.
+const size_t kAdlerMaxBlock = 5552;
+
+typedef uint32_t (*crc_f)(uint32_t crc, const uint8_t* data, size_t size);
+
+// Tables for the "slicing-by-8" method: table[k][b] is the CRC of byte b followed by k zero
+// bytes, so eight bytes can be processed with eight independent lookups.
+struct crc_tables {
+    uint32_t table[8][256];
+
+    explicit crc_tables(uint32_t polynomial) {
+        for (uint32_t b = 0; b < 256; ++b) {
+            uint32_t crc = b;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+            }
+            table[0][b] = crc;
+        }
+        for (int k = 1; k < 8; ++k) {
+            for (int b = 0; b < 256; ++b) {
+                const uint32_t prev = table[k - 1][b];
+                table[k][b]         = (prev >> 8) ^ table[0][prev & 0xff];
+            }
+        }
+    }
+};
+
+uint32_t load_le32(const uint8_t* p) {
+    return uint32_t{p[0]} | (uint32_t{p[1]} << 8) | (uint32_t{p[2]} << 16) |
+           (uint32_t{p[3]} << 24);
+}
+
+uint32_t portable_crc(const crc_tables& tables, uint32_t crc, const uint8_t* data, size_t size) {
+    const uint32_t(*t)[256] = tables.table;
+    for (; size >= 8; size -= 8, data += 8) {
+        const uint32_t lo = crc ^ load_le32(data);
+        const uint32_t hi = load_le32(data + 4);
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    }
+    for (; size > 0; --size, ++data) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xff];
+    }
+    return crc;
+}
+
+uint32_t portable_crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    static const crc_tables tables(kCrc32Polynomial);
+    return portable_crc(tables, crc, data, size);
+}
+
+uint32_t portable_crc32c(uint32_t crc, const uint8_t* data, size_t size) {
+    static const crc_tables tables(kCrc32cPolynomial);
+    return portable_crc(tables, crc, data, size);
+}
+
+#ifdef SFZ_X86
+
+// Writes of at least this many bytes are folded with PCLMULQDQ.  Folding needs 64 bytes, which
+// is enough for it to beat tables; but below about 200 bytes, setting up and reducing the folded
+// state costs more than it saves over the crc32 instruction.
+const size_t kMinFoldSize       = 64;
+const size_t kMinCrc32cFoldSize = 256;
+
+// Constants for folding a CRC with carry-less multiplication, from Intel's "Fast CRC Computation
+// for Generic Polynomials Using PCLMULQDQ Instruction".  With P the polynomial and ' denoting bit
+// reflection, k1 = (x^544 mod P)' << 1, k2 = (x^480 mod P)' << 1, k3 = (x^160 mod P)' << 1,
+// k4 = (x^96 mod P)' << 1, k5 = (x^64 mod P)' << 1, and mu = (x^64 / P)'.
+struct fold_constants {
+    uint64_t k1k2[2];
+    uint64_t k3k4[2];
+    uint64_t k5[2];
+    uint64_t poly_mu[2];
+};
+
+const fold_constants kCrc32Fold = {
+        {0x154442bd4, 0x1c6e41596},
+        {0x1751997d0, 0x0ccaa009e},
+        {0x163cd6124, 0},
+        {0x1db710641, 0x1f7011641},
+};
+
+const fold_constants kCrc32cFold = {
+        {0x0740eef02, 0x09e4addf8},
+        {0x0f20c0dfe, 0x14cd00bd6},
+        {0x0dd45aab8, 0},
+        {0x105ec76f1, 0x0dea713f1},
+};
+
+__m128i load_constants(const uint64_t* k) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(k));
+}
+
+// Folds `x` forward 128 bits, or 512 bits with k1k2, and adds `next`.
+SFZ_TARGET("pclmul,sse4.1")
+inline __m128i fold(__m128i x, __m128i k, __m128i next) {
+    return _mm_xor_si128(
+            _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)),
+            next);
+}
+
+// Computes the CRC of data[0, size & ~15) by folding.  Four lanes of 128 bits are folded forward
+// by 512 bits at a time, to hide the latency of the multiplications; they are then folded into
+// one lane, and the result reduced to 32 bits with Barrett reduction.
+//
+// @param [in] size     The size of the data.  Must be at least 64.
+SFZ_TARGET("pclmul,sse4.1")
+uint32_t fold_crc(const fold_constants& k, uint32_t crc, const uint8_t* data, size_t size) {
+    const __m128i* in = reinterpret_cast<const __m128i*>(data);
+    __m128i        x1 = _mm_xor_si128(_mm_loadu_si128(in + 0), _mm_cvtsi32_si128(crc));
+    __m128i        x2 = _mm_loadu_si128(in + 1);
+    __m128i        x3 = _mm_loadu_si128(in + 2);
+    __m128i        x4 = _mm_loadu_si128(in + 3);
+    in += 4;
+    size -= 64;
+
+    __m128i k12 = load_constants(k.k1k2);
+    for (; size >= 64; size -= 64, in += 4) {
+        x1 = fold(x1, k12, _mm_loadu_si128(in + 0));
+        x2 = fold(x2, k12, _mm_loadu_si128(in + 1));
+        x3 = fold(x3, k12, _mm_loadu_si128(in + 2));
+        x4 = fold(x4, k12, _mm_loadu_si128(in + 3));
+    }
+
+    const __m128i k34 = load_constants(k.k3k4);
+    x1                = fold(x1, k34, x2);
+    x1                = fold(x1, k34, x3);
+    x1                = fold(x1, k34, x4);
+    for (; size >= 16; size -= 16, ++in) {
+        x1 = fold(x1, k34, _mm_loadu_si128(in));
+    }
+
+    // Fold 128 bits to 64, then reduce to 32.
+    const __m128i low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), _mm_clmulepi64_si128(x1, k34, 0x10));
+    x1 = _mm_xor_si128(
+            _mm_srli_si128(x1, 4),
+            _mm_clmulepi64_si128(_mm_and_si128(x1, low32), load_constants(k.k5), 0x00));
+
+    const __m128i poly = load_constants(k.poly_mu);
+    __m128i       t    = _mm_clmulepi64_si128(_mm_and_si128(x1, low32), poly, 0x10);
+    t                  = _mm_clmulepi64_si128(_mm_and_si128(t, low32), poly, 0x00);
+    return _mm_extract_epi32(_mm_xor_si128(x1, t), 1);
+}
+
+SFZ_TARGET("pclmul,sse4.1")
+uint32_t clmul_crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    if (size >= kMinFoldSize) {
+        crc = fold_crc(kCrc32Fold, crc, data, size);
+        data += size & ~size_t{15};
+        size &= 15;
+    }
+    return portable_crc32(crc, data, size);
+}
+
+// The crc32 instruction computes CRC-32C, a word at a time.
+SFZ_TARGET("sse4.2")
+uint32_t sse42_crc32c(uint32_t crc, const uint8_t* data, size_t size) {
+#if defined(__x86_64__) || defined(_M_X64)
+    uint64_t crc64 = crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    for (; size >= 4; size -= 4, data += 4) {
+        uint32_t word;
+        memcpy(&word, data, 4);
+        crc = _mm_crc32_u32(crc, word);
+    }
+    for (; size > 0; --size, ++data) {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+    return crc;
+}
+
+SFZ_TARGET("pclmul,sse4.2")
+uint32_t clmul_crc32c(uint32_t crc, const uint8_t* data, size_t size) {
+    if (size >= kMinCrc32cFoldSize) {
+        crc = fold_crc(kCrc32cFold, crc, data, size);
+        data += size & ~size_t{15};
+        size &= 15;
+    }
+    return sse42_crc32c(crc, data, size);
+}
+
+#endif  // SFZ_X86
+
+crc_f best_crc32() {
+#ifdef SFZ_X86
+    if (cpu().pclmul && cpu().sse41) {
+        return clmul_crc32;
+    }
+#endif
+    return portable_crc32;
+}
+
+crc_f best_crc32c() {
+#ifdef SFZ_X86
+    if (cpu().pclmul && cpu().sse42) {
+        return clmul_crc32c;
+    } else if (cpu().sse42) {
+        return sse42_crc32c;
+    }
+#endif
+    return portable_crc32c;
+}
+
+typedef void (*adler_f)(uint32_t* a, uint32_t* b, const uint8_t* data, size_t size);
+
+void portable_adler(uint32_t* a, uint32_t* b, const uint8_t* data, size_t size) {
+    uint32_t s1 = *a, s2 = *b;
+    while (size > 0) {
+        size_t n = (size < kAdlerMaxBlock) ? size : kAdlerMaxBlock;
+        size -= n;
+        for (; n >= 4; n -= 4, data += 4) {
+            s1 += data[0];
+            s2 += s1;
+            s1 += data[1];
+            s2 += s1;
+            s1 += data[2];
+            s2 += s1;
+            s1 += data[3];
+            s2 += s1;
+        }
+        for (; n > 0; --n, ++data) {
+            s1 += *data;
+            s2 += s1;
+        }
+        s1 %= kAdlerModulus;
+        s2 %= kAdlerModulus;
+    }
+    *a = s1;
+    *b = s2;
+}
+
+#ifdef SFZ_X86
+
+// The SIMD versions sum blocks of `width` bytes at once.  Over one block, the byte at position i
+// adds (width - i) times its value to b, with a multiply-add against descending weights, and the
+// block's sum adds width times its value to b for every block after it.  So per lane, they keep
+// the sum of the bytes (s1), the sum of the running value of s1 before each block (ps), and the
+// weighted sums (s2); at the end of a run of blocks, these are added across lanes into a and b.
+
+// Adds a and b, and the totals across lanes of s1, ps, and s2 for `size` bytes, and reduces.
+void finish_adler(
+        uint32_t* a, uint32_t* b, size_t size, size_t width, uint64_t s1, uint64_t ps,
+        uint64_t s2) {
+    const uint64_t b64 = *b + (uint64_t{*a} * size) + (width * ps) + s2;
+    *a                 = (*a + s1) % kAdlerModulus;
+    *b                 = b64 % kAdlerModulus;
+}
+
+SFZ_TARGET("ssse3")
+uint32_t hsum(__m128i v) {
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4e));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0xb1));
+    return _mm_cvtsi128_si32(v);
+}
+
+SFZ_TARGET("ssse3")
+void ssse3_adler(uint32_t* a, uint32_t* b, const uint8_t* data, size_t size) {
+    const size_t  width   = 16;
+    const __m128i weights = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i ones    = _mm_set1_epi16(1);
+    const __m128i zero    = _mm_setzero_si128();
+    while (size >= width) {
+        const size_t n = std::min(size, kAdlerMaxBlock) & ~(width - 1);
+        __m128i      s1 = zero, ps = zero, s2 = zero;
+        for (size_t i = 0; i < n; i += width) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            ps              = _mm_add_epi32(ps, s1);
+            s1              = _mm_add_epi32(s1, _mm_sad_epu8(x, zero));
+            s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_maddubs_epi16(x, weights), ones));
+        }
+        finish_adler(a, b, n, width, hsum(s1), hsum(ps), hsum(s2));
+        data += n;
+        size -= n;
+    }
+    portable_adler(a, b, data, size);
+}
+
+SFZ_TARGET("avx2")
+uint32_t hsum(__m256i v) {
+    __m128i x = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    x         = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0x4e));
+    x         = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0xb1));
+    return _mm_cvtsi128_si32(x);
+}
+
+SFZ_TARGET("avx2")
+void avx2_adler(uint32_t* a, uint32_t* b, const uint8_t* data, size_t size) {
+    const size_t  width   = 32;
+    const __m256i weights = _mm256_setr_epi8(
+            32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11,
+            10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i zero = _mm256_setzero_si256();
+    while (size >= width) {
+        const size_t n = std::min(size, kAdlerMaxBlock) & ~(width - 1);
+        __m256i      s1 = zero, ps = zero, s2 = zero;
+        for (size_t i = 0; i < n; i += width) {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            ps              = _mm256_add_epi32(ps, s1);
+            s1              = _mm256_add_epi32(s1, _mm256_sad_epu8(x, zero));
+            s2 = _mm256_add_epi32(s2, _mm256_madd_epi16(_mm256_maddubs_epi16(x, weights), ones));
+        }
+        finish_adler(a, b, n, width, hsum(s1), hsum(ps), hsum(s2));
+        data += n;
+        size -= n;
+    }
+    portable_adler(a, b, data, size);
+}
+
+#endif  // SFZ_X86
+
+adler_f best_adler() {
+#ifdef SFZ_X86
+    if (cpu().avx2) {
+        return avx2_adler;
+    } else if (cpu().ssse3) {
+        return ssse3_adler;
+    }
+#endif
+    return portable_adler;
+}
+
+}  // namespace
+
+void crc32c::write(pn::data_view input) {
+    static const crc_f crc_fn = best_crc32c();
+    _state                    = crc_fn(_state, input.data(), input.size());
+}
+
+void crc32::write(pn::data_view input) {
+    static const crc_f crc_fn = best_crc32();
+    _state                    = crc_fn(_state, input.data(), input.size());
+}
+
+void adler32::write(pn::data_view input) {
+    static const adler_f adler_fn = best_adler();
+    adler_fn(&_a, &_b, input.data(), input.size());
+}
+
+}  // namespace sfz
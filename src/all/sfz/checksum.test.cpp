@@ -0,0 +1,169 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <pn/output>
+#include <sfz/checksum.hpp>
+#include <sfz/os.hpp>
+#include <sfz/range.hpp>
+#include <sfz/test-data.hpp>
+#include <vector>
+
+using testing::Eq;
+using testing::NotNull;
+
+namespace sfz {
+
+namespace {
+
+using ChecksumTest = ::testing::Test;
+
+// Straightforward implementations, one bit or byte at a time, to check the fast ones against.
+uint32_t reference_crc(uint32_t polynomial, pn::data_view data) {
+    uint32_t crc = 0xffffffff;
+    for (uint8_t byte : data) {
+        crc ^= byte;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+        }
+    }
+    return ~crc;
+}
+
+uint32_t reference_adler32(pn::data_view data) {
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : data) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+template <typename hasher>
+uint32_t checksum(pn::data_view data) {
+    hasher h;
+    h.write(data);
+    return h.compute();
+}
+
+TEST_F(ChecksumTest, KnownAnswers) {
+    const pn::string_view check = "123456789";
+    EXPECT_THAT(checksum<crc32c>(check.as_data()), Eq(0xe3069283u));
+    EXPECT_THAT(checksum<crc32>(check.as_data()), Eq(0xcbf43926u));
+    EXPECT_THAT(checksum<adler32>(pn::string_view{"Wikipedia"}.as_data()), Eq(0x11e60398u));
+
+    EXPECT_THAT(crc32c().compute(), Eq(0u));
+    EXPECT_THAT(crc32().compute(), Eq(0u));
+    EXPECT_THAT(adler32().compute(), Eq(1u));
+}
+
+// Every size and alignment near the thresholds of the fast paths, and some large ones, should
+// give the same result as the reference implementations.
+TEST_F(ChecksumTest, Sizes) {
+    const pn::data data = random_data(1 << 20, 1);
+    std::vector<int> sizes;
+    for (int size = 0; size < 600; ++size) {
+        sizes.push_back(size);
+    }
+    for (int size : {1000, 4096, 5551, 5552, 5553, 11104, 65536, 100003, (1 << 20) - 3}) {
+        sizes.push_back(size);
+    }
+    for (int size : sizes) {
+        for (int offset : {0, 1, 3}) {
+            const pn::data_view d = pn::data_view{data}.slice(offset, size);
+            EXPECT_THAT(checksum<crc32c>(d), Eq(reference_crc(0x82f63b78, d))) << size;
+            EXPECT_THAT(checksum<crc32>(d), Eq(reference_crc(0xedb88320, d))) << size;
+            EXPECT_THAT(checksum<adler32>(d), Eq(reference_adler32(d))) << size;
+        }
+    }
+
+    // Adler-32's sums must be reduced before they overflow, even for bytes of all ones.
+    const std::vector<uint8_t> ones(100000, 0xff);
+    const pn::data_view        max{ones.data(), static_cast<int>(ones.size())};
+    EXPECT_THAT(checksum<adler32>(max), Eq(reference_adler32(max)));
+}
+
+// Writing in pieces should give the same result as writing everything at once.
+TEST_F(ChecksumTest, Incremental) {
+    const pn::data data = random_data(100000, 2);
+    crc32c         c;
+    crc32          z;
+    adler32        a;
+    int            offset = 0;
+    for (int size = 1; offset < data.size(); size = (size * 3) + 1) {
+        const pn::data_view piece = pn::data_view{data}.slice(offset).slice(
+                0, std::min(size, data.size() - offset));
+        c.write(piece);
+        z.write(piece);
+        a.write(piece);
+        offset += piece.size();
+    }
+    EXPECT_THAT(c.compute(), Eq(checksum<crc32c>(data)));
+    EXPECT_THAT(z.compute(), Eq(checksum<crc32>(data)));
+    EXPECT_THAT(a.compute(), Eq(checksum<adler32>(data)));
+
+    c.reset();
+    EXPECT_THAT(c.compute(), Eq(0u));
+}
+
+TEST_F(ChecksumTest, TypedWrites) {
+    crc32c typed, bytes;
+    typed.write<uint32_t, pn::string_view>(0x01020304, "abc");
+    const uint8_t expected[] = {1, 2, 3, 4, 'a', 'b', 'c'};
+    bytes.write(pn::data_view{expected, sizeof(expected)});
+    EXPECT_THAT(typed.compute(), Eq(bytes.compute()));
+}
+
+TEST_F(ChecksumTest, File) {
+    TemporaryDirectory dir("checksum-test");
+    const pn::string   path = pn::format("{0}/file", dir.path());
+    const pn::data     data = random_data(300000, 3);
+    {
+        pn::output out = pn::output{path, pn::binary};
+        ASSERT_THAT(out.c_obj(), NotNull());
+        ASSERT_THAT(out.write(data), Eq(true));
+    }
+    file_digest_options streamed;
+    streamed.read = READ_STREAMED;
+    EXPECT_THAT(file_digest<crc32c>(path), Eq(checksum<crc32c>(data)));
+    EXPECT_THAT(file_digest<crc32c>(path, streamed), Eq(checksum<crc32c>(data)));
+    EXPECT_THAT(file_digest<crc32>(path), Eq(checksum<crc32>(data)));
+    EXPECT_THAT(file_digest<adler32>(path), Eq(checksum<adler32>(data)));
+}
+
+// Trees should be summed as tree_digest() hashes them: each file's name and content in order.
+TEST_F(ChecksumTest, Tree) {
+    TemporaryDirectory dir("checksum-test");
+    const pn::string   tree = pn::format("{0}/tree", dir.path());
+    crc32c             expected_crc32c;
+    crc32              expected_crc32;
+    adler32            expected_adler32;
+    for (int i : range(3)) {
+        const pn::string name = pn::format("{0}", i);
+        const pn::string path = pn::format("{0}/{1}", tree, name);
+        const pn::data   data = random_data((100000 * i) + 1, i);
+        makedirs(path::dirname(path), 0700);
+        {
+            pn::output out = pn::output{path, pn::binary};
+            ASSERT_THAT(out.c_obj(), NotNull());
+            ASSERT_THAT(out.write(data), Eq(true));
+        }
+        expected_crc32c.write<uint64_t, pn::string_view, uint64_t>(name.size(), name, data.size());
+        expected_crc32c.write(data);
+        expected_crc32.write<uint64_t, pn::string_view, uint64_t>(name.size(), name, data.size());
+        expected_crc32.write(data);
+        expected_adler32.write<uint64_t, pn::string_view, uint64_t>(
+                name.size(), name, data.size());
+        expected_adler32.write(data);
+    }
+    EXPECT_THAT(tree_digest<crc32c>(tree), Eq(expected_crc32c.compute()));
+    EXPECT_THAT(tree_digest<crc32>(tree), Eq(expected_crc32.compute()));
+    EXPECT_THAT(tree_digest<adler32>(tree), Eq(expected_adler32.compute()));
+}
+
+}  // namespace
+}  // namespace sfz
@@ -0,0 +1,182 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <sfz/chunk.hpp>
+
+#include <algorithm>
+#include <sfz/file.hpp>
+#include <sfz/parallel.hpp>
+#include <stdexcept>
+
+namespace sfz {
+
+namespace {
+
+// The gear hash of a window doesn't depend on bytes more than this far before its end, since
+// each byte's contribution is shifted left once per byte after it.
+const size_t kWindow = 64;
+
+// Boundaries are searched for in segments of this size, one per task.  Each segment is searched
+// independently, with its own warm-up, so segments can be searched concurrently.
+const size_t kSegmentSize = 4 << 20;
+
+// A position at which the gear hash matched the looser mask.
+struct candidate {
+    uint64_t end;     // The offset just after the byte at which it matched.
+    bool     strict;  // Whether it matched the stricter mask too.
+};
+
+struct masks {
+    uint64_t loose;
+    uint64_t strict;
+};
+
+// The gear table maps each byte to a random 64-bit value.  Boundaries depend on it, so it must
+// never change; it's generated from a fixed seed with splitmix64.
+struct gear_table {
+    uint64_t values[256];
+
+    gear_table() {
+        uint64_t x = 0x736673636863646bULL;  // "sfzchcdk".
+        for (uint64_t& v : values) {
+            x += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = x;
+            z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z          = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            v          = z ^ (z >> 31);
+        }
+    }
+};
+
+const uint64_t* gear() {
+    static const gear_table table;
+    return table.values;
+}
+
+// Returns a mask of the top `bits` bits.  In a gear hash, the high bits depend on the most
+// bytes, so they are the ones tested.
+uint64_t top_bits(int bits) { return (bits <= 0) ? 0 : (~uint64_t{0} << (64 - bits)); }
+
+// Returns the gear hash of the window ending just before `pos`, as far as it affects the hashes
+// of windows ending at `pos` and after.
+uint64_t warm_up(const uint8_t* data, size_t pos) {
+    const uint64_t* g  = gear();
+    uint64_t        fp = 0;
+    for (size_t i = (pos < kWindow - 1) ? 0 : (pos - (kWindow - 1)); i < pos; ++i) {
+        fp = (fp << 1) + g[data[i]];
+    }
+    return fp;
+}
+
+// Records the candidates in data[begin, end).
+//
+// This is a plain loop: each byte's hash depends on the last, and a SIMD version, which hashed
+// four parts of the segment at once with gathered table lookups, ran at about half its speed.
+// Segments are searched on separate threads instead.
+void scan(
+        const uint8_t* data, size_t begin, size_t end, const masks& m,
+        std::vector<candidate>& out) {
+    const uint64_t* g  = gear();
+    uint64_t        fp = warm_up(data, begin);
+    for (size_t i = begin; i < end; ++i) {
+        fp = (fp << 1) + g[data[i]];
+        if (!(fp & m.loose)) {
+            out.push_back(candidate{i + 1, !(fp & m.strict)});
+        }
+    }
+}
+
+// Chooses the boundaries between chunks from the candidates, with FastCDC's rules: up to
+// `avg_size` bytes into a chunk, only a strict match ends it; after that, any match does.
+std::vector<uint64_t> boundaries(
+        uint64_t size, const std::vector<candidate>& candidates, const chunk_options& options) {
+    std::vector<uint64_t> ends;
+    size_t                next  = 0;
+    uint64_t              start = 0;
+    while (start < size) {
+        const uint64_t min    = start + options.min_size;
+        const uint64_t limit  = std::min<uint64_t>(size, start + options.max_size);
+        const uint64_t normal = std::min<uint64_t>(limit, start + options.avg_size);
+        uint64_t       end    = limit;
+        if (min >= size) {
+            end = size;
+        } else {
+            while ((next < candidates.size()) && (candidates[next].end < min)) {
+                ++next;
+            }
+            for (size_t i = next; (i < candidates.size()) && (candidates[i].end < limit); ++i) {
+                if ((candidates[i].end >= normal) || candidates[i].strict) {
+                    end = candidates[i].end;
+                    break;
+                }
+            }
+        }
+        ends.push_back(end);
+        start = end;
+    }
+    return ends;
+}
+
+}  // namespace
+
+std::vector<chunk> chunk_data(pn::data_view data, const chunk_options& options) {
+    if ((options.min_size == 0) || (options.min_size > options.avg_size) ||
+        (options.avg_size > options.max_size)) {
+        throw std::runtime_error(
+                pn::format(
+                        "invalid chunk sizes: {0}, {1}, {2}", options.min_size, options.avg_size,
+                        options.max_size)
+                        .c_str());
+    }
+
+    // Normalized chunking: two bits more than the average size before it, and two fewer after.
+    // The loose mask's bits are a subset of the strict mask's, so strict matches are also loose.
+    int bits = 0;
+    while ((bits < 61) && ((uint64_t{2} << bits) <= options.avg_size)) {
+        ++bits;
+    }
+    const masks m{top_bits(bits - 2), top_bits(bits + 2)};
+
+    const uint8_t* bytes    = data.data();
+    const uint64_t size     = data.size();
+    const int      threads  = thread_count(options.threads);
+    const size_t   segments = (size + kSegmentSize - 1) / kSegmentSize;
+
+    std::vector<candidate> candidates;
+    ordered_map<std::vector<candidate>>(
+            segments, threads, 2 * threads,
+            [bytes, size, &m](size_t i) {
+                std::vector<candidate> found;
+                scan(bytes, i * kSegmentSize, std::min<uint64_t>(size, (i + 1) * kSegmentSize), m,
+                     found);
+                return found;
+            },
+            [&candidates](size_t, std::vector<candidate>& found) {
+                candidates.insert(candidates.end(), found.begin(), found.end());
+            });
+
+    const std::vector<uint64_t> ends = boundaries(size, candidates, options);
+    std::vector<chunk>          chunks(ends.size());
+    ordered_map<sha1::digest>(
+            chunks.size(), threads, 16 * threads,
+            [&data, &ends](size_t i) {
+                const uint64_t start = (i == 0) ? 0 : ends[i - 1];
+                sha1           sha;
+                sha.write(data.slice(start, ends[i] - start));
+                return sha.compute();
+            },
+            [&chunks, &ends](size_t i, sha1::digest& digest) {
+                const uint64_t start = (i == 0) ? 0 : ends[i - 1];
+                chunks[i]            = chunk{start, ends[i] - start, digest};
+            });
+    return chunks;
+}
+
+std::vector<chunk> chunk_file(pn::string_view path, const chunk_options& options) {
+    mapped_file file(path);
+    return chunk_data(file.data(), options);
+}
+
+}  // namespace sfz
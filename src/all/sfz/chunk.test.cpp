@@ -0,0 +1,163 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <pn/output>
+#include <set>
+#include <sfz/chunk.hpp>
+#include <sfz/os.hpp>
+#include <sfz/test-data.hpp>
+#include <stdexcept>
+#include <vector>
+
+using testing::Eq;
+using testing::Ge;
+using testing::Gt;
+using testing::IsEmpty;
+using testing::Le;
+using testing::Lt;
+using testing::NotNull;
+
+namespace sfz {
+
+namespace {
+
+using ChunkTest = ::testing::Test;
+
+sha1::digest digest(pn::data_view data) {
+    sha1 sha;
+    sha.write(data);
+    return sha.compute();
+}
+
+// Chunks should cover the data in order, within the size limits, with the digest of each.
+void expect_valid(pn::data_view data, const std::vector<chunk>& chunks, const chunk_options& o) {
+    uint64_t offset = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const chunk& c = chunks[i];
+        EXPECT_THAT(c.offset, Eq(offset));
+        EXPECT_THAT(c.size, Le(o.max_size));
+        if (i + 1 < chunks.size()) {
+            EXPECT_THAT(c.size, Ge(o.min_size));
+        }
+        EXPECT_THAT(c.digest, Eq(digest(data.slice(c.offset, c.size))));
+        offset += c.size;
+    }
+    EXPECT_THAT(offset, Eq<uint64_t>(data.size()));
+}
+
+std::set<std::pair<uint64_t, uint64_t>> chunk_ids(const std::vector<chunk>& chunks) {
+    std::set<std::pair<uint64_t, uint64_t>> ids;
+    for (const chunk& c : chunks) {
+        ids.insert(std::make_pair(c.size, (uint64_t{c.digest.d[0]} << 32) | c.digest.d[1]));
+    }
+    return ids;
+}
+
+TEST_F(ChunkTest, Sizes) {
+    const pn::data data = random_data(3 << 20, 1);
+    chunk_options  options;
+    options.min_size = 2 << 10;
+    options.avg_size = 8 << 10;
+    options.max_size = 64 << 10;
+
+    const std::vector<chunk> chunks = chunk_data(data, options);
+    expect_valid(data, chunks, options);
+
+    // Sizes should average close to avg_size.
+    const double average = static_cast<double>(data.size()) / chunks.size();
+    EXPECT_THAT(average, Gt(0.75 * options.avg_size));
+    EXPECT_THAT(average, Lt(1.5 * options.avg_size));
+
+    EXPECT_THAT(chunk_data(pn::data_view{}), IsEmpty());
+    const std::vector<chunk> one = chunk_data(pn::data_view{data}.slice(0, 100), options);
+    ASSERT_THAT(one.size(), Eq<size_t>(1));
+    EXPECT_THAT(one[0].size, Eq<uint64_t>(100));
+}
+
+// Data without any boundaries, like a run of zeros, should be cut at max_size.
+TEST_F(ChunkTest, MaxSize) {
+    const std::vector<uint8_t> bytes(1 << 20);
+    const pn::data_view        zeros{bytes.data(), static_cast<int>(bytes.size())};
+    const chunk_options        options;
+    const std::vector<chunk>   chunks = chunk_data(zeros, options);
+    expect_valid(zeros, chunks, options);
+    ASSERT_THAT(chunks.size(), Eq<size_t>(4));
+    EXPECT_THAT(chunks[0].size, Eq<uint64_t>(options.max_size));
+}
+
+// The chunks shouldn't depend on how the search is divided between threads.
+TEST_F(ChunkTest, Threads) {
+    const pn::data data = random_data((9 << 20) + 123, 2);
+    chunk_options  options;
+    options.threads = 1;
+
+    const std::vector<chunk> serial = chunk_data(data, options);
+    expect_valid(data, serial, options);
+    for (int threads : {2, 3, 8}) {
+        options.threads                   = threads;
+        const std::vector<chunk> parallel = chunk_data(data, options);
+        ASSERT_THAT(parallel.size(), Eq(serial.size())) << threads;
+        for (size_t i = 0; i < serial.size(); ++i) {
+            EXPECT_THAT(parallel[i].offset, Eq(serial[i].offset)) << threads << ", " << i;
+            EXPECT_THAT(parallel[i].digest, Eq(serial[i].digest)) << threads << ", " << i;
+        }
+    }
+}
+
+// An edit in the middle of the data should change only the chunks near it.
+TEST_F(ChunkTest, Edits) {
+    const pn::data data   = random_data(4 << 20, 3);
+    pn::data       edited = pn::data_view{data}.slice(0, 2 << 20).copy();
+    edited += random_data(100, 4);
+    edited += pn::data_view{data}.slice((2 << 20) + 10);
+
+    chunk_options options;
+    options.min_size = 2 << 10;
+    options.avg_size = 8 << 10;
+    options.max_size = 64 << 10;
+
+    const std::vector<chunk> before    = chunk_data(data, options);
+    const std::vector<chunk> after     = chunk_data(edited, options);
+    const auto               old_ids   = chunk_ids(before);
+    size_t                   unchanged = 0;
+    for (const auto& id : chunk_ids(after)) {
+        unchanged += old_ids.count(id);
+    }
+    EXPECT_THAT(unchanged, Ge(before.size() - 4));
+}
+
+TEST_F(ChunkTest, File) {
+    TemporaryDirectory dir("chunk-test");
+    const pn::string   path = pn::format("{0}/file", dir.path());
+    const pn::data     data = random_data(1 << 20, 5);
+    {
+        pn::output out = pn::output{path, pn::binary};
+        ASSERT_THAT(out.c_obj(), NotNull());
+        ASSERT_THAT(out.write(data), Eq(true));
+    }
+    const std::vector<chunk> from_file = chunk_file(path);
+    const std::vector<chunk> from_data = chunk_data(data);
+    ASSERT_THAT(from_file.size(), Eq(from_data.size()));
+    for (size_t i = 0; i < from_data.size(); ++i) {
+        EXPECT_THAT(from_file[i].digest, Eq(from_data[i].digest));
+    }
+}
+
+TEST_F(ChunkTest, InvalidOptions) {
+    chunk_options options;
+    options.min_size = 0;
+    EXPECT_THROW(chunk_data(pn::data_view{}, options), std::runtime_error);
+    options.min_size = 2 * options.avg_size;
+    EXPECT_THROW(chunk_data(pn::data_view{}, options), std::runtime_error);
+    options.min_size = 1;
+    options.max_size = options.avg_size / 2;
+    EXPECT_THROW(chunk_data(pn::data_view{}, options), std::runtime_error);
+}
+
+}  // namespace
+}  // namespace sfz
@@ -0,0 +1,35 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_CODEPAGES_HPP_
+#define SFZ_CODEPAGES_HPP_
+
+#include <stdint.h>
+
+namespace sfz {
+
+// Code points of bytes [0x80, 0xFF] in single-byte encodings, whose bytes [0x00, 0x7F] are ASCII.
+// Bytes which an encoding leaves unassigned are U+FFFD.
+extern const uint16_t kMacRomanSupplement[0x80];
+extern const uint16_t kCp1252Supplement[0x80];
+extern const uint16_t kCp437Supplement[0x80];
+extern const uint16_t kIso8859_2Supplement[0x80];
+extern const uint16_t kIso8859_3Supplement[0x80];
+extern const uint16_t kIso8859_4Supplement[0x80];
+extern const uint16_t kIso8859_5Supplement[0x80];
+extern const uint16_t kIso8859_6Supplement[0x80];
+extern const uint16_t kIso8859_7Supplement[0x80];
+extern const uint16_t kIso8859_8Supplement[0x80];
+extern const uint16_t kIso8859_9Supplement[0x80];
+extern const uint16_t kIso8859_10Supplement[0x80];
+extern const uint16_t kIso8859_11Supplement[0x80];
+extern const uint16_t kIso8859_13Supplement[0x80];
+extern const uint16_t kIso8859_14Supplement[0x80];
+extern const uint16_t kIso8859_15Supplement[0x80];
+extern const uint16_t kIso8859_16Supplement[0x80];
+
+}  // namespace sfz
+
+#endif  // SFZ_CODEPAGES_HPP_
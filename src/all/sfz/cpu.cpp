@@ -0,0 +1,96 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <sfz/cpu.hpp>
+
+#include <stdint.h>
+
+#ifdef SFZ_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace sfz {
+
+namespace {
+
+#ifdef SFZ_X86
+
+// Executes CPUID with the given leaf and subleaf, storing EAX, EBX, ECX, and EDX in `regs`.
+void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+#ifdef _MSC_VER
+    int r[4];
+    __cpuidex(r, leaf, subleaf);
+    for (int i = 0; i < 4; ++i) {
+        regs[i] = r[i];
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Returns XCR0, which identifies the register state that the OS saves on context switches.
+uint64_t xgetbv0() {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+inline bool bit(uint32_t reg, int n) { return (reg >> n) & 1; }
+
+cpu_features detect() {
+    cpu_features f = {};
+    uint32_t     regs[4];
+    cpuid(0, 0, regs);
+    const uint32_t max_leaf = regs[0];
+    if (max_leaf < 1) {
+        return f;
+    }
+
+    cpuid(1, 0, regs);
+    f.sse2   = bit(regs[3], 26);
+    f.ssse3  = bit(regs[2], 9);
+    f.sse41  = bit(regs[2], 19);
+    f.sse42  = bit(regs[2], 20);
+    f.pclmul = bit(regs[2], 1);
+
+    const bool     osxsave   = bit(regs[2], 27);
+    const uint64_t xcr0      = osxsave ? xgetbv0() : 0;
+    const bool     ymm_saved = (xcr0 & 0x06) == 0x06;
+    const bool     zmm_saved = ymm_saved && ((xcr0 & 0xe0) == 0xe0);
+    f.avx                    = ymm_saved && bit(regs[2], 28);
+
+    if (max_leaf >= 7) {
+        cpuid(7, 0, regs);
+        f.avx2     = f.avx && bit(regs[1], 5);
+        f.bmi2     = bit(regs[1], 8);
+        f.sha      = bit(regs[1], 29);
+        f.avx512f  = zmm_saved && bit(regs[1], 16);
+        f.avx512bw = f.avx512f && bit(regs[1], 30);
+    }
+    return f;
+}
+
+#else
+
+cpu_features detect() { return cpu_features{}; }
+
+#endif  // SFZ_X86
+
+}  // namespace
+
+const cpu_features& cpu() {
+    static const cpu_features features = detect();
+    return features;
+}
+
+}  // namespace sfz
@@ -0,0 +1,48 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_CPU_HPP_
+#define SFZ_CPU_HPP_
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SFZ_X86 1
+#endif
+
+// Marks a function as compiled for an instruction set extension, such as "sse4.1,sha", which the
+// rest of the library is not compiled to assume.  Such functions must only be called after
+// checking cpu() for the corresponding features.  MSVC allows intrinsics for any extension to be
+// used without such a marker.
+#if defined(__GNUC__) || defined(__clang__)
+#define SFZ_TARGET(features) __attribute__((target(features)))
+#else
+#define SFZ_TARGET(features)
+#endif
+
+namespace sfz {
+
+// Instruction set extensions available on the running CPU.  All fields are false on CPUs which
+// are not x86 or x86-64.
+struct cpu_features {
+    bool sse2;
+    bool ssse3;
+    bool sse41;
+    bool sse42;
+    bool pclmul;
+    bool avx;
+    bool avx2;
+    bool bmi2;
+    bool sha;
+    bool avx512f;
+    bool avx512bw;
+};
+
+// Returns the features of the running CPU.  They are detected on the first call; later calls are
+// cheap.  Extensions which need OS support for saving registers (AVX, AVX-512) are reported only
+// if the OS has enabled them.
+const cpu_features& cpu();
+
+}  // namespace sfz
+
+#endif  // SFZ_CPU_HPP_
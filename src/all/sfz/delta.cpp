@@ -0,0 +1,441 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <sfz/delta.hpp>
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <sfz/file.hpp>
+#include <stdexcept>
+#include <thread>
+
+namespace sfz {
+
+namespace {
+
+const char     kSignatureMagic[8] = {'s', 'f', 'z', '-', 's', 'i', 'g', 'n'};
+const char     kDeltaMagic[8]     = {'s', 'f', 'z', '-', 'd', 'l', 't', 'a'};
+const uint32_t kVersion           = 1;
+
+// Sizes of the fixed parts of signatures and deltas.
+const int kSignatureHeaderSize = 8 + 4 + 4 + 8;
+const int kBlockSize           = 4 + 20;
+
+// Instructions in a delta, each a byte followed by varint operands.
+const uint8_t kEnd     = 0;  // No operands.
+const uint8_t kCopy    = 1;  // The index of the first block, and the number of blocks.
+const uint8_t kLiteral = 2;  // The number of bytes, followed by the bytes.
+
+const size_t kMinBlockSize = 512;
+const size_t kMaxBlockSize = 64 << 10;
+
+// The rolling checksum from rsync: two 16-bit sums of the window's bytes, the second weighted by
+// each byte's distance from the end of the window.
+struct weak_sum {
+    uint32_t a = 0;
+    uint32_t b = 0;
+
+    weak_sum() = default;
+    explicit weak_sum(const uint8_t* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            a += data[i];
+            b += (size - i) * data[i];
+        }
+    }
+
+    // Slides the window of `size` bytes forward by one byte.
+    void roll(uint8_t out, uint8_t in, size_t size) {
+        a += in - out;
+        b += a - (size * out);
+    }
+
+    uint32_t value() const { return ((b & 0xffff) << 16) | (a & 0xffff); }
+};
+
+sha1::digest strong_sum(const uint8_t* data, size_t size) {
+    sha1 sha;
+    sha.write(pn::data_view{data, static_cast<int>(size)});
+    return sha.compute();
+}
+
+size_t default_block_size(uint64_t size) {
+    const size_t root = static_cast<size_t>(sqrt(static_cast<double>(size)));
+    return std::min(kMaxBlockSize, std::max(kMinBlockSize, (root + 63) & ~size_t{63}));
+}
+
+[[noreturn]] void invalid(const char* what, const char* why) {
+    throw std::runtime_error(pn::format("invalid {0}: {1}", what, why).c_str());
+}
+
+uint64_t load_be(const uint8_t* p, int size) {
+    uint64_t value = 0;
+    for (int i = 0; i < size; ++i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+void write_varint(pn::output& out, uint64_t value) {
+    uint8_t bytes[10];
+    int     size = 0;
+    do {
+        bytes[size++] = (value & 0x7f) | ((value > 0x7f) ? 0x80 : 0);
+        value >>= 7;
+    } while (value);
+    out.write(pn::data_view{bytes, size});
+}
+
+// Reads a delta sequentially, checking that it doesn't read past the end.
+class delta_reader {
+  public:
+    explicit delta_reader(pn::data_view data) : _data(data), _pos(0) {}
+
+    const uint8_t* bytes(int size) {
+        if ((size < 0) || (size > (_data.size() - _pos))) {
+            invalid("delta", "truncated");
+        }
+        const uint8_t* p = _data.data() + _pos;
+        _pos += size;
+        return p;
+    }
+
+    uint64_t fixed(int size) { return load_be(bytes(size), size); }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uint8_t byte = *bytes(1);
+            value |= uint64_t{byte & 0x7fu} << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        invalid("delta", "varint too long");
+    }
+
+    bool done() const { return _pos == _data.size(); }
+
+  private:
+    pn::data_view _data;
+    int           _pos;
+};
+
+// Writes a delta's instructions, merging runs of consecutive blocks into one copy.
+class delta_writer {
+  public:
+    explicit delta_writer(pn::output& out) : _out(out) {}
+
+    void literal(const uint8_t* data, size_t size) {
+        if (size == 0) {
+            return;
+        }
+        flush_copy();
+        _out.write(kLiteral);
+        write_varint(_out, size);
+        _out.write(pn::data_view{data, static_cast<int>(size)});
+    }
+
+    void copy(uint64_t block) {
+        if (_count && (block == _first + _count)) {
+            ++_count;
+            return;
+        }
+        flush_copy();
+        _first = block;
+        _count = 1;
+    }
+
+    // @returns             The block after the last one copied, which is the likeliest to match
+    //                      next, or -1 if the last instruction wasn't a copy.
+    int64_t next_block() const { return _count ? static_cast<int64_t>(_first + _count) : -1; }
+
+    void end() {
+        flush_copy();
+        _out.write(kEnd);
+    }
+
+  private:
+    void flush_copy() {
+        if (_count) {
+            _out.write(kCopy);
+            write_varint(_out, _first);
+            write_varint(_out, _count);
+            _count = 0;
+        }
+    }
+
+    pn::output& _out;
+    uint64_t    _first = 0;
+    uint64_t    _count = 0;
+};
+
+// Finds blocks of a signature by their checksums.
+class block_index {
+  public:
+    explicit block_index(const signature& sig) : _sig(sig), _full(sig.size / sig.block_size) {
+        _by_weak.reserve(_full);
+        for (uint64_t i = 0; i < _full; ++i) {
+            _by_weak.push_back(std::make_pair(sig.blocks[i].weak, i));
+        }
+        std::sort(_by_weak.begin(), _by_weak.end());
+
+        // Most windows match no block, so they're ruled out by a bitmap before searching.
+        _filter_bits = 16;
+        while ((_filter_bits < 28) && ((uint64_t{1} << _filter_bits) < (8 * _full))) {
+            ++_filter_bits;
+        }
+        _filter.resize(uint64_t{1} << (_filter_bits - 6));
+        for (const auto& entry : _by_weak) {
+            const uint64_t bit = filter_bit(entry.first);
+            _filter[bit >> 6] |= uint64_t{1} << (bit & 63);
+        }
+    }
+
+    // Finds a full block with the same content as the window at `data`.  `preferred`, if it
+    // matches, is chosen over other blocks with the same content.
+    // @returns             The block's index, or -1 if there isn't one.
+    int64_t find(uint32_t weak, const uint8_t* data, int64_t preferred) const {
+        const uint64_t bit = filter_bit(weak);
+        if (!(_filter[bit >> 6] & (uint64_t{1} << (bit & 63)))) {
+            return -1;
+        }
+        auto it = std::lower_bound(
+                _by_weak.begin(), _by_weak.end(), std::make_pair(weak, uint64_t{0}));
+        if ((it == _by_weak.end()) || (it->first != weak)) {
+            return -1;
+        }
+        const sha1::digest strong = strong_sum(data, _sig.block_size);
+        if ((preferred >= 0) && (static_cast<uint64_t>(preferred) < _full) &&
+            (_sig.blocks[preferred].weak == weak) && (_sig.blocks[preferred].strong == strong)) {
+            return preferred;
+        }
+        for (; (it != _by_weak.end()) && (it->first == weak); ++it) {
+            if (_sig.blocks[it->second].strong == strong) {
+                return it->second;
+            }
+        }
+        return -1;
+    }
+
+  private:
+    uint64_t filter_bit(uint32_t weak) const {
+        return (weak * uint64_t{0x9e3779b97f4a7c15ULL}) >> (64 - _filter_bits);
+    }
+
+    const signature&                           _sig;
+    const uint64_t                             _full;  // The number of blocks which aren't short.
+    std::vector<std::pair<uint32_t, uint64_t>> _by_weak;
+    int                                        _filter_bits;
+    std::vector<uint64_t>                      _filter;
+};
+
+}  // namespace
+
+pn::data signature::data() const {
+    pn::data   out;
+    pn::output f = out.output();
+    f.write(pn::data_view{reinterpret_cast<const uint8_t*>(kSignatureMagic),
+                          sizeof(kSignatureMagic)});
+    f.write(kVersion, block_size, size);
+    for (const block& b : blocks) {
+        f.write(b.weak, b.strong.d[0], b.strong.d[1], b.strong.d[2], b.strong.d[3],
+                b.strong.d[4]);
+    }
+    return out;
+}
+
+signature signature::read(pn::data_view data) {
+    if ((data.size() < kSignatureHeaderSize) ||
+        memcmp(data.data(), kSignatureMagic, sizeof(kSignatureMagic))) {
+        invalid("signature", "bad header");
+    } else if (load_be(data.data() + 8, 4) != kVersion) {
+        invalid("signature", "unknown version");
+    }
+    signature sig;
+    sig.block_size = load_be(data.data() + 12, 4);
+    sig.size       = load_be(data.data() + 16, 8);
+    if (sig.block_size == 0) {
+        invalid("signature", "block size is 0");
+    }
+    const uint64_t count = (sig.size + sig.block_size - 1) / sig.block_size;
+    if ((count != static_cast<uint64_t>(data.size() - kSignatureHeaderSize) / kBlockSize) ||
+        ((data.size() - kSignatureHeaderSize) % kBlockSize)) {
+        invalid("signature", "wrong number of blocks");
+    }
+    sig.blocks.resize(count);
+    const uint8_t* p = data.data() + kSignatureHeaderSize;
+    for (block& b : sig.blocks) {
+        b.weak = load_be(p, 4);
+        for (int i = 0; i < 5; ++i) {
+            b.strong.d[i] = load_be(p + 4 + (4 * i), 4);
+        }
+        p += kBlockSize;
+    }
+    return sig;
+}
+
+signature make_signature(pn::data_view data, size_t block_size) {
+    signature sig;
+    sig.block_size = block_size ? block_size : default_block_size(data.size());
+    sig.size       = data.size();
+
+    // The full blocks are all the same size, so they can be hashed together on the lanes of the
+    // multi-buffer kernel.
+    std::vector<pn::data_view> views;
+    for (uint64_t offset = 0; offset < sig.size; offset += sig.block_size) {
+        views.push_back(data.slice(offset, std::min<uint64_t>(sig.block_size, sig.size - offset)));
+    }
+    const std::vector<sha1::digest> strong = sha1::hash_many(views);
+    sig.blocks.resize(views.size());
+    for (size_t i = 0; i < views.size(); ++i) {
+        sig.blocks[i].weak   = weak_sum(views[i].data(), views[i].size()).value();
+        sig.blocks[i].strong = strong[i];
+    }
+    return sig;
+}
+
+signature file_signature(pn::string_view path, size_t block_size) {
+    mapped_file file(path);
+    return make_signature(file.data(), block_size);
+}
+
+pn::data make_delta(const signature& sig, pn::data_view data) {
+    // The digest of the new data goes in the header, but it's computed on another thread while
+    // the delta is, and filled in at the end.
+    sha1::digest digest;
+    std::thread  hasher([&data, &digest] { digest = strong_sum(data.data(), data.size()); });
+    struct joiner {
+        std::thread& t;
+        ~joiner() {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+    } join{hasher};
+
+    pn::data   result;
+    pn::output out = result.output();
+    out.write(pn::data_view{reinterpret_cast<const uint8_t*>(kDeltaMagic), sizeof(kDeltaMagic)});
+    out.write(kVersion, sig.block_size, sig.size, static_cast<uint64_t>(data.size()));
+    const int digest_offset = result.size();
+    out.write(uint32_t{0}, uint32_t{0}, uint32_t{0}, uint32_t{0}, uint32_t{0});
+
+    const uint8_t*    bytes = data.data();
+    const size_t      size  = data.size();
+    const size_t      bs    = sig.block_size;
+    const block_index index(sig);
+    delta_writer      writer(out);
+    size_t            literal = 0;  // Where the pending literal bytes start.
+    size_t            pos     = 0;
+    if (size >= bs) {
+        weak_sum weak(bytes, bs);
+        while (true) {
+            const int64_t block = index.find(weak.value(), bytes + pos, writer.next_block());
+            if (block >= 0) {
+                writer.literal(bytes + literal, pos - literal);
+                writer.copy(block);
+                pos += bs;
+                literal = pos;
+                if (pos + bs > size) {
+                    break;
+                }
+                weak = weak_sum(bytes + pos, bs);
+            } else if (pos + bs < size) {
+                weak.roll(bytes[pos], bytes[pos + bs], bs);
+                ++pos;
+            } else {
+                break;
+            }
+        }
+    }
+
+    // The old data's last block may be short, in which case it can only match the end.
+    const size_t tail = sig.size % bs;
+    if (tail && ((size - literal) >= tail)) {
+        const signature::block& last  = sig.blocks.back();
+        const uint8_t*          start = bytes + size - tail;
+        if ((weak_sum(start, tail).value() == last.weak) && (strong_sum(start, tail) == last.strong)) {
+            writer.literal(bytes + literal, size - tail - literal);
+            writer.copy(sig.blocks.size() - 1);
+            literal = size;
+        }
+    }
+    writer.literal(bytes + literal, size - literal);
+    writer.end();
+
+    hasher.join();
+    for (int i = 0; i < 20; ++i) {
+        result[digest_offset + i] = digest.d[i / 4] >> (24 - (8 * (i % 4)));
+    }
+    return result;
+}
+
+pn::data file_delta(const signature& sig, pn::string_view path) {
+    mapped_file file(path);
+    return make_delta(sig, file.data());
+}
+
+void apply_delta(pn::data_view old, pn::data_view delta, pn::output& out) {
+    delta_reader in(delta);
+    if (memcmp(in.bytes(sizeof(kDeltaMagic)), kDeltaMagic, sizeof(kDeltaMagic))) {
+        invalid("delta", "bad header");
+    } else if (in.fixed(4) != kVersion) {
+        invalid("delta", "unknown version");
+    }
+    const uint64_t block_size = in.fixed(4);
+    const uint64_t old_size   = in.fixed(8);
+    const uint64_t new_size   = in.fixed(8);
+    sha1::digest   expected;
+    for (uint32_t& d : expected.d) {
+        d = in.fixed(4);
+    }
+    if (block_size == 0) {
+        invalid("delta", "block size is 0");
+    } else if (old_size != static_cast<uint64_t>(old.size())) {
+        throw std::runtime_error(
+                pn::format("delta is for old data of {0} bytes, not {1}", old_size, old.size())
+                        .c_str());
+    }
+
+    // Everything written is hashed on its way out, to be checked at the end.
+    sha1                 sha;
+    hashing_output<sha1> tee(sha, &out);
+    uint64_t             written = 0;
+    const uint64_t       blocks  = (old_size + block_size - 1) / block_size;
+    while (true) {
+        const uint8_t op = *in.bytes(1);
+        if (op == kEnd) {
+            break;
+        } else if (op == kCopy) {
+            const uint64_t first = in.varint();
+            const uint64_t count = in.varint();
+            if ((first > blocks) || (count > (blocks - first))) {
+                invalid("delta", "copies a block past the end of the old data");
+            }
+            const uint64_t begin = first * block_size;
+            const uint64_t end   = std::min(old_size, (first + count) * block_size);
+            tee.write(old.slice(begin, end - begin));
+            written += end - begin;
+        } else if (op == kLiteral) {
+            const uint64_t size = in.varint();
+            if (size > static_cast<uint64_t>(delta.size())) {
+                invalid("delta", "truncated");
+            }
+            tee.write(pn::data_view{in.bytes(size), static_cast<int>(size)});
+            written += size;
+        } else {
+            invalid("delta", "unknown instruction");
+        }
+    }
+    if (!in.done()) {
+        invalid("delta", "data after end");
+    } else if ((written != new_size) || (sha.compute() != expected)) {
+        throw std::runtime_error("delta produced the wrong data; is the old data different?");
+    }
+    tee.check();
+}
+
+}  // namespace sfz
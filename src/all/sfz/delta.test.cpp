@@ -0,0 +1,131 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <pn/output>
+#include <sfz/delta.hpp>
+#include <sfz/os.hpp>
+#include <sfz/test-data.hpp>
+#include <stdexcept>
+
+using testing::Eq;
+using testing::Lt;
+using testing::NotNull;
+
+namespace sfz {
+
+namespace {
+
+using DeltaTest = ::testing::Test;
+
+pn::data apply(pn::data_view old, pn::data_view delta) {
+    pn::data   result;
+    pn::output out = result.output();
+    apply_delta(old, delta, out);
+    return result;
+}
+
+// Applying a delta to the old data should give the new data back.
+void expect_round_trip(pn::data_view old, pn::data_view updated, size_t block_size = 0) {
+    const signature sig   = make_signature(old, block_size);
+    const pn::data  delta = make_delta(sig, updated);
+    EXPECT_THAT(apply(old, delta), Eq(updated));
+}
+
+TEST_F(DeltaTest, RoundTrip) {
+    const pn::data old = random_data(100000, 1);
+    expect_round_trip(old, old);
+    expect_round_trip(old, pn::data_view{});
+    expect_round_trip(pn::data_view{}, old);
+    expect_round_trip(pn::data_view{}, pn::data_view{});
+    expect_round_trip(old, random_data(50000, 2));
+    expect_round_trip(pn::data_view{old}.slice(0, 100), pn::data_view{old}.slice(0, 1000));
+
+    // Small edits at various places, including within the short last block.
+    for (int offset : {0, 1, 511, 512, 50000, 99999}) {
+        pn::data edited = pn::data_view{old}.slice(0, offset).copy();
+        edited += random_data(7, offset);
+        edited += pn::data_view{old}.slice(offset);
+        expect_round_trip(old, edited, 512);
+        pn::data removed = pn::data_view{old}.slice(0, offset).copy();
+        removed += pn::data_view{old}.slice(std::min(offset + 300, old.size()));
+        expect_round_trip(old, removed, 512);
+    }
+}
+
+// Unchanged blocks should be copied, even when they've moved, so the delta should be about the
+// size of what changed.
+TEST_F(DeltaTest, Size) {
+    const pn::data old     = random_data(1 << 20, 3);
+    pn::data       updated = random_data(1000, 4);
+    updated += pn::data_view{old}.slice(0, 500000);
+    updated += random_data(1000, 5);
+    updated += pn::data_view{old}.slice(500000);
+
+    const signature sig   = make_signature(old);
+    const pn::data  delta = make_delta(sig, updated);
+    EXPECT_THAT(delta.size(), Lt(2000 + 4 * static_cast<int>(sig.block_size)));
+    EXPECT_THAT(apply(old, delta), Eq(pn::data_view{updated}));
+
+    const pn::data same = make_delta(sig, old);
+    EXPECT_THAT(same.size(), Lt(100));
+}
+
+TEST_F(DeltaTest, Signature) {
+    const pn::data  old = random_data(10000, 6);
+    const signature sig = make_signature(old, 1024);
+    EXPECT_THAT(sig.block_size, Eq(1024u));
+    EXPECT_THAT(sig.size, Eq(10000u));
+    ASSERT_THAT(sig.blocks.size(), Eq(10u));
+
+    const signature read = signature::read(sig.data());
+    EXPECT_THAT(read.block_size, Eq(sig.block_size));
+    EXPECT_THAT(read.size, Eq(sig.size));
+    ASSERT_THAT(read.blocks.size(), Eq(sig.blocks.size()));
+    for (size_t i = 0; i < sig.blocks.size(); ++i) {
+        EXPECT_THAT(read.blocks[i].weak, Eq(sig.blocks[i].weak));
+        EXPECT_THAT(read.blocks[i].strong, Eq(sig.blocks[i].strong));
+    }
+
+    pn::data truncated = pn::data_view{sig.data()}.slice(0, 100).copy();
+    EXPECT_THROW(signature::read(truncated), std::runtime_error);
+    EXPECT_THROW(signature::read(pn::data_view{}), std::runtime_error);
+}
+
+TEST_F(DeltaTest, File) {
+    TemporaryDirectory dir("delta-test");
+    const pn::string   old_path = pn::format("{0}/old", dir.path());
+    const pn::string   new_path = pn::format("{0}/new", dir.path());
+    const pn::data     old      = random_data(300000, 7);
+    const pn::data     updated  = pn::data_view{old}.slice(1000).copy();
+    write_file(old_path, old);
+    write_file(new_path, updated);
+
+    const pn::data delta = file_delta(file_signature(old_path), new_path);
+    EXPECT_THAT(apply(old, delta), Eq(pn::data_view{updated}));
+}
+
+// Applying a delta to the wrong data, or applying a corrupt delta, should fail.
+TEST_F(DeltaTest, Invalid) {
+    const pn::data old     = random_data(10000, 8);
+    pn::data       updated = pn::data_view{old}.slice(0, 5000).copy();
+    updated += random_data(100, 9);
+    const pn::data delta = make_delta(make_signature(old, 512), updated);
+
+    pn::data other = old.copy();
+    other[3000] ^= 1;
+    EXPECT_THROW(apply(other, delta), std::runtime_error);
+    EXPECT_THROW(apply(pn::data_view{old}.slice(1), delta), std::runtime_error);
+    EXPECT_THROW(apply(old, pn::data_view{delta}.slice(0, delta.size() - 1)), std::runtime_error);
+    EXPECT_THROW(apply(old, pn::data_view{delta}.slice(0, 20)), std::runtime_error);
+    pn::data trailing = delta.copy();
+    trailing += pn::data_view{delta}.slice(0, 1);
+    EXPECT_THROW(apply(old, trailing), std::runtime_error);
+}
+
+}  // namespace
+}  // namespace sfz
@@ -0,0 +1,234 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <sfz/digest-cache.hpp>
+
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+namespace sfz {
+
+namespace {
+
+const char     kMagic[8]     = {'s', 'f', 'z', 'd', 'c', 'a', 'c', 'h'};
+const uint32_t kVersion      = 1;
+const size_t   kHeaderSize   = 128;
+const size_t   kSlotSize     = 128;
+const size_t   kMaxProbe     = 8;
+const size_t   kKeyWords     = 5;
+const size_t   kStateWords   = 24;
+const int64_t  kRacyInterval = 2000000000;
+
+struct header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t slot_size;
+    uint64_t capacity;
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "cache slots must be lock-free to be shared");
+
+size_t round_up_pow2(size_t n) {
+    size_t result = 1;
+    while (result < n) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Writes the header of a new cache.  A header which is all zero is new too: the process which
+// created the file stopped before writing it.
+void init(uint8_t* data, size_t size) {
+    if (size < kHeaderSize) {
+        return;
+    }
+    for (size_t i = 0; i < kHeaderSize; ++i) {
+        if (data[i] != 0) {
+            return;
+        }
+    }
+    header* h    = reinterpret_cast<header*>(data);
+    memcpy(h->magic, kMagic, sizeof(kMagic));
+    h->version   = kVersion;
+    h->slot_size = kSlotSize;
+    h->capacity  = (size - kHeaderSize) / kSlotSize;
+}
+
+size_t check_header(const shared_mapped_file& file) {
+    const header* h = reinterpret_cast<const header*>(file.data());
+    if ((file.size() < kHeaderSize) || (memcmp(h->magic, kMagic, sizeof(kMagic)) != 0) ||
+        (h->version != kVersion) || (h->slot_size != kSlotSize) || (h->capacity == 0) ||
+        (((h->capacity - 1) & h->capacity) != 0) ||
+        (file.size() != (kHeaderSize + (h->capacity * kSlotSize)))) {
+        throw std::runtime_error(pn::format("{0}: not a digest cache", file.path()).c_str());
+    }
+    return h->capacity;
+}
+
+int64_t ns(int64_t sec, int64_t nsec) { return (sec * 1000000000) + nsec; }
+
+// Computes the key for a transition from `words`, the state before writing a file.
+void make_key(
+        const uint32_t* words, digest_cache::transition kind, pn::string_view name,
+        const digest_cache::file_id& id, uint32_t* key) {
+    sha1 sha;
+    sha.write<uint8_t>(static_cast<uint8_t>(kind));
+    sha.write(pn::data_view{reinterpret_cast<const uint8_t*>(words),
+                            static_cast<int>(kStateWords * sizeof(uint32_t))});
+    sha.write<uint64_t>(name.size());
+    sha.write(pn::data_view{reinterpret_cast<const uint8_t*>(name.data()), name.size()});
+    sha.write(id.dev, id.ino, id.size, id.mtime_ns, id.ctime_ns);
+    const sha1::digest d = sha.compute();
+    memcpy(key, d.d, sizeof(d.d));
+}
+
+}  // namespace
+
+// A slot holds a key and a state, guarded by `seq`.  An even `seq` means that the slot is stable,
+// and 0 that it has never been written.  Writers make `seq` odd while writing.  Since a writer
+// which dies mid-write leaves its slot odd, such slots are skipped rather than waited on.
+struct digest_cache::slot {
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> words[31];
+};
+
+digest_cache::file_id digest_cache::id(const Stat& st) {
+    file_id id;
+    id.dev  = st.st_dev;
+    id.ino  = st.st_ino;
+    id.size = st.st_size;
+#if defined(__APPLE__)
+    id.mtime_ns = ns(st.st_mtimespec.tv_sec, st.st_mtimespec.tv_nsec);
+    id.ctime_ns = ns(st.st_ctimespec.tv_sec, st.st_ctimespec.tv_nsec);
+#elif defined(_WIN32)
+    id.mtime_ns = ns(st.st_mtime, 0);
+    id.ctime_ns = ns(st.st_ctime, 0);
+#else
+    id.mtime_ns = ns(st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+    id.ctime_ns = ns(st.st_ctim.tv_sec, st.st_ctim.tv_nsec);
+#endif
+    return id;
+}
+
+digest_cache::digest_cache(pn::string_view path, size_t capacity)
+        : _file(path, kHeaderSize + (round_up_pow2(capacity) * kSlotSize), init),
+          _capacity(check_header(_file)) {
+    static_assert(sizeof(slot) == kSlotSize, "unexpected slot size");
+}
+
+digest_cache::slot* digest_cache::slots() const {
+    return reinterpret_cast<slot*>(_file.data() + kHeaderSize);
+}
+
+void digest_cache::save(const sha1& sha, uint32_t* words) {
+    memcpy(words, sha._intermediate.d, sizeof(sha._intermediate.d));
+    words[5] = sha._size;
+    words[6] = sha._size >> 32;
+    words[7] = sha._message_block_index;
+
+    // Bytes past _message_block_index are left over from earlier blocks, or uninitialized.
+    uint8_t* block = reinterpret_cast<uint8_t*>(words + 8);
+    memcpy(block, sha._message_block, sha._message_block_index);
+    memset(block + sha._message_block_index, 0, 64 - sha._message_block_index);
+}
+
+void digest_cache::load(sha1& sha, const uint32_t* words) {
+    memcpy(sha._intermediate.d, words, sizeof(sha._intermediate.d));
+    sha._size                = words[5] | (static_cast<uint64_t>(words[6]) << 32);
+    sha._message_block_index = words[7];
+    memcpy(sha._message_block, words + 8, sizeof(sha._message_block));
+}
+
+bool digest_cache::find(
+        sha1& sha, transition kind, pn::string_view name, const file_id& id) const {
+    uint32_t before[kStateWords];
+    uint32_t key[kKeyWords];
+    save(sha, before);
+    make_key(before, kind, name, id, key);
+
+    for (size_t i = 0; i < kMaxProbe; ++i) {
+        slot&          s   = slots()[(key[0] + i) & (_capacity - 1)];
+        const uint32_t seq = s.seq.load(std::memory_order_acquire);
+        if (seq == 0) {
+            return false;
+        } else if (seq & 1) {
+            continue;
+        }
+        uint32_t words[kKeyWords + kStateWords];
+        for (size_t j = 0; j < (kKeyWords + kStateWords); ++j) {
+            words[j] = s.words[j].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((s.seq.load(std::memory_order_relaxed) == seq) &&
+            (memcmp(words, key, sizeof(key)) == 0)) {
+            load(sha, words + kKeyWords);
+            return true;
+        }
+    }
+    return false;
+}
+
+void digest_cache::store(
+        const sha1& before, transition kind, pn::string_view name, const file_id& id,
+        const sha1& after) {
+    // A file modified within the resolution of its timestamp might be modified again without
+    // changing it, so its content can't be trusted to match its identity yet.
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::system_clock::now().time_since_epoch())
+                                .count();
+    if (id.mtime_ns > (now - kRacyInterval)) {
+        return;
+    }
+
+    uint32_t words[kKeyWords + kStateWords];
+    uint32_t state[kStateWords];
+    save(before, state);
+    make_key(state, kind, name, id, words);
+    save(after, words + kKeyWords);
+
+    // Prefer an empty slot or one with the same key.  If the whole probe sequence is in use, the
+    // first slot is replaced.
+    slot*    target = nullptr;
+    uint32_t seq    = 0;
+    for (size_t i = 0; i < kMaxProbe; ++i) {
+        slot& s = slots()[(words[0] + i) & (_capacity - 1)];
+        seq     = s.seq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        } else if (seq == 0) {
+            target = &s;
+            break;
+        }
+        bool same = true;
+        for (size_t j = 0; j < kKeyWords; ++j) {
+            same = same && (s.words[j].load(std::memory_order_relaxed) == words[j]);
+        }
+        if (same) {
+            target = &s;
+            break;
+        }
+    }
+    if (!target) {
+        target = &slots()[words[0] & (_capacity - 1)];
+        seq    = target->seq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            return;
+        }
+    }
+
+    if (!target->seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) {
+        return;  // Another writer got there first.
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t j = 0; j < (kKeyWords + kStateWords); ++j) {
+        target->words[j].store(words[j], std::memory_order_relaxed);
+    }
+    const uint32_t next = seq + 2;
+    target->seq.store((next == 0) ? 2 : next, std::memory_order_release);
+}
+
+}  // namespace sfz
@@ -0,0 +1,279 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <chrono>
+#include <pn/output>
+#include <sfz/digest-cache.hpp>
+#include <sfz/digest.hpp>
+#include <sfz/os.hpp>
+#include <sfz/range.hpp>
+#include <sfz/test-data.hpp>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+using testing::Eq;
+using testing::NotNull;
+
+namespace sfz {
+namespace {
+
+using DigestCacheTest = ::testing::Test;
+
+const digest_cache::transition kFile = digest_cache::transition::file;
+
+digest_cache::file_id test_id(int n) {
+    digest_cache::file_id id;
+    id.dev      = 1;
+    id.ino      = n;
+    id.size     = 100 + n;
+    id.mtime_ns = 1000000000;
+    id.ctime_ns = 1000000000;
+    return id;
+}
+
+// Writes `n` words to `sha`, giving it a distinct state for each `n`.
+void write_test_state(sha1& sha, int n) {
+    for (int i : range(n)) {
+        sha.write<uint32_t>(i);
+    }
+}
+
+sha1::digest test_digest(int n) {
+    sha1 sha;
+    write_test_state(sha, n);
+    return sha.compute();
+}
+
+void store_test_state(digest_cache& cache, int n) {
+    sha1 after;
+    write_test_state(after, n);
+    cache.store(sha1(), kFile, "name", test_id(n), after);
+}
+
+// A stored result should be found from the same state, name, and identity, and nothing else.
+TEST_F(DigestCacheTest, FindStored) {
+    TemporaryDirectory dir("digest-cache-test");
+    digest_cache       cache(pn::format("{0}/cache", dir.path()), 64);
+    EXPECT_THAT(cache.capacity(), Eq<size_t>(64));
+
+    sha1 before, after;
+    write_test_state(before, 3);
+    write_test_state(after, 30);
+    cache.store(before, kFile, "name", test_id(1), after);
+
+    sha1 sha(before);
+    EXPECT_THAT(cache.find(sha, kFile, "name", test_id(1)), Eq(true));
+    EXPECT_THAT(sha.compute(), Eq(after.compute()));
+
+    sha1 other(before);
+    EXPECT_THAT(cache.find(other, kFile, "other", test_id(1)), Eq(false));
+    EXPECT_THAT(cache.find(other, kFile, "name", test_id(2)), Eq(false));
+    EXPECT_THAT(other.compute(), Eq(before.compute()));
+
+    sha1 initial;
+    EXPECT_THAT(cache.find(initial, kFile, "name", test_id(1)), Eq(false));
+
+    sha1 tree(before);
+    EXPECT_THAT(cache.find(tree, digest_cache::transition::tree, "name", test_id(1)), Eq(false));
+}
+
+// A cache should keep its entries and its capacity when reopened.
+TEST_F(DigestCacheTest, Reopen) {
+    TemporaryDirectory dir("digest-cache-test");
+    const pn::string   path = pn::format("{0}/cache", dir.path());
+    {
+        digest_cache cache(path, 100);
+        EXPECT_THAT(cache.capacity(), Eq<size_t>(128));
+        store_test_state(cache, 1);
+    }
+
+    digest_cache cache(path, 1000);
+    EXPECT_THAT(cache.capacity(), Eq<size_t>(128));
+    sha1 sha;
+    EXPECT_THAT(cache.find(sha, kFile, "name", test_id(1)), Eq(true));
+    EXPECT_THAT(sha.compute(), Eq(test_digest(1)));
+}
+
+// Opening a file which isn't a cache should fail.
+TEST_F(DigestCacheTest, NotACache) {
+    TemporaryDirectory dir("digest-cache-test");
+    const pn::string   path = pn::format("{0}/cache", dir.path());
+    {
+        pn::output out = pn::output{path, pn::binary};
+        ASSERT_THAT(out.c_obj(), NotNull());
+        ASSERT_THAT(out.write(pn::string_view{"not a digest cache"}), Eq(true));
+    }
+    EXPECT_THROW(digest_cache cache(path), std::runtime_error);
+}
+
+// A header with no slots should be rejected, rather than indexed with a mask of all ones.
+TEST_F(DigestCacheTest, ZeroCapacity) {
+    TemporaryDirectory dir("digest-cache-test");
+    const pn::string   path        = pn::format("{0}/cache", dir.path());
+    uint8_t            header[128] = {};
+    const uint32_t     version     = 1;
+    const uint32_t     slot_size   = 128;
+    const uint64_t     capacity    = 0;
+    memcpy(header, "sfzdcach", 8);
+    memcpy(header + 8, &version, 4);
+    memcpy(header + 12, &slot_size, 4);
+    memcpy(header + 16, &capacity, 8);
+    write_file(path, pn::data_view{header, sizeof(header)});
+    EXPECT_THROW(digest_cache cache(path), std::runtime_error);
+}
+
+// A file which was extended but never initialized, by a process which stopped in between, should
+// be initialized by the next one to open it.
+TEST_F(DigestCacheTest, Uninitialized) {
+    TemporaryDirectory         dir("digest-cache-test");
+    const pn::string           path = pn::format("{0}/cache", dir.path());
+    const std::vector<uint8_t> zeros(128 + (64 * 128), 0);
+    write_file(path, pn::data_view{zeros.data(), static_cast<int>(zeros.size())});
+
+    digest_cache cache(path, 1000);
+    EXPECT_THAT(cache.capacity(), Eq<size_t>(64));
+    store_test_state(cache, 1);
+    sha1 sha;
+    EXPECT_THAT(cache.find(sha, kFile, "name", test_id(1)), Eq(true));
+    EXPECT_THAT(sha.compute(), Eq(test_digest(1)));
+}
+
+// When the table is full, new entries should replace old ones.
+TEST_F(DigestCacheTest, Full) {
+    TemporaryDirectory dir("digest-cache-test");
+    digest_cache       cache(pn::format("{0}/cache", dir.path()), 4);
+    for (int i : range(100)) {
+        store_test_state(cache, i);
+        sha1 sha;
+        EXPECT_THAT(cache.find(sha, kFile, "name", test_id(i)), Eq(true));
+        EXPECT_THAT(sha.compute(), Eq(test_digest(i)));
+    }
+}
+
+// Results for files modified just now shouldn't be stored.
+TEST_F(DigestCacheTest, Recent) {
+    TemporaryDirectory    dir("digest-cache-test");
+    digest_cache          cache(pn::format("{0}/cache", dir.path()), 64);
+    digest_cache::file_id id = test_id(1);
+    id.mtime_ns              = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+    cache.store(sha1(), kFile, "name", id, sha1());
+    sha1 sha;
+    EXPECT_THAT(cache.find(sha, kFile, "name", id), Eq(false));
+}
+
+// Concurrent readers and writers should only ever see whole entries.
+TEST_F(DigestCacheTest, Concurrent) {
+    TemporaryDirectory dir("digest-cache-test");
+    digest_cache       cache(pn::format("{0}/cache", dir.path()), 16);
+
+    std::vector<std::thread> threads;
+    for (int t : range(4)) {
+        threads.emplace_back([&cache, t] {
+            for (int i : range(2000)) {
+                const int n = (i * 7 + t) % 50;
+                if (i % 2) {
+                    store_test_state(cache, n);
+                } else {
+                    sha1 sha;
+                    if (cache.find(sha, kFile, "name", test_id(n))) {
+                        EXPECT_THAT(sha.compute(), Eq(test_digest(n)));
+                    }
+                }
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+#ifndef _WIN32
+// Sets the modification time of `path` to an hour ago, so that it can be cached.
+void age(pn::string_view path) {
+    struct timeval times[2];
+    gettimeofday(&times[0], nullptr);
+    times[0].tv_sec -= 3600;
+    times[1] = times[0];
+    ASSERT_THAT(utimes(path.copy().c_str(), times), Eq(0));
+}
+
+// Writes a file which is old enough to be cached.
+void write_aged_file(pn::string_view path, pn::string_view data) {
+    write_file(path, data);
+    age(path);
+}
+
+// Digests computed with a cache should match those computed without, whether or not the cache
+// already has them, and whether or not files change in between.
+TEST_F(DigestCacheTest, TreeDigest) {
+    TemporaryDirectory dir("digest-cache-test");
+    const pn::string   tree = pn::format("{0}/tree", dir.path());
+    for (int i : range(20)) {
+        write_aged_file(pn::format("{0}/{1}/{2}", tree, i % 3, i), pn::format("content {0}", i));
+    }
+    digest_cache cache(pn::format("{0}/cache", dir.path()), 64);
+
+    tree_digest_options options;
+    EXPECT_THAT(tree_digest(tree, options, cache), Eq(tree_digest(tree)));
+
+    // The first file is hashed from the initial state.
+    sha1 sha;
+    const digest_cache::file_id id = digest_cache::id(stat(pn::format("{0}/0/0", tree)));
+    EXPECT_THAT(cache.find(sha, digest_cache::transition::tree, "0/0", id), Eq(true));
+    sha1 file_sha;
+    EXPECT_THAT(cache.find(file_sha, kFile, "0/0", id), Eq(false));
+
+    for (int threads : {1, 4}) {
+        options.threads = threads;
+        for (int i : range(3)) {
+            static_cast<void>(i);
+            EXPECT_THAT(tree_digest(tree, options, cache), Eq(tree_digest(tree)));
+        }
+        write_aged_file(pn::format("{0}/1/{1}", tree, threads), "changed");
+        EXPECT_THAT(tree_digest(tree, options, cache), Eq(tree_digest(tree)));
+    }
+
+    const pn::string file = pn::format("{0}/0/0", tree);
+    EXPECT_THAT(file_digest(file, cache), Eq(file_digest(file)));
+    EXPECT_THAT(file_digest(file, cache), Eq(file_digest(file)));
+    write_aged_file(file, "changed again");
+    EXPECT_THAT(file_digest(file, cache), Eq(file_digest(file)));
+}
+
+// A file hashed alone, and as the first file of a tree, starts from the same state.  When its
+// path is the same as its name within the tree, each should still find only its own result.
+TEST_F(DigestCacheTest, FileAndTree) {
+    TemporaryDirectory dir("digest-cache-test");
+    const pn::string   tree = pn::format("{0}/tree", dir.path());
+    write_aged_file(pn::format("{0}/a", tree), "content");
+    write_aged_file(pn::format("{0}/b", tree), "more content");
+    digest_cache cache(pn::format("{0}/cache", dir.path()), 64);
+
+    const pn::string cwd = getcwd();
+    chdir(tree);
+    const sha1::digest file  = file_digest("a");
+    const sha1::digest whole = tree_digest(tree);
+    for (int i : range(2)) {
+        static_cast<void>(i);
+        EXPECT_THAT(tree_digest(tree, tree_digest_options(), cache), Eq(whole));
+        EXPECT_THAT(file_digest("a", cache), Eq(file));
+    }
+    chdir(cwd);
+}
+#endif
+
+}  // namespace
+}  // namespace sfz
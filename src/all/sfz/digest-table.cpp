@@ -0,0 +1,453 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <sfz/digest-table.hpp>
+
+#include <string.h>
+#include <algorithm>
+#include <pn/output>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SFZ_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using sfz::digest_table::npos;
+
+namespace sfz {
+
+namespace {
+
+const char     kMagic[8]   = {'s', 'f', 'z', '-', 'd', 't', 'a', 'b'};
+const uint32_t kVersion    = 1;
+const uint32_t kByteOrder  = 0x01020304;
+const size_t   kHeaderSize = 40;
+
+// Control bytes.  A full slot holds 7 bits of its key's hash, with the high bit clear.
+const uint8_t kEmpty   = 0x80;
+const uint8_t kDeleted = 0xfe;
+
+const size_t kGroupSize   = 16;
+const size_t kMinCapacity = kGroupSize;
+
+// Lookups are batched this many at a time to prefetch for them.
+const size_t kBatchSize = 16;
+
+// The group at which a key's probe sequence starts comes from its first 64 bits, and its control
+// byte from its last word, so the two are independent.
+uint64_t group_hash(const sha1::digest& key) { return (uint64_t{key.d[0]} << 32) | key.d[1]; }
+uint8_t  tag(const sha1::digest& key) { return key.d[4] & 0x7f; }
+
+int count_trailing_zeros(uint32_t x) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return index;
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+void prefetch_line(const void* p) {
+#ifdef _MSC_VER
+    _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+    __builtin_prefetch(p);
+#endif
+}
+
+// The control bytes of a group, with bitmasks of the slots that match a byte.
+class group {
+  public:
+    explicit group(const uint8_t* ctrl) {
+#ifdef SFZ_SSE2
+        _ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+        _ctrl = ctrl;
+#endif
+    }
+
+    uint32_t match(uint8_t byte) const {
+#ifdef SFZ_SSE2
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_ctrl, _mm_set1_epi8(byte)));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < kGroupSize; ++i) {
+            mask |= uint32_t{_ctrl[i] == byte} << i;
+        }
+        return mask;
+#endif
+    }
+
+    // Empty or deleted slots: those with the high bit set.
+    uint32_t match_free() const {
+#ifdef SFZ_SSE2
+        return _mm_movemask_epi8(_ctrl);
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < kGroupSize; ++i) {
+            mask |= uint32_t{_ctrl[i] >> 7} << i;
+        }
+        return mask;
+#endif
+    }
+
+  private:
+#ifdef SFZ_SSE2
+    __m128i _ctrl;
+#else
+    const uint8_t* _ctrl;
+#endif
+};
+
+// Visits groups in triangular order: start, start + 1, start + 3, start + 6, ...  With a power of
+// two groups, that visits each of them once.
+class probe {
+  public:
+    probe(uint64_t hash, size_t groups)
+            : _mask(groups - 1), _group(static_cast<size_t>(hash) & _mask), _step(0) {}
+
+    size_t first_slot() const { return _group * kGroupSize; }
+    void   next() { _group = (_group + ++_step) & _mask; }
+
+  private:
+    size_t _mask;
+    size_t _group;
+    size_t _step;
+};
+
+// The keys of a digest_set, or of a view, in which a probe compares its key.
+struct set_keys {
+    const sha1::digest* keys;
+
+    const void* address(size_t slot) const { return keys + slot; }
+    bool        equal(size_t slot, const sha1::digest& key) const {
+        const uint32_t* k = keys[slot].d;
+        return (k[0] == key.d[0]) && (k[1] == key.d[1]) && (k[2] == key.d[2]) &&
+               (k[3] == key.d[3]) && (k[4] == key.d[4]);
+    }
+};
+
+struct view_keys {
+    const uint8_t* keys;
+
+    const void* address(size_t slot) const { return keys + (20 * slot); }
+    bool        equal(size_t slot, const sha1::digest& key) const {
+        const uint8_t* k = keys + (20 * slot);
+        for (int i = 0; i < 5; ++i, k += 4) {
+            const uint32_t word = (uint32_t{k[0]} << 24) | (uint32_t{k[1]} << 16) |
+                                  (uint32_t{k[2]} << 8) | uint32_t{k[3]};
+            if (word != key.d[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Returns the slot holding `key`, or npos.  At most every group is probed, so that the search
+// ends even in a view of corrupt data with no empty slots.
+template <typename keys_type>
+size_t find_slot(
+        const uint8_t* ctrl, size_t capacity, const keys_type& keys, const sha1::digest& key) {
+    if (capacity == 0) {
+        return npos;
+    }
+    const size_t  groups = capacity / kGroupSize;
+    const uint8_t t      = tag(key);
+    probe         p(group_hash(key), groups);
+    for (size_t i = 0; i < groups; ++i, p.next()) {
+        const group g(ctrl + p.first_slot());
+        for (uint32_t m = g.match(t); m; m &= m - 1) {
+            const size_t slot = p.first_slot() + count_trailing_zeros(m);
+            if (keys.equal(slot, key)) {
+                return slot;
+            }
+        }
+        if (g.match(kEmpty)) {
+            return npos;
+        }
+    }
+    return npos;
+}
+
+// Prefetches the control bytes of each key's first group; then, once they have arrived, the key
+// in the first slot whose control byte matches, which is usually the key itself.
+template <typename keys_type>
+void prefetch_slots(
+        const uint8_t* ctrl, size_t capacity, const keys_type& keys, const sha1::digest* queries,
+        size_t count) {
+    if (capacity == 0) {
+        return;
+    }
+    const size_t groups = capacity / kGroupSize;
+    for (size_t i = 0; i < count; ++i) {
+        prefetch_line(ctrl + probe(group_hash(queries[i]), groups).first_slot());
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const size_t   first = probe(group_hash(queries[i]), groups).first_slot();
+        const uint32_t m     = group(ctrl + first).match(tag(queries[i]));
+        if (m) {
+            prefetch_line(keys.address(first + count_trailing_zeros(m)));
+        }
+    }
+}
+
+// Tables are filled to at most 7/8 of their capacity.
+size_t max_load(size_t capacity) { return capacity / 8 * 7; }
+
+// The smallest capacity that holds `count` keys.
+size_t capacity_for(size_t count) {
+    size_t capacity = kMinCapacity;
+    while (max_load(capacity) < count) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+}  // namespace
+
+digest_set::digest_set() : _size(0), _growth_left(0) {}
+
+digest_set::digest_set(size_t capacity) : digest_set() { reserve(capacity); }
+
+void digest_set::reserve(size_t count) { reserve(count, nullptr); }
+
+bool digest_set::reserve(size_t count, std::vector<size_t>* moved) {
+    if (capacity_for(count) <= _ctrl.size()) {
+        return false;
+    }
+    rehash(capacity_for(count), moved);
+    return true;
+}
+
+void digest_set::clear() {
+    _ctrl.assign(_ctrl.size(), kEmpty);
+    _size        = 0;
+    _growth_left = max_load(_ctrl.size());
+}
+
+void digest_set::rehash(size_t capacity, std::vector<size_t>* moved) {
+    std::vector<uint8_t>      old_ctrl(capacity, kEmpty);
+    std::vector<sha1::digest> old_keys(capacity);
+    _ctrl.swap(old_ctrl);
+    _keys.swap(old_keys);
+    _growth_left = max_load(capacity) - _size;
+    if (moved) {
+        moved->assign(capacity, npos);
+    }
+
+    const size_t groups = capacity / kGroupSize;
+    for (size_t i = 0; i < old_ctrl.size(); ++i) {
+        if (old_ctrl[i] & 0x80) {
+            continue;
+        }
+        const sha1::digest& key = old_keys[i];
+        for (probe p(group_hash(key), groups);; p.next()) {
+            const uint32_t m = group(&_ctrl[p.first_slot()]).match(kEmpty);
+            if (m) {
+                const size_t slot = p.first_slot() + count_trailing_zeros(m);
+                _ctrl[slot]       = old_ctrl[i];
+                _keys[slot]       = key;
+                if (moved) {
+                    (*moved)[slot] = i;
+                }
+                break;
+            }
+        }
+    }
+}
+
+size_t digest_set::find(const sha1::digest& key) const {
+    return find_slot(_ctrl.data(), _ctrl.size(), set_keys{_keys.data()}, key);
+}
+
+bool digest_set::contains(const sha1::digest& key) const { return find(key) != npos; }
+
+bool digest_set::insert(const sha1::digest& key) {
+    bool inserted;
+    insert(key, &inserted, nullptr);
+    return inserted;
+}
+
+size_t digest_set::insert(const sha1::digest& key, bool* inserted, std::vector<size_t>* moved) {
+    size_t slot = find(key);
+    if (slot != npos) {
+        *inserted = false;
+        return slot;
+    }
+    if (_growth_left == 0) {
+        // If at least half the load is deleted slots, clearing them makes enough room; otherwise,
+        // the table doubles.
+        const size_t capacity = _ctrl.size();
+        rehash(((capacity > 0) && (_size <= max_load(capacity) / 2))
+                       ? capacity
+                       : std::max(kMinCapacity, 2 * capacity),
+               moved);
+    }
+
+    const size_t groups = _ctrl.size() / kGroupSize;
+    for (probe p(group_hash(key), groups);; p.next()) {
+        const uint32_t m = group(&_ctrl[p.first_slot()]).match_free();
+        if (m) {
+            slot = p.first_slot() + count_trailing_zeros(m);
+            break;
+        }
+    }
+    if (_ctrl[slot] == kEmpty) {
+        --_growth_left;
+    }
+    _ctrl[slot] = tag(key);
+    _keys[slot] = key;
+    ++_size;
+    *inserted = true;
+    return slot;
+}
+
+bool digest_set::erase(const sha1::digest& key) {
+    const size_t slot = find(key);
+    if (slot == npos) {
+        return false;
+    }
+    // If the slot's group has an empty slot, no probe has passed through it to a later group, so
+    // the slot can be made empty again.  Otherwise, it's marked deleted, so that probes continue.
+    const size_t first = slot - (slot % kGroupSize);
+    if (group(&_ctrl[first]).match(kEmpty)) {
+        _ctrl[slot] = kEmpty;
+        ++_growth_left;
+    } else {
+        _ctrl[slot] = kDeleted;
+    }
+    --_size;
+    return true;
+}
+
+void digest_set::prefetch(const sha1::digest* keys, size_t count) const {
+    prefetch_slots(_ctrl.data(), _ctrl.size(), set_keys{_keys.data()}, keys, count);
+}
+
+size_t digest_set::insert_many(const sha1::digest* keys, size_t count) {
+    reserve(_size + count);
+    size_t added = 0;
+    for (size_t i = 0; i < count; i += kBatchSize) {
+        const size_t n = std::min(kBatchSize, count - i);
+        prefetch(keys + i, n);
+        for (size_t j = i; j < i + n; ++j) {
+            added += insert(keys[j]);
+        }
+    }
+    return added;
+}
+
+void digest_set::contains_many(const sha1::digest* keys, size_t count, bool* found) const {
+    for (size_t i = 0; i < count; i += kBatchSize) {
+        const size_t n = std::min(kBatchSize, count - i);
+        prefetch(keys + i, n);
+        for (size_t j = i; j < i + n; ++j) {
+            found[j] = contains(keys[j]);
+        }
+    }
+}
+
+pn::data digest_set::data() const { return data(nullptr, 0); }
+
+// The header, in big-endian order: "sfz-dtab", the version and value size as 32-bit integers,
+// the size and capacity as 64-bit integers, then 0x01020304 in the host's order, and 4 bytes of
+// zeros.  It's followed by the control bytes, the keys, zeros up to a multiple of 16 bytes, and
+// the values.
+pn::data digest_set::data(const void* values, size_t value_size) const {
+    const size_t capacity = _ctrl.size();
+    pn::data     d;
+    pn::output   out = d.output();
+    out.write(pn::data_view{reinterpret_cast<const uint8_t*>(kMagic), sizeof(kMagic)});
+    out.write<uint32_t, uint32_t, uint64_t, uint64_t>(kVersion, value_size, _size, capacity);
+    out.write(pn::data_view{reinterpret_cast<const uint8_t*>(&kByteOrder), 4});
+    out.write<uint32_t>(0);
+    out.write(pn::data_view{_ctrl.data(), static_cast<int>(capacity)});
+    for (size_t i = 0; i < capacity; ++i) {
+        out.write(_keys[i].data());
+    }
+    const size_t  keys_end  = kHeaderSize + (21 * capacity);
+    const uint8_t zeros[16] = {};
+    out.write(pn::data_view{zeros, static_cast<int>((16 - (keys_end % 16)) % 16)});
+    out.write(pn::data_view{static_cast<const uint8_t*>(values),
+                            static_cast<int>(capacity * value_size)});
+    return d;
+}
+
+digest_set_view::digest_set_view(pn::data_view data) : digest_set_view(data, npos) {}
+
+digest_set_view::digest_set_view(pn::data_view data, size_t value_size) {
+    const uint8_t* p = data.data();
+    if ((static_cast<size_t>(data.size()) < kHeaderSize) || memcmp(p, kMagic, 8)) {
+        throw std::runtime_error("invalid digest table");
+    }
+    auto read = [p](size_t offset, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value = (value << 8) | p[offset + i];
+        }
+        return value;
+    };
+    const uint64_t version = read(8, 4);
+    const uint64_t size    = read(16, 8);
+    _capacity              = read(24, 8);
+    if (version != kVersion) {
+        throw std::runtime_error(
+                pn::format("unsupported digest table version {0}", version).c_str());
+    } else if (memcmp(p + 32, &kByteOrder, 4)) {
+        throw std::runtime_error("digest table is from a host with another byte order");
+    } else if ((value_size != npos) && (read(12, 4) != value_size)) {
+        throw std::runtime_error(
+                pn::format("digest table values are {0} bytes, not {1}", read(12, 4), value_size)
+                        .c_str());
+    } else if (
+            (_capacity % kGroupSize) || (_capacity & (_capacity - 1)) ||
+            (_capacity > (static_cast<uint64_t>(data.size()) / 21)) ||
+            (size > max_load(_capacity))) {
+        throw std::runtime_error("invalid digest table");
+    }
+
+    const size_t keys_end = kHeaderSize + (21 * _capacity);
+    const size_t values   = keys_end + ((16 - (keys_end % 16)) % 16);
+    if (static_cast<uint64_t>(data.size()) != values + (_capacity * read(12, 4))) {
+        throw std::runtime_error("invalid digest table");
+    }
+    _size   = size;
+    _ctrl   = p + kHeaderSize;
+    _keys   = _ctrl + _capacity;
+    _values = p + values;
+}
+
+size_t digest_set_view::find(const sha1::digest& key) const {
+    return find_slot(_ctrl, _capacity, view_keys{_keys}, key);
+}
+
+void digest_set_view::find_many(const sha1::digest* keys, size_t count, size_t* slots) const {
+    prefetch_slots(_ctrl, _capacity, view_keys{_keys}, keys, count);
+    for (size_t i = 0; i < count; ++i) {
+        slots[i] = find(keys[i]);
+    }
+}
+
+bool digest_set_view::contains(const sha1::digest& key) const { return find(key) != npos; }
+
+void digest_set_view::contains_many(const sha1::digest* keys, size_t count, bool* found) const {
+    size_t slots[kBatchSize];
+    for (size_t i = 0; i < count; i += kBatchSize) {
+        const size_t n = std::min(kBatchSize, count - i);
+        find_many(keys + i, n, slots);
+        for (size_t j = 0; j < n; ++j) {
+            found[i + j] = (slots[j] != npos);
+        }
+    }
+}
+
+}  // namespace sfz
@@ -0,0 +1,214 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <pn/output>
+#include <set>
+#include <sfz/digest-table.hpp>
+#include <sfz/file.hpp>
+#include <sfz/os.hpp>
+#include <stdexcept>
+#include <vector>
+
+using testing::Eq;
+using testing::IsNull;
+using testing::NotNull;
+
+namespace sfz {
+
+namespace {
+
+using DigestTableTest = ::testing::Test;
+
+std::vector<sha1::digest> digests(int count, uint32_t seed) {
+    std::vector<sha1::digest> result;
+    for (int i = 0; i < count; ++i) {
+        sha1 sha;
+        sha.write<uint32_t, uint32_t>(seed, i);
+        result.push_back(sha.compute());
+    }
+    return result;
+}
+
+TEST_F(DigestTableTest, Set) {
+    const std::vector<sha1::digest> in  = digests(10000, 1);
+    const std::vector<sha1::digest> out = digests(1000, 2);
+
+    digest_set set;
+    EXPECT_THAT(set.contains(in[0]), Eq(false));
+    for (const sha1::digest& d : in) {
+        EXPECT_THAT(set.insert(d), Eq(true));
+    }
+    EXPECT_THAT(set.insert(in[5]), Eq(false));
+    EXPECT_THAT(set.size(), Eq<size_t>(10000));
+    for (const sha1::digest& d : in) {
+        EXPECT_THAT(set.contains(d), Eq(true));
+    }
+    for (const sha1::digest& d : out) {
+        EXPECT_THAT(set.contains(d), Eq(false));
+    }
+
+    size_t visited = 0;
+    set.for_each([&visited](const sha1::digest&) { ++visited; });
+    EXPECT_THAT(visited, Eq<size_t>(10000));
+
+    set.clear();
+    EXPECT_THAT(set.empty(), Eq(true));
+    EXPECT_THAT(set.contains(in[0]), Eq(false));
+}
+
+// Erasing many keys and inserting others should neither lose keys nor grow the table forever.
+TEST_F(DigestTableTest, Erase) {
+    digest_set                      set;
+    const std::vector<sha1::digest> keys = digests(20000, 3);
+    std::set<size_t>                present;
+    for (size_t round = 0; round < 20; ++round) {
+        for (size_t i = round * 1000; i < (round + 1) * 1000; ++i) {
+            set.insert(keys[i]);
+            present.insert(i);
+        }
+        for (size_t i = round * 1000; i < (round + 1) * 1000; i += 2) {
+            EXPECT_THAT(set.erase(keys[i]), Eq(true));
+            EXPECT_THAT(set.erase(keys[i]), Eq(false));
+            present.erase(i);
+        }
+    }
+    EXPECT_THAT(set.size(), Eq(present.size()));
+    for (size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_THAT(set.contains(keys[i]), Eq(present.count(i) > 0)) << i;
+    }
+}
+
+TEST_F(DigestTableTest, Map) {
+    const std::vector<sha1::digest> keys = digests(5000, 4);
+    digest_map<uint64_t>            map;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        map[keys[i]] = i;
+    }
+    EXPECT_THAT(map.insert(keys[7], 100), Eq(false));
+    EXPECT_THAT(map.size(), Eq<size_t>(5000));
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_THAT(map.find(keys[i]), NotNull());
+        EXPECT_THAT(*map.find(keys[i]), Eq(i));
+    }
+    EXPECT_THAT(map.find(digests(1, 5)[0]), IsNull());
+
+    EXPECT_THAT(map.erase(keys[3]), Eq(true));
+    EXPECT_THAT(map.find(keys[3]), IsNull());
+    EXPECT_THAT(map.insert(keys[3], 33), Eq(true));
+    EXPECT_THAT(*map.find(keys[3]), Eq<uint64_t>(33));
+
+    uint64_t sum = 0;
+    map.for_each([&sum](const sha1::digest&, uint64_t v) { sum += v; });
+    EXPECT_THAT(sum, Eq<uint64_t>((4999 * 5000 / 2) - 3 + 33));
+}
+
+// New keys should have default values, even in slots which held erased keys.
+TEST_F(DigestTableTest, MapEraseThenIndex) {
+    const std::vector<sha1::digest> erased = digests(100, 6);
+    const std::vector<sha1::digest> added  = digests(100, 7);
+    digest_map<uint64_t>            map(100);
+    for (const sha1::digest& d : erased) {
+        map[d] = 5;
+    }
+    for (const sha1::digest& d : erased) {
+        EXPECT_THAT(map.erase(d), Eq(true));
+    }
+    for (const sha1::digest& d : added) {
+        EXPECT_THAT(map[d], Eq<uint64_t>(0));
+    }
+}
+
+TEST_F(DigestTableTest, Many) {
+    const std::vector<sha1::digest> keys = digests(3000, 6);
+    std::vector<uint32_t>           values;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        values.push_back(i * 3);
+    }
+
+    digest_set set;
+    EXPECT_THAT(set.insert_many(keys.data(), 2000), Eq<size_t>(2000));
+    EXPECT_THAT(set.insert_many(keys.data() + 1000, 2000), Eq<size_t>(1000));
+    digest_map<uint32_t> map;
+    EXPECT_THAT(map.insert_many(keys.data(), values.data(), 2000), Eq<size_t>(2000));
+
+    std::vector<sha1::digest> queries = digests(500, 7);
+    queries.insert(queries.end(), keys.begin(), keys.end());
+    std::unique_ptr<bool[]>      found(new bool[queries.size()]);
+    std::vector<const uint32_t*> mapped(queries.size());
+    set.contains_many(queries.data(), queries.size(), found.get());
+    map.find_many(queries.data(), queries.size(), mapped.data());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        EXPECT_THAT(found[i], Eq(i >= 500)) << i;
+        if ((i >= 500) && (i < 2500)) {
+            ASSERT_THAT(mapped[i], NotNull()) << i;
+            EXPECT_THAT(*mapped[i], Eq<uint32_t>((i - 500) * 3));
+        } else {
+            EXPECT_THAT(mapped[i], IsNull()) << i;
+        }
+    }
+}
+
+struct entry {
+    uint64_t offset;
+    uint32_t size;
+};
+
+// A table written to a file and mapped should be searchable in place.
+TEST_F(DigestTableTest, View) {
+    const std::vector<sha1::digest> keys = digests(4000, 8);
+    digest_map<entry>               map;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        map[keys[i]] = entry{i * 1000, static_cast<uint32_t>(i)};
+    }
+    map.erase(keys[0]);
+
+    TemporaryDirectory dir("digest-table-test");
+    const pn::string   path = pn::format("{0}/index", dir.path());
+    {
+        pn::output out = pn::output{path, pn::binary};
+        ASSERT_THAT(out.c_obj(), NotNull());
+        ASSERT_THAT(out.write(map.data()), Eq(true));
+    }
+    mapped_file               file(path);
+    digest_map_view<entry>    view(file.data());
+    digest_set_view           set_view(file.data());
+    std::vector<const entry*> found(keys.size());
+    view.find_many(keys.data(), keys.size(), found.data());
+    EXPECT_THAT(view.size(), Eq<size_t>(3999));
+    EXPECT_THAT(view.find(keys[0]), IsNull());
+    EXPECT_THAT(set_view.contains(keys[0]), Eq(false));
+    for (size_t i = 1; i < keys.size(); ++i) {
+        ASSERT_THAT(view.find(keys[i]), NotNull()) << i;
+        EXPECT_THAT(view.find(keys[i])->offset, Eq(i * 1000));
+        EXPECT_THAT(found[i], Eq(view.find(keys[i])));
+        EXPECT_THAT(set_view.contains(keys[i]), Eq(true));
+    }
+    EXPECT_THAT(view.find(digests(1, 9)[0]), IsNull());
+
+    // An empty set has no slots.
+    const pn::data empty = digest_set().data();
+    EXPECT_THAT(digest_set_view(empty).contains(keys[1]), Eq(false));
+}
+
+TEST_F(DigestTableTest, InvalidView) {
+    digest_map<uint32_t> map;
+    map[digests(1, 10)[0]] = 1;
+    const pn::data data    = map.data();
+
+    EXPECT_THROW(digest_map_view<uint64_t>{data}, std::runtime_error);
+    EXPECT_THROW(digest_set_view(pn::data_view(data).slice(0, 20)), std::runtime_error);
+    EXPECT_THROW(
+            digest_set_view(pn::data_view(data).slice(0, data.size() - 1)), std::runtime_error);
+    pn::data bad = pn::data_view{data}.copy();
+    bad += pn::data_view{data}.slice(0, 1);
+    EXPECT_THROW(digest_set_view{bad}, std::runtime_error);
+}
+
+}  // namespace
+}  // namespace sfz
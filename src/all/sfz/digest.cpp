@@ -6,17 +6,185 @@
 #include <sfz/digest.hpp>
 
 #include <string.h>
+#include <algorithm>
+#include <chrono>
 #include <limits>
-#include <pn/input>
+#include <memory>
+#include <vector>
+#include <sfz/checksum.hpp>
+#include <sfz/digest-cache.hpp>
 #include <sfz/encoding.hpp>
 #include <sfz/file.hpp>
 #include <sfz/os.hpp>
+#include <sfz/parallel.hpp>
+#include <sfz/sha1-kernel.hpp>
 #include <stdexcept>
 
 using std::numeric_limits;
 
 namespace sfz {
 
+namespace {
+
+const sha1::digest kInitialState{0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+// Writes the final blocks of a message to `out`: the last `size` (< 64) bytes of the message at
+// `rest`, followed by a 1 bit, zero padding, and the message length in bits as a big-endian
+// 64-bit integer.
+//
+// @returns             The number of blocks written, either 1 or 2.
+size_t pad_final_blocks(uint8_t* out, const uint8_t* rest, size_t size, uint64_t bits) {
+    const size_t count = (size < 56) ? 1 : 2;
+    if (size > 0) {
+        memcpy(out, rest, size);
+    }
+    out[size] = 0x80;
+    memset(out + size + 1, '\0', (64 * count) - size - 9);
+    for (int i = 0; i < 8; ++i) {
+        out[(64 * count) - 8 + i] = bits >> (56 - (8 * i));
+    }
+    return count;
+}
+
+// A message, or part of one, to be compressed into `state`: the whole blocks among the `size`
+// bytes at `data`.  If `finish` is set, the message ends there, and the rest of `data` is
+// followed by padding and the message length, `bits`.
+struct sha1_job {
+    uint32_t*      state;
+    const uint8_t* data;
+    size_t         size;
+    bool           finish;
+    uint64_t       bits;
+
+    size_t count() const { return size / 64; }
+    size_t tail_count() const { return finish ? (((size % 64) < 56) ? 1 : 2) : 0; }
+    size_t pad(uint8_t* out) const {
+        return pad_final_blocks(out, data + (64 * count()), size % 64, bits);
+    }
+};
+
+// Runs `jobs`, interleaving them across the lanes of the multi-buffer kernel.  Whenever a lane's
+// job runs out of blocks, the next job is loaded into it.  Jobs are started longest-first, so
+// that lanes finish at about the same time; once fewer than half of the lanes are busy, the
+// remaining work is finished with the single-buffer kernel, which is faster per stream.
+void run_sha1_jobs(std::vector<sha1_job>& jobs) {
+    const sha1_kernel&       single = sha1_best_kernel();
+    const sha1_multi_kernel* multi  = sha1_best_multi_kernel();
+    auto                     length = [](const sha1_job* job) {
+        return job->count() + job->tail_count();
+    };
+    auto longer = [&length](const sha1_job* x, const sha1_job* y) {
+        return length(x) > length(y);
+    };
+
+    std::vector<sha1_job*> order;
+    order.reserve(jobs.size());
+    for (sha1_job& job : jobs) {
+        if (length(&job) > 0) {
+            order.push_back(&job);
+        }
+    }
+    if (!std::is_sorted(order.begin(), order.end(), longer)) {
+        std::sort(order.begin(), order.end(), longer);
+    }
+
+    struct lane {
+        sha1_job* job;
+        size_t    remaining;
+        bool      in_tail;
+        uint8_t   tail[128];
+    };
+    const size_t                lanes = multi ? multi->lanes : 0;
+    std::vector<uint32_t>       state(5 * lanes);
+    std::vector<const uint8_t*> blocks(lanes, nullptr);
+    std::vector<lane>           busy(lanes);
+    size_t                      next   = 0;
+    size_t                      active = 0;
+
+    auto enter_tail = [&](size_t i) {
+        lane& l     = busy[i];
+        l.remaining = l.job->pad(l.tail);
+        l.in_tail   = true;
+        blocks[i]   = l.tail;
+    };
+    auto start = [&](size_t i) {
+        lane& l = busy[i];
+        if (next == order.size()) {
+            l.job     = nullptr;
+            blocks[i] = nullptr;
+            return;
+        }
+        l.job = order[next++];
+        if (l.job->count() > 0) {
+            l.remaining = l.job->count();
+            l.in_tail   = false;
+            blocks[i]   = l.job->data;
+        } else {
+            enter_tail(i);
+        }
+        for (int w = 0; w < 5; ++w) {
+            state[(w * lanes) + i] = l.job->state[w];
+        }
+        ++active;
+    };
+    auto save = [&](size_t i) {
+        for (int w = 0; w < 5; ++w) {
+            busy[i].job->state[w] = state[(w * lanes) + i];
+        }
+        --active;
+    };
+
+    for (size_t i = 0; i < lanes; ++i) {
+        start(i);
+    }
+    while ((active > 1) && ((2 * active) >= lanes)) {
+        size_t step = numeric_limits<size_t>::max();
+        for (const lane& l : busy) {
+            if (l.job) {
+                step = std::min(step, l.remaining);
+            }
+        }
+        multi->blocks(state.data(), blocks.data(), step);
+        for (size_t i = 0; i < lanes; ++i) {
+            lane& l = busy[i];
+            if (!l.job) {
+                continue;
+            }
+            blocks[i] += 64 * step;
+            l.remaining -= step;
+            if (l.remaining > 0) {
+                continue;
+            } else if (!l.in_tail && l.job->finish) {
+                enter_tail(i);
+            } else {
+                save(i);
+                start(i);
+            }
+        }
+    }
+
+    uint8_t tail[128];
+    for (size_t i = 0; i < lanes; ++i) {
+        lane& l = busy[i];
+        if (l.job) {
+            save(i);
+            single.blocks(l.job->state, blocks[i], l.remaining);
+            if (!l.in_tail && l.job->finish) {
+                single.blocks(l.job->state, tail, l.job->pad(tail));
+            }
+        }
+    }
+    for (; next < order.size(); ++next) {
+        sha1_job* job = order[next];
+        single.blocks(job->state, job->data, job->count());
+        if (job->finish) {
+            single.blocks(job->state, tail, job->pad(tail));
+        }
+    }
+}
+
+}  // namespace
+
 sha1::sha1() { reset(); }
 
 sha1::sha1(const sha1& other) { memcpy(this, &other, sizeof(sha1)); }
@@ -24,11 +192,7 @@ sha1::sha1(const sha1& other) { memcpy(this, &other, sizeof(sha1)); }
 void sha1::reset() {
     _size                = 0;
     _message_block_index = 0;
-    _intermediate.d[0]   = 0x67452301;
-    _intermediate.d[1]   = 0xefcdab89;
-    _intermediate.d[2]   = 0x98badcfe;
-    _intermediate.d[3]   = 0x10325476;
-    _intermediate.d[4]   = 0xc3d2e1f0;
+    _intermediate        = kInitialState;
 }
 
 void sha1::write(pn::data_view input) {
@@ -39,16 +203,30 @@ void sha1::write(pn::data_view input) {
         static_cast<std::make_unsigned<pn::data_view::size_type>::type>(input.size())) {
         throw std::runtime_error("message is too long");
     }
-    pn::data_view remainder = input;
-    while (_message_block_index + remainder.size() >= 64) {
-        const int size = 64 - _message_block_index;
-        memcpy(_message_block + _message_block_index, remainder.data(), size);
-        remainder.shift(size);
+    _size += 8 * static_cast<uint64_t>(input.size());
+
+    // Top up a partially-filled _message_block first.  After that, whole blocks are passed to the
+    // kernel directly from `input`, and only the tail is copied into _message_block.
+    const uint8_t* bytes = input.data();
+    size_t         size  = input.size();
+    if (_message_block_index > 0) {
+        const size_t fill = std::min<size_t>(64 - _message_block_index, size);
+        memcpy(_message_block + _message_block_index, bytes, fill);
+        _message_block_index += fill;
+        bytes += fill;
+        size -= fill;
+        if (_message_block_index < 64) {
+            return;
+        }
         process_message_block();
     }
-    memcpy(_message_block + _message_block_index, remainder.data(), remainder.size());
-    _message_block_index += remainder.size();
-    _size += 8 * input.size();
+    if (size >= 64) {
+        sha1_best_kernel().blocks(_intermediate.d, bytes, size / 64);
+        bytes += size & ~size_t{63};
+        size &= 63;
+    }
+    memcpy(_message_block, bytes, size);
+    _message_block_index = size;
 }
 
 sha1::digest sha1::compute() const {
@@ -58,77 +236,142 @@ sha1::digest sha1::compute() const {
 }
 
 void sha1::finish() {
-    _message_block[_message_block_index++] = 0x80;
-    if (_message_block_index > 56) {
-        memset(_message_block + _message_block_index, '\0', 64 - _message_block_index);
-        process_message_block();
-    }
-    memset(_message_block + _message_block_index, '\0', 56 - _message_block_index);
-    pn::data size_bytes;
-    size_bytes.output().write(_size);
-    memcpy(_message_block + 56, size_bytes.data(), 8);
-    process_message_block();
+    uint8_t      tail[128];
+    const size_t count = pad_final_blocks(tail, _message_block, _message_block_index, _size);
+    sha1_best_kernel().blocks(_intermediate.d, tail, count);
 }
 
 namespace {
 
-// Does a circular rotation of `word`, shifting it `bits` bits to the left, and moving the bits
-// that were shifted out to the right end of the word.
-inline uint32_t left_rotate(uint32_t word, int bits) {
-    return ((word << bits) | (word >> (32 - bits)));
+// An exported state is, in big-endian order: kStateMagic; the format version, as a uint32_t; the
+// intermediate digest, as five uint32_ts; the size of the content in bits, as a uint64_t; and the
+// number of content bytes which are not yet compressed, as a uint8_t, followed by those bytes.
+const char     kStateMagic[8]   = {'s', 'f', 'z', '-', 's', 'h', 'a', '1'};
+const uint32_t kStateVersion    = 1;
+const int      kStateHeaderSize = 8 + 4 + 20 + 8 + 1;
+
+uint64_t load_be(const uint8_t* p, int size) {
+    uint64_t x = 0;
+    for (int i = 0; i < size; ++i) {
+        x = (x << 8) | p[i];
+    }
+    return x;
 }
 
-// Does the permutation of values for a round of SHA-1.
-inline void permute(
-        uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d, uint32_t* e, uint32_t next) {
-    *e = *d;
-    *d = *c;
-    *c = left_rotate(*b, 30);
-    *b = *a;
-    *a = left_rotate(*a, 5) + next;
+void invalid_state(pn::string_view why) {
+    throw std::runtime_error(pn::format("invalid sha1 state: {0}", why).c_str());
 }
 
 }  // namespace
 
-void sha1::process_message_block() {
-    static const uint32_t k[] = {
-            0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6,
-    };
+pn::data sha1::export_state() const {
+    pn::data   out;
+    pn::output f = out.output();
+    f.write(pn::data_view{reinterpret_cast<const uint8_t*>(kStateMagic), sizeof(kStateMagic)});
+    f.write(kStateVersion);
+    for (int i = 0; i < 5; ++i) {
+        f.write(_intermediate.d[i]);
+    }
+    f.write(_size);
+    f.write(static_cast<uint8_t>(_message_block_index));
+    f.write(pn::data_view{_message_block, _message_block_index});
+    return out;
+}
 
-    uint32_t  w[80];
-    pn::input block = pn::data_view{_message_block, 64}.input();
-    for (int i = 0; i < 16; ++i) {
-        block.read(&w[i]);
+void sha1::import_state(pn::data_view state) {
+    if ((state.size() < kStateHeaderSize) ||
+        (memcmp(state.data(), kStateMagic, sizeof(kStateMagic)) != 0)) {
+        invalid_state("not a sha1 state");
+    }
+    const uint8_t* p       = state.data() + sizeof(kStateMagic);
+    const uint32_t version = load_be(p, 4);
+    if (version != kStateVersion) {
+        invalid_state(pn::format("unsupported version {0}", version));
     }
-    for (int i = 16; i < 80; ++i) {
-        w[i] = left_rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    digest intermediate;
+    for (int i = 0; i < 5; ++i) {
+        intermediate.d[i] = load_be(p + 4 + (4 * i), 4);
+    }
+    const uint64_t size  = load_be(p + 24, 8);
+    const int      index = p[32];
+    if (((size % 8) != 0) || (static_cast<uint64_t>(index) != ((size / 8) % 64))) {
+        invalid_state("inconsistent size");
+    } else if (state.size() != (kStateHeaderSize + index)) {
+        invalid_state("wrong length");
     }
 
-    uint32_t a = _intermediate.d[0];
-    uint32_t b = _intermediate.d[1];
-    uint32_t c = _intermediate.d[2];
-    uint32_t d = _intermediate.d[3];
-    uint32_t e = _intermediate.d[4];
+    _intermediate        = intermediate;
+    _size                = size;
+    _message_block_index = index;
+    memcpy(_message_block, p + 33, index);
+}
+
+void sha1::process_message_block() {
+    sha1_best_kernel().blocks(_intermediate.d, _message_block, 1);
+    _message_block_index = 0;
+}
 
-    for (int i = 0; i < 20; ++i) {
-        permute(&a, &b, &c, &d, &e, ((b & c) | ((~b) & d)) + e + w[i] + k[0]);
+std::vector<sha1::digest> sha1::hash_many(const std::vector<pn::data_view>& messages) {
+    std::vector<digest>   digests(messages.size(), kInitialState);
+    std::vector<sha1_job> jobs(messages.size());
+    for (size_t i = 0; i < messages.size(); ++i) {
+        const pn::data_view message = messages[i];
+        jobs[i] = sha1_job{digests[i].d, message.data(), static_cast<size_t>(message.size()), true,
+                           8 * static_cast<uint64_t>(message.size())};
     }
-    for (int i = 20; i < 40; ++i) {
-        permute(&a, &b, &c, &d, &e, (b ^ c ^ d) + e + w[i] + k[1]);
+    run_sha1_jobs(jobs);
+    return digests;
+}
+
+sha1_multi::sha1_multi(size_t count) : _streams(count) { reset(); }
+
+void sha1_multi::reset() {
+    for (stream& s : _streams) {
+        s.intermediate = kInitialState;
+        s.size         = 0;
+        s.pending.clear();
     }
-    for (int i = 40; i < 60; ++i) {
-        permute(&a, &b, &c, &d, &e, ((b & c) | (b & d) | (c & d)) + e + w[i] + k[2]);
+    _pending_size = 0;
+}
+
+void sha1_multi::write(size_t index, pn::data_view input) {
+    stream& s = _streams[index];
+    if (((numeric_limits<uint64_t>::max() / 8) - s.size) <
+        static_cast<std::make_unsigned<pn::data_view::size_type>::type>(input.size())) {
+        throw std::runtime_error("message is too long");
     }
-    for (int i = 60; i < 80; ++i) {
-        permute(&a, &b, &c, &d, &e, (b ^ c ^ d) + e + w[i] + k[3]);
+    s.size += input.size();
+    s.pending.insert(s.pending.end(), input.data(), input.data() + input.size());
+    _pending_size += input.size();
+    if (_pending_size >= kFlushSize) {
+        flush();
     }
+}
 
-    _intermediate.d[0] += a;
-    _intermediate.d[1] += b;
-    _intermediate.d[2] += c;
-    _intermediate.d[3] += d;
-    _intermediate.d[4] += e;
-    _message_block_index = 0;
+void sha1_multi::flush() {
+    std::vector<sha1_job> jobs;
+    for (stream& s : _streams) {
+        jobs.push_back(sha1_job{s.intermediate.d, s.pending.data(), s.pending.size(), false, 0});
+    }
+    run_sha1_jobs(jobs);
+
+    _pending_size = 0;
+    for (stream& s : _streams) {
+        s.pending.erase(s.pending.begin(), s.pending.end() - (s.pending.size() % 64));
+        _pending_size += s.pending.size();
+    }
+}
+
+std::vector<sha1::digest> sha1_multi::compute() const {
+    std::vector<sha1::digest> digests(_streams.size());
+    std::vector<sha1_job>     jobs(_streams.size());
+    for (size_t i = 0; i < _streams.size(); ++i) {
+        const stream& s = _streams[i];
+        digests[i]      = s.intermediate;
+        jobs[i] = sha1_job{digests[i].d, s.pending.data(), s.pending.size(), true, 8 * s.size};
+    }
+    run_sha1_jobs(jobs);
+    return digests;
 }
 
 sha1::digest::digest(pn::data_view data) {
@@ -167,30 +410,451 @@ pn::string sha1::digest::hex() const {
     return pn::string_view{buf, 40}.copy();
 }
 
-sha1::digest file_digest(pn::string_view path) {
-    mapped_file file(path);
-    sha1        sha;
-    sha.write(file.data());
-    return sha.compute();
+bool sha1::digest::parse_hex(pn::string_view hex, digest* out) {
+    if (hex.size() != 40) {
+        return false;
+    }
+    digest result;
+    for (int i = 0; i < 40; ++i) {
+        const char c = hex.data()[i];
+        uint32_t   value;
+        if ((c >= '0') && (c <= '9')) {
+            value = c - '0';
+        } else if ((c >= 'a') && (c <= 'f')) {
+            value = c - 'a' + 10;
+        } else if ((c >= 'A') && (c <= 'F')) {
+            value = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        result.d[i / 8] = (result.d[i / 8] << 4) | value;
+    }
+    *out = result;
+    return true;
 }
 
-sha1::digest tree_digest(pn::string_view path) {
-    if (!path::isdir(path)) {
-        return file_digest(path);
+namespace {
+
+// Regular files smaller than kMinMapSize are read rather than mapped: for them, setting up and
+// tearing down a mapping costs more than copying.  Files larger than kMaxMapSize are read too, as
+// they might not fit in the address space, or in a pn::data_view.
+const uint64_t kMinMapSize = 64 << 10;
+const uint64_t kMaxMapSize = 1 << 30;
+
+const size_t kStreamBufferSize = 1 << 20;
+const size_t kPageSize         = 4096;
+
+// The number of buffers that a streamed file too large to preload is read ahead into.
+const int kPreloadReadAhead = 4;
+
+// A buffer for reading file content into.  It's aligned to a page, so that the kernel can copy
+// into it efficiently.
+struct page_buffer {
+    std::unique_ptr<uint8_t[]> storage;
+    uint8_t*                   data;
+    size_t                     size;
+
+    explicit page_buffer(size_t size) : storage(new uint8_t[size + kPageSize]), size(size) {
+        const uintptr_t p = reinterpret_cast<uintptr_t>(storage.get());
+        data              = reinterpret_cast<uint8_t*>((p + kPageSize - 1) & ~(kPageSize - 1));
+    }
+};
+
+// Returns a buffer of kStreamBufferSize bytes, which is reused for every file read on the calling
+// thread.
+page_buffer& stream_buffer() {
+    static thread_local page_buffer buffer(kStreamBufferSize);
+    return buffer;
+}
+
+// Reads one byte from each page of `data`, so that it is faulted in before it is needed.
+void prefault_pages(pn::data_view data) {
+    volatile uint8_t sink = 0;
+    for (int i = 0; i < data.size(); i += kPageSize) {
+        sink = sink ^ data[i];
+    }
+}
+
+// Writes file content to `h`.  blake3 can split large files across threads; for other hashers,
+// `threads` is ignored.
+template <typename hasher>
+void write_content(hasher& h, pn::data_view content, int threads) {
+    static_cast<void>(threads);
+    h.write(content);
+}
+
+void write_content(blake3& h, pn::data_view content, int threads) {
+    h.write_parallel(content, threads);
+}
+
+bool is_regular(const Stat& st) { return (st.st_mode & S_IFMT) == S_IFREG; }
+
+// A file opened for hashing.  It's mapped if it's a regular file and `mode` allows, or else
+// streamed through stream_buffer().
+//
+// If `read_ahead` is positive when it's written, a second thread reads ahead of hashing, by up
+// to that many buffers.  For a streamed file, it reads into a ring of buffers; for a mapped one,
+// it faults in the pages of each buffer-sized part of the mapping before it's hashed.
+//
+// A file can also be preloaded on one thread before it is written on another; see preload().
+class file_content {
+  public:
+    file_content(pn::string_view path, ReadMode mode) {
+        if ((mode == READ_AUTO) && !should_map(stat(path))) {
+            mode = READ_STREAMED;
+        }
+        open(path, mode);
+    }
+
+    // As above, for a file whose status is already known.
+    file_content(pn::string_view path, ReadMode mode, const Stat& st) {
+        if ((mode == READ_AUTO) && !should_map(st)) {
+            mode = READ_STREAMED;
+        }
+        open(path, mode);
     }
-    struct digestWalker : TreeWalker {
-        // For files, hash the size and bytes of their UTF-8-encoded path, followed by the size and
-        // bytes of the file content.  We don't worry about the mode or owner of the file, just as
-        // we wouldn't if taking the digest of a file.
-        void file(pn::string_view path, const Stat&) const {
-            pn::data_view path_bytes{reinterpret_cast<const uint8_t*>(path.data() + prefix_size),
-                                     path.size() - prefix_size};
-            sha.write<uint64_t>(path_bytes.size());
-            sha.write(path_bytes);
 
-            mapped_file file(path);
-            sha.write<uint64_t>(file.data().size());
-            sha.write(file.data());
+    explicit file_content(int fd) : _streamed(new streamed_file(fd, pn::format("fd {0}", fd))) {}
+
+    // @returns             The size of the file when it was opened, or 0 if it isn't regular.
+    uint64_t size() const {
+        return _mapped ? static_cast<uint64_t>(_mapped->data().size()) : _streamed->size();
+    }
+
+    // Reads the file ahead of writing it, so that the thread which writes it doesn't wait on I/O.
+    // A mapped file has its pages faulted in, and a streamed file smaller than kMinMapSize is read
+    // into memory.  A larger streamed file is instead read ahead by kPreloadReadAhead buffers when
+    // it's written, if it isn't read ahead already.
+    void preload() {
+        if (_mapped) {
+            prefault_pages(_mapped->data());
+        } else if (_streamed->regular() && (_streamed->size() < kMinMapSize)) {
+            load();
+        } else {
+            _preload_read_ahead = kPreloadReadAhead;
+        }
+    }
+
+    // Writes the whole content of the file to `h`.
+    //
+    // @param [in] threads      The number of threads `h` may use.
+    // @param [in] read_ahead   The number of buffers to read ahead into, or 0 not to.
+    // @param [in] buffer_size  The size of each buffer read ahead into.
+    // @returns                 The number of bytes written.
+    template <typename hasher>
+    uint64_t write_to(hasher& h, int threads, int read_ahead = 0, size_t buffer_size = 0) {
+        if (_loaded) {
+            write_content(h, pn::data_view{_loaded->data(), static_cast<int>(_loaded->size())},
+                          threads);
+            return _loaded->size();
+        } else if ((read_ahead <= 0) && (_preload_read_ahead > 0)) {
+            read_ahead  = _preload_read_ahead;
+            buffer_size = kStreamBufferSize;
+        }
+        if (read_ahead > 0) {
+            return _mapped ? write_mapped_ahead(h, threads, read_ahead, buffer_size)
+                           : write_streamed_ahead(h, threads, read_ahead, buffer_size);
+        } else if (_mapped) {
+            write_content(h, _mapped->data(), threads);
+            return _mapped->data().size();
+        }
+        page_buffer& buffer = stream_buffer();
+        uint64_t     total  = 0;
+        while (size_t n = _streamed->read(buffer.data, buffer.size)) {
+            write_content(h, pn::data_view{buffer.data, static_cast<int>(n)}, threads);
+            total += n;
+        }
+        return total;
+    }
+
+    // Hashes a streamed file in the kernel, if `options` allow, and it's expected to be faster.
+    // @returns                 true if it was hashed, and `d` set.
+    template <typename hasher>
+    bool offload(const file_digest_options& options, typename hasher::digest& d);
+
+  private:
+    template <typename hasher>
+    uint64_t write_streamed_ahead(hasher& h, int threads, int read_ahead, size_t buffer_size) {
+        struct filled {
+            page_buffer buffer;
+            size_t      size;
+        };
+        std::vector<filled> ring;
+        ring.reserve(read_ahead);
+        for (int i = 0; i < read_ahead; ++i) {
+            ring.push_back(filled{page_buffer(buffer_size), 0});
+        }
+        streamed_file& file  = *_streamed;
+        uint64_t       total = 0;
+        pipeline(
+                ring,
+                [&file](filled& f) {
+                    f.size = file.read(f.buffer.data, f.buffer.size);
+                    return f.size > 0;
+                },
+                [&h, &total, threads](filled& f) {
+                    write_content(h, pn::data_view{f.buffer.data, static_cast<int>(f.size)},
+                                  threads);
+                    total += f.size;
+                });
+        return total;
+    }
+
+    template <typename hasher>
+    uint64_t write_mapped_ahead(hasher& h, int threads, int read_ahead, size_t buffer_size) {
+        const pn::data_view        data = _mapped->data();
+        std::vector<pn::data_view> ring(read_ahead);
+        int                        offset = 0;
+        pipeline(
+                ring,
+                [&data, &offset, buffer_size](pn::data_view& part) {
+                    if (offset == data.size()) {
+                        return false;
+                    }
+                    const int size = std::min<size_t>(buffer_size, data.size() - offset);
+                    part           = data.slice(offset, size);
+                    offset += size;
+                    prefault_pages(part);
+                    return true;
+                },
+                [&h, threads](pn::data_view& part) { write_content(h, part, threads); });
+        return data.size();
+    }
+
+    // Reads a streamed file into memory.  It reads up to one byte more than the file's size, so
+    // that a file which has grown since it was opened still fails the caller's check of the size
+    // written, without reading more of it.
+    void load() {
+        std::unique_ptr<std::vector<uint8_t>> loaded(
+                new std::vector<uint8_t>(_streamed->size() + 1));
+        size_t size = 0;
+        while (size < loaded->size()) {
+            const size_t n = _streamed->read(loaded->data() + size, loaded->size() - size);
+            if (n == 0) {
+                break;
+            }
+            size += n;
+        }
+        loaded->resize(size);
+        _loaded = std::move(loaded);
+    }
+
+    static bool should_map(const Stat& st) {
+        return is_regular(st) && (static_cast<uint64_t>(st.st_size) >= kMinMapSize) &&
+               (static_cast<uint64_t>(st.st_size) <= kMaxMapSize);
+    }
+
+    void open(pn::string_view path, ReadMode mode) {
+        if (mode == READ_MAPPED) {
+            _mapped.reset(new mapped_file(path));
+        } else {
+            _streamed.reset(new streamed_file(path));
+        }
+    }
+
+    std::unique_ptr<mapped_file>          _mapped;
+    std::unique_ptr<streamed_file>        _streamed;
+    std::unique_ptr<std::vector<uint8_t>> _loaded;
+    int                                   _preload_read_ahead = 0;
+};
+
+// Files smaller than this aren't offloaded automatically; for them, setting up the kernel's hash
+// costs more than copying.  Offloading is measured with this much data too.
+const uint64_t kMinOffloadSize = 1 << 20;
+
+// The kernel's name for each hasher's hash function, or null if it has none.
+template <typename hasher>
+const char* kernel_name() {
+    return nullptr;
+}
+
+template <>
+const char* kernel_name<sha1>() {
+    return "sha1";
+}
+
+template <>
+const char* kernel_name<sha256>() {
+    return "sha256";
+}
+
+// Hashes `file` with kernel_hasher, for hashers which have a kernel_name().
+// @returns             true if it was hashed, and `d` set.
+template <typename hasher>
+bool kernel_digest(streamed_file&, typename hasher::digest&) {
+    return false;
+}
+
+template <typename hasher>
+bool kernel_digest_bytes(streamed_file& file, typename hasher::digest& d) {
+    kernel_hasher kernel(kernel_name<hasher>());
+    uint8_t       bytes[sizeof(d.d)];
+    if (!kernel.digest(file, bytes, sizeof(bytes))) {
+        return false;
+    }
+    d = typename hasher::digest{pn::data_view{bytes, static_cast<int>(sizeof(bytes))}};
+    return true;
+}
+
+template <>
+bool kernel_digest<sha1>(streamed_file& file, sha1::digest& d) {
+    return kernel_digest_bytes<sha1>(file, d);
+}
+
+template <>
+bool kernel_digest<sha256>(streamed_file& file, sha256::digest& d) {
+    return kernel_digest_bytes<sha256>(file, d);
+}
+
+// Returns the time taken to run `f`, in seconds, as the best of several runs.
+template <typename F>
+double best_time(F f) {
+    double best = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < 3; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+// Measures whether the kernel hashes the file at `fd`, which is in memory, faster than reading
+// and hashing it in user space.  Each run starts from the beginning of the file.  If the two
+// digests disagree, the kernel isn't used.
+template <typename hasher>
+bool kernel_is_faster(int fd) {
+    typename hasher::digest kernel_result, user_result;
+    bool                    kernel_ok = true;
+    const double kernel = best_time([fd, &kernel_result, &kernel_ok] {
+        streamed_file file(fd, "offload measurement");
+        file.seek(0);
+        kernel_ok = kernel_ok && kernel_digest<hasher>(file, kernel_result);
+    });
+    const double user = best_time([fd, &user_result] {
+        streamed_file(fd, "offload measurement").seek(0);
+        file_content content(fd);
+        hasher       h;
+        content.write_to(h, 1);
+        user_result = h.compute();
+    });
+    return kernel_ok && (kernel_result == user_result) && (kernel < user);
+}
+
+// Measures offloading on a file in memory, so that nothing is written to the file system.  If
+// that fails, as where there are no memory files, the kernel isn't used; the digest being
+// computed shouldn't fail over it.
+template <typename hasher>
+bool measure_offload() {
+    if (!kernel_hasher(kernel_name<hasher>()).available()) {
+        return false;
+    }
+    try {
+        pn::data   data;
+        pn::output out = data.output();
+        uint32_t   x   = 1;
+        for (uint64_t i = 0; i < kMinOffloadSize; i += 4) {
+            x = x * 1664525 + 1013904223;
+            out.write(x);
+        }
+        memory_file file(data);
+        return kernel_is_faster<hasher>(file.fd());
+    } catch (std::exception&) {
+        return false;
+    }
+}
+
+template <typename hasher>
+bool offload_is_faster() {
+    static const bool faster = measure_offload<hasher>();
+    return faster;
+}
+
+// Whether to try hashing a file in the kernel, given `options`, and whether it's regular and its
+// size, if so.
+template <typename hasher>
+bool should_offload(const file_digest_options& options, bool regular, uint64_t size) {
+    if (!kernel_name<hasher>() || (options.read == READ_MAPPED)) {
+        return false;
+    }
+    switch (options.offload) {
+        case OFFLOAD_AUTO:
+            return regular && (size >= kMinOffloadSize) && offload_is_faster<hasher>();
+        case OFFLOAD_NEVER: return false;
+        case OFFLOAD_ALWAYS: return true;
+    }
+    return false;
+}
+
+template <typename hasher>
+bool file_content::offload(const file_digest_options& options, typename hasher::digest& d) {
+    return _streamed && should_offload<hasher>(options, _streamed->regular(), _streamed->size()) &&
+           kernel_digest<hasher>(*_streamed, d);
+}
+
+}  // namespace
+
+sha1::digest file_digest(pn::string_view path) { return file_digest<sha1>(path); }
+
+template <typename hasher>
+typename hasher::digest file_digest(pn::string_view path, const file_digest_options& options) {
+    const Stat st = stat(path);
+    if (should_offload<hasher>(options, is_regular(st), st.st_size)) {
+        streamed_file           file(path);
+        typename hasher::digest d;
+        if (kernel_digest<hasher>(file, d)) {
+            return d;
+        }
+    }
+    file_content content(path, options.read, st);
+    hasher       h;
+    content.write_to(
+            h, thread_count(options.threads), options.read_ahead, options.read_ahead_size);
+    return h.compute();
+}
+
+sha1::digest file_digest(int fd) { return file_digest<sha1>(fd); }
+
+template <typename hasher>
+typename hasher::digest file_digest(int fd, const file_digest_options& options) {
+    file_content content(fd);
+    typename hasher::digest d;
+    if (content.offload<hasher>(options, d)) {
+        return d;
+    }
+    hasher h;
+    content.write_to(
+            h, thread_count(options.threads), options.read_ahead, options.read_ahead_size);
+    return h.compute();
+}
+
+sha1::digest file_digest(
+        pn::string_view path, digest_cache& cache, const file_digest_options& options) {
+    const Stat                  st = stat(path);
+    const digest_cache::file_id id = digest_cache::id(st);
+    sha1                        sha;
+    if (!cache.find(sha, digest_cache::transition::file, path, id)) {
+        file_content content(path, options.read, st);
+        content.write_to(sha, 1, options.read_ahead, options.read_ahead_size);
+        if (is_regular(st)) {
+            cache.store(sha1(), digest_cache::transition::file, path, id, sha);
+        }
+    }
+    return sha.compute();
+}
+
+namespace {
+
+struct tree_file {
+    pn::string path;
+    Stat       st;
+};
+
+// Lists the regular files in the tree at `path`, in the order in which tree_digest() hashes them.
+std::vector<tree_file> tree_files(pn::string_view path) {
+    struct fileListWalker : TreeWalker {
+        void file(pn::string_view path, const Stat& st) const {
+            files.push_back(tree_file{path.copy(), st});
         }
 
         // Ignore empty directories.  Directories which are not empty will be included in the
@@ -225,15 +889,196 @@ sha1::digest tree_digest(pn::string_view path) {
             static_cast<void>(stat);
         }
 
-        sha1&     sha;
-        const int prefix_size;
-        digestWalker(sha1& sha, int prefix_size) : sha(sha), prefix_size(prefix_size) {}
+        std::vector<tree_file>& files;
+        fileListWalker(std::vector<tree_file>& files) : files(files) {}
     };
-    sha1 sha;
-    walk(path, WALK_LOGICAL, digestWalker(sha, path.size() + 1));
-    return sha.compute();
+    std::vector<tree_file> files;
+    walk(path, WALK_LOGICAL, fileListWalker(files));
+    return files;
+}
+
+// Writes a file in the tree to `h`: the size and bytes of its UTF-8-encoded path, relative to the
+// root of the tree, followed by the size and bytes of its content.
+//
+// The size is taken from when the file was opened.  If the file is streamed, and its size has
+// changed by the time it's read, the digest would be inconsistent, so that's an error.
+template <typename hasher>
+void write_tree_file(
+        hasher& h, pn::string_view path, pn::string_view name, file_content& content,
+        const file_digest_options& options) {
+    h.template write<uint64_t>(name.size());
+    h.write(pn::data_view{reinterpret_cast<const uint8_t*>(name.data()), name.size()});
+    h.template write<uint64_t>(content.size());
+    if (content.write_to(h, options.threads, options.read_ahead, options.read_ahead_size) !=
+        content.size()) {
+        throw std::runtime_error(
+                pn::format("{0}: file changed size while being hashed", path).c_str());
+    }
+}
+
+// Only sha1 state can be cached, so for other hashers, these are never called with a cache.
+template <typename hasher>
+bool find_tree_file(digest_cache*, hasher&, pn::string_view, const Stat&) {
+    return false;
+}
+
+bool find_tree_file(digest_cache* cache, sha1& sha, pn::string_view name, const Stat& st) {
+    return cache && cache->find(sha, digest_cache::transition::tree, name, digest_cache::id(st));
+}
+
+template <typename hasher>
+void hash_tree_file(
+        digest_cache*, hasher& h, const tree_file& file, pn::string_view name,
+        file_content& content, const file_digest_options& options) {
+    write_tree_file(h, file.path, name, content, options);
+}
+
+void hash_tree_file(
+        digest_cache* cache, sha1& sha, const tree_file& file, pn::string_view name,
+        file_content& content, const file_digest_options& options) {
+    if (!cache) {
+        write_tree_file(sha, file.path, name, content, options);
+        return;
+    }
+    sha1 before(sha);
+    write_tree_file(sha, file.path, name, content, options);
+    cache->store(before, digest_cache::transition::tree, name, digest_cache::id(file.st), sha);
+}
+
+// Hashes a tree, as tree_digest() does, with `cache` if it's not null.  For hashers other than
+// sha1, it's always null.
+template <typename hasher>
+typename hasher::digest hash_tree(
+        pn::string_view path, const tree_digest_options& options, digest_cache* const cache) {
+    // Each file is hashed as file_digest() would, with these options.
+    const int           threads = thread_count(options.threads);
+    file_digest_options file_options;
+    file_options.threads         = threads;
+    file_options.read            = options.read;
+    file_options.read_ahead      = options.read_ahead;
+    file_options.read_ahead_size = options.read_ahead_size;
+    if (!path::isdir(path)) {
+        return file_digest<hasher>(path, file_options);
+    }
+
+    // We don't worry about the mode or owner of the file, just as we wouldn't if taking the
+    // digest of a file.
+    //
+    // Files are hashed in walk order on this thread, since each one continues the digest of the
+    // last.  What the workers can do is to open the files that come next and preload them: fault
+    // in the pages of those which are mapped, and read small streamed files into memory, so that
+    // the hashing thread doesn't wait on I/O.  Larger streamed files are read ahead by a reader
+    // thread as they're hashed.  Memory held by preloading is bounded by `window` small files.
+    // With read-ahead, all of that is left to the file's reader thread instead.
+    //
+    // With a cache, the state after each file is looked up from the state before it.  That
+    // chain is only as long as the files before it are unchanged, so the lookups stop at the
+    // first miss, and from there on every file is hashed (and its result cached).
+    const std::vector<tree_file> files       = tree_files(path);
+    const int                    prefix_size = path.size() + 1;
+    const size_t                 window =
+            (options.max_files_in_flight > 0) ? options.max_files_in_flight : (4 * threads);
+    auto name = [&files, prefix_size](size_t i) { return files[i].path.substr(prefix_size); };
+
+    hasher h;
+    size_t first = 0;
+    while ((first < files.size()) && find_tree_file(cache, h, name(first), files[first].st)) {
+        ++first;
+    }
+
+    const ReadMode mode    = options.read;
+    const bool     preload = (threads > 1) && (options.read_ahead <= 0);
+    ordered_map<std::unique_ptr<file_content>>(
+            files.size() - first, threads, window,
+            [&files, first, mode, preload](size_t i) {
+                const tree_file&              file = files[first + i];
+                std::unique_ptr<file_content> content(new file_content(file.path, mode, file.st));
+                if (preload) {
+                    content->preload();
+                }
+                return content;
+            },
+            [&h, &name, &files, first, cache, &file_options](
+                    size_t i, std::unique_ptr<file_content>& content) {
+                hash_tree_file(
+                        cache, h, files[first + i], name(first + i), *content, file_options);
+            });
+    return h.compute();
+}
+
+}  // namespace
+
+sha1::digest tree_digest(pn::string_view path) {
+    tree_digest_options options;
+    options.threads = 1;
+    return tree_digest<sha1>(path, options);
+}
+
+sha1::digest tree_digest(pn::string_view path, const tree_digest_options& options) {
+    return tree_digest<sha1>(path, options);
+}
+
+sha1::digest tree_digest(
+        pn::string_view path, const tree_digest_options& options, digest_cache& cache) {
+    return hash_tree<sha1>(path, options, &cache);
+}
+
+template <typename hasher>
+typename hasher::digest tree_digest(pn::string_view path, const tree_digest_options& options) {
+    return hash_tree<hasher>(path, options, nullptr);
 }
 
+void file_digests(
+        const std::vector<pn::string_view>& paths, const file_digests_options& options,
+        const std::function<void(size_t, const sha1::digest*, pn::string_view)>& done) {
+    struct result {
+        sha1::digest digest;
+        pn::string   error;
+        bool         ok;
+    };
+    // Each file is hashed on one thread; the parallelism is across files.
+    const int           threads = thread_count(options.threads);
+    tree_digest_options tree_options;
+    tree_options.threads = 1;
+    tree_options.read    = options.read;
+    file_digest_options file_options;
+    file_options.threads = 1;
+    file_options.read    = options.read;
+    ordered_map<result>(
+            paths.size(), threads, 4 * threads,
+            [&paths, &options, &tree_options, &file_options](size_t i) {
+                result r{sha1::digest{}, pn::string{}, false};
+                try {
+                    r.digest = options.trees ? tree_digest<sha1>(paths[i], tree_options)
+                                             : file_digest<sha1>(paths[i], file_options);
+                    r.ok = true;
+                } catch (std::exception& e) {
+                    r.error = e.what();
+                }
+                return r;
+            },
+            [&done](size_t i, result& r) { done(i, r.ok ? &r.digest : nullptr, r.error); });
+}
+
+template sha1::digest   file_digest<sha1>(pn::string_view, const file_digest_options&);
+template sha256::digest file_digest<sha256>(pn::string_view, const file_digest_options&);
+template blake3::digest file_digest<blake3>(pn::string_view, const file_digest_options&);
+template sha1::digest   file_digest<sha1>(int, const file_digest_options&);
+template sha256::digest file_digest<sha256>(int, const file_digest_options&);
+template blake3::digest file_digest<blake3>(int, const file_digest_options&);
+template sha1::digest   tree_digest<sha1>(pn::string_view, const tree_digest_options&);
+template sha256::digest tree_digest<sha256>(pn::string_view, const tree_digest_options&);
+template blake3::digest tree_digest<blake3>(pn::string_view, const tree_digest_options&);
+template crc32c::digest  file_digest<crc32c>(pn::string_view, const file_digest_options&);
+template crc32::digest   file_digest<crc32>(pn::string_view, const file_digest_options&);
+template adler32::digest file_digest<adler32>(pn::string_view, const file_digest_options&);
+template crc32c::digest  file_digest<crc32c>(int, const file_digest_options&);
+template crc32::digest   file_digest<crc32>(int, const file_digest_options&);
+template adler32::digest file_digest<adler32>(int, const file_digest_options&);
+template crc32c::digest  tree_digest<crc32c>(pn::string_view, const tree_digest_options&);
+template crc32::digest   tree_digest<crc32>(pn::string_view, const tree_digest_options&);
+template adler32::digest tree_digest<adler32>(pn::string_view, const tree_digest_options&);
+
 bool operator==(const sha1::digest& lhs, const sha1::digest& rhs) {
     return memcmp(lhs.d, rhs.d, 5 * sizeof(uint32_t)) == 0;
 }
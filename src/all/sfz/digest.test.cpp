@@ -4,22 +4,50 @@
 // under the terms of the MIT License.
 
 #include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <cstring>
+#include <memory>
+#include <new>
 #include <sfz/digest.hpp>
 #include <sfz/file.hpp>
 #include <sfz/os.hpp>
 #include <sfz/range.hpp>
+#include <sfz/sha1-kernel.hpp>
+#include <thread>
+#include <vector>
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using testing::ElementsAreArray;
 using testing::Eq;
 using testing::NotNull;
 
+// Counts allocations, so that tests can check that hashing doesn't allocate.
+static std::atomic<int> allocations{0};
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+
 namespace sfz {
 namespace {
 
-using Sha1Test = ::testing::Test;
+using Sha1Test   = ::testing::Test;
+using Sha256Test = ::testing::Test;
+using Blake3Test = ::testing::Test;
 
 const sha1::digest kEmptyDigest{0xda39a3ee, 0x5e6b4b0d, 0x3255bfef, 0x95601890, 0xafd80709};
 
@@ -195,6 +223,392 @@ TEST_F(Sha1Test, IncrementalDigest) {
     EXPECT_THAT(sha.compute(), Eq(kEmptyDigest));
 }
 
+// Each kernel supported by the running CPU should compute the same result as the portable kernel,
+// for any number of blocks.  The AVX2 kernel handles blocks in pairs, so odd counts matter.
+TEST_F(Sha1Test, Kernels) {
+    // "abc", padded to a single block.
+    uint8_t abc[64] = {'a', 'b', 'c', 0x80};
+    abc[63]         = 24;
+    const uint32_t kAbcDigest[5] = {0xa9993e36, 0x4706816a, 0xba3e2571, 0x7850c26c, 0x9cd0d89d};
+
+    uint8_t blocks[64 * 9];
+    for (int i : range<int>(sizeof(blocks))) {
+        blocks[i] = (i * 131) ^ (i >> 8);
+    }
+
+    for (const sha1_kernel* k = kSha1Kernels; k != kSha1Kernels + kSha1KernelCount; ++k) {
+        if (!k->supported()) {
+            continue;
+        }
+        SCOPED_TRACE(k->name);
+
+        uint32_t state[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+        k->blocks(state, abc, 1);
+        EXPECT_THAT(state, ElementsAreArray(kAbcDigest));
+
+        for (size_t count : range<size_t>(10)) {
+            uint32_t expected[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+            uint32_t actual[5]   = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+            kSha1Kernels[0].blocks(expected, blocks, count);
+            k->blocks(actual, blocks, count);
+            EXPECT_THAT(actual, ElementsAreArray(expected)) << count << " blocks";
+        }
+    }
+}
+
+// Each multi-buffer kernel supported by the running CPU should compute, in each lane, the same
+// result as the portable kernel.  Idle lanes must not disturb the others.
+TEST_F(Sha1Test, MultiKernels) {
+    uint8_t blocks[64 * 3 * 16];
+    for (int i : range<int>(sizeof(blocks))) {
+        blocks[i] = (i * 61) ^ (i >> 7);
+    }
+
+    for (const sha1_multi_kernel* k = kSha1MultiKernels;
+         k != kSha1MultiKernels + kSha1MultiKernelCount; ++k) {
+        if (!k->supported()) {
+            continue;
+        }
+        SCOPED_TRACE(k->name);
+
+        std::vector<uint32_t>       state(5 * k->lanes);
+        std::vector<const uint8_t*> lanes(k->lanes);
+        for (size_t lane : range(k->lanes)) {
+            lanes[lane] = (lane % 3 == 1) ? nullptr : blocks + (64 * 3 * lane);
+            for (size_t w : range<size_t>(5)) {
+                state[(w * k->lanes) + lane] = kEmptyDigest.d[w] + lane;
+            }
+        }
+        k->blocks(state.data(), lanes.data(), 3);
+
+        for (size_t lane : range(k->lanes)) {
+            if (!lanes[lane]) {
+                continue;
+            }
+            uint32_t expected[5];
+            uint32_t actual[5];
+            for (size_t w : range<size_t>(5)) {
+                expected[w] = kEmptyDigest.d[w] + lane;
+                actual[w]   = state[(w * k->lanes) + lane];
+            }
+            kSha1Kernels[0].blocks(expected, lanes[lane], 3);
+            EXPECT_THAT(actual, ElementsAreArray(expected)) << "lane " << lane;
+        }
+    }
+}
+
+// Generates `size` bytes of data which vary with `seed`.
+pn::data test_data(int size, int seed) {
+    pn::data d;
+    for (int i : range(size)) {
+        uint8_t byte = (i * 167) + (seed * 31) + (i >> 8);
+        d += pn::data_view{&byte, 1};
+    }
+    return d;
+}
+
+sha1::digest single_digest(pn::data_view data) {
+    sha1 sha;
+    sha.write(data);
+    return sha.compute();
+}
+
+// hash_many() should agree with hashing each message separately.  Lengths cover every padding
+// case (empty, < 56 bytes, 56-63 bytes, whole blocks) and are mixed so that lanes finish at
+// different times.
+TEST_F(Sha1Test, HashMany) {
+    std::vector<pn::data>      messages;
+    std::vector<pn::data_view> views;
+    for (int size : range(200)) {
+        messages.push_back(test_data(size, size));
+    }
+    for (int size : {1000, 4096, 70000, 5, 64, 128}) {
+        messages.push_back(test_data(size, size));
+    }
+    for (const pn::data& m : messages) {
+        views.push_back(m);
+    }
+
+    std::vector<sha1::digest> digests = sha1::hash_many(views);
+    ASSERT_THAT(digests.size(), Eq(views.size()));
+    for (size_t i : range(views.size())) {
+        EXPECT_THAT(digests[i], Eq(single_digest(views[i]))) << views[i].size() << " bytes";
+    }
+
+    EXPECT_THAT(sha1::hash_many({}).size(), Eq<size_t>(0));
+    EXPECT_THAT(sha1::hash_many({pn::data_view{}})[0], Eq(kEmptyDigest));
+}
+
+// sha1_multi should agree with separate sha1 instances, fed the same pieces in the same order.
+// One stream gets enough data to make sha1_multi compress its buffered blocks mid-stream.
+TEST_F(Sha1Test, Multi) {
+    const int  kStreams = 37;
+    sha1_multi multi(kStreams);
+    std::vector<std::unique_ptr<sha1>> singles;
+    for (int i : range(kStreams)) {
+        static_cast<void>(i);
+        singles.emplace_back(new sha1);
+    }
+    ASSERT_THAT(multi.size(), Eq<size_t>(kStreams));
+
+    for (int round : range(20)) {
+        for (int i : range(kStreams)) {
+            const pn::data piece = test_data((i * 7 + round * 13) % 150, i + round);
+            multi.write(i, piece);
+            singles[i]->write(piece);
+        }
+        const pn::data big = test_data(round * 20000, round);
+        multi.write(round % kStreams, big);
+        singles[round % kStreams]->write(big);
+
+        std::vector<sha1::digest> digests = multi.compute();
+        ASSERT_THAT(digests.size(), Eq<size_t>(kStreams));
+        for (int i : range(kStreams)) {
+            EXPECT_THAT(digests[i], Eq(singles[i]->compute())) << "stream " << i;
+        }
+    }
+
+    multi.reset();
+    for (const sha1::digest& d : multi.compute()) {
+        EXPECT_THAT(d, Eq(kEmptyDigest));
+    }
+}
+
+// Standard SHA-256 test vectors, from FIPS 180-4 examples and NIST.
+TEST_F(Sha256Test, KnownAnswers) {
+    struct {
+        pn::string_view input;
+        int             repeat;
+        sha256::digest  expected;
+    } tests[] = {
+            {"", 1,
+             {0xe3b0c442, 0x98fc1c14, 0x9afbf4c8, 0x996fb924, 0x27ae41e4, 0x649b934c, 0xa495991b,
+              0x7852b855}},
+            {"abc", 1,
+             {0xba7816bf, 0x8f01cfea, 0x414140de, 0x5dae2223, 0xb00361a3, 0x96177a9c, 0xb410ff61,
+              0xf20015ad}},
+            {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+             {0x248d6a61, 0xd20638b8, 0xe5c02693, 0x0c3e6039, 0xa33ce459, 0x64ff2167, 0xf6ecedd4,
+              0x19db06c1}},
+            {"aaaaaaaaaa", 100000,
+             {0xcdc76e5c, 0x9914fb92, 0x81a1c7e2, 0x84d73e67, 0xf1809a48, 0xa497200e, 0x046d39cc,
+              0xc7112cd0}},
+    };
+    for (const auto& test : tests) {
+        sha256 sha;
+        for (int i : range(test.repeat)) {
+            static_cast<void>(i);
+            sha.write(test.input.as_data());
+        }
+        EXPECT_THAT(sha.compute(), Eq(test.expected)) << test.input;
+    }
+    EXPECT_THAT(sha256().compute().hex(),
+                Eq<pn::string_view>(
+                        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+}
+
+// Writing in pieces should give the same digest as writing all at once.
+TEST_F(Sha256Test, Pieces) {
+    const pn::data data = test_data(5000, 1);
+    sha256         whole;
+    whole.write(data);
+    for (int piece : {1, 7, 63, 64, 65, 1000}) {
+        sha256 sha;
+        for (int i = 0; i < data.size(); i += piece) {
+            sha.write(pn::data_view{data}.slice(i, std::min(piece, data.size() - i)));
+        }
+        EXPECT_THAT(sha.compute(), Eq(whole.compute())) << piece;
+    }
+}
+
+// Returns the input used by the BLAKE3 test vectors: bytes which count up modulo 251.
+pn::data blake3_input(int size) {
+    pn::data d;
+    for (int i : range(size)) {
+        uint8_t byte = i % 251;
+        d += pn::data_view{&byte, 1};
+    }
+    return d;
+}
+
+// Test vectors from the BLAKE3 reference implementation, which exercise each way that chunks
+// are combined into a tree.
+TEST_F(Blake3Test, KnownAnswers) {
+    struct {
+        int             size;
+        pn::string_view expected;
+    } tests[] = {
+            {0, "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262"},
+            {1, "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213"},
+            {1023, "10108970eeda3eb932baac1428c7a2163b0e924c9a9e25b35bba72b28f70bd11"},
+            {1024, "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7"},
+            {1025, "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444"},
+            {2048, "e776b6028c7cd22a4d0ba182a8bf62205d2ef576467e838ed6f2529b85fba24a"},
+            {2049, "5f4d72f40d7a5f82b15ca2b2e44b1de3c2ef86c426c95c1af0b6879522563030"},
+            {3072, "b98cb0ff3623be03326b373de6b9095218513e64f1ee2edd2525c7ad1e5cffd2"},
+            {3073, "7124b49501012f81cc7f11ca069ec9226cecb8a2c850cfe644e327d22d3e1cd3"},
+            {4096, "015094013f57a5277b59d8475c0501042c0b642e531b0a1c8f58d2163229e969"},
+            {4097, "9b4052b38f1c5fc8b1f9ff7ac7b27cd242487b3d890d15c96a1c25b8aa0fb995"},
+            {8193, "bab6c09cb8ce8cf459261398d2e7aef35700bf488116ceb94a36d0f5f1b7bc3b"},
+            {31744, "62b6960e1a44bcc1eb1a611a8d6235b6b4b78f32e7abc4fb4c6cdcce94895c47"},
+            {102400, "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085"},
+    };
+    for (const auto& test : tests) {
+        const pn::data data = blake3_input(test.size);
+        blake3         whole;
+        whole.write(data);
+        EXPECT_THAT(whole.compute().hex(), Eq(test.expected)) << test.size;
+
+        for (int piece : {1, 64, 100, 1024, 1500}) {
+            blake3 b;
+            for (int i = 0; i < data.size(); i += piece) {
+                b.write(pn::data_view{data}.slice(i, std::min(piece, data.size() - i)));
+            }
+            EXPECT_THAT(b.compute().hex(), Eq(test.expected)) << test.size << ", " << piece;
+        }
+    }
+}
+
+// Hashing on several threads should give the same digest as hashing on one, including when
+// the input doesn't start on a chunk boundary.
+TEST_F(Blake3Test, Parallel) {
+    const pn::data data = blake3_input((5 << 20) + 3);
+    const char*    expected = "d7b0c8bf65e5c4d83045f23509a2af505c29af408a404c3f363f75a7a49a5040";
+    for (int threads : {1, 2, 3, 8}) {
+        blake3 b;
+        b.write_parallel(data, threads);
+        EXPECT_THAT(b.compute().hex(), Eq<pn::string_view>(expected)) << threads;
+
+        blake3 split;
+        split.write(pn::data_view{data}.slice(0, 12345));
+        split.write_parallel(pn::data_view{data}.slice(12345), threads);
+        EXPECT_THAT(split.compute().hex(), Eq<pn::string_view>(expected)) << threads;
+    }
+}
+
+// Resuming from an exported state should give the same digest as hashing without interruption,
+// wherever the content is split.
+TEST_F(Sha1Test, ExportImport) {
+    const pn::data data = test_data(1000, 1);
+    for (int split : {0, 1, 63, 64, 65, 500, 1000}) {
+        sha1 first;
+        first.write(pn::data_view{data}.slice(0, split));
+        const pn::data state = first.export_state();
+
+        sha1 second;
+        second.write(pn::data_view{data}.slice(0, 10));
+        second.import_state(state);
+        second.write(pn::data_view{data}.slice(split));
+        EXPECT_THAT(second.compute(), Eq(single_digest(data))) << split;
+        EXPECT_THAT(second.export_state().size(), Eq(41 + (1000 % 64)));
+    }
+}
+
+// The exported format is fixed, so that states can be shared between machines and versions.
+TEST_F(Sha1Test, ExportFormat) {
+    sha1 sha;
+    sha.write(pn::string_view{"abc"}.as_data());
+    const uint8_t expected[] = {
+            's',  'f',  'z',  '-',  's',  'h',  'a',  '1',                          // Magic.
+            0x00, 0x00, 0x00, 0x01,                                                  // Version.
+            0x67, 0x45, 0x23, 0x01, 0xef, 0xcd, 0xab, 0x89, 0x98, 0xba, 0xdc, 0xfe,  // State.
+            0x10, 0x32, 0x54, 0x76, 0xc3, 0xd2, 0xe1, 0xf0,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18,                          // Bits.
+            0x03, 'a',  'b',  'c',                                                   // Pending.
+    };
+    const pn::data state = sha.export_state();
+    EXPECT_THAT(state, Eq(pn::data_view{expected, sizeof(expected)}));
+}
+
+// Importing anything but a valid state should fail, and leave the state unchanged.
+TEST_F(Sha1Test, ImportInvalid) {
+    sha1 source;
+    source.write(pn::string_view{"abc"}.as_data());
+    const pn::data valid = source.export_state();
+
+    std::vector<pn::data> invalid;
+    invalid.push_back(pn::data{});
+    invalid.push_back(pn::data_view{valid}.slice(0, 40).copy());
+    invalid.push_back(pn::data_view{valid}.slice(0, valid.size() - 1).copy());
+    invalid.push_back(valid.copy());
+    invalid.back() += pn::data_view{valid}.slice(0, 1);
+    invalid.push_back(valid.copy());
+    invalid.back()[0] = 'S';
+    invalid.push_back(valid.copy());
+    invalid.back()[11] = 2;  // Version.
+    invalid.push_back(valid.copy());
+    invalid.back()[40] = 4;  // Size is 3 bytes, not 4.
+
+    for (const pn::data& state : invalid) {
+        sha1 sha;
+        EXPECT_THROW(sha.import_state(state), std::runtime_error);
+        EXPECT_THAT(sha.compute(), Eq(kEmptyDigest));
+    }
+}
+
+// Typed writes should hash the same bytes that pn::output would write, for each hasher.
+template <typename hasher>
+void expect_typed_writes() {
+    const pn::data   bytes = test_data(100, 3);
+    const pn::string text  = "text";
+    hasher           typed;
+    typed.write(
+            uint8_t{1}, int8_t{-2}, uint16_t{0x0304}, int16_t{-5}, uint32_t{0x06070809},
+            int32_t{-10}, uint64_t{0x0b0c0d0e0f101112}, int64_t{-19}, pn::data_view{bytes},
+            pn::string_view{text}, bytes, text, true);
+    typed.template write<uint64_t>(20);
+
+    pn::data encoded;
+    encoded.output()
+            .write(uint8_t{1}, int8_t{-2}, uint16_t{0x0304}, int16_t{-5}, uint32_t{0x06070809},
+                   int32_t{-10}, uint64_t{0x0b0c0d0e0f101112}, int64_t{-19},
+                   pn::data_view{bytes}, pn::string_view{text}, bytes, text, true)
+            .write<uint64_t>(20)
+            .check();
+    hasher whole;
+    whole.write(pn::data_view{encoded});
+    EXPECT_THAT(typed.compute(), Eq(whole.compute()));
+}
+
+TEST_F(Sha1Test, TypedWrites) {
+    expect_typed_writes<sha1>();
+    expect_typed_writes<sha256>();
+    expect_typed_writes<blake3>();
+}
+
+// Writing integers, strings, and data shouldn't allocate.
+TEST_F(Sha1Test, TypedWritesDontAllocate) {
+    const pn::data   bytes = test_data(100, 4);
+    const pn::string text  = "text";
+    sha1             sha;
+    const int        before = allocations;
+    for (int i = 0; i < 100; ++i) {
+        sha.write(uint8_t{1}, int32_t{i}, uint64_t{2}, bytes, text, pn::data_view{bytes});
+        sha.write<uint64_t>(text.size());
+    }
+    EXPECT_THAT(allocations.load(), Eq(before));
+}
+
+// A hashing_output should hash everything written to it, and copy it to the tee.
+TEST_F(Sha1Test, HashingOutput) {
+    const pn::string text = "text";
+    pn::data         copy;
+    pn::output       tee = copy.output();
+    sha1             sha;
+    hashing_output<sha1>(sha, &tee).write(uint32_t{1}, text).write<uint64_t>(2).check();
+
+    pn::data encoded;
+    encoded.output().write(uint32_t{1}, text).write<uint64_t>(2).check();
+    EXPECT_THAT(copy, Eq(pn::data_view{encoded}));
+    EXPECT_THAT(sha.compute(), Eq(single_digest(encoded)));
+
+    sha256 untee;
+    hashing_output<sha256>(untee).write(uint32_t{1}, text, uint64_t{2});
+    sha256 whole;
+    whole.write(pn::data_view{encoded});
+    EXPECT_THAT(untee.compute(), Eq(whole.compute()));
+}
+
 TEST_F(Sha1Test, ReadWrite) {
     const uint8_t       bytes[20] = {0xda, 0x39, 0xa3, 0xee, 0x5e, 0x6b, 0x4b, 0x0d, 0x32, 0x55,
                                0xbf, 0xef, 0x95, 0x60, 0x18, 0x90, 0xaf, 0xd8, 0x07, 0x09};
@@ -209,6 +623,80 @@ TEST_F(Sha1Test, Print) {
     EXPECT_THAT(kEmptyDigest.hex(), Eq("da39a3ee5e6b4b0d3255bfef95601890afd80709"));
 }
 
+#define SFZ_8_BYTES "01234567"
+#define SFZ_64_BYTES                                                                        \
+    SFZ_8_BYTES SFZ_8_BYTES SFZ_8_BYTES SFZ_8_BYTES SFZ_8_BYTES SFZ_8_BYTES SFZ_8_BYTES \
+            SFZ_8_BYTES
+#define SFZ_640_BYTES                                                                       \
+    SFZ_64_BYTES SFZ_64_BYTES SFZ_64_BYTES SFZ_64_BYTES SFZ_64_BYTES SFZ_64_BYTES SFZ_64_BYTES \
+            SFZ_64_BYTES SFZ_64_BYTES SFZ_64_BYTES
+
+// Digests of literals should be computed at compile time, and match those computed at runtime.
+TEST_F(Sha1Test, Literal) {
+    constexpr sha1::digest abc = sha1_literal("abc");
+    static_assert(abc.d[0] == 0xa9993e36, "sha1_literal(\"abc\")");
+    static_assert(abc.d[4] == 0x9cd0d89d, "sha1_literal(\"abc\")");
+    constexpr sha1::digest empty = sha1_literal("");
+    static_assert(empty.d[0] == 0xda39a3ee, "sha1_literal(\"\")");
+    EXPECT_THAT(empty, Eq(kEmptyDigest));
+
+    constexpr sha1::digest long_digest = sha1_literal(SFZ_640_BYTES);
+    EXPECT_THAT(long_digest,
+                Eq(sha1::digest{0xdea356a2, 0xcddd90c7, 0xa7ecedc5, 0xebb56393, 0x4f460452}));
+
+    // Sizes around the end of a block, where padding spills into another.
+    const char kInput[] = SFZ_64_BYTES SFZ_8_BYTES;
+    EXPECT_THAT(sha1_literal(kInput), Eq(sha1_literal(SFZ_64_BYTES SFZ_8_BYTES)));
+    for (size_t size : {55, 56, 57, 63, 64, 65, 71}) {
+        char s[72] = {};
+        memcpy(s, kInput, size);
+        sha1 sha;
+        sha.write(pn::data_view{reinterpret_cast<const uint8_t*>(s), static_cast<int>(size)});
+        EXPECT_THAT(sha1_constexpr::hash(
+                            sha1::digest(
+                                    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0),
+                            s, size, 0),
+                    Eq(sha.compute()))
+                << size;
+    }
+}
+#undef SFZ_640_BYTES
+#undef SFZ_64_BYTES
+#undef SFZ_8_BYTES
+
+TEST_F(Sha1Test, HexLiteral) {
+    constexpr sha1::digest digest = sha1_hex_literal("da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    static_assert(digest.d[1] == 0x5e6b4b0d, "sha1_hex_literal()");
+    EXPECT_THAT(digest, Eq(kEmptyDigest));
+    EXPECT_THAT(sha1_hex_literal("DA39A3EE5E6B4B0D3255BFEF95601890AFD80709"), Eq(kEmptyDigest));
+
+    char invalid[] = "da39a3ee5e6b4b0d3255bfef95601890afd80709";
+    invalid[39]    = 'g';
+    EXPECT_THROW(sha1_hex_literal(invalid), std::runtime_error);
+}
+
+TEST_F(Sha1Test, ParseHex) {
+    sha1::digest digest;
+    EXPECT_THAT(sha1::digest::parse_hex(kEmptyDigest.hex(), &digest), Eq(true));
+    EXPECT_THAT(digest, Eq(kEmptyDigest));
+    const char upper[] = "DA39A3EE5E6B4B0D3255BFEF95601890AFD80709";
+    EXPECT_THAT(sha1::digest::parse_hex(upper, &digest), Eq(true));
+    EXPECT_THAT(digest, Eq(kEmptyDigest));
+
+    sha1::digest unchanged = kEmptyDigest;
+    EXPECT_THAT(
+            sha1::digest::parse_hex("da39a3ee5e6b4b0d3255bfef95601890afd8070g", &unchanged),
+            Eq(false));
+    EXPECT_THAT(
+            sha1::digest::parse_hex("da39a3ee5e6b4b0d3255bfef95601890afd8070", &unchanged),
+            Eq(false));
+    EXPECT_THAT(
+            sha1::digest::parse_hex("da39a3ee5e6b4b0d3255bfef95601890afd807090", &unchanged),
+            Eq(false));
+    EXPECT_THAT(sha1::digest::parse_hex("", &unchanged), Eq(false));
+    EXPECT_THAT(unchanged, Eq(kEmptyDigest));
+}
+
 struct TreeData {
     const char*  path;
     const char*  data;
@@ -273,8 +761,310 @@ TEST_F(Sha1Test, TreeDigest) {
         EXPECT_THAT(file_digest(path), Eq(tree_data.digest));
     }
     EXPECT_THAT(tree_digest(dir.path()), Eq(kTreeDigest));
+
+    for (int threads : {1, 2, 8}) {
+        for (int window : {0, 1, 3}) {
+            for (ReadMode mode : {READ_AUTO, READ_MAPPED, READ_STREAMED}) {
+                tree_digest_options options;
+                options.threads             = threads;
+                options.max_files_in_flight = window;
+                options.read                = mode;
+                EXPECT_THAT(tree_digest(dir.path(), options), Eq(kTreeDigest));
+            }
+        }
+    }
+}
+
+// The parallel digest of a larger tree should match the serial one, and it should reject the
+// same trees.
+TEST_F(Sha1Test, ParallelTreeDigest) {
+    TemporaryDirectory dir("sha1-test");
+    for (int i : range(100)) {
+        pn::string path = pn::format("{0}/{1}/{2}", dir.path(), i % 7, i);
+        makedirs(path::dirname(path), 0700);
+        pn::output out = pn::output{path, pn::binary};
+        ASSERT_THAT(out.c_obj(), NotNull());
+        ASSERT_THAT(out.write(test_data((i * 1000) + 1, i)), Eq(true));
+    }
+
+    const sha1::digest  expected = tree_digest(dir.path());
+    tree_digest_options options;
+    options.threads = 4;
+    EXPECT_THAT(tree_digest(dir.path(), options), Eq(expected));
+    for (int threads : {1, 4}) {
+        options.threads         = threads;
+        options.read_ahead      = 3;
+        options.read_ahead_size = 16384;
+        EXPECT_THAT(tree_digest(dir.path(), options), Eq(expected));
+    }
+
+    mkfifo(pn::format("{0}/3/fifo", dir.path()), 0700);
+    EXPECT_THROW(tree_digest(dir.path(), options), std::runtime_error);
+}
+
+// The other hashers should digest files and trees the same way sha1 does: file content alone, or
+// each file's name and content in order.
+TEST_F(Blake3Test, FileAndTreeDigest) {
+    TemporaryDirectory dir("blake3-test");
+    const pn::string   tree = pn::format("{0}/tree", dir.path());
+    blake3             expected_tree;
+    sha256             expected_sha256_tree;
+    for (int i : range(5)) {
+        const pn::string name = pn::format("{0}", i);
+        const pn::string path = pn::format("{0}/{1}", tree, name);
+        const pn::data   data = test_data((i * 1000000) + 1, i);
+        makedirs(path::dirname(path), 0700);
+        {
+            pn::output out = pn::output{path, pn::binary};
+            ASSERT_THAT(out.c_obj(), NotNull());
+            ASSERT_THAT(out.write(data), Eq(true));
+        }
+
+        blake3 b;
+        b.write(data);
+        sha256 sha;
+        sha.write(data);
+        EXPECT_THAT(file_digest<blake3>(path), Eq(b.compute()));
+        EXPECT_THAT(file_digest<sha256>(path), Eq(sha.compute()));
+
+        expected_tree.write<uint64_t>(name.size());
+        expected_tree.write(name.as_data());
+        expected_tree.write<uint64_t>(data.size());
+        expected_tree.write(data);
+        expected_sha256_tree.write<uint64_t>(name.size());
+        expected_sha256_tree.write(name.as_data());
+        expected_sha256_tree.write<uint64_t>(data.size());
+        expected_sha256_tree.write(data);
+    }
+
+    for (int threads : {1, 4}) {
+        tree_digest_options options;
+        options.threads = threads;
+        EXPECT_THAT(tree_digest<blake3>(tree, options), Eq(expected_tree.compute()));
+        EXPECT_THAT(tree_digest<sha256>(tree, options), Eq(expected_sha256_tree.compute()));
+    }
+    EXPECT_THAT(tree_digest<sha1>(tree), Eq(tree_digest(tree)));
+}
+
+// Files should have the same digest however they're read, including empty files, files which
+// straddle the size at which they are mapped automatically, and files read ahead of hashing.
+TEST_F(Sha1Test, ReadModes) {
+    TemporaryDirectory dir("sha1-test");
+    for (int size : {0, 1, 4096, 65535, 65536, 3000000}) {
+        const pn::string path = pn::format("{0}/{1}", dir.path(), size);
+        const pn::data   data = test_data(size, size);
+        {
+            pn::output out = pn::output{path, pn::binary};
+            ASSERT_THAT(out.c_obj(), NotNull());
+            ASSERT_THAT(out.write(data), Eq(true));
+        }
+
+        for (ReadMode mode : {READ_AUTO, READ_MAPPED, READ_STREAMED}) {
+            for (int read_ahead : {0, 1, 4}) {
+                for (size_t read_ahead_size : {4096, 1 << 20}) {
+                    file_digest_options options;
+                    options.read            = mode;
+                    options.read_ahead      = read_ahead;
+                    options.read_ahead_size = read_ahead_size;
+                    EXPECT_THAT(file_digest<sha1>(path, options), Eq(single_digest(data)))
+                            << size << ", " << mode << ", " << read_ahead << ", "
+                            << read_ahead_size;
+                }
+            }
+        }
+        EXPECT_THAT(file_digest(path), Eq(single_digest(data))) << size;
+    }
+}
+
+#ifdef __linux__
+// Returns the number of bytes that the calling thread has read from files so far.
+uint64_t thread_bytes_read() {
+    FILE*              f     = fopen("/proc/thread-self/io", "r");
+    unsigned long long rchar = 0;
+    if (f) {
+        if (fscanf(f, "rchar: %llu", &rchar) != 1) {
+            rchar = 0;
+        }
+        fclose(f);
+    }
+    return rchar;
+}
+
+// With more than one thread, the workers should read small files ahead of hashing, so the thread
+// which hashes them reads (almost) nothing itself.  With one, it reads everything.
+TEST_F(Sha1Test, PreloadSmallFiles) {
+    TemporaryDirectory dir("sha1-test");
+    uint64_t           total = 0;
+    for (int i : range(50)) {
+        const pn::string path = pn::format("{0}/{1}", dir.path(), i);
+        const pn::data   data = test_data(20000 + i, i);
+        pn::output       out  = pn::output{path, pn::binary};
+        ASSERT_THAT(out.c_obj(), NotNull());
+        ASSERT_THAT(out.write(data), Eq(true));
+        total += data.size();
+    }
+
+    uint64_t           before   = thread_bytes_read();
+    const sha1::digest expected = tree_digest(dir.path());
+    EXPECT_THAT(thread_bytes_read() - before, testing::Ge(total));
+
+    for (ReadMode mode : {READ_AUTO, READ_STREAMED}) {
+        tree_digest_options options;
+        options.threads = 4;
+        options.read    = mode;
+        before          = thread_bytes_read();
+        EXPECT_THAT(tree_digest(dir.path(), options), Eq(expected)) << mode;
+        EXPECT_THAT(thread_bytes_read() - before, testing::Lt(total / 10)) << mode;
+    }
 }
 #endif
 
+// Pipes can't be mapped, but they should be streamed in any mode but READ_MAPPED.
+TEST_F(Sha1Test, Fifo) {
+    TemporaryDirectory dir("sha1-test");
+    const pn::string   path = pn::format("{0}/fifo", dir.path());
+    const pn::data     data = test_data(3000000, 1);
+    mkfifo(path, 0700);
+
+    for (int read_ahead : {0, 2}) {
+        std::thread writer([&path, &data] {
+            pn::output out = pn::output{path, pn::binary};
+            out.write(data);
+        });
+        file_digest_options options;
+        options.read_ahead = read_ahead;
+        EXPECT_THAT(file_digest<sha1>(path, options), Eq(single_digest(data)));
+        writer.join();
+    }
+}
+
+// Reading from a descriptor should start at its current offset, and leave it open.
+TEST_F(Sha1Test, FileDescriptor) {
+    TemporaryDirectory dir("sha1-test");
+    const pn::string   path = pn::format("{0}/file", dir.path());
+    const pn::data     data = test_data(200000, 1);
+    {
+        pn::output out = pn::output{path, pn::binary};
+        ASSERT_THAT(out.c_obj(), NotNull());
+        ASSERT_THAT(out.write(data), Eq(true));
+    }
+
+    const int fd = open(path.c_str(), O_RDONLY);
+    ASSERT_THAT(fd, testing::Ge(0));
+    ASSERT_THAT(lseek(fd, 1000, SEEK_SET), Eq(1000));
+    EXPECT_THAT(file_digest(fd), Eq(single_digest(pn::data_view{data}.slice(1000))));
+    EXPECT_THAT(file_digest(fd), Eq(kEmptyDigest));
+    EXPECT_THAT(close(fd), Eq(0));
+
+    int pipe_fds[2];
+    ASSERT_THAT(pipe(pipe_fds), Eq(0));
+    std::thread writer([&pipe_fds, &data] {
+        for (int i = 0; i < data.size();) {
+            const ssize_t n = write(pipe_fds[1], data.data() + i, data.size() - i);
+            if (n <= 0) {
+                break;
+            }
+            i += n;
+        }
+        close(pipe_fds[1]);
+    });
+    EXPECT_THAT(file_digest<sha256>(pipe_fds[0]), Eq(file_digest<sha256>(path)));
+    writer.join();
+    close(pipe_fds[0]);
+}
+
+// Hashing in the kernel, where it's available, should give the same digests as hashing in user
+// space, and consume the same part of a descriptor.  Where it isn't, it should fall back.
+TEST_F(Sha1Test, Offload) {
+    EXPECT_THAT(kernel_hasher("no-such-hash").available(), Eq(false));
+#ifdef __linux__
+    // Offloading is measured on a file in memory, which should read like any other.
+    {
+        const pn::data memory_data = test_data(3000000, 2);
+        memory_file    memory(memory_data);
+        EXPECT_THAT(file_digest(memory.fd()), Eq(single_digest(memory_data)));
+        EXPECT_THAT(file_digest(memory.fd()), Eq(kEmptyDigest));
+    }
+#endif
+
+    TemporaryDirectory dir("sha1-test");
+    const pn::string   path = pn::format("{0}/file", dir.path());
+    for (int size : {0, 1000, 3000000}) {
+        const pn::data data = test_data(size, 1);
+        {
+            pn::output out = pn::output{path, pn::binary};
+            ASSERT_THAT(out.c_obj(), NotNull());
+            ASSERT_THAT(out.write(data), Eq(true));
+        }
+        sha256 sha;
+        sha.write(data);
+        const sha256::digest expected = sha.compute();
+
+        for (OffloadMode offload : {OFFLOAD_AUTO, OFFLOAD_NEVER, OFFLOAD_ALWAYS}) {
+            file_digest_options options;
+            options.offload = offload;
+            EXPECT_THAT(file_digest<sha1>(path, options), Eq(single_digest(data)))
+                    << size << ", " << offload;
+            EXPECT_THAT(file_digest<sha256>(path, options), Eq(expected)) << size << ", " << offload;
+            EXPECT_THAT(file_digest<blake3>(path, options), Eq(file_digest<blake3>(path)));
+
+            const int fd = open(path.c_str(), O_RDONLY);
+            ASSERT_THAT(fd, testing::Ge(0));
+            ASSERT_THAT(lseek(fd, size / 2, SEEK_SET), Eq(size / 2));
+            EXPECT_THAT(file_digest<sha1>(fd, options),
+                        Eq(single_digest(pn::data_view{data}.slice(size / 2))));
+            EXPECT_THAT(file_digest<sha1>(fd, options), Eq(kEmptyDigest));
+            EXPECT_THAT(close(fd), Eq(0));
+        }
+    }
+}
+#endif
+
+// Many files should be hashed in order, with errors reported for those that can't be hashed, and
+// directories hashed as trees if asked.
+TEST_F(Sha1Test, FileDigests) {
+    TemporaryDirectory      dir("sha1-test");
+    std::vector<pn::string> paths;
+    std::vector<pn::data>   data;
+    for (int i : range(20)) {
+        paths.push_back(pn::format("{0}/tree/{1}", dir.path(), i));
+        data.push_back(test_data(i * 10000, i));
+        if (i == 0) {
+            makedirs(path::dirname(paths[0]), 0700);
+        }
+        pn::output out = pn::output{paths[i], pn::binary};
+        ASSERT_THAT(out.c_obj(), NotNull());
+        ASSERT_THAT(out.write(data[i]), Eq(true));
+    }
+    paths.push_back(pn::format("{0}/missing", dir.path()));
+    paths.push_back(pn::format("{0}/tree", dir.path()));
+    std::vector<pn::string_view> views(paths.begin(), paths.end());
+
+    for (int threads : {1, 4}) {
+        for (bool trees : {false, true}) {
+            file_digests_options options;
+            options.threads = threads;
+            options.trees   = trees;
+            size_t next     = 0;
+            file_digests(
+                    views, options,
+                    [&](size_t i, const sha1::digest* digest, pn::string_view error) {
+                        EXPECT_THAT(i, Eq(next++));
+                        if (i < 20) {
+                            ASSERT_THAT(digest, NotNull()) << error;
+                            EXPECT_THAT(*digest, Eq(single_digest(data[i]))) << i;
+                        } else if ((i == 21) && trees) {
+                            ASSERT_THAT(digest, NotNull()) << error;
+                            EXPECT_THAT(*digest, Eq(tree_digest(paths[i])));
+                        } else {
+                            EXPECT_THAT(digest, testing::IsNull()) << i;
+                            EXPECT_THAT(error.empty(), Eq(false));
+                        }
+                    });
+            EXPECT_THAT(next, Eq(paths.size()));
+        }
+    }
+}
+
 }  // namespace
 }  // namespace sfz
@@ -0,0 +1,214 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <sfz/duplicates.hpp>
+
+#include <algorithm>
+#include <sfz/file.hpp>
+#include <sfz/hash.hpp>
+#include <sfz/os.hpp>
+#include <sfz/parallel.hpp>
+#include <utility>
+
+namespace sfz {
+
+namespace {
+
+// A distinct file, with each of the paths it was found at.
+struct file_entry {
+    uint64_t                size;
+    uint64_t                dev;
+    uint64_t                ino;
+    std::vector<pn::string> paths;
+    uint64_t                sample;
+    sha1::digest            digest;
+};
+
+// Lists the regular files in a tree which aren't too small.  Symlinks aren't followed, so that
+// there can be no cycles, and anything else is ignored.
+struct fileWalker : TreeWalker {
+    void file(pn::string_view path, const Stat& st) const {
+        if (static_cast<uint64_t>(st.st_size) >= min_size) {
+            std::vector<pn::string> paths;
+            paths.push_back(path.copy());
+            files.push_back(file_entry{static_cast<uint64_t>(st.st_size),
+                                       static_cast<uint64_t>(st.st_dev),
+                                       static_cast<uint64_t>(st.st_ino), std::move(paths), 0,
+                                       sha1::digest{}});
+        }
+    }
+
+    void pre_directory(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+    void cycle_directory(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+    void post_directory(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+    void symlink(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+    void broken_symlink(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+    void other(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+
+    uint64_t                 min_size;
+    std::vector<file_entry>& files;
+    fileWalker(uint64_t min_size, std::vector<file_entry>& files)
+            : min_size(min_size), files(files) {}
+};
+
+bool by_first_path(const file_entry& x, const file_entry& y) {
+    return pn::string_view{x.paths[0]} < pn::string_view{y.paths[0]};
+}
+
+bool by_nothing(const file_entry&, const file_entry&) { return false; }
+bool by_sample(const file_entry& x, const file_entry& y) { return x.sample < y.sample; }
+bool by_digest(const file_entry& x, const file_entry& y) {
+    return std::lexicographical_compare(x.digest.d, x.digest.d + 5, y.digest.d, y.digest.d + 5);
+}
+
+// Merges the paths of hard links to the same file, and of paths found twice, under overlapping
+// roots.
+void merge_links(std::vector<file_entry>& files) {
+    std::sort(files.begin(), files.end(), [](const file_entry& x, const file_entry& y) {
+        if ((x.dev != y.dev) || (x.ino != y.ino)) {
+            return (x.dev != y.dev) ? (x.dev < y.dev) : (x.ino < y.ino);
+        }
+        return by_first_path(x, y);
+    });
+    std::vector<file_entry> merged;
+    for (file_entry& f : files) {
+        if (!merged.empty() && (f.ino != 0) && (merged.back().dev == f.dev) &&
+            (merged.back().ino == f.ino)) {
+            if (pn::string_view{merged.back().paths.back()} != pn::string_view{f.paths[0]}) {
+                merged.back().paths.push_back(std::move(f.paths[0]));
+            }
+        } else {
+            merged.push_back(std::move(f));
+        }
+    }
+    files.swap(merged);
+}
+
+// Keeps the files which have the same size as another, and which `less` doesn't order before or
+// after it, and sorts them by size, largest first, so that large files are read first.
+template <typename Less>
+void keep_matches(std::vector<file_entry>& files, Less less) {
+    std::stable_sort(
+            files.begin(), files.end(), [&less](const file_entry& x, const file_entry& y) {
+                return (x.size != y.size) ? (x.size > y.size) : less(x, y);
+            });
+    std::vector<file_entry> kept;
+    for (size_t i = 0; i < files.size();) {
+        size_t j = i + 1;
+        while ((j < files.size()) && (files[j].size == files[i].size) &&
+               !less(files[i], files[j])) {
+            ++j;
+        }
+        if (j - i > 1) {
+            for (; i < j; ++i) {
+                kept.push_back(std::move(files[i]));
+            }
+        }
+        i = j;
+    }
+    files.swap(kept);
+}
+
+size_t read_fully(streamed_file& file, uint8_t* data, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        const size_t n = file.read(data + total, size - total);
+        if (n == 0) {
+            break;
+        }
+        total += n;
+    }
+    return total;
+}
+
+// Hashes the first and last `sample_size` bytes of a file, which must be larger than twice that.
+uint64_t sample_hash(pn::string_view path, uint64_t size, size_t sample_size) {
+    std::vector<uint8_t> buffer(2 * sample_size);
+    streamed_file        file(path);
+    size_t               n = read_fully(file, buffer.data(), sample_size);
+    file.seek(size - sample_size);
+    n += read_fully(file, buffer.data() + n, sample_size);
+    return fast_hash64(pn::data_view{buffer.data(), static_cast<int>(n)});
+}
+
+}  // namespace
+
+std::vector<duplicate_group> find_duplicates(
+        const std::vector<pn::string_view>& roots, const duplicate_options& options) {
+    std::vector<file_entry> files;
+    for (pn::string_view root : roots) {
+        walk(root, WALK_PHYSICAL, fileWalker(options.min_size, files));
+    }
+    merge_links(files);
+
+    // Files of a unique size can't be duplicates.
+    keep_matches(files, by_nothing);
+
+    // Tell apart files of the same size by their ends.  Smaller files are only hashed whole.
+    const int           threads = thread_count(options.threads);
+    const size_t        sample  = std::max<size_t>(options.sample_size, 1);
+    std::vector<size_t> sampled;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (files[i].size > 2 * sample) {
+            sampled.push_back(i);
+        }
+    }
+    ordered_map<uint64_t>(
+            sampled.size(), threads, 4 * threads,
+            [&files, &sampled, sample](size_t i) {
+                const file_entry& f = files[sampled[i]];
+                return sample_hash(f.paths[0], f.size, sample);
+            },
+            [&files, &sampled](size_t i, uint64_t& hash) { files[sampled[i]].sample = hash; });
+    keep_matches(files, by_sample);
+
+    // Confirm that files which are still alike are the same by hashing them whole.
+    file_digest_options file_options;
+    file_options.threads = 1;
+    file_options.read    = options.read;
+    ordered_map<sha1::digest>(
+            files.size(), threads, 4 * threads,
+            [&files, &file_options](size_t i) {
+                return file_digest<sha1>(files[i].paths[0], file_options);
+            },
+            [&files](size_t i, sha1::digest& digest) { files[i].digest = digest; });
+    keep_matches(files, by_digest);
+
+    std::vector<duplicate_group> groups;
+    for (size_t i = 0; i < files.size();) {
+        duplicate_group group{files[i].size, files[i].digest, {}};
+        size_t          j = i + 1;
+        while ((j < files.size()) && (files[j].size == group.size) &&
+               (files[j].digest == group.digest)) {
+            ++j;
+        }
+        std::sort(files.begin() + i, files.begin() + j, by_first_path);
+        for (; i < j; ++i) {
+            group.files.push_back(std::move(files[i].paths));
+        }
+        groups.push_back(std::move(group));
+    }
+    return groups;
+}
+
+}  // namespace sfz
@@ -0,0 +1,123 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sfz/duplicates.hpp>
+#include <sfz/os.hpp>
+#include <sfz/test-data.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using testing::ElementsAre;
+using testing::Eq;
+using testing::IsEmpty;
+using testing::SizeIs;
+
+namespace sfz {
+
+namespace {
+
+using DuplicatesTest = ::testing::Test;
+
+// Describes each group as the paths of its files, relative to `root`, with hard links to the
+// same file joined by '='.
+std::vector<std::string> describe(
+        const std::vector<duplicate_group>& groups, pn::string_view root) {
+    std::vector<std::string> result;
+    for (const duplicate_group& group : groups) {
+        std::string s;
+        for (const std::vector<pn::string>& paths : group.files) {
+            s += s.empty() ? "" : " ";
+            for (size_t i = 0; i < paths.size(); ++i) {
+                const pn::string_view relative = pn::string_view{paths[i]}.substr(root.size() + 1);
+                s += (i ? "=" : "") + std::string(relative.data(), relative.size());
+            }
+        }
+        result.push_back(s);
+    }
+    return result;
+}
+
+// Files should be duplicates only if their content is the same, including when their sizes and
+// ends are the same, and larger groups should come first.
+TEST_F(DuplicatesTest, Content) {
+    TemporaryDirectory dir("duplicates-test");
+    const pn::string   root = dir.path().copy();
+    write_file(pn::format("{0}/a/hello", root), "hello, world");
+    write_file(pn::format("{0}/b/hello", root), "hello, world");
+    write_file(pn::format("{0}/b/deep/hello", root), "hello, world");
+    write_file(pn::format("{0}/a/unique", root), "unique size");
+    write_file(pn::format("{0}/a/jello", root), "jello, world");
+    write_file(pn::format("{0}/a/long1", root), "start 1111111111111111 end");
+    write_file(pn::format("{0}/b/long1", root), "start 1111111111111111 end");
+    write_file(pn::format("{0}/a/long2", root), "start 2222222222222222 end");
+    write_file(pn::format("{0}/a/empty", root), "");
+    write_file(pn::format("{0}/b/empty", root), "");
+
+    for (int threads : {1, 4}) {
+        for (size_t sample_size : {4, 4096}) {
+            duplicate_options options;
+            options.threads     = threads;
+            options.sample_size = sample_size;
+            const std::vector<duplicate_group> groups = find_duplicates({root}, options);
+            EXPECT_THAT(describe(groups, root),
+                        ElementsAre("a/long1 b/long1", "a/hello b/deep/hello b/hello"));
+            ASSERT_THAT(groups, SizeIs(2));
+            EXPECT_THAT(groups[1].size, Eq<uint64_t>(12));
+            EXPECT_THAT(groups[1].digest, Eq(sha1_literal("hello, world")));
+        }
+    }
+
+    duplicate_options options;
+    options.min_size = 0;
+    EXPECT_THAT(describe(find_duplicates({root}, options), root),
+                ElementsAre("a/long1 b/long1", "a/hello b/deep/hello b/hello", "a/empty b/empty"));
+    options.min_size = 13;
+    EXPECT_THAT(describe(find_duplicates({root}, options), root), ElementsAre("a/long1 b/long1"));
+}
+
+// Roots may overlap, or be files, without a file being listed twice.
+TEST_F(DuplicatesTest, Roots) {
+    TemporaryDirectory dir("duplicates-test");
+    const pn::string   root = dir.path().copy();
+    write_file(pn::format("{0}/a/x", root), "same");
+    write_file(pn::format("{0}/b/x", root), "same");
+    const pn::string a = pn::format("{0}/a", root);
+    const pn::string b = pn::format("{0}/b/x", root);
+
+    EXPECT_THAT(find_duplicates({a}), IsEmpty());
+    EXPECT_THAT(describe(find_duplicates({a, b}), root), ElementsAre("a/x b/x"));
+    EXPECT_THAT(describe(find_duplicates({root, a, b}), root), ElementsAre("a/x b/x"));
+    EXPECT_THROW(find_duplicates({pn::format("{0}/missing", root)}), std::runtime_error);
+}
+
+#ifndef _WIN32
+
+// Hard links to a file should be listed together, as one file, and symlinks ignored.
+TEST_F(DuplicatesTest, Links) {
+    TemporaryDirectory dir("duplicates-test");
+    const pn::string   root = dir.path().copy();
+    write_file(pn::format("{0}/a", root), "content");
+    write_file(pn::format("{0}/b", root), "content");
+    ASSERT_THAT(
+            ::link(pn::format("{0}/a", root).c_str(), pn::format("{0}/c", root).c_str()), Eq(0));
+    symlink("a", pn::format("{0}/d", root));
+    EXPECT_THAT(describe(find_duplicates({root}), root), ElementsAre("a=c b"));
+
+    unlink(pn::format("{0}/b", root));
+    EXPECT_THAT(find_duplicates({root}), IsEmpty());
+}
+
+#endif  // _WIN32
+
+}  // namespace
+}  // namespace sfz
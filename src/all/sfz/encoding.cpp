@@ -5,10 +5,23 @@
 
 #include <sfz/encoding.hpp>
 
+#include <string.h>
 #include <algorithm>
+#include <array>
+#include <memory>
 #include <pn/data>
 #include <pn/string>
+#include <sfz/codepages.hpp>
+#include <sfz/cpu.hpp>
 #include <sfz/range.hpp>
+#include <vector>
+
+#ifdef SFZ_X86
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace sfz {
 
@@ -26,233 +39,1252 @@ namespace {
 // @returns             true iff `code` is a surrogate code.
 inline bool is_surrogate(uint32_t rune) { return (rune & 0xfffff800) == 0x00d800; }
 
-}  // namespace
+// Kernels may store up to kSlack bytes past the end of what they write, so that they can always
+// store a whole vector.  Conversions into a buffer with no room to spare finish without them.
+const size_t kSlack = 32;
 
-const pn::rune kUnknownCodePoint{0x00fffd};       // REPLACEMENT CHARACTER.
-const pn::rune kAsciiUnknownCodePoint{0x00003f};  // QUESTION MARK.
+int count_trailing_zeros(uint32_t x) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return index;
+#else
+    return __builtin_ctz(x);
+#endif
+}
 
-bool is_valid_code_point(uint32_t rune) { return (rune <= 0x10ffff) && (!is_surrogate(rune)); }
+const uint64_t kHighBits = 0x8080808080808080ULL;
 
-namespace ascii {
+uint64_t read64(const uint8_t* p) {
+    uint64_t x;
+    memcpy(&x, p, 8);
+    return x;
+}
 
-pn::data encode(pn::string_view string) {
-    pn::data out;
-    for (pn::rune r : string) {
-        uint8_t byte = kAsciiUnknownCodePoint.value();
-        if (r.value() < 0x80) {
-            byte = r.value();
+// A UTF-8 sequence, as examined by read_sequence().  If it's valid, `size` is its size.  If it's
+// invalid, `size` is the size of its longest valid prefix (at least 1), which is to be replaced as
+// a whole, as Unicode recommends.  If it's a valid prefix which is cut off at the end of the
+// input, `size` is 0.
+struct sequence {
+    int  size;
+    bool valid;
+};
+
+sequence read_sequence(const uint8_t* in, size_t n, uint32_t* rune) {
+    const uint8_t lead = in[0];
+    int           size;
+    uint8_t       lo = 0x80, hi = 0xbf;  // The range of the next byte.
+    if (lead < 0x80) {
+        *rune = lead;
+        return {1, true};
+    } else if (lead < 0xc2) {
+        return {1, false};
+    } else if (lead < 0xe0) {
+        size = 2;
+    } else if (lead < 0xf0) {
+        size = 3;
+        lo   = (lead == 0xe0) ? 0xa0 : 0x80;  // Overlong.
+        hi   = (lead == 0xed) ? 0x9f : 0xbf;  // Surrogates.
+    } else if (lead < 0xf5) {
+        size = 4;
+        lo   = (lead == 0xf0) ? 0x90 : 0x80;  // Overlong.
+        hi   = (lead == 0xf4) ? 0x8f : 0xbf;  // Above U+10FFFF.
+    } else {
+        return {1, false};
+    }
+
+    uint32_t r = lead & (0x7f >> size);
+    for (int i = 1; i < size; ++i) {
+        if (static_cast<size_t>(i) == n) {
+            return {0, false};
+        } else if ((in[i] < lo) || (in[i] > hi)) {
+            return {i, false};
         }
-        out += pn::data_view{&byte, 1};
+        r  = (r << 6) | (in[i] & 0x3f);
+        lo = 0x80;
+        hi = 0xbf;
     }
-    return out;
+    *rune = r;
+    return {size, true};
 }
 
-pn::string decode(pn::data_view data) {
-    pn::string out;
-    for (uint8_t byte : data) {
-        if (byte < 0x80) {
-            out += pn::rune{byte};
+// Kernels for runs of text which can be converted without looking up each rune.  Each has a
+// portable version, which works eight bytes at a time where it can, and vector versions, which
+// are chosen by cpu().
+//
+// copy_ascii() copies bytes from `in` to `out` until the first which isn't ASCII, and returns the
+// number copied.  widen_latin1() converts all `n` Latin-1 bytes to UTF-8 (at most 2n bytes), and
+// returns the size of the UTF-8.  narrow_latin1() converts UTF-8 to Latin-1 until the first rune
+// which isn't in Latin-1, or isn't entirely in `in`, or isn't valid UTF-8, and returns the number
+// of bytes read, and sets `written` to the number written.
+//
+// The sizes of conversions are counted with two more: ascii_length() returns the number of bytes
+// before the first which isn't ASCII, and count_range() returns the number of bytes in [lo, hi].
+//
+// find_invalid_utf8() returns the offset of the first sequence which read_sequence() wouldn't
+// accept as valid, or `n` if there is none.
+typedef size_t (*copy_ascii_f)(const uint8_t* in, size_t n, uint8_t* out);
+typedef size_t (*widen_latin1_f)(const uint8_t* in, size_t n, uint8_t* out);
+typedef size_t (*narrow_latin1_f)(const uint8_t* in, size_t n, uint8_t* out, size_t* written);
+typedef size_t (*ascii_length_f)(const uint8_t* in, size_t n);
+typedef size_t (*count_range_f)(const uint8_t* in, size_t n, uint8_t lo, uint8_t hi);
+typedef size_t (*find_invalid_utf8_f)(const uint8_t* in, size_t n);
+
+size_t portable_copy_ascii(const uint8_t* in, size_t n, uint8_t* out) {
+    size_t i = 0;
+    for (; (i + 8 <= n) && !(read64(in + i) & kHighBits); i += 8) {
+        memcpy(out + i, in + i, 8);
+    }
+    for (; (i < n) && (in[i] < 0x80); ++i) {
+        out[i] = in[i];
+    }
+    return i;
+}
+
+size_t portable_widen_latin1(const uint8_t* in, size_t n, uint8_t* out) {
+    uint8_t* const start = out;
+    for (size_t i = 0; i < n;) {
+        if ((i + 8 <= n) && !(read64(in + i) & kHighBits)) {
+            memcpy(out, in + i, 8);
+            out += 8;
+            i += 8;
+        } else if (in[i] < 0x80) {
+            *(out++) = in[i++];
         } else {
-            out += pn::rune{kUnknownCodePoint};
+            *(out++) = 0xc0 | (in[i] >> 6);
+            *(out++) = 0x80 | (in[i++] & 0x3f);
         }
     }
-    return out;
+    return out - start;
 }
 
-}  // namespace ascii
+size_t portable_narrow_latin1(const uint8_t* in, size_t n, uint8_t* out, size_t* written) {
+    uint8_t* const start = out;
+    size_t         i     = 0;
+    while (i < n) {
+        if ((i + 8 <= n) && !(read64(in + i) & kHighBits)) {
+            memcpy(out, in + i, 8);
+            out += 8;
+            i += 8;
+        } else if (in[i] < 0x80) {
+            *(out++) = in[i++];
+        } else if (((in[i] & 0xfe) == 0xc2) && (i + 1 < n) && ((in[i + 1] & 0xc0) == 0x80)) {
+            // U+0080 to U+00FF are encoded as 0xC2 or 0xC3, then a continuation byte.
+            *(out++) = ((in[i] & 0x03) << 6) | (in[i + 1] & 0x3f);
+            i += 2;
+        } else {
+            break;
+        }
+    }
+    *written = out - start;
+    return i;
+}
 
-namespace latin1 {
+size_t portable_ascii_length(const uint8_t* in, size_t n) {
+    size_t i = 0;
+    for (; (i + 8 <= n) && !(read64(in + i) & kHighBits); i += 8) {
+    }
+    for (; (i < n) && (in[i] < 0x80); ++i) {
+    }
+    return i;
+}
 
-pn::data encode(pn::string_view string) {
-    pn::data out;
-    for (pn::rune r : string) {
-        uint8_t byte = '?';
-        if (r.value() < 0x100) {
-            byte = r.value();
+size_t portable_count_range(const uint8_t* in, size_t n, uint8_t lo, uint8_t hi) {
+    const uint8_t span  = hi - lo;
+    size_t        count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        count += static_cast<uint8_t>(in[i] - lo) <= span;
+    }
+    return count;
+}
+
+size_t portable_find_invalid_utf8(const uint8_t* in, size_t n) {
+    size_t i = 0;
+    while (i < n) {
+        i += portable_ascii_length(in + i, n - i);
+        for (uint32_t rune; (i < n) && (in[i] >= 0x80);) {
+            const sequence seq = read_sequence(in + i, n - i, &rune);
+            if (!seq.valid) {
+                return i;
+            }
+            i += seq.size;
         }
-        out += pn::data_view{&byte, 1};
     }
-    return out;
+    return n;
 }
 
-pn::string decode(pn::data_view data) {
-    pn::string out;
-    for (uint8_t byte : data) {
-        out += pn::rune{byte};
+// Finishes find_invalid_utf8() with the portable version, once a vector version has either found
+// an error in the block at `i`, or run out of whole blocks.  Every sequence which ends before `i`
+// is valid, and none is longer than four bytes, so the first invalid sequence can start no
+// earlier than three bytes before `i`.  Continuation bytes there belong to sequences which ended
+// earlier, so the portable version starts after them.
+size_t find_invalid_utf8_after(const uint8_t* in, size_t n, size_t i) {
+    size_t from = (i > 3) ? (i - 3) : 0;
+    while ((from < i) && ((in[from] & 0xc0) == 0x80)) {
+        ++from;
     }
-    return out;
+    return from + portable_find_invalid_utf8(in + from, n - from);
 }
 
-}  // namespace latin1
+#ifdef SFZ_X86
 
-namespace macroman {
+// Shuffles which compact vectors of bytes, indexed by a mask of the bytes in each group of eight.
+// For widening, each of eight 16-bit lanes keeps its low byte, and its high byte if its bit is
+// set.  For narrowing, each of eight bytes is kept unless its bit is set.
+struct shuffle_table {
+    uint8_t shuffle[256][16];
+    uint8_t size[256];
+};
 
-namespace {
+shuffle_table make_widen_table() {
+    shuffle_table t;
+    for (int mask = 0; mask < 256; ++mask) {
+        int size = 0;
+        for (int lane = 0; lane < 8; ++lane) {
+            t.shuffle[mask][size++] = 2 * lane;
+            if (mask & (1 << lane)) {
+                t.shuffle[mask][size++] = (2 * lane) + 1;
+            }
+        }
+        t.size[mask] = size;
+        memset(t.shuffle[mask] + size, 0x80, 16 - size);
+    }
+    return t;
+}
+
+shuffle_table make_narrow_table() {
+    shuffle_table t;
+    for (int mask = 0; mask < 256; ++mask) {
+        int size = 0;
+        for (int i = 0; i < 8; ++i) {
+            if (!(mask & (1 << i))) {
+                t.shuffle[mask][size++] = i;
+            }
+        }
+        t.size[mask] = size;
+        memset(t.shuffle[mask] + size, 0x80, 16 - size);
+    }
+    return t;
+}
+
+const shuffle_table kWiden  = make_widen_table();
+const shuffle_table kNarrow = make_narrow_table();
+
+SFZ_TARGET("sse2")
+size_t sse2_copy_ascii(const uint8_t* in, size_t n, uint8_t* out) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const int     high = _mm_movemask_epi8(v);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), v);
+        if (high) {
+            return i + count_trailing_zeros(high);
+        }
+    }
+    return i + portable_copy_ascii(in + i, n - i, out + i);
+}
+
+SFZ_TARGET("avx2")
+size_t avx2_copy_ascii(const uint8_t* in, size_t n, uint8_t* out) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i  v    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        const uint32_t high = _mm256_movemask_epi8(v);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+        if (high) {
+            return i + count_trailing_zeros(high);
+        }
+    }
+    return i + sse2_copy_ascii(in + i, n - i, out + i);
+}
+
+// Widens eight Latin-1 bytes, zero-extended to 16-bit lanes, with the given mask of those which
+// aren't ASCII.  Those become a lead byte, then a continuation byte.
+SFZ_TARGET("ssse3")
+uint8_t* ssse3_widen8(__m128i w, int high, uint8_t* out) {
+    const __m128i lead = _mm_or_si128(_mm_srli_epi16(w, 6), _mm_set1_epi16(0xc0));
+    const __m128i cont =
+            _mm_or_si128(_mm_and_si128(w, _mm_set1_epi16(0x3f)), _mm_set1_epi16(0x80));
+    const __m128i pair  = _mm_or_si128(lead, _mm_slli_epi16(cont, 8));
+    const __m128i wide  = _mm_cmpgt_epi16(w, _mm_set1_epi16(0x7f));
+    const __m128i lanes = _mm_or_si128(_mm_and_si128(wide, pair), _mm_andnot_si128(wide, w));
+    _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(out),
+            _mm_shuffle_epi8(
+                    lanes, _mm_loadu_si128(
+                                   reinterpret_cast<const __m128i*>(kWiden.shuffle[high]))));
+    return out + kWiden.size[high];
+}
+
+SFZ_TARGET("ssse3")
+size_t ssse3_widen_latin1(const uint8_t* in, size_t n, uint8_t* out) {
+    uint8_t* const start = out;
+    const __m128i  zero  = _mm_setzero_si128();
+    size_t         i     = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const int     high = _mm_movemask_epi8(v);
+        if (!high) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+            out += 16;
+            continue;
+        }
+        out = ssse3_widen8(_mm_unpacklo_epi8(v, zero), high & 0xff, out);
+        out = ssse3_widen8(_mm_unpackhi_epi8(v, zero), high >> 8, out);
+    }
+    return (out - start) + portable_widen_latin1(in + i, n - i, out);
+}
+
+// Narrows sixteen bytes at a time where they are only ASCII and two-byte sequences for U+0080 to
+// U+00FF.  Each lead byte is combined with the continuation after it, and then continuations are
+// dropped.  Other blocks, including those in which a lead and continuation aren't paired, as at
+// the end of the block or in invalid UTF-8, are left to the portable version.
+SFZ_TARGET("ssse3")
+size_t ssse3_narrow_latin1(const uint8_t* in, size_t n, uint8_t* out, size_t* written) {
+    uint8_t* const start = out;
+    size_t         i     = 0;
+    while (i + 16 <= n) {
+        const __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const int     high = _mm_movemask_epi8(v);
+        if (!high) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+            out += 16;
+            i += 16;
+            continue;
+        }
+
+        const __m128i leads =
+                _mm_cmpeq_epi8(_mm_and_si128(v, _mm_set1_epi8(-2)), _mm_set1_epi8(0xc2 - 256));
+        const __m128i conts = _mm_cmpeq_epi8(
+                _mm_and_si128(v, _mm_set1_epi8(0xc0 - 256)), _mm_set1_epi8(0x80 - 256));
+        const int lead_mask = _mm_movemask_epi8(leads);
+        const int cont_mask = _mm_movemask_epi8(conts);
+        if (((lead_mask | cont_mask) != high) || ((lead_mask << 1) != cont_mask)) {
+            size_t       w;
+            const size_t read = portable_narrow_latin1(in + i, 16, out, &w);
+            out += w;
+            i += read;
+            if (!read) {
+                break;
+            }
+            continue;
+        }
+
+        const __m128i next  = _mm_srli_si128(v, 1);
+        const __m128i value = _mm_or_si128(
+                _mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi8(0x03)), 6),
+                _mm_and_si128(next, _mm_set1_epi8(0x3f)));
+        const __m128i bytes =
+                _mm_or_si128(_mm_and_si128(leads, value), _mm_andnot_si128(leads, v));
+        const int lo = cont_mask & 0xff;
+        const int hi = cont_mask >> 8;
+        _mm_storel_epi64(
+                reinterpret_cast<__m128i*>(out),
+                _mm_shuffle_epi8(
+                        bytes, _mm_loadu_si128(
+                                       reinterpret_cast<const __m128i*>(kNarrow.shuffle[lo]))));
+        out += kNarrow.size[lo];
+        _mm_storel_epi64(
+                reinterpret_cast<__m128i*>(out),
+                _mm_shuffle_epi8(
+                        _mm_srli_si128(bytes, 8),
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(kNarrow.shuffle[hi]))));
+        out += kNarrow.size[hi];
+        i += 16;
+    }
+    size_t       w;
+    const size_t read = portable_narrow_latin1(in + i, n - i, out, &w);
+    *written          = (out - start) + w;
+    return i + read;
+}
+
+SFZ_TARGET("sse2")
+size_t sse2_ascii_length(const uint8_t* in, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const int     high = _mm_movemask_epi8(v);
+        if (high) {
+            return i + count_trailing_zeros(high);
+        }
+    }
+    return i + portable_ascii_length(in + i, n - i);
+}
+
+SFZ_TARGET("avx2")
+size_t avx2_ascii_length(const uint8_t* in, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const uint32_t high = _mm256_movemask_epi8(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)));
+        if (high) {
+            return i + count_trailing_zeros(high);
+        }
+    }
+    return i + sse2_ascii_length(in + i, n - i);
+}
+
+// Counts bytes in range a vector at a time.  A byte is in [lo, hi] if, less lo, it is no greater
+// than hi - lo, unsigned.  Each byte of `counts` adds one for each vector in which that byte is in
+// range, so they are summed before they can overflow, every 255 vectors.
+SFZ_TARGET("sse2")
+size_t sse2_count_range(const uint8_t* in, size_t n, uint8_t lo, uint8_t hi) {
+    const __m128i base  = _mm_set1_epi8(lo);
+    const __m128i span  = _mm_set1_epi8(hi - lo);
+    const __m128i zero  = _mm_setzero_si128();
+    size_t        count = 0;
+    size_t        i     = 0;
+    while (i + 16 <= n) {
+        const size_t end    = i + (16 * std::min<size_t>((n - i) / 16, 255));
+        __m128i      counts = zero;
+        for (; i < end; i += 16) {
+            const __m128i v = _mm_sub_epi8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), base);
+            counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(_mm_min_epu8(v, span), v));
+        }
+        const __m128i sums = _mm_sad_epu8(counts, zero);
+        count += _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+    return count + portable_count_range(in + i, n - i, lo, hi);
+}
+
+SFZ_TARGET("avx2")
+size_t avx2_count_range(const uint8_t* in, size_t n, uint8_t lo, uint8_t hi) {
+    const __m256i base  = _mm256_set1_epi8(lo);
+    const __m256i span  = _mm256_set1_epi8(hi - lo);
+    const __m256i zero  = _mm256_setzero_si256();
+    size_t        count = 0;
+    size_t        i     = 0;
+    while (i + 32 <= n) {
+        const size_t end    = i + (32 * std::min<size_t>((n - i) / 32, 255));
+        __m256i      counts = zero;
+        for (; i < end; i += 32) {
+            const __m256i v = _mm256_sub_epi8(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)), base);
+            counts = _mm256_sub_epi8(counts, _mm256_cmpeq_epi8(_mm256_min_epu8(v, span), v));
+        }
+        const __m256i wide = _mm256_sad_epu8(counts, zero);
+        const __m128i sums =
+                _mm_add_epi64(_mm256_castsi256_si128(wide), _mm256_extracti128_si256(wide, 1));
+        count += _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+    return count + sse2_count_range(in + i, n - i, lo, hi);
+}
+
+// Validates UTF-8 a vector at a time by table lookup, as in Keiser and Lemire, "Validating UTF-8
+// In Less Than One Instruction Per Byte".  Most errors can be told from two bytes: the high and
+// low nibbles of the first byte, and the high nibble of the second, each look up the set of errors
+// they're consistent with, and an error is present where all three agree.  The rest are sequences
+// with too few or too many continuation bytes, which are found by comparing the continuation
+// bytes expected after each lead, two and three bytes back, with those which are present.
+const uint8_t kTooShort    = 1 << 0;  // 11______ 0_______, or 11______ 11______
+const uint8_t kTooLong     = 1 << 1;  // 0_______ 10______
+const uint8_t kOverlong3   = 1 << 2;  // 11100000 100_____
+const uint8_t kTooLarge    = 1 << 3;  // 11110100 1001____ to 11111111 10111111
+const uint8_t kSurrogate   = 1 << 4;  // 11101101 101_____
+const uint8_t kOverlong2   = 1 << 5;  // 1100000_ 10______
+const uint8_t kOverlong4   = 1 << 6;  // 11110000 1000____
+const uint8_t kTooLarge100 = 1 << 6;  // 11110101 1000____ to 11111111 1000____
+const uint8_t kTwoConts    = 1 << 7;  // 10______ 10______
+const uint8_t kCarry       = kTooShort | kTooLong | kTwoConts;
 
-uint16_t kMacRomanSupplement[0x80] = {
-        0x00C4,  // LATIN CAPITAL LETTER A WITH DIAERESIS
-        0x00C5,  // LATIN CAPITAL LETTER A WITH RING ABOVE
-        0x00C7,  // LATIN CAPITAL LETTER C WITH CEDILLA
-        0x00C9,  // LATIN CAPITAL LETTER E WITH ACUTE
-        0x00D1,  // LATIN CAPITAL LETTER N WITH TILDE
-        0x00D6,  // LATIN CAPITAL LETTER O WITH DIAERESIS
-        0x00DC,  // LATIN CAPITAL LETTER U WITH DIAERESIS
-        0x00E1,  // LATIN SMALL LETTER A WITH ACUTE
-        0x00E0,  // LATIN SMALL LETTER A WITH GRAVE
-        0x00E2,  // LATIN SMALL LETTER A WITH CIRCUMFLEX
-        0x00E4,  // LATIN SMALL LETTER A WITH DIAERESIS
-        0x00E3,  // LATIN SMALL LETTER A WITH TILDE
-        0x00E5,  // LATIN SMALL LETTER A WITH RING ABOVE
-        0x00E7,  // LATIN SMALL LETTER C WITH CEDILLA
-        0x00E9,  // LATIN SMALL LETTER E WITH ACUTE
-        0x00E8,  // LATIN SMALL LETTER E WITH GRAVE
-        0x00EA,  // LATIN SMALL LETTER E WITH CIRCUMFLEX
-        0x00EB,  // LATIN SMALL LETTER E WITH DIAERESIS
-        0x00ED,  // LATIN SMALL LETTER I WITH ACUTE
-        0x00EC,  // LATIN SMALL LETTER I WITH GRAVE
-        0x00EE,  // LATIN SMALL LETTER I WITH CIRCUMFLEX
-        0x00EF,  // LATIN SMALL LETTER I WITH DIAERESIS
-        0x00F1,  // LATIN SMALL LETTER N WITH TILDE
-        0x00F3,  // LATIN SMALL LETTER O WITH ACUTE
-        0x00F2,  // LATIN SMALL LETTER O WITH GRAVE
-        0x00F4,  // LATIN SMALL LETTER O WITH CIRCUMFLEX
-        0x00F6,  // LATIN SMALL LETTER O WITH DIAERESIS
-        0x00F5,  // LATIN SMALL LETTER O WITH TILDE
-        0x00FA,  // LATIN SMALL LETTER U WITH ACUTE
-        0x00F9,  // LATIN SMALL LETTER U WITH GRAVE
-        0x00FB,  // LATIN SMALL LETTER U WITH CIRCUMFLEX
-        0x00FC,  // LATIN SMALL LETTER U WITH DIAERESIS
-        0x2020,  // DAGGER
-        0x00B0,  // DEGREE SIGN
-        0x00A2,  // CENT SIGN
-        0x00A3,  // POUND SIGN
-        0x00A7,  // SECTION SIGN
-        0x2022,  // BULLET
-        0x00B6,  // PILCROW SIGN
-        0x00DF,  // LATIN SMALL LETTER SHARP S
-        0x00AE,  // REGISTERED SIGN
-        0x00A9,  // COPYRIGHT SIGN
-        0x2122,  // TRADE MARK SIGN
-        0x00B4,  // ACUTE ACCENT
-        0x00A8,  // DIAERESIS
-        0x2260,  // NOT EQUAL TO
-        0x00C6,  // LATIN CAPITAL LETTER AE
-        0x00D8,  // LATIN CAPITAL LETTER O WITH STROKE
-        0x221E,  // INFINITY
-        0x00B1,  // PLUS-MINUS SIGN
-        0x2264,  // LESS-THAN OR EQUAL TO
-        0x2265,  // GREATER-THAN OR EQUAL TO
-        0x00A5,  // YEN SIGN
-        0x00B5,  // MICRO SIGN
-        0x2202,  // PARTIAL DIFFERENTIAL
-        0x2211,  // N-ARY SUMMATION
-        0x220F,  // N-ARY PRODUCT
-        0x03C0,  // GREEK SMALL LETTER PI
-        0x222B,  // INTEGRAL
-        0x00AA,  // FEMININE ORDINAL INDICATOR
-        0x00BA,  // MASCULINE ORDINAL INDICATOR
-        0x03A9,  // GREEK CAPITAL LETTER OMEGA
-        0x00E6,  // LATIN SMALL LETTER AE
-        0x00F8,  // LATIN SMALL LETTER O WITH STROKE
-        0x00BF,  // INVERTED QUESTION MARK
-        0x00A1,  // INVERTED EXCLAMATION MARK
-        0x00AC,  // NOT SIGN
-        0x221A,  // SQUARE ROOT
-        0x0192,  // LATIN SMALL LETTER F WITH HOOK
-        0x2248,  // ALMOST EQUAL TO
-        0x2206,  // INCREMENT
-        0x00AB,  // LEFT-POINTING DOUBLE ANGLE QUOTATION MARK
-        0x00BB,  // RIGHT-POINTING DOUBLE ANGLE QUOTATION MARK
-        0x2026,  // HORIZONTAL ELLIPSIS
-        0x00A0,  // NO-BREAK SPACE
-        0x00C0,  // LATIN CAPITAL LETTER A WITH GRAVE
-        0x00C3,  // LATIN CAPITAL LETTER A WITH TILDE
-        0x00D5,  // LATIN CAPITAL LETTER O WITH TILDE
-        0x0152,  // LATIN CAPITAL LIGATURE OE
-        0x0153,  // LATIN SMALL LIGATURE OE
-        0x2013,  // EN DASH
-        0x2014,  // EM DASH
-        0x201C,  // LEFT DOUBLE QUOTATION MARK
-        0x201D,  // RIGHT DOUBLE QUOTATION MARK
-        0x2018,  // LEFT SINGLE QUOTATION MARK
-        0x2019,  // RIGHT SINGLE QUOTATION MARK
-        0x00F7,  // DIVISION SIGN
-        0x25CA,  // LOZENGE
-        0x00FF,  // LATIN SMALL LETTER Y WITH DIAERESIS
-        0x0178,  // LATIN CAPITAL LETTER Y WITH DIAERESIS
-        0x2044,  // FRACTION SLASH
-        0x20AC,  // EURO SIGN
-        0x2039,  // SINGLE LEFT-POINTING ANGLE QUOTATION MARK
-        0x203A,  // SINGLE RIGHT-POINTING ANGLE QUOTATION MARK
-        0xFB01,  // LATIN SMALL LIGATURE FI
-        0xFB02,  // LATIN SMALL LIGATURE FL
-        0x2021,  // DOUBLE DAGGER
-        0x00B7,  // MIDDLE DOT
-        0x201A,  // SINGLE LOW-9 QUOTATION MARK
-        0x201E,  // DOUBLE LOW-9 QUOTATION MARK
-        0x2030,  // PER MILLE SIGN
-        0x00C2,  // LATIN CAPITAL LETTER A WITH CIRCUMFLEX
-        0x00CA,  // LATIN CAPITAL LETTER E WITH CIRCUMFLEX
-        0x00C1,  // LATIN CAPITAL LETTER A WITH ACUTE
-        0x00CB,  // LATIN CAPITAL LETTER E WITH DIAERESIS
-        0x00C8,  // LATIN CAPITAL LETTER E WITH GRAVE
-        0x00CD,  // LATIN CAPITAL LETTER I WITH ACUTE
-        0x00CE,  // LATIN CAPITAL LETTER I WITH CIRCUMFLEX
-        0x00CF,  // LATIN CAPITAL LETTER I WITH DIAERESIS
-        0x00CC,  // LATIN CAPITAL LETTER I WITH GRAVE
-        0x00D3,  // LATIN CAPITAL LETTER O WITH ACUTE
-        0x00D4,  // LATIN CAPITAL LETTER O WITH CIRCUMFLEX
-        0xF8FF,  // Apple logo
-        0x00D2,  // LATIN CAPITAL LETTER O WITH GRAVE
-        0x00DA,  // LATIN CAPITAL LETTER U WITH ACUTE
-        0x00DB,  // LATIN CAPITAL LETTER U WITH CIRCUMFLEX
-        0x00D9,  // LATIN CAPITAL LETTER U WITH GRAVE
-        0x0131,  // LATIN SMALL LETTER DOTLESS I
-        0x02C6,  // MODIFIER LETTER CIRCUMFLEX ACCENT
-        0x02DC,  // SMALL TILDE
-        0x00AF,  // MACRON
-        0x02D8,  // BREVE
-        0x02D9,  // DOT ABOVE
-        0x02DA,  // RING ABOVE
-        0x00B8,  // CEDILLA
-        0x02DD,  // DOUBLE ACUTE ACCENT
-        0x02DB,  // OGONEK
-        0x02C7,  // CARON
+const uint8_t kFirstHigh[16] = {
+        kTooLong,  kTooLong,  kTooLong,  kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+        kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+        kTooShort | kOverlong2,                             // 1100____
+        kTooShort,                                          // 1101____
+        kTooShort | kOverlong3 | kSurrogate,                // 1110____
+        kTooShort | kTooLarge | kTooLarge100 | kOverlong4,  // 1111____
 };
 
-}  // namespace
+const uint8_t kFirstLow[16] = {
+        kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+        kCarry | kOverlong2,
+        kCarry,
+        kCarry,
+        kCarry | kTooLarge,
+        kCarry | kTooLarge | kTooLarge100,
+        kCarry | kTooLarge | kTooLarge100,
+        kCarry | kTooLarge | kTooLarge100,
+        kCarry | kTooLarge | kTooLarge100,
+        kCarry | kTooLarge | kTooLarge100,
+        kCarry | kTooLarge | kTooLarge100,
+        kCarry | kTooLarge | kTooLarge100,
+        kCarry | kTooLarge | kTooLarge100,
+        kCarry | kTooLarge | kTooLarge100 | kSurrogate,
+        kCarry | kTooLarge | kTooLarge100,
+        kCarry | kTooLarge | kTooLarge100,
+};
 
-pn::data encode(pn::string_view string) {
-    pn::data out;
-    for (pn::rune r : string) {
-        uint8_t byte = '?';
-        if (r.value() < 0x80) {
-            byte = r.value();
+const uint8_t kSecondHigh[16] = {
+        kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+        kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge100 | kOverlong4,
+        kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+        kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+        kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+        kTooShort, kTooShort, kTooShort, kTooShort,
+};
+
+// The greatest byte which may end a block which is followed by ASCII.  Leads of two-, three-, and
+// four-byte sequences which are cut off are greater.
+const uint8_t kIncomplete[32] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xdf, 0xbf,
+};
+
+// Returns a vector which is nonzero where `v`, preceded by `prev`, is invalid.
+SFZ_TARGET("ssse3")
+__m128i ssse3_utf8_errors(__m128i v, __m128i prev) {
+    const __m128i low    = _mm_set1_epi8(0x0f);
+    const __m128i prev1  = _mm_alignr_epi8(v, prev, 15);
+    const __m128i prev2  = _mm_alignr_epi8(v, prev, 14);
+    const __m128i prev3  = _mm_alignr_epi8(v, prev, 13);
+    const __m128i first  = _mm_and_si128(
+            _mm_shuffle_epi8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(kFirstHigh)),
+                    _mm_and_si128(_mm_srli_epi16(prev1, 4), low)),
+            _mm_shuffle_epi8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(kFirstLow)),
+                    _mm_and_si128(prev1, low)));
+    const __m128i second = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(kSecondHigh)),
+            _mm_and_si128(_mm_srli_epi16(v, 4), low));
+    const __m128i third  = _mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80));
+    const __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80));
+    const __m128i needed = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(0x80 - 256));
+    return _mm_xor_si128(_mm_and_si128(first, second), needed);
+}
+
+SFZ_TARGET("ssse3")
+size_t ssse3_find_invalid_utf8(const uint8_t* in, size_t n) {
+    const __m128i zero       = _mm_setzero_si128();
+    const __m128i incomplete = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kIncomplete + 16));
+    __m128i       prev       = zero;
+    size_t        i          = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v      = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const __m128i errors = _mm_movemask_epi8(v) ? ssse3_utf8_errors(v, prev)
+                                                    : _mm_subs_epu8(prev, incomplete);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(errors, zero)) != 0xffff) {
+            break;
+        }
+        prev = v;
+    }
+    return find_invalid_utf8_after(in, n, i);
+}
+
+// As ssse3_utf8_errors(), but shuffles only work within each 128-bit lane, so the bytes before
+// each lane are brought alongside it first.
+SFZ_TARGET("avx2")
+__m256i avx2_utf8_errors(__m256i v, __m256i prev) {
+    const __m256i low    = _mm256_set1_epi8(0x0f);
+    const __m256i before = _mm256_permute2x128_si256(prev, v, 0x21);
+    const __m256i prev1  = _mm256_alignr_epi8(v, before, 15);
+    const __m256i prev2  = _mm256_alignr_epi8(v, before, 14);
+    const __m256i prev3  = _mm256_alignr_epi8(v, before, 13);
+    const __m256i first  = _mm256_and_si256(
+            _mm256_shuffle_epi8(
+                    _mm256_broadcastsi128_si256(
+                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(kFirstHigh))),
+                    _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low)),
+            _mm256_shuffle_epi8(
+                    _mm256_broadcastsi128_si256(
+                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(kFirstLow))),
+                    _mm256_and_si256(prev1, low)));
+    const __m256i second = _mm256_shuffle_epi8(
+            _mm256_broadcastsi128_si256(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(kSecondHigh))),
+            _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+    const __m256i third  = _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80));
+    const __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80));
+    const __m256i needed =
+            _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(0x80 - 256));
+    return _mm256_xor_si256(_mm256_and_si256(first, second), needed);
+}
+
+SFZ_TARGET("avx2")
+size_t avx2_find_invalid_utf8(const uint8_t* in, size_t n) {
+    const __m256i zero       = _mm256_setzero_si256();
+    const __m256i incomplete = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kIncomplete));
+    __m256i       prev       = zero;
+    size_t        i          = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i v      = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        const __m256i errors = _mm256_movemask_epi8(v) ? avx2_utf8_errors(v, prev)
+                                                       : _mm256_subs_epu8(prev, incomplete);
+        if (~_mm256_movemask_epi8(_mm256_cmpeq_epi8(errors, zero))) {
+            break;
+        }
+        prev = v;
+    }
+    return find_invalid_utf8_after(in, n, i);
+}
+
+#endif  // SFZ_X86
+
+struct kernels {
+    copy_ascii_f        copy_ascii;
+    widen_latin1_f      widen_latin1;
+    narrow_latin1_f     narrow_latin1;
+    ascii_length_f      ascii_length;
+    count_range_f       count_range;
+    find_invalid_utf8_f find_invalid_utf8;
+};
+
+const kernels kPortable{portable_copy_ascii,   portable_widen_latin1, portable_narrow_latin1,
+                        portable_ascii_length, portable_count_range,  portable_find_invalid_utf8};
+
+kernels best_kernels() {
+    kernels k = kPortable;
+#ifdef SFZ_X86
+    if (cpu().avx2) {
+        k.copy_ascii   = avx2_copy_ascii;
+        k.ascii_length = avx2_ascii_length;
+        k.count_range  = avx2_count_range;
+    } else if (cpu().sse2) {
+        k.copy_ascii   = sse2_copy_ascii;
+        k.ascii_length = sse2_ascii_length;
+        k.count_range  = sse2_count_range;
+    }
+    if (cpu().avx2) {
+        k.find_invalid_utf8 = avx2_find_invalid_utf8;
+    } else if (cpu().ssse3) {
+        k.find_invalid_utf8 = ssse3_find_invalid_utf8;
+    }
+    if (cpu().ssse3) {
+        k.widen_latin1  = ssse3_widen_latin1;
+        k.narrow_latin1 = ssse3_narrow_latin1;
+    }
+#endif
+    return k;
+}
+
+const kernels& kernel() {
+    static const kernels k = best_kernels();
+    return k;
+}
+
+// A single-byte encoding, whose bytes [0x00, 0x7F] are ASCII, and whose bytes [0x80, 0xFF] are
+// given by a table of 128 code points, with U+FFFD for those which are unassigned.
+//
+// Neither direction searches the table.  Decoding copies the UTF-8 of each byte, which is built
+// when the codepage is.  Encoding splits a code point into its high byte, which selects one of a
+// few 256-byte pages, and its low byte, which indexes it.  Page 0 is all zeros, and is selected by
+// every high byte which has no code points in the encoding.  Zero can't be the encoding of a code
+// point outside ASCII, so it marks those which can't be encoded.
+class codepage {
+  public:
+    explicit codepage(const uint16_t* supplement) {
+        memset(_page, 0, sizeof _page);
+        _pages.push_back(page{});
+        for (int i : range(0x80)) {
+            const pn::rune r{supplement[i]};
+            memcpy(_utf8[i], r.data(), r.size());
+            _utf8_size[i] = r.size();
+
+            if ((supplement[i] < 0x80) || (supplement[i] == kUnknownCodePoint.value())) {
+                continue;
+            }
+            uint8_t& index = _page[supplement[i] >> 8];
+            if (!index) {
+                index = _pages.size();
+                _pages.push_back(page{});
+            }
+            uint8_t& byte = _pages[index][supplement[i] & 0xff];
+            if (!byte) {
+                byte = 0x80 + i;
+            }
+        }
+    }
+    codepage(const codepage&) = delete;
+    codepage& operator=(const codepage&) = delete;
+
+    // Returns the byte which encodes `rune`, which isn't ASCII, or 0 if there is none.
+    uint8_t find(uint32_t rune) const {
+        return (rune < 0x10000) ? _pages[_page[rune >> 8]][rune & 0xff] : 0;
+    }
+
+    // Returns the UTF-8 of `byte`, which isn't ASCII.  There are always 4 bytes to copy.
+    const uint8_t* utf8(uint8_t byte) const { return _utf8[byte - 0x80]; }
+    size_t         utf8_size(uint8_t byte) const { return _utf8_size[byte - 0x80]; }
+
+  private:
+    typedef std::array<uint8_t, 0x100> page;
+
+    uint8_t           _utf8[0x80][4];
+    uint8_t           _utf8_size[0x80];
+    uint8_t           _page[0x100];
+    std::vector<page> _pages;
+};
+
+// Returns the codepage for a table in <sfz/codepages.hpp>, building it on first use.
+template <const uint16_t* supplement>
+const codepage& codepage_of() {
+    static const codepage c(supplement);
+    return c;
+}
+
+// Returns the codepage for `e`, or nullptr for ASCII and Latin-1, which have none.
+const codepage* codepage_for(encoding e) {
+    switch (e) {
+        case encoding::ascii: return nullptr;
+        case encoding::latin1: return nullptr;
+        case encoding::macroman: return &codepage_of<kMacRomanSupplement>();
+        case encoding::cp1252: return &codepage_of<kCp1252Supplement>();
+        case encoding::cp437: return &codepage_of<kCp437Supplement>();
+        case encoding::iso8859_2: return &codepage_of<kIso8859_2Supplement>();
+        case encoding::iso8859_3: return &codepage_of<kIso8859_3Supplement>();
+        case encoding::iso8859_4: return &codepage_of<kIso8859_4Supplement>();
+        case encoding::iso8859_5: return &codepage_of<kIso8859_5Supplement>();
+        case encoding::iso8859_6: return &codepage_of<kIso8859_6Supplement>();
+        case encoding::iso8859_7: return &codepage_of<kIso8859_7Supplement>();
+        case encoding::iso8859_8: return &codepage_of<kIso8859_8Supplement>();
+        case encoding::iso8859_9: return &codepage_of<kIso8859_9Supplement>();
+        case encoding::iso8859_10: return &codepage_of<kIso8859_10Supplement>();
+        case encoding::iso8859_11: return &codepage_of<kIso8859_11Supplement>();
+        case encoding::iso8859_13: return &codepage_of<kIso8859_13Supplement>();
+        case encoding::iso8859_14: return &codepage_of<kIso8859_14Supplement>();
+        case encoding::iso8859_15: return &codepage_of<kIso8859_15Supplement>();
+        case encoding::iso8859_16: return &codepage_of<kIso8859_16Supplement>();
+    }
+    return nullptr;
+}
+
+// Returns the byte which encodes a sequence from read_sequence() in `e`, which has codepage `cp`.
+uint8_t encode_sequence(encoding e, const codepage* cp, sequence seq, uint32_t rune) {
+    uint8_t byte = 0;
+    if (!seq.valid) {
+        return kAsciiUnknownCodePoint.value();
+    } else if (e == encoding::latin1) {
+        byte = (rune < 0x100) ? rune : 0;
+    } else if (cp) {
+        byte = cp->find(rune);
+    }
+    return byte ? byte : kAsciiUnknownCodePoint.value();
+}
+
+// Encodes UTF-8 from `in` into `out`, until all of `in` is read, or `size` bytes are written, or
+// the next sequence is cut off at the end of `in`.  Invalid sequences, and code points which `e`
+// can't represent, are encoded as kAsciiUnknownCodePoint.
+//
+// Like the kernels `k`, this may store up to kSlack bytes past the end of what it writes.
+convert_result encode_with(
+        const kernels& k, encoding e, const uint8_t* in, size_t n, uint8_t* out, size_t size) {
+    const codepage* cp = codepage_for(e);
+    size_t          i = 0, o = 0;
+    while ((i < n) && (o < size)) {
+        // Every byte written reads at least one, so reading no more than there is room to write
+        // can't overflow `out`.
+        if (e == encoding::latin1) {
+            size_t written;
+            i += k.narrow_latin1(in + i, std::min(n - i, size - o), out + o, &written);
+            o += written;
         } else {
-            for (int i : range(0x80)) {
-                if (r.value() == kMacRomanSupplement[i]) {
-                    byte = 0x80 + i;
-                    break;
-                }
+            const size_t copied = k.copy_ascii(in + i, std::min(n - i, size - o), out + o);
+            i += copied;
+            o += copied;
+        }
+
+        while ((i < n) && (o < size) && (in[i] >= 0x80)) {
+            uint32_t       rune;
+            const sequence seq = read_sequence(in + i, n - i, &rune);
+            if (!seq.size) {
+                return {i, o};
+            }
+            out[o++] = encode_sequence(e, cp, seq, rune);
+            i += seq.size;
+        }
+    }
+    return {i, o};
+}
+
+// Decodes bytes from `in` into `out` as UTF-8, until all of `in` is read, or the next code point
+// doesn't fit in the `size` bytes of `out`.
+//
+// Like the kernels `k`, this may store up to kSlack bytes past the end of what it writes.
+convert_result decode_with(
+        const kernels& k, encoding e, const uint8_t* in, size_t n, uint8_t* out, size_t size) {
+    const codepage* cp = codepage_for(e);
+    size_t          i = 0, o = 0;
+    while ((i < n) && (o < size)) {
+        if (e == encoding::latin1) {
+            // Each byte is at most two of UTF-8.
+            const size_t m = std::min(n - i, (size - o) / 2);
+            if (m) {
+                o += k.widen_latin1(in + i, m, out + o);
+                i += m;
+            } else if (in[i] < 0x80) {
+                out[o++] = in[i++];
+            } else {
+                break;
+            }
+            continue;
+        }
+
+        const size_t copied = k.copy_ascii(in + i, std::min(n - i, size - o), out + o);
+        i += copied;
+        o += copied;
+        for (; (i < n) && (in[i] >= 0x80); ++i) {
+            const uint8_t* utf8 = cp ? cp->utf8(in[i]) : reinterpret_cast<const uint8_t*>(
+                                                                 kUnknownCodePoint.data());
+            const size_t utf8_size = cp ? cp->utf8_size(in[i]) : kUnknownCodePoint.size();
+            if (size - o < utf8_size) {
+                return {i, o};
             }
+            memcpy(out + o, utf8, utf8_size);
+            o += utf8_size;
+        }
+    }
+    return {i, o};
+}
+
+// Converts with `convert`, into a caller's buffer, which has no room to spare past `size`.  The
+// vector kernels write all but the last kSlack bytes, and the portable ones, which store only what
+// they write, finish.
+template <typename function>
+convert_result convert_exactly(
+        function convert, encoding e, const uint8_t* in, size_t n, uint8_t* out, size_t size) {
+    convert_result r{0, 0};
+    if (size > kSlack) {
+        r = convert(kernel(), e, in, n, out, size - kSlack);
+    }
+    const convert_result tail =
+            convert(kPortable, e, in + r.read, n - r.read, out + r.written, size - r.written);
+    return {r.read + tail.read, r.written + tail.written};
+}
+
+// Every code point is encoded as one byte, so the size is the number of code points: the number
+// of bytes which aren't continuation bytes.
+size_t encoded_size_of(pn::string_view string) {
+    const uint8_t* const in = reinterpret_cast<const uint8_t*>(string.data());
+    return string.size() - kernel().count_range(in, string.size(), 0x80, 0xbf);
+}
+
+size_t decoded_size_of(encoding e, pn::data_view data) {
+    const kernels&       k  = kernel();
+    const uint8_t* const in = data.data();
+    const size_t         n  = data.size();
+    if (e == encoding::ascii) {
+        return n + (2 * k.count_range(in, n, 0x80, 0xff));  // kUnknownCodePoint is 3 bytes.
+    } else if (e == encoding::latin1) {
+        return n + k.count_range(in, n, 0x80, 0xff);
+    }
+
+    const codepage* cp   = codepage_for(e);
+    size_t          size = 0;
+    for (size_t i = 0; i < n;) {
+        const size_t ascii = k.ascii_length(in + i, n - i);
+        size += ascii;
+        i += ascii;
+        for (; (i < n) && (in[i] >= 0x80); ++i) {
+            size += cp->utf8_size(in[i]);
+        }
+    }
+    return size;
+}
+
+size_t count_unencodable_of(encoding e, pn::string_view string) {
+    const kernels&       k  = kernel();
+    const uint8_t* const in = reinterpret_cast<const uint8_t*>(string.data());
+    const size_t         n  = string.size();
+    if (e == encoding::ascii) {
+        return k.count_range(in, n, 0xc0, 0xff);  // Lead bytes of code points outside ASCII.
+    } else if (e == encoding::latin1) {
+        return k.count_range(in, n, 0xc4, 0xff);  // Lead bytes of code points from U+0100.
+    }
+
+    const codepage* cp    = codepage_for(e);
+    size_t          count = 0;
+    for (size_t i = 0; i < n;) {
+        i += k.ascii_length(in + i, n - i);
+        while ((i < n) && (in[i] >= 0x80)) {
+            uint32_t       rune;
+            const sequence seq = read_sequence(in + i, n - i, &rune);
+            count += !cp->find(rune);
+            i += seq.size;
         }
-        out += pn::data_view{&byte, 1};
     }
+    return count;
+}
+
+// The whole-buffer conversions count the size of their output first, and convert into a scratch
+// buffer of that size.  pn::data and pn::string can't be sized up front or written in place, so
+// the buffer is then appended to an empty result.  That is two allocations and an extra copy, with
+// twice the output's size in memory at the peak, but neither allocation is ever regrown, as the
+// result would be if it were appended to chunk by chunk.
+pn::data encode_all(encoding e, pn::string_view string) {
+    const size_t               size = encoded_size_of(string);
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[size + kSlack]);
+    encode_with(
+            kernel(), e, reinterpret_cast<const uint8_t*>(string.data()), string.size(),
+            buffer.get(), size);
+    pn::data out;
+    out += pn::data_view{buffer.get(), static_cast<int>(size)};
     return out;
 }
 
-pn::string decode(pn::data_view data) {
+pn::string decode_all(encoding e, pn::data_view data) {
+    const size_t               size = decoded_size_of(e, data);
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[size + kSlack]);
+    decode_with(kernel(), e, data.data(), data.size(), buffer.get(), size);
     pn::string out;
-    for (uint8_t byte : data) {
-        if (byte < 0x80) {
-            out += pn::rune{byte};
-        } else {
-            out += pn::rune{kMacRomanSupplement[byte - 0x80]};
+    out += pn::string_view{reinterpret_cast<const char*>(buffer.get()), static_cast<int>(size)};
+    return out;
+}
+
+// Splits UTF-8 into runs of valid sequences and single invalid sequences, and passes each run to
+// `valid(in, n)`, and each invalid sequence to `invalid()`.  A valid prefix which is cut off at
+// the end is one invalid sequence.
+template <typename valid_function, typename invalid_function>
+void split_utf8(const uint8_t* in, size_t n, valid_function valid, invalid_function invalid) {
+    const kernels& k = kernel();
+    for (size_t i = 0; i < n;) {
+        const size_t run = k.find_invalid_utf8(in + i, n - i);
+        if (run) {
+            valid(in + i, run);
+            i += run;
+        }
+        if (i < n) {
+            uint32_t       rune;
+            const sequence seq = read_sequence(in + i, n - i, &rune);
+            invalid();
+            i += seq.size ? seq.size : (n - i);
         }
     }
+}
+
+}  // namespace
+
+const pn::rune kUnknownCodePoint{0x00fffd};       // REPLACEMENT CHARACTER.
+const pn::rune kAsciiUnknownCodePoint{0x00003f};  // QUESTION MARK.
+
+bool is_valid_code_point(uint32_t rune) { return (rune <= 0x10ffff) && (!is_surrogate(rune)); }
+
+namespace utf8 {
+
+size_t find_invalid(pn::data_view data) {
+    return kernel().find_invalid_utf8(data.data(), data.size());
+}
+
+bool is_valid(pn::data_view data) {
+    return find_invalid(data) == static_cast<size_t>(data.size());
+}
+
+// Valid input is appended as it is.  Otherwise, the size is counted first, as in decode_all().
+pn::string decode(pn::data_view data) {
+    size_t size = 0, replaced = 0;
+    split_utf8(
+            data.data(), data.size(), [&size](const uint8_t*, size_t n) { size += n; },
+            [&size, &replaced]() {
+                size += kUnknownCodePoint.size();
+                ++replaced;
+            });
+
+    pn::string out;
+    if (!replaced) {
+        out += pn::string_view{reinterpret_cast<const char*>(data.data()), data.size()};
+        return out;
+    }
+
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[size]);
+    uint8_t*                   p = buffer.get();
+    split_utf8(
+            data.data(), data.size(),
+            [&p](const uint8_t* in, size_t n) {
+                memcpy(p, in, n);
+                p += n;
+            },
+            [&p]() {
+                memcpy(p, kUnknownCodePoint.data(), kUnknownCodePoint.size());
+                p += kUnknownCodePoint.size();
+            });
+    out += pn::string_view{reinterpret_cast<const char*>(buffer.get()), static_cast<int>(size)};
     return out;
 }
 
+}  // namespace utf8
+
+namespace ascii {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::ascii, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::ascii, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::ascii, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::ascii, string);
+}
+
+}  // namespace ascii
+
+namespace latin1 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::latin1, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::latin1, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::latin1, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::latin1, string);
+}
+
+}  // namespace latin1
+
+namespace macroman {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::macroman, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::macroman, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::macroman, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::macroman, string);
+}
+
 }  // namespace macroman
 
+namespace cp1252 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::cp1252, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::cp1252, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::cp1252, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::cp1252, string);
+}
+
+}  // namespace cp1252
+
+namespace cp437 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::cp437, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::cp437, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::cp437, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::cp437, string);
+}
+
+}  // namespace cp437
+
+namespace iso8859_2 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_2, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_2, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_2, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_2, string);
+}
+
+}  // namespace iso8859_2
+
+namespace iso8859_3 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_3, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_3, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_3, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_3, string);
+}
+
+}  // namespace iso8859_3
+
+namespace iso8859_4 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_4, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_4, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_4, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_4, string);
+}
+
+}  // namespace iso8859_4
+
+namespace iso8859_5 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_5, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_5, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_5, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_5, string);
+}
+
+}  // namespace iso8859_5
+
+namespace iso8859_6 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_6, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_6, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_6, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_6, string);
+}
+
+}  // namespace iso8859_6
+
+namespace iso8859_7 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_7, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_7, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_7, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_7, string);
+}
+
+}  // namespace iso8859_7
+
+namespace iso8859_8 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_8, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_8, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_8, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_8, string);
+}
+
+}  // namespace iso8859_8
+
+namespace iso8859_9 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_9, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_9, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_9, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_9, string);
+}
+
+}  // namespace iso8859_9
+
+namespace iso8859_10 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_10, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_10, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_10, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_10, string);
+}
+
+}  // namespace iso8859_10
+
+namespace iso8859_11 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_11, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_11, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_11, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_11, string);
+}
+
+}  // namespace iso8859_11
+
+namespace iso8859_13 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_13, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_13, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_13, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_13, string);
+}
+
+}  // namespace iso8859_13
+
+namespace iso8859_14 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_14, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_14, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_14, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_14, string);
+}
+
+}  // namespace iso8859_14
+
+namespace iso8859_15 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_15, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_15, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_15, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_15, string);
+}
+
+}  // namespace iso8859_15
+
+namespace iso8859_16 {
+
+pn::data   encode(pn::string_view string) { return encode_all(encoding::iso8859_16, string); }
+pn::string decode(pn::data_view data) { return decode_all(encoding::iso8859_16, data); }
+size_t     encoded_size(pn::string_view string) { return encoded_size_of(string); }
+size_t     decoded_size(pn::data_view data) { return decoded_size_of(encoding::iso8859_16, data); }
+size_t     count_unencodable(pn::string_view string) {
+    return count_unencodable_of(encoding::iso8859_16, string);
+}
+
+}  // namespace iso8859_16
+
+encoder::encoder(encoding e) : _encoding(e), _partial_size(0) {}
+
+convert_result encoder::convert(pn::data_view in, uint8_t* out, size_t size) {
+    const uint8_t* const data = in.data();
+    const size_t         n    = in.size();
+    convert_result       r{0, 0};
+    if (_partial_size && size) {
+        // Finish the sequence which was cut off at the end of the last call.  It was a valid
+        // prefix, so whether or not the rest is valid, at least those bytes are replaced together.
+        uint8_t      seq[4];
+        const size_t more = std::min<size_t>(n, 4 - _partial_size);
+        memcpy(seq, _partial, _partial_size);
+        memcpy(seq + _partial_size, data, more);
+        uint32_t       rune;
+        const sequence s = read_sequence(seq, _partial_size + more, &rune);
+        if (!s.size) {
+            memcpy(_partial + _partial_size, data, more);
+            _partial_size += more;
+            return {more, 0};
+        }
+        *out          = encode_sequence(_encoding, codepage_for(_encoding), s, rune);
+        r             = {static_cast<size_t>(s.size - _partial_size), 1};
+        _partial_size = 0;
+    }
+
+    const convert_result rest =
+            convert_exactly(encode_with, _encoding, data + r.read, n - r.read, out + r.written,
+                            size - r.written);
+    r.read += rest.read;
+    r.written += rest.written;
+    if ((r.read < n) && (r.written < size)) {
+        // The rest of `in` is a sequence which was cut off.
+        _partial_size = n - r.read;
+        memcpy(_partial, data + r.read, _partial_size);
+        r.read = n;
+    }
+    return r;
+}
+
+size_t encoder::finish(uint8_t* out, size_t size) {
+    if (!_partial_size || !size) {
+        return 0;
+    }
+    _partial_size = 0;
+    *out          = kAsciiUnknownCodePoint.value();
+    return 1;
+}
+
+decoder::decoder(encoding e) : _encoding(e) {}
+
+convert_result decoder::convert(pn::data_view in, uint8_t* out, size_t size) {
+    return convert_exactly(decode_with, _encoding, in.data(), in.size(), out, size);
+}
+
 }  // namespace sfz
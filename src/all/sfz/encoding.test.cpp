@@ -5,11 +5,14 @@
 
 #include <sfz/encoding.hpp>
 
+#include <string.h>
+#include <algorithm>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <pn/data>
 #include <pn/string>
 #include <sfz/range.hpp>
+#include <vector>
 
 using testing::Eq;
 using testing::Test;
@@ -158,6 +161,67 @@ TEST_F(Latin1EncodingTest, EncodeInvalid) {
     }
 }
 
+// Text long enough to fill several output chunks, mostly ASCII, with runs of other runes of
+// varying length, so that runs start and end at every offset within a vector.
+pn::data long_data(int size = 100000) {
+    pn::data data;
+    uint32_t x = 1;
+    for (int i : range(size)) {
+        x               = (x * 1103515245) + 12345;
+        const uint8_t b = ((x >> 16) % 5) ? ((x >> 8) & 0x7f) : (0x80 | (x >> 24));
+        data += pn::data_view{&b, 1};
+        static_cast<void>(i);
+    }
+    return data;
+}
+
+pn::string long_string(int size = 100000) {
+    const uint32_t runes[] = {0x41, 0x7f, 0x80, 0xe9, 0xff, 0x100, 0x20ac, 0x1f600};
+    pn::string     string;
+    uint32_t       x = 1;
+    for (int i : range(size)) {
+        x = (x * 1103515245) + 12345;
+        string += pn::rune{((x >> 16) % 3) ? ((x >> 8) & 0x7f) : runes[(x >> 24) % 8]};
+        static_cast<void>(i);
+    }
+    return string;
+}
+
+TEST_F(AsciiEncodingTest, Long) {
+    const pn::data data = long_data();
+    pn::string     decoded;
+    for (uint8_t byte : data) {
+        decoded += (byte < 0x80) ? pn::rune{byte} : kUnknownCodePoint;
+    }
+    EXPECT_THAT(ascii::decode(data), Eq<pn::string_view>(decoded));
+
+    const pn::string string = long_string();
+    pn::data         encoded;
+    for (pn::rune r : string) {
+        const uint8_t byte = (r.value() < 0x80) ? r.value() : kAsciiUnknownCodePoint.value();
+        encoded += pn::data_view{&byte, 1};
+    }
+    EXPECT_THAT(ascii::encode(string), Eq<pn::data_view>(encoded));
+}
+
+TEST_F(Latin1EncodingTest, Long) {
+    const pn::data data = long_data();
+    pn::string     decoded;
+    for (uint8_t byte : data) {
+        decoded += pn::rune{byte};
+    }
+    EXPECT_THAT(latin1::decode(data), Eq<pn::string_view>(decoded));
+    EXPECT_THAT(latin1::encode(decoded), Eq<pn::data_view>(data));
+
+    const pn::string string = long_string();
+    pn::data         encoded;
+    for (pn::rune r : string) {
+        const uint8_t byte = (r.value() < 0x100) ? r.value() : kAsciiUnknownCodePoint.value();
+        encoded += pn::data_view{&byte, 1};
+    }
+    EXPECT_THAT(latin1::encode(string), Eq<pn::data_view>(encoded));
+}
+
 typedef Test MacRomanEncodingTest;
 
 const pn::string_view kMacRomanSupplement =
@@ -210,6 +274,233 @@ TEST_F(MacRomanEncodingTest, EncodeInvalid) {
     }
 }
 
+TEST_F(MacRomanEncodingTest, Long) {
+    std::vector<pn::rune> supplement;
+    for (pn::rune r : kMacRomanSupplement) {
+        supplement.push_back(r);
+    }
+
+    const pn::data data = long_data();
+    pn::string     decoded;
+    for (uint8_t byte : data) {
+        decoded += (byte < 0x80) ? pn::rune{byte} : supplement[byte - 0x80];
+    }
+    EXPECT_THAT(macroman::decode(data), Eq<pn::string_view>(decoded));
+    EXPECT_THAT(macroman::encode(decoded), Eq<pn::data_view>(data));
+}
+
+typedef Test CodepageEncodingTest;
+
+pn::data bytes(const char* s) {
+    return pn::data{reinterpret_cast<const uint8_t*>(s), static_cast<int>(strlen(s))};
+}
+
+TEST_F(CodepageEncodingTest, Decode) {
+    EXPECT_THAT(cp1252::decode(bytes("\200 \223x\224 \351")), Eq<pn::string_view>("€ “x” é"));
+    EXPECT_THAT(cp437::decode(bytes("\311\315\273 \202 \341")), Eq<pn::string_view>("╔═╗ é ß"));
+    EXPECT_THAT(iso8859_2::decode(bytes("\243\363d\274")), Eq<pn::string_view>("Łódź"));
+    EXPECT_THAT(iso8859_5::decode(bytes("\274\330\340")), Eq<pn::string_view>("Мир"));
+    EXPECT_THAT(iso8859_7::decode(bytes("\341\342\343")), Eq<pn::string_view>("αβγ"));
+    EXPECT_THAT(iso8859_15::decode(bytes("\244 \275")), Eq<pn::string_view>("€ œ"));
+}
+
+TEST_F(CodepageEncodingTest, Encode) {
+    EXPECT_THAT(cp1252::encode("€ “x” é"), Eq<pn::data_view>(bytes("\200 \223x\224 \351")));
+    EXPECT_THAT(cp437::encode("╔═╗ é ß"), Eq<pn::data_view>(bytes("\311\315\273 \202 \341")));
+    EXPECT_THAT(iso8859_2::encode("Łódź"), Eq<pn::data_view>(bytes("\243\363d\274")));
+    EXPECT_THAT(iso8859_5::encode("Мир"), Eq<pn::data_view>(bytes("\274\330\340")));
+    EXPECT_THAT(iso8859_7::encode("αβγ"), Eq<pn::data_view>(bytes("\341\342\343")));
+    EXPECT_THAT(iso8859_15::encode("€ œ"), Eq<pn::data_view>(bytes("\244 \275")));
+}
+
+TEST_F(CodepageEncodingTest, Unassigned) {
+    // Windows-1252 leaves 0x81, 0x8D, 0x8F, 0x90, and 0x9D unassigned; ISO-8859-3 leaves 0xA5.
+    EXPECT_THAT(cp1252::decode(bytes("a\201b\235")), Eq<pn::string_view>("a�b�"));
+    EXPECT_THAT(iso8859_3::decode(bytes("\245")), Eq<pn::string_view>("�"));
+    EXPECT_THAT(cp1252::encode("a�b"), Eq<pn::data_view>(bytes("a?b")));
+}
+
+TEST_F(CodepageEncodingTest, EncodeInvalid) {
+    // Code points outside each encoding, both in and out of the pages which it uses.
+    EXPECT_THAT(cp1252::encode("Ā€ゆ😀"), Eq<pn::data_view>(bytes("?\200??")));
+    EXPECT_THAT(iso8859_5::encode("Ѐ§ÿ"), Eq<pn::data_view>(bytes("?\375?")));
+    EXPECT_THAT(macroman::encode("ΩΨ"), Eq<pn::data_view>(bytes("\275?")));
+}
+
+typedef pn::data (*encode_f)(pn::string_view);
+typedef pn::string (*decode_f)(pn::data_view);
+typedef size_t (*encoded_size_f)(pn::string_view);
+typedef size_t (*decoded_size_f)(pn::data_view);
+
+const struct {
+    encoding       e;
+    encode_f       encode;
+    decode_f       decode;
+    encoded_size_f encoded_size;
+    decoded_size_f decoded_size;
+    encoded_size_f count_unencodable;
+} kCodecs[] = {
+        {encoding::ascii, ascii::encode, ascii::decode, ascii::encoded_size, ascii::decoded_size,
+         ascii::count_unencodable},
+        {encoding::latin1, latin1::encode, latin1::decode, latin1::encoded_size,
+         latin1::decoded_size, latin1::count_unencodable},
+        {encoding::macroman, macroman::encode, macroman::decode, macroman::encoded_size,
+         macroman::decoded_size, macroman::count_unencodable},
+        {encoding::cp1252, cp1252::encode, cp1252::decode, cp1252::encoded_size,
+         cp1252::decoded_size, cp1252::count_unencodable},
+        {encoding::cp437, cp437::encode, cp437::decode, cp437::encoded_size, cp437::decoded_size,
+         cp437::count_unencodable},
+        {encoding::iso8859_2, iso8859_2::encode, iso8859_2::decode, iso8859_2::encoded_size,
+         iso8859_2::decoded_size, iso8859_2::count_unencodable},
+        {encoding::iso8859_3, iso8859_3::encode, iso8859_3::decode, iso8859_3::encoded_size,
+         iso8859_3::decoded_size, iso8859_3::count_unencodable},
+        {encoding::iso8859_4, iso8859_4::encode, iso8859_4::decode, iso8859_4::encoded_size,
+         iso8859_4::decoded_size, iso8859_4::count_unencodable},
+        {encoding::iso8859_5, iso8859_5::encode, iso8859_5::decode, iso8859_5::encoded_size,
+         iso8859_5::decoded_size, iso8859_5::count_unencodable},
+        {encoding::iso8859_6, iso8859_6::encode, iso8859_6::decode, iso8859_6::encoded_size,
+         iso8859_6::decoded_size, iso8859_6::count_unencodable},
+        {encoding::iso8859_7, iso8859_7::encode, iso8859_7::decode, iso8859_7::encoded_size,
+         iso8859_7::decoded_size, iso8859_7::count_unencodable},
+        {encoding::iso8859_8, iso8859_8::encode, iso8859_8::decode, iso8859_8::encoded_size,
+         iso8859_8::decoded_size, iso8859_8::count_unencodable},
+        {encoding::iso8859_9, iso8859_9::encode, iso8859_9::decode, iso8859_9::encoded_size,
+         iso8859_9::decoded_size, iso8859_9::count_unencodable},
+        {encoding::iso8859_10, iso8859_10::encode, iso8859_10::decode, iso8859_10::encoded_size,
+         iso8859_10::decoded_size, iso8859_10::count_unencodable},
+        {encoding::iso8859_11, iso8859_11::encode, iso8859_11::decode, iso8859_11::encoded_size,
+         iso8859_11::decoded_size, iso8859_11::count_unencodable},
+        {encoding::iso8859_13, iso8859_13::encode, iso8859_13::decode, iso8859_13::encoded_size,
+         iso8859_13::decoded_size, iso8859_13::count_unencodable},
+        {encoding::iso8859_14, iso8859_14::encode, iso8859_14::decode, iso8859_14::encoded_size,
+         iso8859_14::decoded_size, iso8859_14::count_unencodable},
+        {encoding::iso8859_15, iso8859_15::encode, iso8859_15::decode, iso8859_15::encoded_size,
+         iso8859_15::decoded_size, iso8859_15::count_unencodable},
+        {encoding::iso8859_16, iso8859_16::encode, iso8859_16::decode, iso8859_16::encoded_size,
+         iso8859_16::decoded_size, iso8859_16::count_unencodable},
+};
+
+TEST_F(CodepageEncodingTest, RoundTrip) {
+    for (const auto& codec : kCodecs) {
+        for (int i : range(0x100)) {
+            const uint8_t    byte = i;
+            const pn::string s    = codec.decode(pn::data_view{&byte, 1});
+            if (*s.begin() != kUnknownCodePoint) {
+                EXPECT_THAT(codec.encode(s), Eq<pn::data_view>(pn::data_view{&byte, 1})) << i;
+            }
+        }
+    }
+}
+
+typedef Test EncodingSizeTest;
+
+TEST_F(EncodingSizeTest, Sizes) {
+    const pn::data   data   = long_data();
+    const pn::string string = long_string(20000);
+    for (const auto& codec : kCodecs) {
+        // Lengths around those of the vectors, and of the runs of them which are counted at once.
+        for (int size : {0, 1, 15, 16, 17, 31, 32, 33, 8159, 8160, 8161, 100000}) {
+            const pn::data_view part = pn::data_view{data}.slice(0, size);
+            EXPECT_THAT(codec.decoded_size(part), Eq<size_t>(codec.decode(part).size())) << size;
+        }
+        EXPECT_THAT(codec.encoded_size(string), Eq<size_t>(codec.encode(string).size()));
+
+        size_t unencodable = 0;
+        for (pn::rune r : string) {
+            const pn::data encoded = codec.encode(pn::string_view{r.data(), r.size()});
+            unencodable += (r != kAsciiUnknownCodePoint) && (encoded[0] == '?');
+        }
+        EXPECT_THAT(codec.count_unencodable(string), Eq(unencodable));
+    }
+}
+
+typedef Test StreamingEncodingTest;
+
+// Converts `in` with `c`, taking at most `in_size` bytes of input and `out_size` bytes of output
+// per call.
+template <typename converter>
+pn::data convert_in_parts(converter& c, pn::data_view in, size_t in_size, size_t out_size) {
+    pn::data             out;
+    std::vector<uint8_t> buffer(out_size);
+    for (int i = 0; i < in.size();) {
+        const pn::data_view  part{in.data() + i, std::min<int>(in_size, in.size() - i)};
+        const convert_result r = c.convert(part, buffer.data(), out_size);
+        out += pn::data_view{buffer.data(), static_cast<int>(r.written)};
+        i += r.read;
+    }
+    return out;
+}
+
+TEST_F(StreamingEncodingTest, Decode) {
+    const pn::data data = long_data(20000);
+    for (const auto& codec : kCodecs) {
+        const pn::string expected = codec.decode(data);
+        for (size_t in_size : {1, 7, 100, 100000}) {
+            for (size_t out_size : {4, 5, 33, 4096}) {
+                decoder        d(codec.e);
+                const pn::data decoded = convert_in_parts(d, data, in_size, out_size);
+                EXPECT_THAT(
+                        decoded, Eq<pn::data_view>(pn::data_view{
+                                         reinterpret_cast<const uint8_t*>(expected.data()),
+                                         expected.size()}))
+                        << in_size << " " << out_size;
+            }
+        }
+    }
+}
+
+TEST_F(StreamingEncodingTest, Encode) {
+    const pn::string    string = long_string(20000);
+    const pn::data_view utf8{reinterpret_cast<const uint8_t*>(string.data()), string.size()};
+    for (const auto& codec : kCodecs) {
+        const pn::data expected = codec.encode(string);
+        for (size_t in_size : {1, 2, 3, 5, 100, 1000000}) {
+            for (size_t out_size : {1, 3, 33, 4096}) {
+                encoder  e(codec.e);
+                pn::data encoded = convert_in_parts(e, utf8, in_size, out_size);
+                uint8_t  last;
+                EXPECT_THAT(e.finish(&last, 1), Eq<size_t>(0));
+                EXPECT_THAT(encoded, Eq<pn::data_view>(expected)) << in_size << " " << out_size;
+            }
+        }
+    }
+}
+
+TEST_F(StreamingEncodingTest, CarrySequence) {
+    // The euro sign, U+20AC, is E2 82 AC in UTF-8, and 80 in Windows-1252.
+    encoder        e(encoding::cp1252);
+    uint8_t        out[4];
+    convert_result r = e.convert(bytes("a\342"), out, 4);
+    EXPECT_THAT(r.read, Eq<size_t>(2));
+    EXPECT_THAT(r.written, Eq<size_t>(1));
+    r = e.convert(bytes("\202"), out, 4);
+    EXPECT_THAT(r.read, Eq<size_t>(1));
+    EXPECT_THAT(r.written, Eq<size_t>(0));
+    r = e.convert(bytes("\254b"), out, 4);
+    EXPECT_THAT(r.read, Eq<size_t>(2));
+    ASSERT_THAT(r.written, Eq<size_t>(2));
+    EXPECT_THAT(out[0], Eq(0x80));
+    EXPECT_THAT(out[1], Eq('b'));
+
+    // A sequence still cut off at the end is replaced.
+    r = e.convert(bytes("\342\202"), out, 4);
+    EXPECT_THAT(r.read, Eq<size_t>(2));
+    EXPECT_THAT(r.written, Eq<size_t>(0));
+    ASSERT_THAT(e.finish(out, 4), Eq<size_t>(1));
+    EXPECT_THAT(out[0], Eq('?'));
+}
+
+TEST_F(StreamingEncodingTest, EncodeInvalid) {
+    // Each invalid sequence is replaced once, up to the first byte which couldn't continue it:
+    // a cut-off sequence, a byte which can't start one, and a surrogate, whose second byte is out
+    // of range after ED, so that it and the third byte are each replaced separately.
+    const pn::data in = bytes("a\342\202b\377c\355\240\200d");
+    for (size_t in_size : {1, 2, 100}) {
+        encoder e(encoding::latin1);
+        EXPECT_THAT(convert_in_parts(e, in, in_size, 64), Eq<pn::data_view>(bytes("a?b?c???d")));
+    }
+}
+
 typedef Test Utf8EncodingTest;
 
 TEST_F(Utf8EncodingTest, EncodeAscii) {
@@ -244,5 +535,144 @@ TEST_F(Utf8EncodingTest, EncodeLatin1) {
             bytes, Eq(pn::data_view{reinterpret_cast<const uint8_t*>(kLatin1Supplement), 256}));
 }
 
+TEST_F(Utf8EncodingTest, Valid) {
+    const pn::string string = long_string();
+    const pn::data_view data{reinterpret_cast<const uint8_t*>(string.data()), string.size()};
+    EXPECT_THAT(utf8::find_invalid(data), Eq<size_t>(data.size()));
+    EXPECT_THAT(utf8::is_valid(data), Eq(true));
+    EXPECT_THAT(utf8::decode(data), Eq<pn::string_view>(string));
+    EXPECT_THAT(utf8::is_valid(pn::data_view{}), Eq(true));
+}
+
+// Each invalid sequence is found, and replaced, wherever it falls within a vector, and wherever
+// the vector is within a sequence which continues into it.
+TEST_F(Utf8EncodingTest, Invalid) {
+    const struct {
+        const char* bytes;
+        int         valid;  // The size of the valid prefix of `bytes`.
+        const char* decoded;
+    } kInvalid[] = {
+            {"\200", 0, "�"},                  // Stray continuation.
+            {"\302\200\277", 2, "\302\200�"},  // Too many continuations.
+            {"\300\257", 0, "��"},             // Overlong, 2 bytes.
+            {"\340\237\277", 0, "���"},        // Overlong, 3 bytes.
+            {"\360\217\277\277", 0, "����"},   // Overlong, 4 bytes.
+            {"\355\240\200", 0, "���"},        // Surrogate.
+            {"\364\220\200\200", 0, "����"},   // Above U+10FFFF.
+            {"\370\210\200\200\200", 0, "�����"},
+            {"\377", 0, "�"},
+            {"\342\202x", 0, "�x"},  // Cut off.
+            {"\360\237\230x", 0, "�x"},
+            {"\342\360\237\230\200", 0, "�😀"},
+    };
+    const char kRest[] = "and the rest of the vector, which is long enough to fill it";
+    for (const auto& invalid : kInvalid) {
+        for (int offset : range(70)) {
+            for (const char* prefix : {"a", "é", "€", "😀"}) {
+                pn::string text;
+                while (text.size() < offset) {
+                    text += prefix;
+                }
+                pn::data data;
+                data += pn::data_view{reinterpret_cast<const uint8_t*>(text.data()), text.size()};
+                data += bytes(invalid.bytes);
+                data += bytes(kRest);
+
+                pn::string expected;
+                expected += text;
+                expected += invalid.decoded;
+                expected += kRest;
+                EXPECT_THAT(utf8::find_invalid(data), Eq<size_t>(text.size() + invalid.valid))
+                        << invalid.bytes << " after " << offset;
+                EXPECT_THAT(utf8::decode(data), Eq<pn::string_view>(expected))
+                        << invalid.bytes << " after " << offset;
+            }
+        }
+    }
+}
+
+TEST_F(Utf8EncodingTest, CutOffAtEnd) {
+    for (const char* cut_off : {"\303", "\342\202", "\360\237\230"}) {
+        for (int offset : range(70)) {
+            pn::data data;
+            for (int i : range(offset)) {
+                data += bytes("a");
+            }
+            data += bytes(cut_off);
+            EXPECT_THAT(utf8::find_invalid(data), Eq<size_t>(offset)) << offset;
+            EXPECT_THAT(utf8::decode(data).size(), Eq(offset + 3)) << offset;
+        }
+    }
+}
+
+// Finds invalid UTF-8 a byte at a time, by the table of well-formed byte sequences in the Unicode
+// standard.
+size_t reference_find_invalid(pn::data_view data) {
+    for (int i = 0; i < data.size();) {
+        const uint8_t lead = data[i];
+        int           size = 1;
+        uint8_t       lo = 0x80, hi = 0xbf;
+        if (lead < 0x80) {
+            size = 1;
+        } else if ((0xc2 <= lead) && (lead <= 0xdf)) {
+            size = 2;
+        } else if ((0xe0 <= lead) && (lead <= 0xef)) {
+            size = 3;
+            lo   = (lead == 0xe0) ? 0xa0 : 0x80;
+            hi   = (lead == 0xed) ? 0x9f : 0xbf;
+        } else if ((0xf0 <= lead) && (lead <= 0xf4)) {
+            size = 4;
+            lo   = (lead == 0xf0) ? 0x90 : 0x80;
+            hi   = (lead == 0xf4) ? 0x8f : 0xbf;
+        } else {
+            return i;
+        }
+        for (int j : range(1, size)) {
+            if ((i + j == data.size()) || (data[i + j] < lo) || (data[i + j] > hi)) {
+                return i;
+            }
+            lo = 0x80;
+            hi = 0xbf;
+        }
+        i += size;
+    }
+    return data.size();
+}
+
+// Mostly-valid text, with a few random bytes among it, agrees with the reference.
+TEST_F(Utf8EncodingTest, Random) {
+    uint32_t seed = 1;
+    auto     next = [&seed](uint32_t n) {
+        seed = (seed * 1103515245) + 12345;
+        return (seed >> 8) % n;
+    };
+    const uint32_t kRunes[] = {0x41, 0x41, 0x41, 0xe9, 0x20ac, 0xfffd, 0x1f600, 0x10ffff};
+    for (int trial : range(500)) {
+        pn::data data;
+        for (int i : range(next(300))) {
+            if (next(100)) {
+                const pn::rune r{kRunes[next(8)]};
+                data += pn::data_view{reinterpret_cast<const uint8_t*>(r.data()), r.size()};
+            } else {
+                const uint8_t byte = 0x80 + next(0x80);
+                data += pn::data_view{&byte, 1};
+            }
+        }
+
+        for (int start : range(std::min(4, data.size()))) {
+            const pn::data_view slice = data.slice(start);
+            const size_t        first = reference_find_invalid(slice);
+            EXPECT_THAT(utf8::find_invalid(slice), Eq(first)) << trial;
+
+            const pn::string decoded = utf8::decode(slice);
+            const pn::data_view bytes{reinterpret_cast<const uint8_t*>(decoded.data()),
+                                      decoded.size()};
+            EXPECT_THAT(utf8::is_valid(bytes), Eq(true)) << trial;
+            EXPECT_THAT(bytes.slice(0, first), Eq(slice.slice(0, first))) << trial;
+            EXPECT_THAT(decoded.size() >= slice.size(), Eq(true)) << trial;
+        }
+    }
+}
+
 }  // namespace
 }  // namespace sfz
@@ -0,0 +1,487 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <sfz/hash.hpp>
+
+#include <string.h>
+#include <sfz/cpu.hpp>
+
+#ifdef SFZ_X86
+#include <immintrin.h>
+#endif
+
+namespace sfz {
+
+namespace {
+
+const uint32_t kPrime32_1 = 0x9e3779b1;
+const uint32_t kPrime32_2 = 0x85ebca77;
+const uint32_t kPrime32_3 = 0xc2b2ae3d;
+const uint64_t kPrime64_1 = 0x9e3779b185ebca87ULL;
+const uint64_t kPrime64_2 = 0xc2b2ae3d27d4eb4fULL;
+const uint64_t kPrime64_3 = 0x165667b19e3779f9ULL;
+const uint64_t kPrime64_4 = 0x85ebca77c2b2ae63ULL;
+const uint64_t kPrime64_5 = 0x27d4eb2f165667c5ULL;
+const uint64_t kPrimeMx1  = 0x165667919e3779f9ULL;
+const uint64_t kPrimeMx2  = 0x9fb21c651e98df25ULL;
+
+// XXH3's default secret: pseudo-random bytes which every step mixes into the input.  With a
+// seed, inputs over 240 bytes are hashed with a secret derived from it.
+const size_t  kSecretSize          = 192;
+const uint8_t kSecret[kSecretSize] = {
+        0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad,
+        0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3,
+        0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc,
+        0xff, 0x72, 0x21, 0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+        0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65,
+        0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19,
+        0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8, 0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9,
+        0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+        0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb,
+        0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb, 0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0,
+        0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d,
+        0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+        0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+// Offsets into the secret used by particular steps.
+const size_t kMidSizeStart  = 3;    // For the 17th and later 16-byte rounds, of 129-240 bytes.
+const size_t kMidSizeLast   = 119;  // For the last 16 bytes of 129-240 bytes.
+const size_t kLastStripe    = 7;    // Back from the scramble key, for the last stripe.
+const size_t kMergeAccStart = 11;   // For merging the accumulators into the result.
+
+// Long inputs are hashed in stripes of 64 bytes, in blocks of 16 stripes.  Each stripe of a block
+// uses the secret from 8 bytes further on, and then the block's accumulators are scrambled.
+const size_t kStripeSize      = 64;
+const size_t kStripesPerBlock = (kSecretSize - kStripeSize) / 8;
+const size_t kBlockSize       = kStripeSize * kStripesPerBlock;
+
+inline uint32_t read32(const uint8_t* p) {
+    return uint32_t{p[0]} | (uint32_t{p[1]} << 8) | (uint32_t{p[2]} << 16) |
+           (uint32_t{p[3]} << 24);
+}
+
+inline uint64_t read64(const uint8_t* p) {
+    return uint64_t{read32(p)} | (uint64_t{read32(p + 4)} << 32);
+}
+
+inline void write64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        p[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+}
+
+inline uint32_t swap32(uint32_t x) {
+    return (x << 24) | ((x << 8) & 0x00ff0000) | ((x >> 8) & 0x0000ff00) | (x >> 24);
+}
+
+inline uint64_t swap64(uint64_t x) {
+    return (uint64_t{swap32(static_cast<uint32_t>(x))} << 32) |
+           swap32(static_cast<uint32_t>(x >> 32));
+}
+
+inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// Returns the full 128-bit product of `a` and `b`.
+inline hash128 multiply(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    const unsigned __int128 p = static_cast<unsigned __int128>(a) * b;
+    return hash128{static_cast<uint64_t>(p), static_cast<uint64_t>(p >> 64)};
+#else
+    const uint64_t lo_lo = (a & 0xffffffff) * (b & 0xffffffff);
+    const uint64_t hi_lo = (a >> 32) * (b & 0xffffffff);
+    const uint64_t lo_hi = (a & 0xffffffff) * (b >> 32);
+    const uint64_t hi_hi = (a >> 32) * (b >> 32);
+    const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+    return hash128{(cross << 32) | (lo_lo & 0xffffffff), hi_hi + (hi_lo >> 32) + (cross >> 32)};
+#endif
+}
+
+inline uint64_t multiply_fold(uint64_t a, uint64_t b) {
+    const hash128 p = multiply(a, b);
+    return p.low ^ p.high;
+}
+
+inline uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= kPrime64_2;
+    h ^= h >> 29;
+    h *= kPrime64_3;
+    return h ^ (h >> 32);
+}
+
+inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= kPrimeMx1;
+    return h ^ (h >> 32);
+}
+
+inline uint64_t rrmxmx(uint64_t h, uint64_t size) {
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= kPrimeMx2;
+    h ^= (h >> 35) + size;
+    h *= kPrimeMx2;
+    return h ^ (h >> 28);
+}
+
+inline uint64_t mix16(const uint8_t* in, const uint8_t* secret, uint64_t seed) {
+    return multiply_fold(
+            read64(in) ^ (read64(secret) + seed), read64(in + 8) ^ (read64(secret + 8) - seed));
+}
+
+// Mixes 32 bytes, from `a` and `b`, into a 128-bit accumulator.
+inline void mix32(
+        hash128& acc, const uint8_t* a, const uint8_t* b, const uint8_t* secret, uint64_t seed) {
+    acc.low += mix16(a, secret, seed);
+    acc.low ^= read64(b) + read64(b + 8);
+    acc.high += mix16(b, secret + 16, seed);
+    acc.high ^= read64(a) + read64(a + 8);
+}
+
+// Hashes of 0 to 240 bytes.  Each size range reads the input once, mostly with overlapping reads
+// from both ends, so there are no loops over single bytes.
+
+uint64_t hash64_0to16(const uint8_t* in, size_t size, uint64_t seed) {
+    const uint8_t* s = kSecret;
+    if (size > 8) {
+        const uint64_t lo = read64(in) ^ ((read64(s + 24) ^ read64(s + 32)) + seed);
+        const uint64_t hi = read64(in + size - 8) ^ ((read64(s + 40) ^ read64(s + 48)) - seed);
+        return avalanche(size + swap64(lo) + hi + multiply_fold(lo, hi));
+    } else if (size >= 4) {
+        seed ^= uint64_t{swap32(static_cast<uint32_t>(seed))} << 32;
+        const uint64_t input = read32(in + size - 4) + (uint64_t{read32(in)} << 32);
+        return rrmxmx(input ^ ((read64(s + 8) ^ read64(s + 16)) - seed), size);
+    } else if (size > 0) {
+        const uint32_t combined = (uint32_t{in[0]} << 16) | (uint32_t{in[size >> 1]} << 24) |
+                                  uint32_t{in[size - 1]} | (static_cast<uint32_t>(size) << 8);
+        return xxh64_avalanche(combined ^ ((read32(s) ^ read32(s + 4)) + seed));
+    }
+    return xxh64_avalanche(seed ^ read64(s + 56) ^ read64(s + 64));
+}
+
+uint64_t hash64_17to128(const uint8_t* in, size_t size, uint64_t seed) {
+    const uint8_t* s   = kSecret;
+    uint64_t       acc = size * kPrime64_1;
+    if (size > 32) {
+        if (size > 64) {
+            if (size > 96) {
+                acc += mix16(in + 48, s + 96, seed);
+                acc += mix16(in + size - 64, s + 112, seed);
+            }
+            acc += mix16(in + 32, s + 64, seed);
+            acc += mix16(in + size - 48, s + 80, seed);
+        }
+        acc += mix16(in + 16, s + 32, seed);
+        acc += mix16(in + size - 32, s + 48, seed);
+    }
+    acc += mix16(in, s, seed);
+    acc += mix16(in + size - 16, s + 16, seed);
+    return avalanche(acc);
+}
+
+uint64_t hash64_129to240(const uint8_t* in, size_t size, uint64_t seed) {
+    const uint8_t* s   = kSecret;
+    uint64_t       acc = size * kPrime64_1;
+    for (size_t i = 0; i < 8; ++i) {
+        acc += mix16(in + (16 * i), s + (16 * i), seed);
+    }
+    acc = avalanche(acc);
+    for (size_t i = 8; i < size / 16; ++i) {
+        acc += mix16(in + (16 * i), s + (16 * (i - 8)) + kMidSizeStart, seed);
+    }
+    acc += mix16(in + size - 16, s + kMidSizeLast, seed);
+    return avalanche(acc);
+}
+
+hash128 hash128_0to16(const uint8_t* in, size_t size, uint64_t seed) {
+    const uint8_t* s = kSecret;
+    if (size > 8) {
+        const uint64_t flip_lo = (read64(s + 32) ^ read64(s + 40)) - seed;
+        const uint64_t flip_hi = (read64(s + 48) ^ read64(s + 56)) + seed;
+        const uint64_t in_lo   = read64(in);
+        uint64_t       in_hi   = read64(in + size - 8);
+        hash128        m       = multiply(in_lo ^ in_hi ^ flip_lo, kPrime64_1);
+        m.low += uint64_t{size - 1} << 54;
+        in_hi ^= flip_hi;
+        m.high += in_hi + (uint64_t{static_cast<uint32_t>(in_hi)} * (kPrime32_2 - 1));
+        m.low ^= swap64(m.high);
+        hash128 h = multiply(m.low, kPrime64_2);
+        h.high += m.high * kPrime64_2;
+        return hash128{avalanche(h.low), avalanche(h.high)};
+    } else if (size >= 4) {
+        seed ^= uint64_t{swap32(static_cast<uint32_t>(seed))} << 32;
+        const uint64_t input = read32(in) + (uint64_t{read32(in + size - 4)} << 32);
+        const uint64_t keyed = input ^ ((read64(s + 16) ^ read64(s + 24)) + seed);
+        hash128        m     = multiply(keyed, kPrime64_1 + (size << 2));
+        m.high += m.low << 1;
+        m.low ^= m.high >> 3;
+        m.low ^= m.low >> 35;
+        m.low *= kPrimeMx2;
+        m.low ^= m.low >> 28;
+        return hash128{m.low, avalanche(m.high)};
+    } else if (size > 0) {
+        const uint32_t lo = (uint32_t{in[0]} << 16) | (uint32_t{in[size >> 1]} << 24) |
+                            uint32_t{in[size - 1]} | (static_cast<uint32_t>(size) << 8);
+        const uint32_t hi = (swap32(lo) << 13) | (swap32(lo) >> 19);
+        return hash128{xxh64_avalanche(lo ^ ((read32(s) ^ read32(s + 4)) + seed)),
+                       xxh64_avalanche(hi ^ ((read32(s + 8) ^ read32(s + 12)) - seed))};
+    }
+    return hash128{xxh64_avalanche(seed ^ read64(s + 64) ^ read64(s + 72)),
+                   xxh64_avalanche(seed ^ read64(s + 80) ^ read64(s + 88))};
+}
+
+hash128 finish128(const hash128& acc, size_t size, uint64_t seed) {
+    return hash128{avalanche(acc.low + acc.high),
+                   0 - avalanche((acc.low * kPrime64_1) + (acc.high * kPrime64_4) +
+                                 ((size - seed) * kPrime64_2))};
+}
+
+hash128 hash128_17to128(const uint8_t* in, size_t size, uint64_t seed) {
+    const uint8_t* s = kSecret;
+    hash128        acc{size * kPrime64_1, 0};
+    if (size > 32) {
+        if (size > 64) {
+            if (size > 96) {
+                mix32(acc, in + 48, in + size - 64, s + 96, seed);
+            }
+            mix32(acc, in + 32, in + size - 48, s + 64, seed);
+        }
+        mix32(acc, in + 16, in + size - 32, s + 32, seed);
+    }
+    mix32(acc, in, in + size - 16, s, seed);
+    return finish128(acc, size, seed);
+}
+
+hash128 hash128_129to240(const uint8_t* in, size_t size, uint64_t seed) {
+    const uint8_t* s = kSecret;
+    hash128        acc{size * kPrime64_1, 0};
+    for (size_t i = 0; i < 4; ++i) {
+        mix32(acc, in + (32 * i), in + (32 * i) + 16, s + (32 * i), seed);
+    }
+    acc = hash128{avalanche(acc.low), avalanche(acc.high)};
+    for (size_t i = 4; i < size / 32; ++i) {
+        mix32(acc, in + (32 * i), in + (32 * i) + 16, s + (32 * (i - 4)) + kMidSizeStart, seed);
+    }
+    mix32(acc, in + size - 16, in + size - 32, s + kMidSizeLast - 16, 0 - seed);
+    return finish128(acc, size, seed);
+}
+
+// Hashing of long inputs.  Eight 64-bit accumulators each take one word of every stripe, which is
+// where the SIMD kernels come in: they update several accumulators per instruction.
+
+typedef void (*accumulate_f)(uint64_t* acc, const uint8_t* in, const uint8_t* secret, size_t n);
+typedef void (*scramble_f)(uint64_t* acc, const uint8_t* secret);
+
+// Accumulates `n` stripes of `in`, the i-th with the secret from 8 * i bytes.
+void portable_accumulate(uint64_t* acc, const uint8_t* in, const uint8_t* secret, size_t n) {
+    for (size_t stripe = 0; stripe < n; ++stripe, in += kStripeSize, secret += 8) {
+        for (int i = 0; i < 8; ++i) {
+            const uint64_t value = read64(in + (8 * i));
+            const uint64_t key   = value ^ read64(secret + (8 * i));
+            acc[i ^ 1] += value;
+            acc[i] += (key & 0xffffffff) * (key >> 32);
+        }
+    }
+}
+
+void portable_scramble(uint64_t* acc, const uint8_t* secret) {
+    for (int i = 0; i < 8; ++i) {
+        acc[i] = (acc[i] ^ (acc[i] >> 47) ^ read64(secret + (8 * i))) * kPrime32_1;
+    }
+}
+
+#ifdef SFZ_X86
+
+SFZ_TARGET("sse2")
+void sse2_accumulate(uint64_t* acc, const uint8_t* in, const uint8_t* secret, size_t n) {
+    __m128i* a = reinterpret_cast<__m128i*>(acc);
+    __m128i  v[4];
+    for (int i = 0; i < 4; ++i) {
+        v[i] = _mm_loadu_si128(a + i);
+    }
+    for (size_t stripe = 0; stripe < n; ++stripe, in += kStripeSize, secret += 8) {
+        for (int i = 0; i < 4; ++i) {
+            const __m128i value =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + (16 * i)));
+            const __m128i key = _mm_xor_si128(
+                    value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret + (16 * i))));
+            const __m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, 0x31));
+            v[i] = _mm_add_epi64(v[i], _mm_add_epi64(_mm_shuffle_epi32(value, 0x4e), product));
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        _mm_storeu_si128(a + i, v[i]);
+    }
+}
+
+SFZ_TARGET("sse2")
+void sse2_scramble(uint64_t* acc, const uint8_t* secret) {
+    __m128i*      a     = reinterpret_cast<__m128i*>(acc);
+    const __m128i prime = _mm_set1_epi32(kPrime32_1);
+    for (int i = 0; i < 4; ++i) {
+        __m128i x = _mm_loadu_si128(a + i);
+        x         = _mm_xor_si128(
+                _mm_xor_si128(x, _mm_srli_epi64(x, 47)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret + (16 * i))));
+        const __m128i lo = _mm_mul_epu32(x, prime);
+        const __m128i hi = _mm_mul_epu32(_mm_shuffle_epi32(x, 0x31), prime);
+        _mm_storeu_si128(a + i, _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+    }
+}
+
+SFZ_TARGET("avx2")
+void avx2_accumulate(uint64_t* acc, const uint8_t* in, const uint8_t* secret, size_t n) {
+    __m256i* a  = reinterpret_cast<__m256i*>(acc);
+    __m256i  v0 = _mm256_loadu_si256(a);
+    __m256i  v1 = _mm256_loadu_si256(a + 1);
+    for (size_t stripe = 0; stripe < n; ++stripe, in += kStripeSize, secret += 8) {
+        const __m256i value0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        const __m256i value1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 32));
+        const __m256i key0   = _mm256_xor_si256(
+                value0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret)));
+        const __m256i key1 = _mm256_xor_si256(
+                value1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret + 32)));
+        v0 = _mm256_add_epi64(
+                v0, _mm256_add_epi64(
+                            _mm256_shuffle_epi32(value0, 0x4e),
+                            _mm256_mul_epu32(key0, _mm256_shuffle_epi32(key0, 0x31))));
+        v1 = _mm256_add_epi64(
+                v1, _mm256_add_epi64(
+                            _mm256_shuffle_epi32(value1, 0x4e),
+                            _mm256_mul_epu32(key1, _mm256_shuffle_epi32(key1, 0x31))));
+    }
+    _mm256_storeu_si256(a, v0);
+    _mm256_storeu_si256(a + 1, v1);
+}
+
+SFZ_TARGET("avx2")
+void avx2_scramble(uint64_t* acc, const uint8_t* secret) {
+    __m256i*      a     = reinterpret_cast<__m256i*>(acc);
+    const __m256i prime = _mm256_set1_epi32(kPrime32_1);
+    for (int i = 0; i < 2; ++i) {
+        __m256i x = _mm256_loadu_si256(a + i);
+        x         = _mm256_xor_si256(
+                _mm256_xor_si256(x, _mm256_srli_epi64(x, 47)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret + (32 * i))));
+        const __m256i lo = _mm256_mul_epu32(x, prime);
+        const __m256i hi = _mm256_mul_epu32(_mm256_shuffle_epi32(x, 0x31), prime);
+        _mm256_storeu_si256(a + i, _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+    }
+}
+
+#endif  // SFZ_X86
+
+struct long_kernel {
+    accumulate_f accumulate;
+    scramble_f   scramble;
+};
+
+long_kernel best_kernel() {
+#ifdef SFZ_X86
+    if (cpu().avx2) {
+        return long_kernel{avx2_accumulate, avx2_scramble};
+    } else if (cpu().sse2) {
+        return long_kernel{sse2_accumulate, sse2_scramble};
+    }
+#endif
+    return long_kernel{portable_accumulate, portable_scramble};
+}
+
+// Accumulates all of `in`, which is more than 240 bytes, into `acc`.
+void hash_long(uint64_t* acc, const uint8_t* in, size_t size, const uint8_t* secret) {
+    static const long_kernel k = best_kernel();
+
+    const uint64_t init[8] = {kPrime32_3, kPrime64_1, kPrime64_2, kPrime64_3,
+                              kPrime64_4, kPrime32_2, kPrime64_5, kPrime32_1};
+    memcpy(acc, init, sizeof(init));
+
+    const size_t blocks = (size - 1) / kBlockSize;
+    for (size_t b = 0; b < blocks; ++b) {
+        k.accumulate(acc, in + (b * kBlockSize), secret, kStripesPerBlock);
+        k.scramble(acc, secret + kSecretSize - kStripeSize);
+    }
+
+    // The last block is partial; it has at least one byte.  Its whole stripes are accumulated,
+    // and then the last 64 bytes of input, which may overlap them.
+    const size_t stripes = ((size - 1) - (blocks * kBlockSize)) / kStripeSize;
+    k.accumulate(acc, in + (blocks * kBlockSize), secret, stripes);
+    k.accumulate(
+            acc, in + size - kStripeSize, secret + kSecretSize - kStripeSize - kLastStripe, 1);
+}
+
+uint64_t merge(const uint64_t* acc, const uint8_t* secret, uint64_t start) {
+    uint64_t result = start;
+    for (int i = 0; i < 4; ++i) {
+        const uint8_t* key = secret + (16 * i);
+        result += multiply_fold(acc[2 * i] ^ read64(key), acc[(2 * i) + 1] ^ read64(key + 8));
+    }
+    return avalanche(result);
+}
+
+// Returns the secret for hashing long inputs with `seed`.  Seed 0 uses the default secret.
+const uint8_t* seeded_secret(uint64_t seed, uint8_t* buffer) {
+    if (seed == 0) {
+        return kSecret;
+    }
+    for (size_t i = 0; i < kSecretSize; i += 16) {
+        write64(buffer + i, read64(kSecret + i) + seed);
+        write64(buffer + i + 8, read64(kSecret + i + 8) - seed);
+    }
+    return buffer;
+}
+
+uint64_t hash64_long(const uint8_t* in, size_t size, uint64_t seed) {
+    uint8_t        buffer[kSecretSize];
+    const uint8_t* secret = seeded_secret(seed, buffer);
+    uint64_t       acc[8];
+    hash_long(acc, in, size, secret);
+    return merge(acc, secret + kMergeAccStart, size * kPrime64_1);
+}
+
+hash128 hash128_long(const uint8_t* in, size_t size, uint64_t seed) {
+    uint8_t        buffer[kSecretSize];
+    const uint8_t* secret = seeded_secret(seed, buffer);
+    uint64_t       acc[8];
+    hash_long(acc, in, size, secret);
+    return hash128{merge(acc, secret + kMergeAccStart, size * kPrime64_1),
+                   merge(acc, secret + kSecretSize - kStripeSize - kMergeAccStart,
+                         ~(size * kPrime64_2))};
+}
+
+}  // namespace
+
+uint64_t fast_hash64(pn::data_view data, uint64_t seed) {
+    const uint8_t* in   = data.data();
+    const size_t   size = data.size();
+    if (size <= 16) {
+        return hash64_0to16(in, size, seed);
+    } else if (size <= 128) {
+        return hash64_17to128(in, size, seed);
+    } else if (size <= 240) {
+        return hash64_129to240(in, size, seed);
+    }
+    return hash64_long(in, size, seed);
+}
+
+hash128 fast_hash128(pn::data_view data, uint64_t seed) {
+    const uint8_t* in   = data.data();
+    const size_t   size = data.size();
+    if (size <= 16) {
+        return hash128_0to16(in, size, seed);
+    } else if (size <= 128) {
+        return hash128_17to128(in, size, seed);
+    } else if (size <= 240) {
+        return hash128_129to240(in, size, seed);
+    }
+    return hash128_long(in, size, seed);
+}
+
+bool operator==(const hash128& lhs, const hash128& rhs) {
+    return (lhs.low == rhs.low) && (lhs.high == rhs.high);
+}
+
+bool operator!=(const hash128& lhs, const hash128& rhs) { return !(lhs == rhs); }
+
+}  // namespace sfz
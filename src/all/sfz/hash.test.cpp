@@ -0,0 +1,147 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <set>
+#include <sfz/hash.hpp>
+#include <sfz/test-data.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using testing::Eq;
+using testing::Ne;
+
+namespace sfz {
+
+namespace {
+
+using HashTest = ::testing::Test;
+
+// Values from the xxHash library's XXH3_64bits_withSeed() and XXH3_128bits_withSeed(), for
+// prefixes of random_bytes(5000, 1), covering each size range.
+TEST_F(HashTest, KnownAnswers) {
+    struct known {
+        int      size;
+        uint64_t seed;
+        uint64_t hash64;
+        uint64_t low;
+        uint64_t high;
+    };
+    const known answers[] = {
+            {0, 0, 0x2d06800538d394c2ULL, 0x6001c324468d497fULL, 0x99aa06d3014798d8ULL},
+            {0, 42, 0xb029411ff43d84d2ULL, 0x3c1d09e9fe249164ULL, 0x16c20acd33f7af2fULL},
+            {1, 0, 0x429e81bc6744101cULL, 0x429e81bc6744101cULL, 0xbeff62be44bc9be4ULL},
+            {1, 42, 0xd4a47eebd4f70c23ULL, 0xd4a47eebd4f70c23ULL, 0xf497dde7a0c9dd91ULL},
+            {3, 0, 0x32dbb5c7774cc94fULL, 0x32dbb5c7774cc94fULL, 0x9dce807f4a9aaa56ULL},
+            {3, 42, 0xccd6bdd2005973a5ULL, 0xccd6bdd2005973a5ULL, 0x70e1c0b220be69c5ULL},
+            {4, 0, 0x65775238ca34c06fULL, 0x5def542b8e8255bbULL, 0x9772187e76395ea0ULL},
+            {4, 42, 0x4765fa2b07d89f96ULL, 0xf15f796f5f7dadd1ULL, 0xc594c19367a839edULL},
+            {8, 0, 0x90b760c9d253d0ffULL, 0xda3ca77f4508da63ULL, 0x29a3277f85f28675ULL},
+            {8, 42, 0x784f06a18d4b3f32ULL, 0xab34e04fc9104813ULL, 0x1dc6fb2445abbe89ULL},
+            {9, 0, 0x15ae9f843bb50ea4ULL, 0x85e53a642b77ffabULL, 0x57fc1cef528bd187ULL},
+            {9, 42, 0x630c3028617962aaULL, 0x41ba0bd84241edeeULL, 0x1edd72f986921b3dULL},
+            {16, 0, 0x372c92fa68129c98ULL, 0x4c6929dc65a535a0ULL, 0xf8ae1a6f144fb00bULL},
+            {16, 42, 0x792660fdb93da5fbULL, 0x807860a8c38c627dULL, 0x0689ddc5bc23e023ULL},
+            {17, 0, 0xb5d6b9c1898bd9d6ULL, 0x43287186cdfec85dULL, 0x0ad716e7cfed9dc8ULL},
+            {17, 42, 0xd2f66763b91b3821ULL, 0xf5201cf49078e48bULL, 0xe901a3aaf4ed5187ULL},
+            {32, 0, 0x0ab1dbf9e9f8c22cULL, 0xcf805526ea96182fULL, 0x3061e37048c04caaULL},
+            {32, 42, 0xe07f1e5615ed5a13ULL, 0xd3f84f8affe71062ULL, 0x7b18cbe1c664ac5aULL},
+            {33, 0, 0x4f4ae280e8465c3cULL, 0x9fc38e5c19be3ef3ULL, 0x7787bc63ca3818d6ULL},
+            {33, 42, 0x3fb224eb6a525e50ULL, 0x5cfe9df6141e8fefULL, 0xf006674c50992cd7ULL},
+            {64, 0, 0x84fcac4cce9f990dULL, 0x4cbebc1074a4c793ULL, 0x87477a4bb45568edULL},
+            {64, 42, 0x3d19796c471a77b3ULL, 0xcb10cc4e2fdd6e20ULL, 0x0b4053206b5bddacULL},
+            {65, 0, 0x2c9f18dff914a8bdULL, 0x8f4238b9da164902ULL, 0x1df8ba4eac471be1ULL},
+            {65, 42, 0xa2a64765f912de9eULL, 0x86f2fb58827f4b21ULL, 0x39536fd9b93495edULL},
+            {96, 0, 0xe1e1ba1b4e47ded7ULL, 0xbc2bc1d3d2a98617ULL, 0x6eea949b1d64d297ULL},
+            {96, 42, 0x4c4a686c812e6ae5ULL, 0xd09956b932bf0582ULL, 0xa98e62ae4ba8ac33ULL},
+            {97, 0, 0x5cc877781800cb6bULL, 0x2dc297aec6120b11ULL, 0x3abe16c7b27cae02ULL},
+            {97, 42, 0x66cae5bcb66e5636ULL, 0x858f839936ce7b03ULL, 0x2cde07fd846b11dfULL},
+            {128, 0, 0xc59e505a97d029e0ULL, 0x6772960c7e09e15bULL, 0x2b83749a25627c55ULL},
+            {128, 42, 0x3527e537fbef6c1cULL, 0x2c5e99307b84783fULL, 0xb57356eeea2a2e03ULL},
+            {129, 0, 0xf9e651a476d6d3caULL, 0xd15020c0444d308fULL, 0xd2c5fdf14399d768ULL},
+            {129, 42, 0xb037e613d3246c00ULL, 0xbd9085bcbde4c7ceULL, 0x1fbf401e1f198a98ULL},
+            {240, 0, 0x967597e635f3c527ULL, 0xe16f608e11e76335ULL, 0xb2c3c2aa029b2279ULL},
+            {240, 42, 0x39db46b839b46e18ULL, 0x136a9e3937cda4a8ULL, 0x7f10bd598772a09cULL},
+            {241, 0, 0xd6afac6f8fa85b01ULL, 0xd6afac6f8fa85b01ULL, 0xe75e577a31d24834ULL},
+            {241, 42, 0xfba92d5b53a13f5fULL, 0xfba92d5b53a13f5fULL, 0x1edccb67e3b8771aULL},
+            {1024, 0, 0xbb9f0c3761cdfd54ULL, 0xbb9f0c3761cdfd54ULL, 0x1ac8856c8b289d9aULL},
+            {1024, 42, 0x1dd013b34c391a3aULL, 0x1dd013b34c391a3aULL, 0x154c1c78e9371fdbULL},
+            {1025, 0, 0x95edccc1adc4d895ULL, 0x95edccc1adc4d895ULL, 0x15379a00bb4cec98ULL},
+            {1025, 42, 0xb0f205851b0caee9ULL, 0xb0f205851b0caee9ULL, 0x36b1858ada295281ULL},
+            {5000, 0, 0x06983d4ce0939f36ULL, 0x06983d4ce0939f36ULL, 0xb66e1e66e1733cffULL},
+            {5000, 42, 0xf8090add513029baULL, 0xf8090add513029baULL, 0x6b9d34e976366fadULL},
+    };
+    const std::vector<uint8_t> bytes = random_bytes(5000, 1);
+    for (const known& k : answers) {
+        const pn::data_view data{bytes.data(), k.size};
+        EXPECT_THAT(fast_hash64(data, k.seed), Eq(k.hash64)) << k.size << ", " << k.seed;
+        EXPECT_THAT(fast_hash128(data, k.seed), Eq(hash128{k.low, k.high}))
+                << k.size << ", " << k.seed;
+    }
+
+    EXPECT_THAT(fast_hash64(pn::string_view{"abc"}.as_data()), Eq(0x78af5f94892f3950ULL));
+}
+
+// The hash shouldn't depend on the alignment of the data.
+TEST_F(HashTest, Alignment) {
+    const std::vector<uint8_t> bytes = random_bytes(3000, 2);
+    for (int size : {7, 15, 100, 200, 1500, 2999}) {
+        const uint64_t expected = fast_hash64(pn::data_view{bytes.data(), size});
+        for (int offset = 1; offset < 8; ++offset) {
+            std::vector<uint8_t> shifted(offset);
+            shifted.insert(shifted.end(), bytes.begin(), bytes.begin() + size);
+            EXPECT_THAT(fast_hash64(pn::data_view{shifted.data() + offset, size}), Eq(expected))
+                    << size << ", " << offset;
+        }
+    }
+}
+
+// Changing any one bit of the input, or the seed, should change the hash.
+TEST_F(HashTest, Sensitivity) {
+    std::vector<uint8_t> bytes = random_bytes(1000, 3);
+    for (int size : {1, 5, 12, 40, 200, 1000}) {
+        const pn::data_view data{bytes.data(), size};
+        std::set<uint64_t>  seen{fast_hash64(data)};
+        for (int bit = 0; bit < 8 * size; bit += 7) {
+            bytes[bit / 8] ^= 1 << (bit % 8);
+            seen.insert(fast_hash64(data));
+            bytes[bit / 8] ^= 1 << (bit % 8);
+        }
+        EXPECT_THAT(seen.size(), Eq<size_t>(1 + ((8 * size) + 6) / 7)) << size;
+        EXPECT_THAT(fast_hash64(data, 1), Ne(fast_hash64(data, 2))) << size;
+        EXPECT_THAT(fast_hash128(data, 1), Ne(fast_hash128(data, 2))) << size;
+    }
+}
+
+TEST_F(HashTest, Containers) {
+    std::unordered_map<pn::string, int, string_hash> counts;
+    for (const char* word : {"a", "b", "a", "c", "a"}) {
+        ++counts[word];
+    }
+    EXPECT_THAT(counts.size(), Eq<size_t>(3));
+    EXPECT_THAT(counts["a"], Eq(3));
+    EXPECT_THAT(string_hash()("abc"), Eq<size_t>(fast_hash64(pn::string_view{"abc"}.as_data())));
+    EXPECT_THAT(string_hash(7)("abc"), Ne(string_hash(8)("abc")));
+
+    const std::vector<uint8_t>                    bytes = random_bytes(100, 4);
+    std::unordered_set<pn::data_view, data_hash>  blobs;
+    std::unordered_set<sha1::digest, digest_hash> digests;
+    for (int size = 0; size < 100; ++size) {
+        const pn::data_view d{bytes.data(), size};
+        blobs.insert(d);
+        sha1 sha;
+        sha.write(d);
+        digests.insert(sha.compute());
+    }
+    blobs.insert(pn::data_view{bytes.data(), 50});
+    EXPECT_THAT(blobs.size(), Eq<size_t>(100));
+    EXPECT_THAT(digests.size(), Eq<size_t>(100));
+}
+
+}  // namespace
+}  // namespace sfz
@@ -0,0 +1,293 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <sfz/manifest.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <sfz/file.hpp>
+#include <sfz/os.hpp>
+#include <sfz/parallel.hpp>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace sfz {
+
+namespace {
+
+bool parse_size(pn::string_view decimal, uint64_t* size) {
+    if (decimal.empty()) {
+        return false;
+    }
+    *size = 0;
+    for (int i = 0; i < decimal.size(); ++i) {
+        const char c = decimal.data()[i];
+        if ((c < '0') || (c > '9') || (*size > (UINT64_MAX - (c - '0')) / 10)) {
+            return false;
+        }
+        *size = (*size * 10) + (c - '0');
+    }
+    return true;
+}
+
+bool is_regular(const Stat& st) { return (st.st_mode & S_IFMT) == S_IFREG; }
+
+manifest_mismatch mismatch(
+        ManifestProblem problem, const manifest_entry& e, uint64_t actual_size = 0,
+        const sha1::digest& actual_digest = sha1::digest{}) {
+    return manifest_mismatch{problem,       e.path.copy(), e.size, e.digest, actual_size,
+                             actual_digest};
+}
+
+// Sorts mismatches found out of order by the indexes they were found with.
+std::vector<manifest_mismatch> in_order(std::vector<std::pair<size_t, manifest_mismatch>>& found) {
+    std::sort(
+            found.begin(), found.end(),
+            [](const std::pair<size_t, manifest_mismatch>& x,
+               const std::pair<size_t, manifest_mismatch>& y) { return x.first < y.first; });
+    std::vector<manifest_mismatch> mismatches;
+    for (std::pair<size_t, manifest_mismatch>& m : found) {
+        mismatches.push_back(std::move(m.second));
+    }
+    return mismatches;
+}
+
+// Lists the regular files in a tree, with their paths relative to its root.  Anything else is
+// ignored: it's only of interest if the manifest lists it, and then it's been reported already.
+struct fileWalker : TreeWalker {
+    void file(pn::string_view path, const Stat& st) const {
+        files.emplace_back(path.substr(prefix).copy(), st.st_size);
+    }
+
+    void pre_directory(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+    void cycle_directory(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+    void post_directory(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+    void symlink(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+    void broken_symlink(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+    void other(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+
+    int                                           prefix;
+    std::vector<std::pair<pn::string, uint64_t>>& files;
+    fileWalker(int prefix, std::vector<std::pair<pn::string, uint64_t>>& files)
+            : prefix(prefix), files(files) {}
+};
+
+}  // namespace
+
+std::vector<manifest_entry> parse_manifest(pn::string_view text) {
+    std::vector<manifest_entry> entries;
+    int                         line_number = 0;
+    for (int start = 0; start < text.size();) {
+        int end = text.find(pn::rune{'\n'}, start);
+        if (end == pn::string_view::npos) {
+            end = text.size();
+        }
+        const pn::string_view line = text.substr(start, end - start);
+        start                      = end + 1;
+        ++line_number;
+        if (line.empty()) {
+            continue;
+        }
+
+        manifest_entry e{pn::string{}, 0, sha1::digest{}};
+        const int      size_end =
+                (line.size() < 44) ? pn::string_view::npos : line.find(pn::rune{' '}, 41);
+        if ((line.size() < 44) || (line.data()[40] != ' ') ||
+            (size_end == pn::string_view::npos) || (size_end + 1 == line.size()) ||
+            !sha1::digest::parse_hex(line.substr(0, 40), &e.digest) ||
+            !parse_size(line.substr(41, size_end - 41), &e.size)) {
+            throw std::runtime_error(
+                    pn::format("manifest line {0}: expected \"<sha1> <size> <path>\"", line_number)
+                            .c_str());
+        }
+        e.path = line.substr(size_end + 1).copy();
+        entries.push_back(std::move(e));
+    }
+    return entries;
+}
+
+std::vector<manifest_entry> read_manifest(pn::string_view path) {
+    mapped_file file(path);
+    try {
+        return parse_manifest(file.string());
+    } catch (std::runtime_error& e) {
+        throw std::runtime_error(pn::format("{0}: {1}", path, e.what()).c_str());
+    }
+}
+
+pn::string format_manifest(const std::vector<manifest_entry>& entries) {
+    pn::string text;
+    for (const manifest_entry& e : entries) {
+        text += pn::format("{0} {1} {2}\n", e.digest.hex(), e.size, e.path);
+    }
+    return text;
+}
+
+std::vector<manifest_entry> build_manifest(pn::string_view root, const merkle_options& options) {
+    const merkle_tree                     tree(root, options);
+    const std::vector<merkle_tree::node>& nodes = tree.nodes();
+
+    // Each directory comes before its entries, so its path is known by the time they're reached.
+    std::vector<pn::string>     paths(nodes.size());
+    std::vector<manifest_entry> entries;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const merkle_tree::node& n = nodes[i];
+        if (!n.directory) {
+            entries.push_back(manifest_entry{paths[i].copy(), n.size, n.digest});
+            continue;
+        }
+        for (size_t j = n.first_child; j < n.first_child + n.child_count; ++j) {
+            paths[j] = (i == 0) ? nodes[j].name.copy()
+                                : pn::format("{0}/{1}", paths[i], nodes[j].name);
+        }
+    }
+    std::sort(
+            entries.begin(), entries.end(),
+            [](const manifest_entry& x, const manifest_entry& y) {
+                return pn::string_view{x.path} < pn::string_view{y.path};
+            });
+    return entries;
+}
+
+std::vector<manifest_mismatch> verify_manifest(
+        pn::string_view root, const std::vector<manifest_entry>& manifest,
+        const verify_options& options) {
+    // Mismatches are found out of order, so each is kept with its entry's index, and those of
+    // unlisted files with indexes past the end of the manifest.
+    std::vector<std::pair<size_t, manifest_mismatch>> found;
+
+    // Check sizes, which needs nothing but stat(2).
+    std::vector<size_t> to_hash;
+    for (size_t i = 0; i < manifest.size(); ++i) {
+        if (options.stop_at_first_mismatch && !found.empty()) {
+            return in_order(found);
+        }
+        const manifest_entry& e    = manifest[i];
+        const pn::string      full = pn::format("{0}/{1}", root, e.path);
+        Stat                  st;
+        try {
+            st = stat(full);
+        } catch (std::runtime_error&) {
+            if (path::exists(full)) {
+                throw;
+            }
+            found.emplace_back(i, mismatch(MANIFEST_MISSING, e));
+            continue;
+        }
+        if (!is_regular(st)) {
+            found.emplace_back(i, mismatch(MANIFEST_NOT_A_FILE, e));
+        } else if (static_cast<uint64_t>(st.st_size) != e.size) {
+            found.emplace_back(i, mismatch(MANIFEST_WRONG_SIZE, e, st.st_size));
+        } else {
+            to_hash.push_back(i);
+        }
+    }
+    if (options.stop_at_first_mismatch && !found.empty()) {
+        return in_order(found);
+    }
+
+    if (options.check_unlisted) {
+        std::vector<pn::string_view> listed;
+        for (const manifest_entry& e : manifest) {
+            listed.push_back(e.path);
+        }
+        std::sort(listed.begin(), listed.end());
+        std::vector<std::pair<pn::string, uint64_t>> files;
+        walk(root, WALK_LOGICAL, fileWalker(root.size() + 1, files));
+        std::sort(
+                files.begin(), files.end(),
+                [](const std::pair<pn::string, uint64_t>& x,
+                   const std::pair<pn::string, uint64_t>& y) {
+                    return pn::string_view{x.first} < pn::string_view{y.first};
+                });
+        for (std::pair<pn::string, uint64_t>& f : files) {
+            if (!std::binary_search(listed.begin(), listed.end(), pn::string_view{f.first})) {
+                found.emplace_back(
+                        manifest.size() + found.size(),
+                        manifest_mismatch{MANIFEST_UNLISTED, std::move(f.first), 0, sha1::digest{},
+                                          f.second, sha1::digest{}});
+                if (options.stop_at_first_mismatch) {
+                    return in_order(found);
+                }
+            }
+        }
+    }
+
+    // Hash the rest, largest first, so that a large file isn't left to be hashed alone at the
+    // end.  Each file is hashed on one thread; the parallelism is across files.
+    std::stable_sort(to_hash.begin(), to_hash.end(), [&manifest](size_t x, size_t y) {
+        return manifest[x].size > manifest[y].size;
+    });
+    file_digest_options file_options;
+    file_options.threads = 1;
+    file_options.read    = options.read;
+    std::atomic<size_t> next(0);
+    std::atomic<bool>   stop(false);
+    std::mutex          mu;
+    std::exception_ptr  error;
+    auto                work = [&]() {
+        while (!stop.load(std::memory_order_relaxed)) {
+            const size_t j = next.fetch_add(1);
+            if (j >= to_hash.size()) {
+                return;
+            }
+            const manifest_entry& e = manifest[to_hash[j]];
+            try {
+                const sha1::digest digest =
+                        file_digest<sha1>(pn::format("{0}/{1}", root, e.path), file_options);
+                if (digest != e.digest) {
+                    std::lock_guard<std::mutex> lock(mu);
+                    found.emplace_back(
+                            to_hash[j], mismatch(MANIFEST_WRONG_DIGEST, e, e.size, digest));
+                    if (options.stop_at_first_mismatch) {
+                        stop = true;
+                    }
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mu);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                stop = true;
+            }
+        }
+    };
+    const size_t threads = std::min<size_t>(thread_count(options.threads), to_hash.size());
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& t : workers) {
+        t.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return in_order(found);
+}
+
+}  // namespace sfz
@@ -0,0 +1,168 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sfz/manifest.hpp>
+#include <sfz/os.hpp>
+#include <sfz/test-data.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using testing::ElementsAre;
+using testing::Eq;
+using testing::IsEmpty;
+using testing::SizeIs;
+
+namespace sfz {
+
+namespace {
+
+using ManifestTest = ::testing::Test;
+
+// Describes each mismatch as its path, prefixed with its problem.
+std::vector<std::string> describe(const std::vector<manifest_mismatch>& mismatches) {
+    std::vector<std::string> result;
+    for (const manifest_mismatch& m : mismatches) {
+        const char* prefix = "";
+        switch (m.problem) {
+            case MANIFEST_MISSING: prefix = "missing "; break;
+            case MANIFEST_NOT_A_FILE: prefix = "not a file "; break;
+            case MANIFEST_WRONG_SIZE: prefix = "size "; break;
+            case MANIFEST_WRONG_DIGEST: prefix = "digest "; break;
+            case MANIFEST_UNLISTED: prefix = "unlisted "; break;
+        }
+        result.push_back(prefix + std::string(m.path.data(), m.path.size()));
+    }
+    return result;
+}
+
+pn::string make_tree(const TemporaryDirectory& dir) {
+    pn::string tree = pn::format("{0}/tree", dir.path());
+    write_file(pn::format("{0}/b", tree), "bee");
+    write_file(pn::format("{0}/a/x", tree), "ex");
+    write_file(pn::format("{0}/a/y", tree), "why");
+    write_file(pn::format("{0}/a/deep/z", tree), "zed");
+    write_file(pn::format("{0}/c/w w", tree), "double-u");
+    return tree;
+}
+
+TEST_F(ManifestTest, Format) {
+    const std::vector<manifest_entry> entries = parse_manifest(
+            "a9993e364706816aba3e25717850c26c9cd0d89d 3 docs/abc.txt\n"
+            "\n"
+            "DA39A3EE5E6B4B0D3255BFEF95601890AFD80709 0 with spaces \n");
+    ASSERT_THAT(entries, SizeIs(2));
+    EXPECT_THAT(entries[0].path, Eq<pn::string_view>("docs/abc.txt"));
+    EXPECT_THAT(entries[0].size, Eq<uint64_t>(3));
+    EXPECT_THAT(entries[0].digest, Eq(sha1_literal("abc")));
+    EXPECT_THAT(entries[1].path, Eq<pn::string_view>("with spaces "));
+    EXPECT_THAT(entries[1].size, Eq<uint64_t>(0));
+
+    EXPECT_THAT(format_manifest(entries),
+                Eq<pn::string_view>("a9993e364706816aba3e25717850c26c9cd0d89d 3 docs/abc.txt\n"
+                                    "da39a3ee5e6b4b0d3255bfef95601890afd80709 0 with spaces \n"));
+    EXPECT_THAT(parse_manifest(""), IsEmpty());
+}
+
+TEST_F(ManifestTest, FormatInvalid) {
+    for (const char* line : {
+                 "a9993e364706816aba3e25717850c26c9cd0d89d 3",
+                 "a9993e364706816aba3e25717850c26c9cd0d89d 3 ",
+                 "a9993e364706816aba3e25717850c26c9cd0d89 3 abc",
+                 "a9993e364706816aba3e25717850c26c9cd0d89g 3 abc",
+                 "a9993e364706816aba3e25717850c26c9cd0d89d  abc",
+                 "a9993e364706816aba3e25717850c26c9cd0d89d -3 abc",
+                 "a9993e364706816aba3e25717850c26c9cd0d89d 18446744073709551616 abc",
+         }) {
+        EXPECT_THROW(parse_manifest(line), std::runtime_error) << line;
+    }
+    EXPECT_THAT(parse_manifest("a9993e364706816aba3e25717850c26c9cd0d89d 18446744073709551615 a")
+                        .at(0)
+                        .size,
+                Eq<uint64_t>(18446744073709551615u));
+}
+
+// A manifest built from a tree should verify against it, and survive being written and read.
+TEST_F(ManifestTest, Build) {
+    TemporaryDirectory                dir("manifest-test");
+    const pn::string                  tree     = make_tree(dir);
+    const std::vector<manifest_entry> manifest = build_manifest(tree);
+    ASSERT_THAT(manifest, SizeIs(5));
+    EXPECT_THAT(manifest[0].path, Eq<pn::string_view>("a/deep/z"));
+    EXPECT_THAT(manifest[4].path, Eq<pn::string_view>("c/w w"));
+    EXPECT_THAT(manifest[4].size, Eq<uint64_t>(8));
+    EXPECT_THAT(manifest[3].digest, Eq(sha1_literal("bee")));
+
+    const pn::string path = pn::format("{0}/manifest", dir.path());
+    write_file(path, format_manifest(manifest));
+    const std::vector<manifest_entry> read = read_manifest(path);
+    ASSERT_THAT(read, SizeIs(5));
+    EXPECT_THAT(read[2].path, Eq<pn::string_view>("a/y"));
+    EXPECT_THAT(read[2].digest, Eq(manifest[2].digest));
+
+    EXPECT_THAT(verify_manifest(tree, read), IsEmpty());
+}
+
+// Every kind of mismatch should be found, and reported in the order of the manifest.
+TEST_F(ManifestTest, Verify) {
+    TemporaryDirectory                dir("manifest-test");
+    const pn::string                  tree     = make_tree(dir);
+    const std::vector<manifest_entry> manifest = build_manifest(tree);
+
+    write_file(pn::format("{0}/a/x", tree), "eks");
+    write_file(pn::format("{0}/a/y", tree), "wye");
+    unlink(pn::format("{0}/b", tree));
+    unlink(pn::format("{0}/c/w w", tree));
+    mkdir(pn::format("{0}/c/w w", tree), 0700);
+    write_file(pn::format("{0}/c/new", tree), "new");
+
+    for (int threads : {1, 4}) {
+        verify_options options;
+        options.threads = threads;
+        EXPECT_THAT(describe(verify_manifest(tree, manifest, options)),
+                    ElementsAre("size a/x", "digest a/y", "missing b", "not a file c/w w"));
+
+        options.check_unlisted = true;
+        const std::vector<manifest_mismatch> mismatches = verify_manifest(tree, manifest, options);
+        EXPECT_THAT(describe(mismatches), ElementsAre(
+                                                  "size a/x", "digest a/y", "missing b",
+                                                  "not a file c/w w", "unlisted c/new"));
+        ASSERT_THAT(mismatches, SizeIs(5));
+        EXPECT_THAT(mismatches[0].expected_size, Eq<uint64_t>(2));
+        EXPECT_THAT(mismatches[0].actual_size, Eq<uint64_t>(3));
+        EXPECT_THAT(mismatches[1].expected_digest, Eq(sha1_literal("why")));
+        EXPECT_THAT(mismatches[1].actual_digest, Eq(sha1_literal("wye")));
+        EXPECT_THAT(mismatches[4].actual_size, Eq<uint64_t>(3));
+    }
+}
+
+// In stop-at-first mode, one mismatch should be reported.  A size mismatch is found before
+// anything is hashed.
+TEST_F(ManifestTest, StopAtFirst) {
+    TemporaryDirectory          dir("manifest-test");
+    const pn::string            tree     = make_tree(dir);
+    std::vector<manifest_entry> manifest = build_manifest(tree);
+
+    verify_options options;
+    options.stop_at_first_mismatch = true;
+    EXPECT_THAT(verify_manifest(tree, manifest, options), IsEmpty());
+
+    manifest[4].digest = sha1::digest{};
+    EXPECT_THAT(describe(verify_manifest(tree, manifest, options)), ElementsAre("digest c/w w"));
+
+    write_file(pn::format("{0}/a/x", tree), "eks");
+    write_file(pn::format("{0}/a/y", tree), "wye");
+    EXPECT_THAT(describe(verify_manifest(tree, manifest, options)), ElementsAre("size a/x"));
+
+    options.threads = 1;
+    write_file(pn::format("{0}/a/x", tree), "ex");
+    EXPECT_THAT(verify_manifest(tree, manifest, options), SizeIs(1));
+}
+
+}  // namespace
+}  // namespace sfz
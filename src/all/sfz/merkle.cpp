@@ -0,0 +1,262 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <sfz/merkle.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <sfz/os.hpp>
+#include <sfz/parallel.hpp>
+#include <stdexcept>
+
+namespace sfz {
+
+namespace {
+
+// Files modified this soon before an earlier tree was built may have changed again without
+// changing their identity, so their digests aren't reused.
+const int64_t kRacyInterval = 2000000000;
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+}
+
+bool operator==(const digest_cache::file_id& x, const digest_cache::file_id& y) {
+    return (x.dev == y.dev) && (x.ino == y.ino) && (x.size == y.size) &&
+           (x.mtime_ns == y.mtime_ns) && (x.ctime_ns == y.ctime_ns);
+}
+
+// An entry found while walking the tree, before the tree is put in order.
+struct entry {
+    pn::string                          name;
+    Stat                                st;
+    bool                                directory;
+    std::vector<std::unique_ptr<entry>> children;
+};
+
+// Builds a tree of entries from the walk, which visits each directory's contents between its
+// pre_directory() and post_directory() calls.
+struct entryWalker : TreeWalker {
+    void pre_directory(pn::string_view path, const Stat& st) const {
+        std::unique_ptr<entry> e(new entry{
+                stack.empty() ? pn::string{} : path::basename(path).copy(), st, true, {}});
+        entry* const dir = e.get();
+        if (root) {
+            parent()->children.push_back(std::move(e));
+        } else {
+            root = std::move(e);
+        }
+        stack.push_back(dir);
+    }
+    void post_directory(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+        stack.pop_back();
+    }
+
+    void file(pn::string_view path, const Stat& st) const {
+        if (stack.empty()) {
+            throw std::runtime_error(pn::format("{0}: not a directory", path).c_str());
+        }
+        parent()->children.emplace_back(new entry{path::basename(path).copy(), st, false, {}});
+    }
+
+    // As in tree_digest(), throw exceptions on anything that isn't a regular file or directory,
+    // and ignore broken symlinks.
+    void cycle_directory(pn::string_view path, const Stat&) const {
+        throw std::runtime_error(pn::format("Found directory cycle: {0}.", path).c_str());
+    }
+    void other(pn::string_view path, const Stat&) const {
+        throw std::runtime_error(pn::format("Found non-regular file: {0}", path).c_str());
+    }
+    void broken_symlink(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+
+    // Can't happen during WALK_LOGICAL.
+    void symlink(pn::string_view path, const Stat& stat) const {
+        static_cast<void>(path);
+        static_cast<void>(stat);
+    }
+
+    entry* parent() const { return stack.back(); }
+
+    std::unique_ptr<entry>& root;
+    std::vector<entry*>&    stack;
+    entryWalker(std::unique_ptr<entry>& root, std::vector<entry*>& stack)
+            : root(root), stack(stack) {}
+};
+
+pn::string join(pn::string_view dir, pn::string_view name) {
+    return dir.empty() ? name.copy() : pn::format("{0}/{1}", dir, name);
+}
+
+// Computes the digest of a directory from its entries, which must already have theirs.
+sha1::digest directory_digest(const merkle_tree::node* children, size_t count) {
+    sha1 sha;
+    for (size_t i = 0; i < count; ++i) {
+        const merkle_tree::node& child = children[i];
+        const uint32_t*          d     = child.digest.d;
+        sha.write<uint8_t, uint64_t>(child.directory ? 'd' : 'f', child.name.size());
+        sha.write(child.name.as_data());
+        sha.write(d[0], d[1], d[2], d[3], d[4]);
+    }
+    return sha.compute();
+}
+
+}  // namespace
+
+merkle_tree::merkle_tree(pn::string_view path, const merkle_options& options)
+        : _time_ns{now_ns()} {
+    std::unique_ptr<entry> root;
+    std::vector<entry*>    stack;
+    walk(path, WALK_LOGICAL, entryWalker(root, stack));
+    if (!root) {
+        throw std::runtime_error(pn::format("{0}: not a directory", path).c_str());
+    }
+
+    // Lay out the nodes breadth-first, sorting each directory's entries as it's reached.  Files
+    // are listed, with their paths relative to the root, for hashing.
+    struct pending {
+        entry*     e;
+        size_t     index;
+        pn::string path;
+    };
+    std::vector<pending> queue;
+    std::vector<pending> files;
+    _nodes.push_back(node{pn::string{}, true, sha1::digest{}, 0, digest_cache::file_id{}, 0, 0});
+    queue.push_back(pending{root.get(), 0, pn::string{}});
+    for (size_t q = 0; q < queue.size(); ++q) {
+        entry* const e = queue[q].e;
+        std::sort(
+                e->children.begin(), e->children.end(),
+                [](const std::unique_ptr<entry>& x, const std::unique_ptr<entry>& y) {
+                    return pn::string_view{x->name} < pn::string_view{y->name};
+                });
+        _nodes[queue[q].index].first_child = _nodes.size();
+        _nodes[queue[q].index].child_count = e->children.size();
+        for (const std::unique_ptr<entry>& child : e->children) {
+            node n{child->name.copy(), child->directory, sha1::digest{}, 0,
+                   digest_cache::id(child->st), 0, 0};
+            pending p{child.get(), _nodes.size(), join(queue[q].path, child->name)};
+            if (child->directory) {
+                n.id = digest_cache::file_id{};
+                queue.push_back(std::move(p));
+            } else {
+                n.size = child->st.st_size;
+                files.push_back(std::move(p));
+            }
+            _nodes.push_back(std::move(n));
+        }
+    }
+
+    // Files are independent, so unlike in tree_digest(), they can be hashed concurrently.
+    const int           threads = thread_count(options.threads);
+    file_digest_options file_options;
+    file_options.threads         = 1;
+    file_options.read            = options.read;
+    file_options.read_ahead      = options.read_ahead;
+    file_options.read_ahead_size = options.read_ahead_size;
+    const merkle_tree* previous  = options.previous;
+    digest_cache*      cache     = options.cache;
+    ordered_map<sha1::digest>(
+            files.size(), threads, 4 * threads,
+            [this, &files, &path, &file_options, previous, cache](size_t i) {
+                const node& n = _nodes[files[i].index];
+                if (previous) {
+                    const node* old = previous->find(files[i].path);
+                    if (old && !old->directory && (old->id == n.id) &&
+                        (n.id.mtime_ns <= (previous->_time_ns - kRacyInterval))) {
+                        return old->digest;
+                    }
+                }
+                const pn::string full = pn::format("{0}/{1}", path, files[i].path);
+                return cache ? file_digest(full, *cache, file_options)
+                             : file_digest<sha1>(full, file_options);
+            },
+            [this, &files](size_t i, sha1::digest& digest) {
+                _nodes[files[i].index].digest = digest;
+            });
+
+    // Children come after their parents, so working backwards, each directory's entries are
+    // complete by the time it's reached.
+    for (size_t i = _nodes.size(); i-- > 0;) {
+        node& n = _nodes[i];
+        if (!n.directory) {
+            continue;
+        }
+        n.digest = directory_digest(children(n), n.child_count);
+        for (size_t j = 0; j < n.child_count; ++j) {
+            n.size += children(n)[j].size;
+        }
+    }
+}
+
+const merkle_tree::node* merkle_tree::find(pn::string_view path) const {
+    const node* n = &root();
+    while (!path.empty()) {
+        const int             slash = path.find(pn::rune{'/'});
+        const pn::string_view name  = (slash < 0) ? path : path.substr(0, slash);
+        path                        = (slash < 0) ? pn::string_view{} : path.substr(slash + 1);
+        if (!n->directory) {
+            return nullptr;
+        }
+        const node* begin = children(*n);
+        const node* end   = begin + n->child_count;
+        const node* it    = std::lower_bound(begin, end, name, [](const node& x, pn::string_view y) {
+            return pn::string_view{x.name} < y;
+        });
+        if ((it == end) || (pn::string_view{it->name} != name)) {
+            return nullptr;
+        }
+        n = it;
+    }
+    return n;
+}
+
+namespace {
+
+void diff_nodes(
+        const merkle_tree& before, const merkle_tree::node& x, const merkle_tree& after,
+        const merkle_tree::node& y, pn::string_view path, std::vector<merkle_difference>& out) {
+    if ((x.directory == y.directory) && (x.digest == y.digest)) {
+        return;
+    } else if (!x.directory || !y.directory) {
+        out.push_back(merkle_difference{MERKLE_MODIFIED, path.copy()});
+        return;
+    }
+
+    // Merge the two sorted lists of entries.
+    const merkle_tree::node* xs = before.children(x);
+    const merkle_tree::node* ys = after.children(y);
+    size_t                   i = 0, j = 0;
+    while ((i < x.child_count) || (j < y.child_count)) {
+        if ((j == y.child_count) ||
+            ((i < x.child_count) && (pn::string_view{xs[i].name} < pn::string_view{ys[j].name}))) {
+            out.push_back(merkle_difference{MERKLE_REMOVED, join(path, xs[i++].name)});
+        } else if (
+                (i == x.child_count) ||
+                (pn::string_view{ys[j].name} < pn::string_view{xs[i].name})) {
+            out.push_back(merkle_difference{MERKLE_ADDED, join(path, ys[j++].name)});
+        } else {
+            diff_nodes(before, xs[i], after, ys[j], join(path, xs[i].name), out);
+            ++i, ++j;
+        }
+    }
+}
+
+}  // namespace
+
+std::vector<merkle_difference> diff(const merkle_tree& before, const merkle_tree& after) {
+    std::vector<merkle_difference> out;
+    diff_nodes(before, before.root(), after, after.root(), "", out);
+    return out;
+}
+
+}  // namespace sfz
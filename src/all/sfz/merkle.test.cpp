@@ -0,0 +1,171 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sfz/merkle.hpp>
+#include <sfz/os.hpp>
+#include <sfz/range.hpp>
+#include <sfz/test-data.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using testing::ElementsAre;
+using testing::Eq;
+using testing::IsEmpty;
+using testing::IsNull;
+using testing::Ne;
+using testing::NotNull;
+
+namespace sfz {
+
+namespace {
+
+using MerkleTest = ::testing::Test;
+
+// Describes each difference as its path, prefixed with '+', '-', or '~' for added, removed, or
+// modified.
+std::vector<std::string> describe(const std::vector<merkle_difference>& differences) {
+    std::vector<std::string> result;
+    for (const merkle_difference& d : differences) {
+        const char prefix = (d.change == MERKLE_ADDED) ? '+'
+                                                        : (d.change == MERKLE_REMOVED) ? '-' : '~';
+        result.push_back(prefix + std::string(d.path.data(), d.path.size()));
+    }
+    return result;
+}
+
+// Creates a tree with files at several depths, and an empty directory.
+pn::string make_tree(const TemporaryDirectory& dir) {
+    pn::string tree = pn::format("{0}/tree", dir.path());
+    write_file(pn::format("{0}/b", tree), "bee");
+    write_file(pn::format("{0}/a/x", tree), "ex");
+    write_file(pn::format("{0}/a/y", tree), "why");
+    write_file(pn::format("{0}/a/deep/z", tree), "zed");
+    write_file(pn::format("{0}/c/w", tree), "double-u");
+    makedirs(pn::format("{0}/empty", tree), 0700);
+    return tree;
+}
+
+// Nodes should be laid out breadth-first, with each directory's entries sorted and contiguous,
+// and should record the digest and size of each file and directory.
+TEST_F(MerkleTest, Structure) {
+    TemporaryDirectory dir("merkle-test");
+    const pn::string   tree = make_tree(dir);
+    const merkle_tree  merkle(tree);
+
+    const merkle_tree::node& root = merkle.root();
+    EXPECT_THAT(root.directory, Eq(true));
+    EXPECT_THAT(root.size, Eq<uint64_t>(19));
+    ASSERT_THAT(root.child_count, Eq<size_t>(4));
+    EXPECT_THAT(merkle.children(root)[0].name, Eq<pn::string_view>("a"));
+    EXPECT_THAT(merkle.children(root)[1].name, Eq<pn::string_view>("b"));
+    EXPECT_THAT(merkle.children(root)[2].name, Eq<pn::string_view>("c"));
+    EXPECT_THAT(merkle.children(root)[3].name, Eq<pn::string_view>("empty"));
+    EXPECT_THAT(merkle.nodes().size(), Eq<size_t>(10));
+
+    const merkle_tree::node* b = merkle.find("b");
+    ASSERT_THAT(b, NotNull());
+    EXPECT_THAT(b->directory, Eq(false));
+    EXPECT_THAT(b->size, Eq<uint64_t>(3));
+    EXPECT_THAT(b->digest, Eq(file_digest(pn::format("{0}/b", tree))));
+
+    const merkle_tree::node* z = merkle.find("a/deep/z");
+    ASSERT_THAT(z, NotNull());
+    EXPECT_THAT(z->digest, Eq(file_digest(pn::format("{0}/a/deep/z", tree))));
+
+    const merkle_tree::node* empty = merkle.find("empty");
+    ASSERT_THAT(empty, NotNull());
+    EXPECT_THAT(empty->directory, Eq(true));
+    EXPECT_THAT(empty->child_count, Eq<size_t>(0));
+    EXPECT_THAT(empty->digest, Eq(sha1().compute()));
+
+    EXPECT_THAT(merkle.find(""), Eq(&root));
+    EXPECT_THAT(merkle.find("a/deep/missing"), IsNull());
+    EXPECT_THAT(merkle.find("b/c"), IsNull());
+
+    EXPECT_THROW(merkle_tree(pn::format("{0}/b", tree)), std::runtime_error);
+}
+
+// Files hashed into a cache should have the same digests, however they're read.
+TEST_F(MerkleTest, Cache) {
+    TemporaryDirectory dir("merkle-test");
+    const pn::string   tree = make_tree(dir);
+    const merkle_tree  expected(tree);
+    int                caches = 0;
+    for (ReadMode mode : {READ_AUTO, READ_MAPPED, READ_STREAMED}) {
+        for (int read_ahead : {0, 2}) {
+            digest_cache   cache(pn::format("{0}/cache-{1}", dir.path(), caches++), 64);
+            merkle_options options;
+            options.read       = mode;
+            options.read_ahead = read_ahead;
+            options.cache      = &cache;
+            EXPECT_THAT(merkle_tree(tree, options).root().digest, Eq(expected.root().digest))
+                    << mode << ", " << read_ahead;
+        }
+    }
+}
+
+// A change to a file should change the digests of the directories above it, and no others.
+TEST_F(MerkleTest, Digests) {
+    TemporaryDirectory dir("merkle-test");
+    const pn::string   tree = make_tree(dir);
+    const merkle_tree  before(tree);
+    for (int threads : {1, 4}) {
+        merkle_options options;
+        options.threads = threads;
+        EXPECT_THAT(merkle_tree(tree, options).root().digest, Eq(before.root().digest));
+    }
+
+    write_file(pn::format("{0}/a/deep/z", tree), "zee");
+    const merkle_tree after(tree);
+    EXPECT_THAT(after.root().digest, Ne(before.root().digest));
+    EXPECT_THAT(after.find("a")->digest, Ne(before.find("a")->digest));
+    EXPECT_THAT(after.find("a/deep")->digest, Ne(before.find("a/deep")->digest));
+    EXPECT_THAT(after.find("c")->digest, Eq(before.find("c")->digest));
+    EXPECT_THAT(after.find("a/x")->digest, Eq(before.find("a/x")->digest));
+}
+
+TEST_F(MerkleTest, Diff) {
+    TemporaryDirectory dir("merkle-test");
+    const pn::string   tree = make_tree(dir);
+    const merkle_tree  before(tree);
+    EXPECT_THAT(diff(before, before), IsEmpty());
+
+    write_file(pn::format("{0}/a/y", tree), "wye");
+    write_file(pn::format("{0}/a/new", tree), "new");
+    unlink(pn::format("{0}/b", tree));
+    write_file(pn::format("{0}/b/inside", tree), "now a directory");
+    rmtree(pn::format("{0}/c", tree));
+    write_file(pn::format("{0}/d/e/f", tree), "added directory");
+    const merkle_tree after(tree);
+
+    EXPECT_THAT(describe(diff(before, after)), ElementsAre("+a/new", "~a/y", "~b", "-c", "+d"));
+    EXPECT_THAT(describe(diff(after, before)), ElementsAre("-a/new", "~a/y", "~b", "+c", "-d"));
+}
+
+// Building from an earlier tree should give the same digests as building from scratch, whether
+// files have changed or not.
+TEST_F(MerkleTest, Previous) {
+    TemporaryDirectory dir("merkle-test");
+    const pn::string   tree = make_tree(dir);
+    const merkle_tree  first(tree);
+
+    merkle_options options;
+    options.previous = &first;
+    const merkle_tree second(tree, options);
+    EXPECT_THAT(second.root().digest, Eq(first.root().digest));
+
+    write_file(pn::format("{0}/a/x", tree), "EX");
+    options.previous = &second;
+    const merkle_tree third(tree, options);
+    EXPECT_THAT(third.root().digest, Eq(merkle_tree(tree).root().digest));
+    EXPECT_THAT(third.root().digest, Ne(first.root().digest));
+}
+
+}  // namespace
+}  // namespace sfz
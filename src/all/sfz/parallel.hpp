@@ -0,0 +1,219 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_PARALLEL_HPP_
+#define SFZ_PARALLEL_HPP_
+
+#include <stddef.h>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sfz {
+
+// Returns `threads` if positive, or else the number of hardware threads, which is at least 1.
+inline int thread_count(int threads) {
+    if (threads > 0) {
+        return threads;
+    }
+    const unsigned int n = std::thread::hardware_concurrency();
+    return (n > 0) ? n : 1;
+}
+
+// Computes `produce(i)` for each `i` in [0, count) on a pool of `threads` workers, and passes
+// each result to `consume(i, result)` on the calling thread, in order of `i`.  At most `window`
+// results are computed or waiting to be consumed at any time, which bounds the resources held
+// by results.  With a single thread, everything runs on the calling thread.
+//
+// If `produce` or `consume` throws, the workers stop taking new items, calls already running are
+// allowed to finish, the workers are joined, and the first exception in order of `i` is rethrown.
+//
+// @param [in] count    The number of items.
+// @param [in] threads  The number of workers.  Must be positive; see thread_count().
+// @param [in] window   The maximum number of results in flight.  Must be positive.
+// @param [in] produce  Callable as T(size_t).  Called concurrently from the workers.
+// @param [in] consume  Callable as void(size_t, T&).
+template <typename T, typename Produce, typename Consume>
+void ordered_map(size_t count, int threads, size_t window, Produce produce, Consume consume) {
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            T result = produce(i);
+            consume(i, result);
+        }
+        return;
+    }
+
+    struct slot {
+        bool               ready = false;
+        T                  result;
+        std::exception_ptr error;
+    };
+    std::vector<slot>       slots(count);
+    std::mutex              mu;
+    std::condition_variable cv;
+    size_t                  next     = 0;
+    size_t                  consumed = 0;
+    bool                    stop     = false;
+
+    auto work = [&]() {
+        std::unique_lock<std::mutex> lock(mu);
+        while (true) {
+            cv.wait(lock, [&] { return stop || (next == count) || (next < consumed + window); });
+            if (stop || (next == count)) {
+                return;
+            }
+            const size_t i = next++;
+            lock.unlock();
+            T                  result{};
+            std::exception_ptr error;
+            try {
+                result = produce(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+            slots[i].result = std::move(result);
+            slots[i].error  = error;
+            slots[i].ready  = true;
+            if (error) {
+                stop = true;
+            }
+            cv.notify_all();
+        }
+    };
+
+    // Joins the workers on the way out, including when unwinding.
+    struct joiner {
+        std::vector<std::thread> workers;
+        std::mutex&              mu;
+        std::condition_variable& cv;
+        bool&                    stop;
+        ~joiner() {
+            {
+                std::lock_guard<std::mutex> lock(mu);
+                stop = true;
+            }
+            cv.notify_all();
+            for (std::thread& t : workers) {
+                t.join();
+            }
+        }
+    } pool{{}, mu, cv, stop};
+    const size_t n = (static_cast<size_t>(threads) < count) ? threads : count;
+    for (size_t i = 0; i < n; ++i) {
+        pool.workers.emplace_back(work);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        slot& s = slots[i];
+        {
+            std::unique_lock<std::mutex> lock(mu);
+            cv.wait(lock, [&] { return s.ready; });
+        }
+        if (s.error) {
+            std::rethrow_exception(s.error);
+        }
+        consume(i, s.result);
+        s.result = T();
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            ++consumed;
+        }
+        cv.notify_all();
+    }
+}
+
+// Overlaps producing data with consuming it: calls `fill(buffer)` repeatedly on a separate thread,
+// and `drain(buffer)` on the calling thread for each buffer filled, in order.  The buffers are
+// used in rotation, so the reader can be up to `buffers.size()` buffers ahead.  Stops once
+// `fill` returns false, after draining everything filled before.
+//
+// If `fill` throws, the exception is rethrown after draining the buffers filled before.  If
+// `drain` throws, the reader is stopped and joined, and the exception propagates.
+//
+// @param [in] buffers  The buffers to rotate through.  Must not be empty.
+// @param [in] fill     Callable as bool(Buffer&).  Returns false, leaving the buffer unused,
+//                      when there is nothing more to fill.
+// @param [in] drain    Callable as void(Buffer&).
+template <typename Buffer, typename Fill, typename Drain>
+void pipeline(std::vector<Buffer>& buffers, Fill fill, Drain drain) {
+    const size_t            count = buffers.size();
+    std::mutex              mu;
+    std::condition_variable cv;
+    size_t                  filled  = 0;
+    size_t                  drained = 0;
+    bool                    done    = false;
+    bool                    stop    = false;
+    std::exception_ptr      error;
+
+    auto read = [&]() {
+        std::unique_lock<std::mutex> lock(mu);
+        while (true) {
+            cv.wait(lock, [&] { return stop || (filled < drained + count); });
+            if (stop) {
+                return;
+            }
+            Buffer& buffer = buffers[filled % count];
+            lock.unlock();
+            bool more = false;
+            try {
+                more = fill(buffer);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+            if (more) {
+                ++filled;
+            } else {
+                done = true;
+            }
+            cv.notify_all();
+            if (done) {
+                return;
+            }
+        }
+    };
+
+    // Joins the reader on the way out, including when unwinding.
+    struct joiner {
+        std::thread              reader;
+        std::mutex&              mu;
+        std::condition_variable& cv;
+        bool&                    stop;
+        ~joiner() {
+            {
+                std::lock_guard<std::mutex> lock(mu);
+                stop = true;
+            }
+            cv.notify_all();
+            reader.join();
+        }
+    } reader{std::thread(read), mu, cv, stop};
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mu);
+            cv.wait(lock, [&] { return done || (drained < filled); });
+            if (drained == filled) {
+                break;
+            }
+        }
+        drain(buffers[drained % count]);
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            ++drained;
+        }
+        cv.notify_all();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+}  // namespace sfz
+
+#endif  // SFZ_PARALLEL_HPP_
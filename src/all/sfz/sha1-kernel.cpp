@@ -0,0 +1,683 @@
+// Copyright (c) 2010-2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <sfz/sha1-kernel.hpp>
+
+#include <sfz/cpu.hpp>
+
+#ifdef SFZ_X86
+#include <immintrin.h>
+#endif
+
+namespace sfz {
+
+namespace {
+
+const uint32_t kRoundConstants[] = {
+        0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6,
+};
+
+// Does a circular rotation of `word`, shifting it `bits` bits to the left, and moving the bits
+// that were shifted out to the right end of the word.
+inline uint32_t left_rotate(uint32_t word, int bits) {
+    return ((word << bits) | (word >> (32 - bits)));
+}
+
+inline uint32_t load_be32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+// Does the permutation of values for a round of SHA-1.
+inline void permute(
+        uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d, uint32_t* e, uint32_t next) {
+    *e = *d;
+    *d = *c;
+    *c = left_rotate(*b, 30);
+    *b = *a;
+    *a = left_rotate(*a, 5) + next;
+}
+
+// Runs the 80 rounds of SHA-1 on `state`.  Each word of the message schedule `wk` must already
+// have the round constant added to it.  The SIMD kernels below compute `wk` in vector registers,
+// but the rounds themselves are serially dependent, so they are shared with the portable kernel.
+inline void rounds(uint32_t* state, const uint32_t* wk) {
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+    uint32_t e = state[4];
+
+    for (int i = 0; i < 20; ++i) {
+        permute(&a, &b, &c, &d, &e, ((b & c) | ((~b) & d)) + e + wk[i]);
+    }
+    for (int i = 20; i < 40; ++i) {
+        permute(&a, &b, &c, &d, &e, (b ^ c ^ d) + e + wk[i]);
+    }
+    for (int i = 40; i < 60; ++i) {
+        permute(&a, &b, &c, &d, &e, ((b & c) | (b & d) | (c & d)) + e + wk[i]);
+    }
+    for (int i = 60; i < 80; ++i) {
+        permute(&a, &b, &c, &d, &e, (b ^ c ^ d) + e + wk[i]);
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+// Based on the code provided by RFC 3174.
+void portable_blocks(uint32_t* state, const uint8_t* blocks, size_t count) {
+    for (; count > 0; --count, blocks += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = load_be32(blocks + (4 * i));
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = left_rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        for (int i = 0; i < 80; ++i) {
+            w[i] += kRoundConstants[i / 20];
+        }
+        rounds(state, w);
+    }
+}
+
+bool portable_supported() { return true; }
+
+#ifdef SFZ_X86
+
+// The SSSE3 and AVX2 kernels compute the message schedule four words at a time.  The recurrence
+// w[i] = rol(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1) means the last word of each group of four
+// depends on the first, so the first 16 computed words (groups 4-7) are computed with w[i-3]
+// zeroed in the last lane and then patched.  From w[32] on, the equivalent recurrence
+// w[i] = rol(w[i-6] ^ w[i-16] ^ w[i-28] ^ w[i-32], 2) has no dependencies within a group.
+
+template <int bits>
+SFZ_TARGET("sse2") inline __m128i rotl_epi32(__m128i x) {
+    return _mm_or_si128(_mm_slli_epi32(x, bits), _mm_srli_epi32(x, 32 - bits));
+}
+
+SFZ_TARGET("ssse3") void ssse3_schedule(const uint8_t* block, uint32_t* wk) {
+    const __m128i swap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    __m128i       w[20];
+    for (int i = 0; i < 4; ++i) {
+        w[i] = _mm_shuffle_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + (16 * i))), swap);
+    }
+    for (int i = 4; i < 8; ++i) {
+        __m128i x = _mm_xor_si128(
+                _mm_xor_si128(w[i - 4], _mm_alignr_epi8(w[i - 3], w[i - 4], 8)),
+                _mm_xor_si128(w[i - 2], _mm_srli_si128(w[i - 1], 4)));
+        x    = rotl_epi32<1>(x);
+        w[i] = _mm_xor_si128(x, rotl_epi32<1>(_mm_slli_si128(x, 12)));
+    }
+    for (int i = 8; i < 20; ++i) {
+        __m128i x = _mm_xor_si128(
+                _mm_xor_si128(_mm_alignr_epi8(w[i - 1], w[i - 2], 8), w[i - 4]),
+                _mm_xor_si128(w[i - 7], w[i - 8]));
+        w[i] = rotl_epi32<2>(x);
+    }
+    for (int i = 0; i < 20; ++i) {
+        const __m128i k = _mm_set1_epi32(kRoundConstants[i / 5]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(wk + (4 * i)), _mm_add_epi32(w[i], k));
+    }
+}
+
+SFZ_TARGET("ssse3") void ssse3_blocks(uint32_t* state, const uint8_t* blocks, size_t count) {
+    for (; count > 0; --count, blocks += 64) {
+        uint32_t wk[80];
+        ssse3_schedule(blocks, wk);
+        rounds(state, wk);
+    }
+}
+
+bool ssse3_supported() { return cpu().ssse3; }
+
+template <int bits>
+SFZ_TARGET("avx2") inline __m256i rotl_epi32(__m256i x) {
+    return _mm256_or_si256(_mm256_slli_epi32(x, bits), _mm256_srli_epi32(x, 32 - bits));
+}
+
+SFZ_TARGET("avx2") inline __m256i load_pair(const uint8_t* lo, const uint8_t* hi) {
+    return _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lo))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi)), 1);
+}
+
+// Computes the message schedules of two blocks at once: one in each 128-bit lane.  The
+// recurrence is the same as in ssse3_schedule(); AVX2 byte shifts and alignments operate
+// within lanes, so the code is a direct translation.
+SFZ_TARGET("avx2") void avx2_schedule(const uint8_t* block, uint32_t* wk0, uint32_t* wk1) {
+    const __m256i swap = _mm256_set_epi8(
+            12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3, 12, 13, 14, 15, 8, 9, 10, 11,
+            4, 5, 6, 7, 0, 1, 2, 3);
+    __m256i w[20];
+    for (int i = 0; i < 4; ++i) {
+        w[i] = _mm256_shuffle_epi8(load_pair(block + (16 * i), block + 64 + (16 * i)), swap);
+    }
+    for (int i = 4; i < 8; ++i) {
+        __m256i x = _mm256_xor_si256(
+                _mm256_xor_si256(w[i - 4], _mm256_alignr_epi8(w[i - 3], w[i - 4], 8)),
+                _mm256_xor_si256(w[i - 2], _mm256_srli_si256(w[i - 1], 4)));
+        x    = rotl_epi32<1>(x);
+        w[i] = _mm256_xor_si256(x, rotl_epi32<1>(_mm256_slli_si256(x, 12)));
+    }
+    for (int i = 8; i < 20; ++i) {
+        __m256i x = _mm256_xor_si256(
+                _mm256_xor_si256(_mm256_alignr_epi8(w[i - 1], w[i - 2], 8), w[i - 4]),
+                _mm256_xor_si256(w[i - 7], w[i - 8]));
+        w[i] = rotl_epi32<2>(x);
+    }
+    for (int i = 0; i < 20; ++i) {
+        const __m256i x = _mm256_add_epi32(w[i], _mm256_set1_epi32(kRoundConstants[i / 5]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(wk0 + (4 * i)), _mm256_castsi256_si128(x));
+        _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(wk1 + (4 * i)), _mm256_extracti128_si256(x, 1));
+    }
+}
+
+SFZ_TARGET("avx2") void avx2_blocks(uint32_t* state, const uint8_t* blocks, size_t count) {
+    for (; count >= 2; count -= 2, blocks += 128) {
+        uint32_t wk[2][80];
+        avx2_schedule(blocks, wk[0], wk[1]);
+        rounds(state, wk[0]);
+        rounds(state, wk[1]);
+    }
+    if (count > 0) {
+        uint32_t wk[80];
+        ssse3_schedule(blocks, wk);
+        rounds(state, wk);
+    }
+}
+
+bool avx2_supported() { return cpu().avx2; }
+
+SFZ_TARGET("ssse3") inline __m128i load_be(const uint8_t* p) {
+    const __m128i swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), swap);
+}
+
+// Uses the SHA extensions.  SHA1RNDS4 performs four rounds, taking A, B, C, and D in one
+// register (A in the highest lane), and the sum of E and four schedule words in another.
+// SHA1NEXTE derives the next E from the previous A and adds the next four schedule words;
+// SHA1MSG1 and SHA1MSG2 compute the schedule four words at a time.
+SFZ_TARGET("sha,sse4.1,ssse3")
+void shani_blocks(uint32_t* state, const uint8_t* blocks, size_t count) {
+    __m128i abcd = _mm_shuffle_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1b);
+    __m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+    __m128i e1, msg0, msg1, msg2, msg3;
+
+    for (; count > 0; --count, blocks += 64) {
+        const __m128i abcd_save = abcd;
+        const __m128i e0_save   = e0;
+
+        // Rounds 0-3.
+        msg0 = load_be(blocks + 0);
+        e0   = _mm_add_epi32(e0, msg0);
+        e1   = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        // Rounds 4-7.
+        msg1 = load_be(blocks + 16);
+        e1   = _mm_sha1nexte_epu32(e1, msg1);
+        e0   = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+        // Rounds 8-11.
+        msg2 = load_be(blocks + 32);
+        e0   = _mm_sha1nexte_epu32(e0, msg2);
+        e1   = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        // Rounds 12-15.
+        msg3 = load_be(blocks + 48);
+        e1   = _mm_sha1nexte_epu32(e1, msg3);
+        e0   = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        // Rounds 16-19.
+        e0   = _mm_sha1nexte_epu32(e0, msg0);
+        e1   = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        // Rounds 20-23.
+        e1   = _mm_sha1nexte_epu32(e1, msg1);
+        e0   = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        // Rounds 24-27.
+        e0   = _mm_sha1nexte_epu32(e0, msg2);
+        e1   = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        // Rounds 28-31.
+        e1   = _mm_sha1nexte_epu32(e1, msg3);
+        e0   = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        // Rounds 32-35.
+        e0   = _mm_sha1nexte_epu32(e0, msg0);
+        e1   = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        // Rounds 36-39.
+        e1   = _mm_sha1nexte_epu32(e1, msg1);
+        e0   = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        // Rounds 40-43.
+        e0   = _mm_sha1nexte_epu32(e0, msg2);
+        e1   = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        // Rounds 44-47.
+        e1   = _mm_sha1nexte_epu32(e1, msg3);
+        e0   = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        // Rounds 48-51.
+        e0   = _mm_sha1nexte_epu32(e0, msg0);
+        e1   = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        // Rounds 52-55.
+        e1   = _mm_sha1nexte_epu32(e1, msg1);
+        e0   = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        // Rounds 56-59.
+        e0   = _mm_sha1nexte_epu32(e0, msg2);
+        e1   = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        // Rounds 60-63.
+        e1   = _mm_sha1nexte_epu32(e1, msg3);
+        e0   = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        // Rounds 64-67.
+        e0   = _mm_sha1nexte_epu32(e0, msg0);
+        e1   = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        // Rounds 68-71.
+        e1   = _mm_sha1nexte_epu32(e1, msg1);
+        e0   = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        // Rounds 72-75.
+        e0   = _mm_sha1nexte_epu32(e0, msg2);
+        e1   = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+        // Rounds 76-79.
+        e1   = _mm_sha1nexte_epu32(e1, msg3);
+        e0   = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        e0   = _mm_sha1nexte_epu32(e0, e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1b));
+    state[4] = _mm_extract_epi32(e0, 3);
+}
+
+bool shani_supported() { return cpu().sha && cpu().sse41 && cpu().ssse3; }
+
+// The multi-buffer kernels hash one stream per 32-bit lane, following the RFC 3174 algorithm
+// with each word widened to a vector.  Each lane's block is first copied to `words`, which are
+// then transposed so that w[t] holds word `t` of every lane's block.  A null block pointer marks
+// an idle lane, which is fed zeros and whose result is ignored by the caller.
+//
+// The rounds are unrolled five at a time, which brings the variables back into their original
+// roles without copying them.  The round functions are identified by `f`: 0 for Ch, 1 for
+// Parity, and 2 for Maj.
+
+SFZ_TARGET("ssse3")
+inline void ssse3_multi_transpose(const uint8_t* const* blocks, size_t block, __m128i* w) {
+    const __m128i swap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    __m128i       rows[4][4];
+    for (int lane = 0; lane < 4; ++lane) {
+        for (int i = 0; i < 4; ++i) {
+            rows[lane][i] = blocks[lane] ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                                                   blocks[lane] + (64 * block) + (16 * i)))
+                                         : _mm_setzero_si128();
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        const __m128i t0 = _mm_unpacklo_epi32(rows[0][i], rows[1][i]);
+        const __m128i t1 = _mm_unpacklo_epi32(rows[2][i], rows[3][i]);
+        const __m128i t2 = _mm_unpackhi_epi32(rows[0][i], rows[1][i]);
+        const __m128i t3 = _mm_unpackhi_epi32(rows[2][i], rows[3][i]);
+        w[(4 * i) + 0]   = _mm_shuffle_epi8(_mm_unpacklo_epi64(t0, t1), swap);
+        w[(4 * i) + 1]   = _mm_shuffle_epi8(_mm_unpackhi_epi64(t0, t1), swap);
+        w[(4 * i) + 2]   = _mm_shuffle_epi8(_mm_unpacklo_epi64(t2, t3), swap);
+        w[(4 * i) + 3]   = _mm_shuffle_epi8(_mm_unpackhi_epi64(t2, t3), swap);
+    }
+}
+
+template <int f>
+SFZ_TARGET("ssse3")
+inline void ssse3_round(__m128i a, __m128i& b, __m128i c, __m128i d, __m128i& e, __m128i wk) {
+    __m128i x;
+    if (f == 0) {
+        x = _mm_or_si128(_mm_and_si128(b, c), _mm_andnot_si128(b, d));
+    } else if (f == 1) {
+        x = _mm_xor_si128(_mm_xor_si128(b, c), d);
+    } else {
+        x = _mm_or_si128(_mm_and_si128(b, c), _mm_and_si128(d, _mm_or_si128(b, c)));
+    }
+    e = _mm_add_epi32(_mm_add_epi32(e, wk), _mm_add_epi32(rotl_epi32<5>(a), x));
+    b = rotl_epi32<30>(b);
+}
+
+template <int f>
+SFZ_TARGET("ssse3")
+inline void ssse3_rounds(__m128i* s, const __m128i* w, int first, uint32_t k) {
+    const __m128i kk = _mm_set1_epi32(k);
+    for (int i = first; i < first + 20; i += 5) {
+        ssse3_round<f>(s[0], s[1], s[2], s[3], s[4], _mm_add_epi32(w[i + 0], kk));
+        ssse3_round<f>(s[4], s[0], s[1], s[2], s[3], _mm_add_epi32(w[i + 1], kk));
+        ssse3_round<f>(s[3], s[4], s[0], s[1], s[2], _mm_add_epi32(w[i + 2], kk));
+        ssse3_round<f>(s[2], s[3], s[4], s[0], s[1], _mm_add_epi32(w[i + 3], kk));
+        ssse3_round<f>(s[1], s[2], s[3], s[4], s[0], _mm_add_epi32(w[i + 4], kk));
+    }
+}
+
+SFZ_TARGET("ssse3")
+void ssse3_multi_blocks(uint32_t* state, const uint8_t* const* blocks, size_t count) {
+    __m128i s[5];
+    for (int i = 0; i < 5; ++i) {
+        s[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + (4 * i)));
+    }
+    for (size_t block = 0; block < count; ++block) {
+        __m128i w[80];
+        ssse3_multi_transpose(blocks, block, w);
+        for (int t = 16; t < 80; ++t) {
+            w[t] = rotl_epi32<1>(_mm_xor_si128(
+                    _mm_xor_si128(w[t - 3], w[t - 8]), _mm_xor_si128(w[t - 14], w[t - 16])));
+        }
+
+        __m128i x[5] = {s[0], s[1], s[2], s[3], s[4]};
+        ssse3_rounds<0>(x, w, 0, kRoundConstants[0]);
+        ssse3_rounds<1>(x, w, 20, kRoundConstants[1]);
+        ssse3_rounds<2>(x, w, 40, kRoundConstants[2]);
+        ssse3_rounds<1>(x, w, 60, kRoundConstants[3]);
+        for (int i = 0; i < 5; ++i) {
+            s[i] = _mm_add_epi32(s[i], x[i]);
+        }
+    }
+    for (int i = 0; i < 5; ++i) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state + (4 * i)), s[i]);
+    }
+}
+
+// With AVX2 and AVX-512, the transposition gathers each word from the copied blocks.
+SFZ_TARGET("avx2")
+inline void avx2_multi_transpose(const uint8_t* const* blocks, size_t block, __m256i* w) {
+    const __m256i swap = _mm256_set_epi8(
+            12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3, 12, 13, 14, 15, 8, 9, 10, 11,
+            4, 5, 6, 7, 0, 1, 2, 3);
+    const __m256i index = _mm256_set_epi32(112, 96, 80, 64, 48, 32, 16, 0);
+    uint32_t      words[8][16];
+    for (int lane = 0; lane < 8; ++lane) {
+        __m256i* out = reinterpret_cast<__m256i*>(words[lane]);
+        if (blocks[lane]) {
+            const __m256i* in =
+                    reinterpret_cast<const __m256i*>(blocks[lane] + (64 * block));
+            _mm256_storeu_si256(out, _mm256_loadu_si256(in));
+            _mm256_storeu_si256(out + 1, _mm256_loadu_si256(in + 1));
+        } else {
+            _mm256_storeu_si256(out, _mm256_setzero_si256());
+            _mm256_storeu_si256(out + 1, _mm256_setzero_si256());
+        }
+    }
+    for (int t = 0; t < 16; ++t) {
+        const int* base = reinterpret_cast<const int*>(&words[0][t]);
+        w[t]            = _mm256_shuffle_epi8(_mm256_i32gather_epi32(base, index, 4), swap);
+    }
+}
+
+template <int f>
+SFZ_TARGET("avx2")
+inline void avx2_round(__m256i a, __m256i& b, __m256i c, __m256i d, __m256i& e, __m256i wk) {
+    __m256i x;
+    if (f == 0) {
+        x = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_andnot_si256(b, d));
+    } else if (f == 1) {
+        x = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+    } else {
+        x = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)));
+    }
+    e = _mm256_add_epi32(_mm256_add_epi32(e, wk), _mm256_add_epi32(rotl_epi32<5>(a), x));
+    b = rotl_epi32<30>(b);
+}
+
+template <int f>
+SFZ_TARGET("avx2")
+inline void avx2_rounds(__m256i* s, const __m256i* w, int first, uint32_t k) {
+    const __m256i kk = _mm256_set1_epi32(k);
+    for (int i = first; i < first + 20; i += 5) {
+        avx2_round<f>(s[0], s[1], s[2], s[3], s[4], _mm256_add_epi32(w[i + 0], kk));
+        avx2_round<f>(s[4], s[0], s[1], s[2], s[3], _mm256_add_epi32(w[i + 1], kk));
+        avx2_round<f>(s[3], s[4], s[0], s[1], s[2], _mm256_add_epi32(w[i + 2], kk));
+        avx2_round<f>(s[2], s[3], s[4], s[0], s[1], _mm256_add_epi32(w[i + 3], kk));
+        avx2_round<f>(s[1], s[2], s[3], s[4], s[0], _mm256_add_epi32(w[i + 4], kk));
+    }
+}
+
+SFZ_TARGET("avx2")
+void avx2_multi_blocks(uint32_t* state, const uint8_t* const* blocks, size_t count) {
+    __m256i s[5];
+    for (int i = 0; i < 5; ++i) {
+        s[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state + (8 * i)));
+    }
+    for (size_t block = 0; block < count; ++block) {
+        __m256i w[80];
+        avx2_multi_transpose(blocks, block, w);
+        for (int t = 16; t < 80; ++t) {
+            w[t] = rotl_epi32<1>(_mm256_xor_si256(
+                    _mm256_xor_si256(w[t - 3], w[t - 8]),
+                    _mm256_xor_si256(w[t - 14], w[t - 16])));
+        }
+
+        __m256i x[5] = {s[0], s[1], s[2], s[3], s[4]};
+        avx2_rounds<0>(x, w, 0, kRoundConstants[0]);
+        avx2_rounds<1>(x, w, 20, kRoundConstants[1]);
+        avx2_rounds<2>(x, w, 40, kRoundConstants[2]);
+        avx2_rounds<1>(x, w, 60, kRoundConstants[3]);
+        for (int i = 0; i < 5; ++i) {
+            s[i] = _mm256_add_epi32(s[i], x[i]);
+        }
+    }
+    for (int i = 0; i < 5; ++i) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(state + (8 * i)), s[i]);
+    }
+}
+
+// Uses the zero-masking form of VPROLD; the unmasked intrinsic trips -Wmaybe-uninitialized in
+// some versions of GCC.
+template <int bits>
+SFZ_TARGET("avx512f") inline __m512i rotl_epi32(__m512i x) {
+    return _mm512_maskz_rol_epi32(0xffff, x, bits);
+}
+
+SFZ_TARGET("avx512f,avx512bw")
+inline void avx512_multi_transpose(const uint8_t* const* blocks, size_t block, __m512i* w) {
+    const __m512i swap  = _mm512_set4_epi32(0x0c0d0e0f, 0x08090a0b, 0x04050607, 0x00010203);
+    const __m512i index = _mm512_set_epi32(
+            240, 224, 208, 192, 176, 160, 144, 128, 112, 96, 80, 64, 48, 32, 16, 0);
+    uint32_t words[16][16];
+    for (int lane = 0; lane < 16; ++lane) {
+        _mm512_storeu_si512(
+                words[lane], blocks[lane] ? _mm512_loadu_si512(blocks[lane] + (64 * block))
+                                          : _mm512_setzero_si512());
+    }
+    for (int t = 0; t < 16; ++t) {
+        w[t] = _mm512_shuffle_epi8(
+                _mm512_mask_i32gather_epi32(
+                        _mm512_setzero_si512(), 0xffff, index, &words[0][t], 4),
+                swap);
+    }
+}
+
+// VPTERNLOGD computes each round function in one instruction: 0xca is b ? c : d, 0x96 is
+// b ^ c ^ d, and 0xe8 is the majority of b, c, and d.
+template <int f>
+SFZ_TARGET("avx512f")
+inline void avx512_round(__m512i a, __m512i& b, __m512i c, __m512i d, __m512i& e, __m512i wk) {
+    const __m512i x = _mm512_ternarylogic_epi32(b, c, d, (f == 0) ? 0xca : (f == 1) ? 0x96 : 0xe8);
+    e = _mm512_add_epi32(_mm512_add_epi32(e, wk), _mm512_add_epi32(rotl_epi32<5>(a), x));
+    b = rotl_epi32<30>(b);
+}
+
+template <int f>
+SFZ_TARGET("avx512f")
+inline void avx512_rounds(__m512i* s, const __m512i* w, int first, uint32_t k) {
+    const __m512i kk = _mm512_set1_epi32(k);
+    for (int i = first; i < first + 20; i += 5) {
+        avx512_round<f>(s[0], s[1], s[2], s[3], s[4], _mm512_add_epi32(w[i + 0], kk));
+        avx512_round<f>(s[4], s[0], s[1], s[2], s[3], _mm512_add_epi32(w[i + 1], kk));
+        avx512_round<f>(s[3], s[4], s[0], s[1], s[2], _mm512_add_epi32(w[i + 2], kk));
+        avx512_round<f>(s[2], s[3], s[4], s[0], s[1], _mm512_add_epi32(w[i + 3], kk));
+        avx512_round<f>(s[1], s[2], s[3], s[4], s[0], _mm512_add_epi32(w[i + 4], kk));
+    }
+}
+
+SFZ_TARGET("avx512f,avx512bw")
+void avx512_multi_blocks(uint32_t* state, const uint8_t* const* blocks, size_t count) {
+    __m512i s[5];
+    for (int i = 0; i < 5; ++i) {
+        s[i] = _mm512_loadu_si512(state + (16 * i));
+    }
+    for (size_t block = 0; block < count; ++block) {
+        __m512i w[80];
+        avx512_multi_transpose(blocks, block, w);
+        for (int t = 16; t < 80; ++t) {
+            w[t] = rotl_epi32<1>(_mm512_ternarylogic_epi32(
+                    _mm512_xor_si512(w[t - 3], w[t - 8]), w[t - 14], w[t - 16], 0x96));
+        }
+
+        __m512i x[5] = {s[0], s[1], s[2], s[3], s[4]};
+        avx512_rounds<0>(x, w, 0, kRoundConstants[0]);
+        avx512_rounds<1>(x, w, 20, kRoundConstants[1]);
+        avx512_rounds<2>(x, w, 40, kRoundConstants[2]);
+        avx512_rounds<1>(x, w, 60, kRoundConstants[3]);
+        for (int i = 0; i < 5; ++i) {
+            s[i] = _mm512_add_epi32(s[i], x[i]);
+        }
+    }
+    for (int i = 0; i < 5; ++i) {
+        _mm512_storeu_si512(state + (16 * i), s[i]);
+    }
+}
+
+bool avx512_supported() { return cpu().avx512f && cpu().avx512bw; }
+
+#endif  // SFZ_X86
+
+const sha1_kernel& select_best_kernel() {
+    for (size_t i = kSha1KernelCount; i > 1; --i) {
+        if (kSha1Kernels[i - 1].supported()) {
+            return kSha1Kernels[i - 1];
+        }
+    }
+    return kSha1Kernels[0];
+}
+
+const sha1_multi_kernel* select_best_multi_kernel() {
+    for (size_t i = kSha1MultiKernelCount; i > 0; --i) {
+        if (kSha1MultiKernels[i - 1].supported()) {
+            return &kSha1MultiKernels[i - 1];
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+const sha1_kernel kSha1Kernels[] = {
+        {"portable", portable_supported, portable_blocks},
+#ifdef SFZ_X86
+        {"ssse3", ssse3_supported, ssse3_blocks},
+        {"avx2", avx2_supported, avx2_blocks},
+        {"sha", shani_supported, shani_blocks},
+#endif
+};
+const size_t kSha1KernelCount = sizeof(kSha1Kernels) / sizeof(kSha1Kernels[0]);
+
+const sha1_kernel& sha1_best_kernel() {
+    static const sha1_kernel& best = select_best_kernel();
+    return best;
+}
+
+const sha1_multi_kernel kSha1MultiKernels[] = {
+#ifdef SFZ_X86
+        {"ssse3", 4, ssse3_supported, ssse3_multi_blocks},
+        {"avx2", 8, avx2_supported, avx2_multi_blocks},
+        {"avx512", 16, avx512_supported, avx512_multi_blocks},
+#endif
+        {nullptr, 0, nullptr, nullptr},
+};
+const size_t kSha1MultiKernelCount = (sizeof(kSha1MultiKernels) / sizeof(kSha1MultiKernels[0])) - 1;
+
+const sha1_multi_kernel* sha1_best_multi_kernel() {
+    static const sha1_multi_kernel* best = select_best_multi_kernel();
+    return best;
+}
+
+}  // namespace sfz
@@ -0,0 +1,57 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_SHA1_KERNEL_HPP_
+#define SFZ_SHA1_KERNEL_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sfz {
+
+// Applies the SHA-1 compression function to `count` consecutive 64-byte blocks starting at
+// `blocks`, updating the five words of `state` in place.
+typedef void (*sha1_blocks_f)(uint32_t* state, const uint8_t* blocks, size_t count);
+
+// An implementation of sha1_blocks_f, along with a check of whether the running CPU can execute
+// it.
+struct sha1_kernel {
+    const char*   name;
+    bool          (*supported)();
+    sha1_blocks_f blocks;
+};
+
+// All implementations compiled into the library, from slowest to fastest.  The first entry is
+// the portable implementation, which is supported everywhere.
+extern const sha1_kernel kSha1Kernels[];
+extern const size_t      kSha1KernelCount;
+
+// Returns the fastest kernel supported by the running CPU.  The choice is made on the first call.
+const sha1_kernel& sha1_best_kernel();
+
+// Applies the SHA-1 compression function to `lanes` independent streams at once, one per SIMD
+// lane.  `state` holds five rows of `lanes` words: state[(word * lanes) + lane].  For each lane,
+// `count` consecutive blocks are read starting from blocks[lane]; a null pointer marks an idle
+// lane, whose state is left in an unspecified condition.
+typedef void (*sha1_multi_blocks_f)(uint32_t* state, const uint8_t* const* blocks, size_t count);
+
+struct sha1_multi_kernel {
+    const char*         name;
+    size_t              lanes;
+    bool                (*supported)();
+    sha1_multi_blocks_f blocks;
+};
+
+// All multi-buffer implementations compiled into the library, from narrowest to widest.  There
+// may be none, on platforms without SIMD kernels.
+extern const sha1_multi_kernel kSha1MultiKernels[];
+extern const size_t            kSha1MultiKernelCount;
+
+// Returns the widest multi-buffer kernel supported by the running CPU, or null if there is none.
+const sha1_multi_kernel* sha1_best_multi_kernel();
+
+}  // namespace sfz
+
+#endif  // SFZ_SHA1_KERNEL_HPP_
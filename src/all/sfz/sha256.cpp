@@ -0,0 +1,253 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#include <sfz/digest.hpp>
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <sfz/cpu.hpp>
+#include <stdexcept>
+
+#ifdef SFZ_X86
+#include <immintrin.h>
+#endif
+
+using std::numeric_limits;
+
+namespace sfz {
+
+namespace {
+
+const sha256::digest kInitialState{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+const uint32_t kRoundConstants[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+        0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+        0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+        0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+        0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+        0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+        0xc67178f2,
+};
+
+inline uint32_t right_rotate(uint32_t word, int bits) {
+    return (word >> bits) | (word << (32 - bits));
+}
+
+inline uint32_t load_be32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+// Follows FIPS 180-4, section 6.2.2.
+void portable_blocks(uint32_t* state, const uint8_t* blocks, size_t count) {
+    for (size_t block = 0; block < count; ++block, blocks += 64) {
+        uint32_t w[64];
+        for (int t = 0; t < 16; ++t) {
+            w[t] = load_be32(blocks + (4 * t));
+        }
+        for (int t = 16; t < 64; ++t) {
+            const uint32_t s0 =
+                    right_rotate(w[t - 15], 7) ^ right_rotate(w[t - 15], 18) ^ (w[t - 15] >> 3);
+            const uint32_t s1 =
+                    right_rotate(w[t - 2], 17) ^ right_rotate(w[t - 2], 19) ^ (w[t - 2] >> 10);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int t = 0; t < 64; ++t) {
+            const uint32_t s1 = right_rotate(e, 6) ^ right_rotate(e, 11) ^ right_rotate(e, 25);
+            const uint32_t ch = (e & f) ^ (~e & g);
+            const uint32_t t1 = h + s1 + ch + kRoundConstants[t] + w[t];
+            const uint32_t s0 = right_rotate(a, 2) ^ right_rotate(a, 13) ^ right_rotate(a, 22);
+            const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            h                  = g;
+            g                  = f;
+            f                  = e;
+            e                  = d + t1;
+            d                  = c;
+            c                  = b;
+            b                  = a;
+            a                  = t1 + s0 + maj;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#ifdef SFZ_X86
+
+// SHA-NI keeps the state in two registers, as ABEF and CDGH.  SHA256RNDS2 performs two rounds
+// using the low two words of its third operand, so each group of four rounds takes two.
+SFZ_TARGET("sha,sse4.1,ssse3")
+void shani_blocks(uint32_t* state, const uint8_t* blocks, size_t count) {
+    const __m128i swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp   = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i*>(state)), 0xb1);
+    __m128i cdgh  = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i*>(state + 4)), 0x1b);
+    __m128i abef  = _mm_alignr_epi8(tmp, cdgh, 8);
+    cdgh          = _mm_blend_epi16(cdgh, tmp, 0xf0);
+
+    for (size_t block = 0; block < count; ++block, blocks += 64) {
+        const __m128i abef_save = abef;
+        const __m128i cdgh_save = cdgh;
+
+        // m[g % 4] holds words 4g through 4g + 3 of the message schedule.
+        __m128i m[4];
+        for (int g = 0; g < 16; ++g) {
+            __m128i& mg = m[g % 4];
+            if (g < 4) {
+                mg = _mm_shuffle_epi8(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + (16 * g))),
+                        swap);
+            } else {
+                const __m128i w7 = _mm_alignr_epi8(m[(g + 3) % 4], m[(g + 2) % 4], 4);
+                mg = _mm_sha256msg2_epu32(
+                        _mm_add_epi32(_mm_sha256msg1_epu32(mg, m[(g + 1) % 4]), w7),
+                        m[(g + 3) % 4]);
+            }
+            __m128i wk = _mm_add_epi32(
+                    mg, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kRoundConstants + (4 * g))));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+            wk   = _mm_shuffle_epi32(wk, 0x0e);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, wk);
+        }
+
+        abef = _mm_add_epi32(abef, abef_save);
+        cdgh = _mm_add_epi32(cdgh, cdgh_save);
+    }
+
+    tmp  = _mm_shuffle_epi32(abef, 0x1b);
+    cdgh = _mm_shuffle_epi32(cdgh, 0xb1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(tmp, cdgh, 0xf0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(cdgh, tmp, 8));
+}
+
+#endif  // SFZ_X86
+
+typedef void (*sha256_blocks_f)(uint32_t* state, const uint8_t* blocks, size_t count);
+
+sha256_blocks_f best_blocks() {
+#ifdef SFZ_X86
+    if (cpu().sha && cpu().sse41 && cpu().ssse3) {
+        return shani_blocks;
+    }
+#endif
+    return portable_blocks;
+}
+
+void compress(uint32_t* state, const uint8_t* blocks, size_t count) {
+    static const sha256_blocks_f blocks_f = best_blocks();
+    blocks_f(state, blocks, count);
+}
+
+}  // namespace
+
+sha256::sha256() { reset(); }
+
+sha256::sha256(const sha256& other) { memcpy(this, &other, sizeof(sha256)); }
+
+void sha256::reset() {
+    _size                = 0;
+    _message_block_index = 0;
+    _intermediate        = kInitialState;
+}
+
+void sha256::write(pn::data_view input) {
+    if (input.empty()) {
+        return;
+    }
+    if (((numeric_limits<uint64_t>::max() - _size) / 8) <
+        static_cast<std::make_unsigned<pn::data_view::size_type>::type>(input.size())) {
+        throw std::runtime_error("message is too long");
+    }
+    _size += 8 * static_cast<uint64_t>(input.size());
+
+    const uint8_t* bytes = input.data();
+    size_t         size  = input.size();
+    if (_message_block_index > 0) {
+        const size_t fill = std::min<size_t>(64 - _message_block_index, size);
+        memcpy(_message_block + _message_block_index, bytes, fill);
+        _message_block_index += fill;
+        bytes += fill;
+        size -= fill;
+        if (_message_block_index < 64) {
+            return;
+        }
+        compress(_intermediate.d, _message_block, 1);
+    }
+    if (size >= 64) {
+        compress(_intermediate.d, bytes, size / 64);
+        bytes += size & ~size_t{63};
+        size &= 63;
+    }
+    memcpy(_message_block, bytes, size);
+    _message_block_index = size;
+}
+
+sha256::digest sha256::compute() const {
+    uint8_t      tail[128];
+    const size_t count = (_message_block_index < 56) ? 1 : 2;
+    memcpy(tail, _message_block, _message_block_index);
+    tail[_message_block_index] = 0x80;
+    memset(tail + _message_block_index + 1, '\0', (64 * count) - _message_block_index - 9);
+    for (int i = 0; i < 8; ++i) {
+        tail[(64 * count) - 8 + i] = _size >> (56 - (8 * i));
+    }
+
+    digest result = _intermediate;
+    compress(result.d, tail, count);
+    return result;
+}
+
+sha256::digest::digest(pn::data_view data) {
+    if (data.size() != 32) {
+        throw std::runtime_error(
+                pn::format("sha256 digest created from data of size {0}", data.size()).c_str());
+    }
+    for (int i = 0; i < 8; ++i) {
+        d[i] = load_be32(data.data() + (4 * i));
+    }
+}
+
+pn::data sha256::digest::data() const {
+    pn::data   out;
+    pn::output f = out.output();
+    for (int i = 0; i < 8; ++i) {
+        f.write(d[i]);
+    }
+    return out;
+}
+
+pn::string sha256::digest::hex() const {
+    char  buf[65];
+    char* ptr = buf;
+    for (int i = 0; i < 8; ++i) {
+        sprintf(ptr, "%08x", d[i]);
+        ptr += 8;
+    }
+    return pn::string_view{buf, 64}.copy();
+}
+
+bool operator==(const sha256::digest& lhs, const sha256::digest& rhs) {
+    return memcmp(lhs.d, rhs.d, sizeof(lhs.d)) == 0;
+}
+
+bool operator!=(const sha256::digest& lhs, const sha256::digest& rhs) { return !(lhs == rhs); }
+
+}  // namespace sfz
@@ -0,0 +1,52 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+#ifndef SFZ_TEST_DATA_HPP_
+#define SFZ_TEST_DATA_HPP_
+
+#include <stdint.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <pn/data>
+#include <pn/output>
+#include <pn/string>
+#include <sfz/os.hpp>
+#include <vector>
+
+namespace sfz {
+
+// Returns `size` pseudo-random bytes, which are the same for each `seed`.  For tests which need
+// data with no structure for chunking, matching, or hashing to exploit.
+inline std::vector<uint8_t> random_bytes(int size, uint32_t seed) {
+    std::vector<uint8_t> bytes(size);
+    uint32_t             x = seed;
+    for (uint8_t& b : bytes) {
+        x = x * 1664525 + 1013904223;
+        b = x >> 24;
+    }
+    return bytes;
+}
+
+inline pn::data random_data(int size, uint32_t seed) {
+    const std::vector<uint8_t> bytes = random_bytes(size, seed);
+    return pn::data_view{bytes.data(), size}.copy();
+}
+
+// Writes `data` to a new file at `path`, creating the directories above it if needed.
+inline void write_file(pn::string_view path, pn::data_view data) {
+    makedirs(path::dirname(path), 0700);
+    pn::output out = pn::output{path, pn::binary};
+    ASSERT_THAT(out.c_obj(), testing::NotNull());
+    ASSERT_THAT(out.write(data), testing::Eq(true));
+}
+
+inline void write_file(pn::string_view path, pn::string_view data) {
+    write_file(path, pn::data_view{reinterpret_cast<const uint8_t*>(data.data()), data.size()});
+}
+
+}  // namespace sfz
+
+#endif  // SFZ_TEST_DATA_HPP_
@@ -0,0 +1,117 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+// Compares updating data with a delta against copying it whole: the bytes transferred (the
+// signature one way and the delta the other, against the new data), and the throughput of each
+// step.  With two paths, measures those files; otherwise, synthetic data with scattered edits.
+//
+//     delta-bench [OLD NEW]
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <pn/output>
+#include <sfz/delta.hpp>
+#include <sfz/file.hpp>
+#include <stdexcept>
+#include <vector>
+
+using sfz::signature;
+
+namespace {
+
+// Old data of `size` pseudo-random bytes, and new data with `edits` small insertions, deletions,
+// and changes spread through it, as might come from an updated data file.
+void make_data(int size, int edits, pn::data* old, pn::data* updated) {
+    std::vector<uint8_t> bytes(size);
+    uint32_t             x    = 1;
+    auto                 next = [&x] {
+        x = x * 1664525 + 1013904223;
+        return x >> 8;
+    };
+    for (uint8_t& b : bytes) {
+        b = next();
+    }
+    *old = pn::data_view{bytes.data(), size}.copy();
+
+    for (int i = 0; i < edits; ++i) {
+        const size_t at = next() % bytes.size();
+        switch (next() % 3) {
+            case 0: bytes.insert(bytes.begin() + at, 16, next()); break;
+            case 1:
+                bytes.erase(bytes.begin() + at, bytes.begin() + std::min(at + 16, bytes.size()));
+                break;
+            case 2: bytes[at] ^= 0xff; break;
+        }
+    }
+    *updated = pn::data_view{bytes.data(), static_cast<int>(bytes.size())}.copy();
+}
+
+template <typename F>
+double seconds(F f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void report(const char* step, double bytes, double secs) {
+    printf("  %-12s %10.1f ms %10.1f MB/s\n", step, 1e3 * secs, bytes / secs / 1e6);
+}
+
+void bench(pn::data_view old, pn::data_view updated) {
+    signature      sig;
+    pn::data       delta, copy, result;
+    const double   sign     = seconds([&] { sig = sfz::make_signature(old); });
+    const pn::data sig_data = sig.data();
+    const double   diff     = seconds([&] { delta = sfz::make_delta(sig, updated); });
+    const double   patch    = seconds([&] {
+        pn::output out = result.output();
+        sfz::apply_delta(old, delta, out);
+    });
+    const double full = seconds([&] { copy = pn::data_view{updated}.copy(); });
+    if ((pn::data_view{result} != updated) || (pn::data_view{copy} != updated)) {
+        throw std::runtime_error("delta produced the wrong data");
+    }
+
+    const double sent = sig_data.size() + delta.size();
+    printf("old %d bytes, new %d bytes, block size %u\n", old.size(), updated.size(),
+           sig.block_size);
+    printf("  full copy    %10d bytes\n", updated.size());
+    printf("  signature    %10d bytes\n", sig_data.size());
+    printf("  delta        %10d bytes\n", delta.size());
+    printf("  total        %10.0f bytes (%.2f%% of a full copy)\n", sent,
+           100.0 * sent / std::max(1, updated.size()));
+    report("signature", old.size(), sign);
+    report("delta", updated.size(), diff);
+    report("apply", updated.size(), patch);
+    report("full copy", updated.size(), full);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        if (argc == 3) {
+            sfz::mapped_file old(argv[1]);
+            sfz::mapped_file updated(argv[2]);
+            bench(old.data(), updated.data());
+        } else if (argc == 1) {
+            for (int edits : {0, 10, 100, 1000}) {
+                pn::data old, updated;
+                make_data(64 << 20, edits, &old, &updated);
+                printf("%d edits: ", edits);
+                bench(old, updated);
+            }
+        } else {
+            fprintf(stderr, "usage: %s [OLD NEW]\n", argv[0]);
+            return 64;
+        }
+    } catch (std::exception& e) {
+        fprintf(stderr, "%s: %s\n", argv[0], e.what());
+        return 1;
+    }
+    return 0;
+}
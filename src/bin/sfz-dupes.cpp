@@ -0,0 +1,115 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+// Lists sets of files with the same content in the given trees, largest first, with a path on
+// each line and a blank line after each set.  Hard links to the same file count as one file;
+// its paths are listed together.
+//
+//     sfz-dupes [-j JOBS] [-m MIN_SIZE] [--summary] PATH...
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <exception>
+#include <pn/string>
+#include <sfz/args.hpp>
+#include <sfz/duplicates.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+const char kUsage[] =
+        "usage: %s [OPTIONS] PATH...\n"
+        "\n"
+        "Lists sets of duplicate files under each PATH.\n"
+        "\n"
+        "options:\n"
+        "  -j, --jobs=N      read N files at once (default: one per CPU)\n"
+        "  -m, --min-size=N  ignore files smaller than N bytes (default: 1)\n"
+        "  -s, --summary     print only the number of duplicates and their size\n"
+        "  -h, --help        show this help\n";
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    sfz::duplicate_options       options;
+    int64_t                      min_size = 1;
+    bool                         summary  = false;
+    std::vector<pn::string_view> roots;
+    try {
+        sfz::args::callbacks callbacks;
+        callbacks.short_option = [&](pn::rune opt, const sfz::args::callbacks::get_value_f& get) {
+            switch (opt.value()) {
+                case 'j': sfz::args::integer_option(get(), &options.threads); return true;
+                case 'm': sfz::args::integer_option(get(), &min_size); return true;
+                case 's': summary = true; return true;
+                case 'h':
+                    printf(kUsage, argv[0]);
+                    exit(0);
+                default: return false;
+            }
+        };
+        callbacks.long_option = [&callbacks](
+                                        pn::string_view                          opt,
+                                        const sfz::args::callbacks::get_value_f& get) {
+            if (opt == "jobs") {
+                return callbacks.short_option(pn::rune{'j'}, get);
+            } else if (opt == "min-size") {
+                return callbacks.short_option(pn::rune{'m'}, get);
+            } else if (opt == "summary") {
+                return callbacks.short_option(pn::rune{'s'}, get);
+            } else if (opt == "help") {
+                return callbacks.short_option(pn::rune{'h'}, get);
+            }
+            return false;
+        };
+        callbacks.argument = [&roots](pn::string_view arg) {
+            roots.push_back(arg);
+            return true;
+        };
+        sfz::args::parse(argc - 1, argv + 1, callbacks);
+        if (options.threads < 0) {
+            throw std::runtime_error("--jobs must not be negative");
+        } else if (min_size < 0) {
+            throw std::runtime_error("--min-size must not be negative");
+        } else if (roots.empty()) {
+            throw std::runtime_error("expected at least one path");
+        }
+        options.min_size = min_size;
+    } catch (std::exception& e) {
+        sfz::args::print_error(argv[0], e);
+        fprintf(stderr, kUsage, argv[0]);
+        return 64;
+    }
+
+    try {
+        const std::vector<sfz::duplicate_group> groups = sfz::find_duplicates(roots, options);
+        uint64_t                                files  = 0;
+        uint64_t                                wasted = 0;
+        for (const sfz::duplicate_group& group : groups) {
+            files += group.files.size() - 1;
+            wasted += group.size * (group.files.size() - 1);
+            if (summary) {
+                continue;
+            }
+            for (const std::vector<pn::string>& paths : group.files) {
+                for (const pn::string& path : paths) {
+                    printf("%s\n", path.c_str());
+                }
+            }
+            printf("\n");
+        }
+        if (summary) {
+            printf("%llu duplicate files in %llu sets, occupying %llu bytes\n",
+                   static_cast<unsigned long long>(files),
+                   static_cast<unsigned long long>(groups.size()),
+                   static_cast<unsigned long long>(wasted));
+        }
+    } catch (std::exception& e) {
+        sfz::args::print_error(argv[0], e);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,318 @@
+// Copyright (c) 2026 The libsfz Authors
+//
+// This file is part of libsfz, a free software project.  You can redistribute it and/or modify it
+// under the terms of the MIT License.
+
+// Prints or checks SHA-1 digests of files, as sha1sum(1) does, but hashes several files at once.
+// Digests are still printed in the order the files were given, as soon as each is ready.
+//
+//     sfz-sum [-j JOBS] [--tree] [PATH...]
+//     sfz-sum [-j JOBS] [--tree] --check [--quiet] [SUMS...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <exception>
+#include <functional>
+#include <pn/string>
+#include <sfz/args.hpp>
+#include <sfz/digest.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+const char kUsage[] =
+        "usage: %s [OPTIONS] [PATH...]\n"
+        "\n"
+        "Prints or checks the SHA-1 digest of each PATH.  With no PATH, or when PATH is -, reads\n"
+        "standard input.\n"
+        "\n"
+        "options:\n"
+        "  -c, --check   read digests from each PATH and check them\n"
+        "  -j, --jobs=N  read N files at once (default: one per CPU)\n"
+        "  -t, --tree    hash directories as trees, rather than failing on them\n"
+        "  -q, --quiet   with --check, don't print OK for each file which matches\n"
+        "  -h, --help    show this help\n";
+
+typedef std::function<void(size_t, const sfz::sha1::digest*, pn::string_view)> done_f;
+
+// Hashes each of `paths` as file_digests() does, except that - is standard input.  Files between
+// each - are hashed at once; standard input is hashed on its own, in order.
+void hash_paths(
+        const std::vector<pn::string_view>& paths, const sfz::file_digests_options& options,
+        const done_f& done) {
+    size_t start = 0;
+    for (size_t i = 0; i <= paths.size(); ++i) {
+        if ((i < paths.size()) && (paths[i] != "-")) {
+            continue;
+        }
+        const std::vector<pn::string_view> batch(paths.begin() + start, paths.begin() + i);
+        sfz::file_digests(
+                batch, options,
+                [&done, start](size_t j, const sfz::sha1::digest* digest, pn::string_view error) {
+                    done(start + j, digest, error);
+                });
+        if (i < paths.size()) {
+            try {
+                const sfz::sha1::digest digest = sfz::file_digest(0);
+                done(i, &digest, "");
+            } catch (std::exception& e) {
+                done(i, nullptr, e.what());
+            }
+        }
+        start = i + 1;
+    }
+}
+
+// Like sha1sum, a name containing a backslash or newline is escaped, and its line is marked by a
+// leading backslash.
+bool needs_escape(pn::string_view name) {
+    for (const char* p = name.data(); p != name.data() + name.size(); ++p) {
+        if ((*p == '\\') || (*p == '\n')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void print_name(pn::string_view name) {
+    for (const char* p = name.data(); p != name.data() + name.size(); ++p) {
+        switch (*p) {
+            case '\\': fputs("\\\\", stdout); break;
+            case '\n': fputs("\\n", stdout); break;
+            default: putchar(*p); break;
+        }
+    }
+}
+
+int print_sums(
+        const char* program, const std::vector<pn::string_view>& paths,
+        const sfz::file_digests_options& options) {
+    int status = 0;
+    hash_paths(
+            paths, options,
+            [program, &paths, &status](
+                    size_t i, const sfz::sha1::digest* digest, pn::string_view error) {
+                if (!digest) {
+                    fflush(stdout);
+                    fprintf(stderr, "%s: %s\n", program, error.copy().c_str());
+                    status = 1;
+                    return;
+                }
+                const bool escape = needs_escape(paths[i]);
+                printf("%s%s  ", escape ? "\\" : "", digest->hex().c_str());
+                if (escape) {
+                    print_name(paths[i]);
+                } else {
+                    fwrite(paths[i].data(), 1, paths[i].size(), stdout);
+                }
+                printf("\n");
+                fflush(stdout);
+            });
+    return status;
+}
+
+bool read_all(pn::string_view path, std::vector<char>* data) {
+    FILE* f = (path == "-") ? stdin : fopen(path.copy().c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    char   buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        data->insert(data->end(), buffer, buffer + n);
+    }
+    const bool ok = !ferror(f);
+    if (f != stdin) {
+        fclose(f);
+    }
+    return ok;
+}
+
+// Parses a line of sha1sum output: "<sha1>  <name>", or "<sha1> *<name>" for a file read in
+// binary mode, with a leading backslash if the name is escaped.
+bool parse_line(pn::string_view line, sfz::sha1::digest* digest, pn::string* name) {
+    const bool escaped = !line.empty() && (line.data()[0] == '\\');
+    if (escaped) {
+        line = line.substr(1);
+    }
+    if ((line.size() < 43) || (line.data()[40] != ' ') ||
+        ((line.data()[41] != ' ') && (line.data()[41] != '*'))) {
+        return false;
+    }
+    if (!sfz::sha1::digest::parse_hex(line.substr(0, 40), digest)) {
+        return false;
+    }
+
+    const pn::string_view rest = line.substr(42);
+    *name                      = pn::string{};
+    for (const char* p = rest.data(); p != rest.data() + rest.size(); ++p) {
+        if (!escaped || (*p != '\\')) {
+            *name += pn::string_view{p, 1};
+        } else if (++p == rest.data() + rest.size()) {
+            return false;
+        } else if (*p == '\\') {
+            *name += pn::string_view{"\\"};
+        } else if (*p == 'n') {
+            *name += pn::string_view{"\n"};
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void print_result(pn::string_view name, const char* result) {
+    if (needs_escape(name)) {
+        putchar('\\');
+        print_name(name);
+    } else {
+        fwrite(name.data(), 1, name.size(), stdout);
+    }
+    printf(": %s\n", result);
+    fflush(stdout);
+}
+
+int check_sums(
+        const char* program, pn::string_view sums, const sfz::file_digests_options& options,
+        bool quiet) {
+    std::vector<char> text;
+    if (!read_all(sums, &text)) {
+        fprintf(stderr, "%s: %s: can't read\n", program, sums.copy().c_str());
+        return 1;
+    }
+
+    std::vector<sfz::sha1::digest> expected;
+    std::vector<pn::string>        names;
+    int                            malformed = 0;
+    for (size_t start = 0; start < text.size();) {
+        size_t end = start;
+        while ((end < text.size()) && (text[end] != '\n')) {
+            ++end;
+        }
+        size_t size = end - start;
+        if ((size > 0) && (text[end - 1] == '\r')) {
+            --size;
+        }
+        const pn::string_view line{text.data() + start, static_cast<int>(size)};
+        start = end + 1;
+
+        sfz::sha1::digest digest;
+        pn::string        name;
+        if (parse_line(line, &digest, &name)) {
+            expected.push_back(digest);
+            names.push_back(std::move(name));
+        } else if (!line.empty()) {
+            ++malformed;
+        }
+    }
+    if (expected.empty()) {
+        fprintf(stderr, "%s: %s: no properly formatted SHA1 checksum lines found\n", program,
+                sums.copy().c_str());
+        return 1;
+    }
+
+    int                                unreadable = 0;
+    int                                mismatched = 0;
+    const std::vector<pn::string_view> paths(names.begin(), names.end());
+    hash_paths(
+            paths, options,
+            [&](size_t i, const sfz::sha1::digest* digest, pn::string_view error) {
+                if (!digest) {
+                    fflush(stdout);
+                    fprintf(stderr, "%s: %s\n", program, error.copy().c_str());
+                    print_result(paths[i], "FAILED open or read");
+                    ++unreadable;
+                } else if (*digest != expected[i]) {
+                    print_result(paths[i], "FAILED");
+                    ++mismatched;
+                } else if (!quiet) {
+                    print_result(paths[i], "OK");
+                }
+            });
+
+    if (malformed) {
+        fprintf(stderr, "%s: WARNING: %d line%s improperly formatted\n", program, malformed,
+                (malformed == 1) ? " is" : "s are");
+    }
+    if (unreadable) {
+        fprintf(stderr, "%s: WARNING: %d listed file%s could not be read\n", program, unreadable,
+                (unreadable == 1) ? "" : "s");
+    }
+    if (mismatched) {
+        fprintf(stderr, "%s: WARNING: %d computed checksum%s did NOT match\n", program,
+                mismatched, (mismatched == 1) ? "" : "s");
+    }
+    return (unreadable || mismatched) ? 1 : 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    sfz::file_digests_options    options;
+    bool                         check = false;
+    bool                         quiet = false;
+    std::vector<pn::string_view> paths;
+    try {
+        sfz::args::callbacks callbacks;
+        callbacks.short_option = [&](pn::rune opt, const sfz::args::callbacks::get_value_f& get) {
+            switch (opt.value()) {
+                case 'c': check = true; return true;
+                case 'j': sfz::args::integer_option(get(), &options.threads); return true;
+                case 't': options.trees = true; return true;
+                case 'q': quiet = true; return true;
+                case 'h':
+                    printf(kUsage, argv[0]);
+                    exit(0);
+                default: return false;
+            }
+        };
+        callbacks.long_option = [&callbacks](
+                                        pn::string_view                          opt,
+                                        const sfz::args::callbacks::get_value_f& get) {
+            if (opt == "check") {
+                return callbacks.short_option(pn::rune{'c'}, get);
+            } else if (opt == "jobs") {
+                return callbacks.short_option(pn::rune{'j'}, get);
+            } else if (opt == "tree") {
+                return callbacks.short_option(pn::rune{'t'}, get);
+            } else if (opt == "quiet") {
+                return callbacks.short_option(pn::rune{'q'}, get);
+            } else if (opt == "help") {
+                return callbacks.short_option(pn::rune{'h'}, get);
+            }
+            return false;
+        };
+        callbacks.argument = [&paths](pn::string_view arg) {
+            paths.push_back(arg);
+            return true;
+        };
+        sfz::args::parse(argc - 1, argv + 1, callbacks);
+        if (options.threads < 0) {
+            throw std::runtime_error("--jobs must not be negative");
+        } else if (quiet && !check) {
+            throw std::runtime_error("--quiet is only meaningful with --check");
+        }
+        if (paths.empty()) {
+            paths.push_back("-");
+        }
+    } catch (std::exception& e) {
+        sfz::args::print_error(argv[0], e);
+        fprintf(stderr, kUsage, argv[0]);
+        return 64;
+    }
+
+    try {
+        if (!check) {
+            return print_sums(argv[0], paths, options);
+        }
+        int status = 0;
+        for (pn::string_view sums : paths) {
+            status |= check_sums(argv[0], sums, options, quiet);
+        }
+        return status;
+    } catch (std::exception& e) {
+        sfz::args::print_error(argv[0], e);
+        return 1;
+    }
+}
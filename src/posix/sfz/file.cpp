@@ -7,14 +7,22 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
+#include <sys/file.h>
 #include <sys/mman.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <pn/output>
 #include <sfz/error.hpp>
 #include <stdexcept>
 
+#ifdef __linux__
+#include <linux/if_alg.h>
+#include <sys/socket.h>
+#endif
+
 namespace sfz {
 
 mapped_file::mapped_file(pn::string_view path) : _path(path.copy()), _fd(_path) {
@@ -25,14 +33,26 @@ mapped_file::mapped_file(pn::string_view path) : _path(path.copy()), _fd(_path)
     if (S_ISDIR(st.st_mode)) {
         throw std::runtime_error(pn::format("{0}: {1}", path, posix_strerror(EISDIR)).c_str());
     }
+    if (st.st_size > INT_MAX) {
+        throw std::runtime_error(pn::format("{0}: {1}", path, posix_strerror(EFBIG)).c_str());
+    }
     _size = st.st_size;
+    if (_size == 0) {
+        // mmap(2) rejects empty mappings, but there's nothing to map anyway.
+        _data = nullptr;
+        return;
+    }
     _data = reinterpret_cast<uint8_t*>(mmap(NULL, _size, PROT_READ, MAP_PRIVATE, _fd.no, 0));
     if (_data == MAP_FAILED) {
         throw std::runtime_error(pn::format("{0}: {1}", path, posix_strerror()).c_str());
     }
 }
 
-mapped_file::~mapped_file() { munmap(_data, _size); }
+mapped_file::~mapped_file() {
+    if (_data) {
+        munmap(_data, _size);
+    }
+}
 
 mapped_file::fd::fd(const pn::string& path) : no{::open(path.c_str(), O_RDONLY)} {
     if (no < 0) {
@@ -46,4 +66,241 @@ mapped_file::fd::~fd() {
     }
 }
 
+streamed_file::streamed_file(pn::string_view path)
+        : _path(path.copy()), _fd{::open(_path.c_str(), O_RDONLY)}, _owned{true} {
+    if (_fd < 0) {
+        throw std::runtime_error(pn::format("{0}: {1}", path, posix_strerror()).c_str());
+    }
+    init();
+}
+
+streamed_file::streamed_file(int fd, pn::string_view name)
+        : _path(name.copy()), _fd{fd}, _owned{false} {
+    init();
+}
+
+void streamed_file::init() {
+    struct stat st;
+    if (fstat(_fd, &st) < 0) {
+        const int error = errno;
+        if (_owned) {
+            close(_fd);
+        }
+        throw std::runtime_error(pn::format("{0}: {1}", _path, posix_strerror(error)).c_str());
+    }
+    if (S_ISDIR(st.st_mode)) {
+        if (_owned) {
+            close(_fd);
+        }
+        throw std::runtime_error(pn::format("{0}: {1}", _path, posix_strerror(EISDIR)).c_str());
+    }
+    _regular = S_ISREG(st.st_mode);
+    _size    = _regular ? st.st_size : 0;
+#if defined(POSIX_FADV_SEQUENTIAL) && !defined(__APPLE__)
+    // Only advice; pipes and some file systems reject it, which is fine.
+    posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+streamed_file::~streamed_file() {
+    if (_owned) {
+        close(_fd);
+    }
+}
+
+size_t streamed_file::read(uint8_t* data, size_t size) {
+    while (true) {
+        const ssize_t n = ::read(_fd, data, size);
+        if (n >= 0) {
+            return n;
+        } else if (errno != EINTR) {
+            throw std::runtime_error(pn::format("{0}: {1}", _path, posix_strerror()).c_str());
+        }
+    }
+}
+
+void streamed_file::seek(uint64_t offset) {
+    if (lseek(_fd, offset, SEEK_SET) < 0) {
+        throw std::runtime_error(pn::format("{0}: {1}", _path, posix_strerror()).c_str());
+    }
+}
+
+#ifdef __linux__
+
+namespace {
+
+// The most to splice at once, and the size requested for the pipe it goes through.
+const size_t kSpliceSize = 1 << 20;
+
+struct closer {
+    int fd;
+    ~closer() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+}  // namespace
+
+kernel_hasher::kernel_hasher(const char* algorithm) : _socket{-1} {
+    const int s = socket(AF_ALG, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (s < 0) {
+        return;
+    }
+    sockaddr_alg addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.salg_family = AF_ALG;
+    strncpy(reinterpret_cast<char*>(addr.salg_type), "hash", sizeof(addr.salg_type) - 1);
+    strncpy(reinterpret_cast<char*>(addr.salg_name), algorithm, sizeof(addr.salg_name) - 1);
+    if (bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(s);
+        return;
+    }
+    _socket = s;
+}
+
+kernel_hasher::~kernel_hasher() {
+    if (_socket >= 0) {
+        close(_socket);
+    }
+}
+
+// The file is spliced into a pipe, and from the pipe to the socket, with SPLICE_F_MORE, so that
+// the kernel continues the same digest across splices.  An empty send() then finishes it.
+bool kernel_hasher::digest(streamed_file& file, uint8_t* digest, size_t size) {
+    if (_socket < 0) {
+        return false;
+    }
+    closer op{accept4(_socket, nullptr, nullptr, SOCK_CLOEXEC)};
+    int    pipe_fds[2];
+    if ((op.fd < 0) || (pipe2(pipe_fds, O_CLOEXEC) < 0)) {
+        return false;
+    }
+    closer in{pipe_fds[0]}, out{pipe_fds[1]};
+    fcntl(out.fd, F_SETPIPE_SZ, static_cast<int>(kSpliceSize));  // Only advice.
+
+    // Regular files are spliced from an explicit offset, which is moved past what was hashed at
+    // the end, as if the file had been read.
+    loff_t        offset = file._regular ? lseek(file._fd, 0, SEEK_CUR) : 0;
+    loff_t* const from   = (file._regular && (offset >= 0)) ? &offset : nullptr;
+    bool          started = false;
+    while (true) {
+        const ssize_t n = splice(file._fd, from, out.fd, nullptr, kSpliceSize, SPLICE_F_MORE);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (!started && (errno == EINVAL)) {
+                return false;  // The file system or device can't be spliced from.
+            }
+            throw std::runtime_error(pn::format("{0}: {1}", file._path, posix_strerror()).c_str());
+        } else if (n == 0) {
+            break;
+        }
+        started = true;
+        for (ssize_t left = n; left > 0;) {
+            const ssize_t m = splice(in.fd, nullptr, op.fd, nullptr, left, SPLICE_F_MORE);
+            if ((m < 0) && (errno == EINTR)) {
+                continue;
+            } else if (m <= 0) {
+                throw std::runtime_error(
+                        pn::format("{0}: {1}", file._path, posix_strerror()).c_str());
+            }
+            left -= m;
+        }
+    }
+
+    if ((send(op.fd, nullptr, 0, 0) < 0) ||
+        (read(op.fd, digest, size) != static_cast<ssize_t>(size))) {
+        throw std::runtime_error(pn::format("{0}: {1}", file._path, posix_strerror()).c_str());
+    }
+    if (from) {
+        lseek(file._fd, offset, SEEK_SET);
+    }
+    return true;
+}
+
+memory_file::memory_file(pn::data_view data) : _fd{memfd_create("sfz", MFD_CLOEXEC)} {
+    if (_fd < 0) {
+        throw std::runtime_error(pn::format("memfd_create: {0}", posix_strerror()).c_str());
+    }
+    closer fd{_fd};
+    for (int i = 0; i < data.size();) {
+        const ssize_t n = write(_fd, data.data() + i, data.size() - i);
+        if ((n < 0) && (errno == EINTR)) {
+            continue;
+        } else if (n <= 0) {
+            throw std::runtime_error(pn::format("memfd: {0}", posix_strerror()).c_str());
+        }
+        i += n;
+    }
+    if (lseek(_fd, 0, SEEK_SET) < 0) {
+        throw std::runtime_error(pn::format("memfd: {0}", posix_strerror()).c_str());
+    }
+    fd.fd = -1;  // Now owned by this object.
+}
+
+#else
+
+memory_file::memory_file(pn::data_view data) : _fd{-1} {
+    static_cast<void>(data);
+    throw std::runtime_error("memory files are not supported");
+}
+
+kernel_hasher::kernel_hasher(const char* algorithm) : _socket{-1} {
+    static_cast<void>(algorithm);
+}
+
+kernel_hasher::~kernel_hasher() {}
+
+bool kernel_hasher::digest(streamed_file& file, uint8_t* digest, size_t size) {
+    static_cast<void>(file);
+    static_cast<void>(digest);
+    static_cast<void>(size);
+    return false;
+}
+
+#endif  // __linux__
+
+memory_file::~memory_file() { close(_fd); }
+
+shared_mapped_file::shared_mapped_file(
+        pn::string_view path, size_t size, void (*init)(uint8_t* data, size_t size))
+        : _path(path.copy()), _fd(_path) {
+    if (flock(_fd.no, LOCK_EX) < 0) {
+        throw std::runtime_error(pn::format("{0}: {1}", path, posix_strerror()).c_str());
+    }
+    struct stat st;
+    if (fstat(_fd.no, &st) < 0) {
+        throw std::runtime_error(pn::format("{0}: {1}", path, posix_strerror()).c_str());
+    }
+    const bool created = (st.st_size == 0);
+    if (created && (ftruncate(_fd.no, size) < 0)) {
+        throw std::runtime_error(pn::format("{0}: {1}", path, posix_strerror()).c_str());
+    }
+    _size = created ? size : st.st_size;
+    _data = reinterpret_cast<uint8_t*>(
+            mmap(NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd.no, 0));
+    if (_data == MAP_FAILED) {
+        throw std::runtime_error(pn::format("{0}: {1}", path, posix_strerror()).c_str());
+    }
+    init(_data, _size);
+    flock(_fd.no, LOCK_UN);
+}
+
+shared_mapped_file::~shared_mapped_file() { munmap(_data, _size); }
+
+shared_mapped_file::fd::fd(const pn::string& path)
+        : no{::open(path.c_str(), O_RDWR | O_CREAT, 0644)} {
+    if (no < 0) {
+        throw std::runtime_error(pn::format("{0}: {1}", path, posix_strerror()).c_str());
+    }
+}
+
+shared_mapped_file::fd::~fd() {
+    if (no >= 0) {
+        close(no);
+    }
+}
+
 }  // namespace sfz
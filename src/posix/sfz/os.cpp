@@ -25,17 +25,17 @@ const static pn::rune sep{'/'};
 
 bool exists(pn::string_view path) {
     Stat st;
-    return (stat(path.copy().c_str(), &st) == 0);
+    return (::stat(path.copy().c_str(), &st) == 0);
 }
 
 bool isdir(pn::string_view path) {
     Stat st;
-    return (stat(path.copy().c_str(), &st) == 0) && ((st.st_mode & S_IFMT) == S_IFDIR);
+    return (::stat(path.copy().c_str(), &st) == 0) && ((st.st_mode & S_IFMT) == S_IFDIR);
 }
 
 bool isfile(pn::string_view path) {
     Stat st;
-    return (stat(path.copy().c_str(), &st) == 0) && ((st.st_mode & S_IFMT) == S_IFREG);
+    return (::stat(path.copy().c_str(), &st) == 0) && ((st.st_mode & S_IFMT) == S_IFREG);
 }
 
 bool islink(pn::string_view path) {
@@ -126,6 +126,14 @@ void symlink(pn::string_view content, pn::string_view container) {
     }
 }
 
+Stat stat(pn::string_view path) {
+    Stat st;
+    if (::stat(path.copy().c_str(), &st) != 0) {
+        throw std::runtime_error(pn::format("stat: {0}: {1}", path, posix_strerror()).c_str());
+    }
+    return st;
+}
+
 void mkdir(pn::string_view path, mode_t mode) {
     if (::mkdir(path.copy().c_str(), mode) != 0) {
         throw std::runtime_error(pn::format("mkdir: {0}: {1}", path, posix_strerror()).c_str());
@@ -226,7 +234,7 @@ scandir_container::iterator& scandir_container::iterator::operator++() {
         return ++*this;
     }
     _entry.name = name.copy();
-    if (stat(path::join(_dir, name).c_str(), &_entry.st) != 0) {
+    if (::stat(path::join(_dir, name).c_str(), &_entry.st) != 0) {
         throw std::runtime_error(pn::format("scandir: {0}: {1}", name, posix_strerror()).c_str());
     }
     return *this;
@@ -9,8 +9,10 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <io.h>
 #include <memoryapi.h>
 #include <stdio.h>
+#include <algorithm>
 #include <pn/output>
 #include <sfz/error.hpp>
 #include <stdexcept>
@@ -66,4 +68,118 @@ mapped_file::view_of_file::~view_of_file() {
     }
 }
 
+streamed_file::streamed_file(pn::string_view path)
+        : _path{path.copy()},
+          _h{CreateFileW(
+                  _path.copy().cpp_wstr().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr)},
+          _owned{true} {
+    if (_h == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error(pn::format("{0}: {1}", path, win_strerror()).c_str());
+    }
+    init();
+}
+
+streamed_file::streamed_file(int fd, pn::string_view name)
+        : _path{name.copy()}, _h{reinterpret_cast<HANDLE>(_get_osfhandle(fd))}, _owned{false} {
+    if (_h == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error(pn::format("{0}: {1}", name, posix_strerror(EBADF)).c_str());
+    }
+    init();
+}
+
+void streamed_file::init() {
+    _regular = (GetFileType(_h) == FILE_TYPE_DISK);
+    _size    = 0;
+    if (_regular) {
+        try {
+            _size = file_size(_path, _h);
+        } catch (...) {
+            if (_owned) {
+                CloseHandle(_h);
+            }
+            throw;
+        }
+    }
+}
+
+streamed_file::~streamed_file() {
+    if (_owned) {
+        CloseHandle(_h);
+    }
+}
+
+size_t streamed_file::read(uint8_t* data, size_t size) {
+    DWORD n = 0;
+    if (!ReadFile(_h, data, static_cast<DWORD>(std::min<size_t>(size, MAXDWORD)), &n, nullptr)) {
+        // The write end of a pipe being closed is the end of the file.
+        if (GetLastError() == ERROR_BROKEN_PIPE) {
+            return 0;
+        }
+        throw std::runtime_error(pn::format("{0}: {1}", _path, win_strerror()).c_str());
+    }
+    return n;
+}
+
+void streamed_file::seek(uint64_t offset) {
+    LARGE_INTEGER distance;
+    distance.QuadPart = offset;
+    if (!SetFilePointerEx(_h, distance, nullptr, FILE_BEGIN)) {
+        throw std::runtime_error(pn::format("{0}: {1}", _path, win_strerror()).c_str());
+    }
+}
+
+shared_mapped_file::shared_mapped_file(
+        pn::string_view path, size_t size, void (*init)(uint8_t* data, size_t size))
+        : _path{path.copy()},
+          _file{_path, CreateFileW(
+                               _path.copy().cpp_wstr().c_str(), GENERIC_READ | GENERIC_WRITE,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, 0,
+                               nullptr)},
+          _size{lock_and_size(_path, _file.h, size)},
+          _file_mapping{_path, CreateFileMappingW(
+                                       _file.h, NULL, PAGE_READWRITE,
+                                       static_cast<DWORD>(static_cast<uint64_t>(_size) >> 32),
+                                       static_cast<DWORD>(_size), NULL)},
+          _view_of_file{_path, MapViewOfFile(_file_mapping.h, FILE_MAP_ALL_ACCESS, 0, 0, _size)} {
+    init(data(), _size);
+    OVERLAPPED overlapped = {};
+    UnlockFileEx(_file.h, 0, MAXDWORD, MAXDWORD, &overlapped);
+}
+
+shared_mapped_file::~shared_mapped_file() {}
+
+size_t shared_mapped_file::lock_and_size(pn::string_view path, HANDLE h, size_t size) {
+    OVERLAPPED overlapped = {};
+    if (!LockFileEx(h, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped)) {
+        throw std::runtime_error(pn::format("{0}: {1}", path, win_strerror()).c_str());
+    }
+    const LONGLONG existing = file_size(path, h);
+    return (existing == 0) ? size : existing;
+}
+
+shared_mapped_file::handle::handle(pn::string_view path, HANDLE handle) : h{handle} {
+    if ((h == INVALID_HANDLE_VALUE) || (h == NULL)) {
+        throw std::runtime_error(pn::format("{0}: {1}", path, win_strerror()).c_str());
+    }
+}
+
+shared_mapped_file::handle::~handle() {
+    if ((h != INVALID_HANDLE_VALUE) && (h != NULL)) {
+        CloseHandle(h);
+    }
+}
+
+shared_mapped_file::view_of_file::view_of_file(pn::string_view path, LPVOID p) : ptr{p} {
+    if (ptr == NULL) {
+        throw std::runtime_error(pn::format("{0}: {1}", path, win_strerror()).c_str());
+    }
+}
+
+shared_mapped_file::view_of_file::~view_of_file() {
+    if (ptr != NULL) {
+        UnmapViewOfFile(ptr);
+    }
+}
+
 }  // namespace sfz
@@ -224,6 +224,14 @@ void mkdir(pn::string_view path, mkdir_mode_t mode) {
     }
 }
 
+Stat stat(pn::string_view path) {
+    Stat st;
+    if (_wstat(path.copy().cpp_wstr().c_str(), &st) < 0) {
+        throw std::runtime_error(pn::format("stat: {0}: {1}", path, posix_strerror()).c_str());
+    }
+    return st;
+}
+
 void mkfifo(pn::string_view path, mkdir_mode_t mode) {
     static_cast<void>(mode);
     throw std::runtime_error(pn::format("mkfifo: {0}: not supported", path).c_str());